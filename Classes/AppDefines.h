@@ -19,6 +19,9 @@
 #define ENABLE_FPS
 #define ENABLE_POLY_COUNT
 
+// Enable this to print which images were loaded during startup, how, and when they were first used.
+//#define ENABLE_IMAGE_TRACE
+
 // Enable this to rendering every physics frame, enabling all frames to be visible, but time-innaccurate.
 #define ENABLE_PHYSICS_FRAMES_ALL
 
@@ -26,6 +29,10 @@
 //#define ENABLE_PHYSICS_DEBUG
 //#define ENABLE_PARTICLE_DEBUG
 //#define ENABLE_SPRITE_DEBUG
+//#define ENABLE_PARTICLE_BENCHMARK
+//#define ENABLE_IMAGE_DECODE_BENCHMARK
+//#define ENABLE_XML_PARSE_BENCHMARK
+//#define ENABLE_SYSTEM_TESTS
 
 //#define ENABLE_MENU_SYSTEM
 #define ENABLE_IMAGELOADER_SYSTEM
@@ -88,6 +88,16 @@ static const uint32 image_pack_title[] =
 };
 
 static const uint32 image_pack_main[] = 
+{
+	FILE_ID_IMAGE_REWIND,
+	FILE_ID_IMAGE_RESTART,
+	FILE_ID_IMAGE_MENU,
+	FILE_ID_IMAGE_PAUSE,
+	FILE_ID_IMAGE_RESUME,
+};
+
+// Only a few particle images are used by any one particle mode, so these are loaded lazily when first used.
+static const uint32 image_pack_main_particles[] = 
 {
 	FILE_ID_IMAGE_PARTICLE,
 	FILE_ID_IMAGE_PARTICLE_SMALL,
@@ -98,11 +108,6 @@ static const uint32 image_pack_main[] =
 	FILE_ID_IMAGE_PARTICLE_YELLOW_SPARKLE,
 	FILE_ID_IMAGE_PARTICLE_BLUE_SPARKLE,
 	FILE_ID_IMAGE_PARTICLE_DROPLET,
-	FILE_ID_IMAGE_REWIND,
-	FILE_ID_IMAGE_RESTART,
-	FILE_ID_IMAGE_MENU,
-	FILE_ID_IMAGE_PAUSE,
-	FILE_ID_IMAGE_RESUME,
 };
 
 static const uint32 image_pack_unittest[] = 
@@ -11,6 +11,7 @@
 #define __MAINSCREEN_H__
 
 #include "ParticleSystem.h"
+#include "ParticleEffectLibrary.h"
 #include "Camera.h"
 #include "physics_types.h"
 #include "BasicInterface.h"
@@ -51,6 +52,9 @@ static const int RESUME_WAIT_TIME = 1000;
 
 static const int NUM_GRAV_WELLS = 2;
 
+// The particle budget priority of the main screen particles. They are the only particles on screen, so any priority would do.
+static const int PARTICLE_BUDGET_PRIORITY = 1;
+
 // The height amount to adjust the glview when opening the modal view.
 static const int GL_TO_MODAL_Y_OFFSET = 44 + 190;
 
@@ -104,6 +108,7 @@ typedef struct particleData
 	int mode;						// The id of the current particle mode.
 	const char* name;				// The name displayed on the screen to indicate the current particle mode.
 	int num_masses;					// Used for adjusting particle properties.
+	const char* effect_name;		// The name of the effect in the effect library that holds the mode.
 } particleData;
 
 
@@ -170,6 +175,9 @@ public:
 	void resume(bool shouldWait = FALSE);
 	
 private:
+	// Loads the given mode from the effect library. Returns FALSE if the library does not have it.
+	BOOL setLibraryMode(int mode);
+	
 	// Visible bg color.
 	color _bg_color;
 	
@@ -208,6 +216,9 @@ private:
 	particleData _particle_mode;
 	
 	CParticleSystem _particle_sys;
+	
+	// The compiled effects of every mode.
+	CParticleEffectLibrary _effect_library;
 	POGravWell _grav_wells[NUM_GRAV_WELLS];
 	CCamera _camera;
 	
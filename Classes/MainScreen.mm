@@ -12,6 +12,8 @@
 #import "Engine.h"
 #import "MainScreen.h"
 #import "Graphics.h"
+#import "SpriteBatch.h"
+#import "ParticleBudget.h"
 #import "Image.h"
 #import "ImageLoader.h"
 #import "AppDefines.h"
@@ -26,21 +28,21 @@
 // Particle mode data.
 const particleData mode_data[eParticleDispMode_MAX] =
 {
-	{ 	eParticleDispMode_burst, "Burst", 1 },
-	{	eParticleDispMode_3Dburst, "3D Burst", 1 },
-	{	eParticleDispMode_sparkle, "Sparkle", 1 },
-	{	eParticleDispMode_fireworks, "Fireworks", 1 },
-	{	eParticleDispMode_water, "Water", 1 },
-	{	eParticleDispMode_fire, "Fire", 1 },
-	{	eParticleDispMode_firesmoke, "Fire and Smoke", 2 },
-	{	eParticleDispMode_flames, "Flame Bursts", 10 },
-	{	eParticleDispMode_sun, "Fireball", 1 },
-	{	eParticleDispMode_smoketrail, "Smoke Trail", 2 },
-	{	eParticleDispMode_radar, "Circle", 1 },
-	{	eParticleDispMode_gravwell, "Orbit", 1 },
-	{	eParticleDispMode_bigbang, "Explosion", 1 },
-	{	eParticleDispMode_laser, "Strands", 1 },
-	{	eParticleDispMode_snow, "Snow", 1 },
+	{ 	eParticleDispMode_burst, "Burst", 1, "burst" },
+	{	eParticleDispMode_3Dburst, "3D Burst", 1, "3d_burst" },
+	{	eParticleDispMode_sparkle, "Sparkle", 1, "sparkle" },
+	{	eParticleDispMode_fireworks, "Fireworks", 1, "fireworks" },
+	{	eParticleDispMode_water, "Water", 1, "water" },
+	{	eParticleDispMode_fire, "Fire", 1, "fire" },
+	{	eParticleDispMode_firesmoke, "Fire and Smoke", 2, "fire_smoke" },
+	{	eParticleDispMode_flames, "Flame Bursts", 10, "flames" },
+	{	eParticleDispMode_sun, "Fireball", 1, "sun" },
+	{	eParticleDispMode_smoketrail, "Smoke Trail", 2, "smoke_trail" },
+	{	eParticleDispMode_radar, "Circle", 1, "radar" },
+	{	eParticleDispMode_gravwell, "Orbit", 1, "grav_well" },
+	{	eParticleDispMode_bigbang, "Explosion", 1, "big_bang" },
+	{	eParticleDispMode_laser, "Strands", 1, "laser" },
+	{	eParticleDispMode_snow, "Snow", 1, "snow" },
 };
 
 // This is used for the particle image label when switching particle images.
@@ -117,6 +119,15 @@ void CMainScreen::init()
 	_text_fade_counter = TEXT_FADE_TIME;
 	
 	GET_IMGLOADER->loadImagePack(image_pack_main, (int)(sizeof(image_pack_main) / sizeof(uint32)));
+	GET_IMGLOADER->loadImagePackLazy(image_pack_main_particles, (int)(sizeof(image_pack_main_particles) / sizeof(uint32)), TRUE);
+	
+	// Every mode of the screen comes from the effect library, which the "Compile Effects" build phase compiles into the bundle from res/effects/effects.pfxt.
+	NSString* effect_path = [[NSBundle mainBundle] pathForResource:@"effects" ofType:@PARTICLE_EFFECT_EXTENSION];
+	
+	if (effect_path != nil)
+	{
+		_effect_library.load([effect_path UTF8String]);
+	}
 	
 	_particle_sys.setIsRunning(TRUE);
 
@@ -202,7 +213,9 @@ void CMainScreen::init()
 void CMainScreen::destroy()
 {
 	GET_IMGLOADER->unloadImagePack();
+	GET_PARTICLE_BUDGET->unregisterSystem(&_particle_sys);
 	_particle_sys.destroy();
+	_effect_library.unload();
 	_rewind_sprite.destroy();
 	_restart_sprite.destroy();
 	_menu_sprite.destroy();
@@ -218,221 +231,21 @@ void CMainScreen::setMode(int mode, bool reset_props)
 	
 	_particle_sys.destroy();
 	
-	switch (mode) 
+	if (!setLibraryMode(mode))
 	{
-		case eParticleDispMode_burst:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(1, 800);
-			_particle_sys.recenterMass(0, 160, 240);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeBurst]);
-			_particle_sys.setDrawCenter(0, FALSE);
-		}
-			break;
-				
-		case eParticleDispMode_3Dburst:
-		{
-			_camera.init();
-			
-			_particle_sys.init(1, 800);
-			_particle_sys.recenterMass(0, 160, 240, -5);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeBurst]);
-			_particle_sys.setDrawCenter(0, FALSE);
-			_particle_sys.setEnable3D(0, TRUE);
-			
-		}
-			break;
-			
-		case eParticleDispMode_sparkle:
-		{
-			_camera.init();
-			
-			_particle_sys.init(1, 500);
-			_particle_sys.recenterMass(0, 160, 240, -10);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeScreenSparkler]);
-			_particle_sys.setDrawCenter(0, FALSE);			
-		}
-			break;
-			
-		case eParticleDispMode_fireworks:
-		{
-			_particle_sys.init(1, 200);
-			_particle_sys.recenterMass(0, 240, 160);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeFireworks]);
-			_particle_sys.setDrawCenter(0, FALSE);
-		}
-			break;
-			
-		case eParticleDispMode_water:
-		{
-			_particle_sys.init(1, 300);
-			_particle_sys.recenterMass(0, 160, 160);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeFall]);
-			_particle_sys.setDrawCenter(0, FALSE);
-		}
-			break;
-			
-		case eParticleDispMode_fire:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(1, 200);
-			_particle_sys.recenterMass(0, 160, 240);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeFire]);
-			_particle_sys.setDrawCenter(0, TRUE);
-		}
-			break;
-			
-		case eParticleDispMode_firesmoke:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(2, 200);
-			_particle_sys.recenterMass(0, 160, 300);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeSteam]);
-			_particle_sys.setDrawCenter(0, FALSE);
-			
-			_particle_sys.recenterMass(1, 160, 300);
-			_particle_sys.setMassActive(1, TRUE);
-			_particle_sys.setMode(1, particle_mode_props[eParticleModeFire]);
-			_particle_sys.setDrawCenter(1, TRUE);
-		}
-			break;
-			
-		case eParticleDispMode_flames:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(10, 50);
-			
-			int xPos = 60;
-			for (int i = 0; i < 10; ++i)
-			{
-				_particle_sys.recenterMass(i, xPos, 300);
-				_particle_sys.setMassActive(i, TRUE);
-				_particle_sys.setMode(i, particle_mode_props[eParticleModeFire]);
-				_particle_sys.setDrawCenter(i, TRUE);
-				
-				xPos += 20;
-			}
-		}
-			break;
-			
-		case eParticleDispMode_sun:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(1, 500);
-			_particle_sys.recenterMass(0, 160, 240);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeSun]);
-			_particle_sys.setDrawCenter(0, TRUE);
-		}
-			break;
-			
-		case eParticleDispMode_smoketrail:
-		{
-			_camera.reset();
-	
-			// Init 2 masses of particles, resulting in 2 smoke trails.
-			_particle_sys.init(2, 100);
-			// Center at bottom left corner of the screen.
-			_particle_sys.recenterMass(0, 0, 480);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeSmokeTrail]);
-			// The trail will travel right and up so we place a positive x impulse and a negative y impulse.
-			_particle_sys.applyImpulse(0, 12, -25);
-			_particle_sys.setDrawCenter(0, FALSE);
-			// Don't release more than one set of particles since the trail moves off screen.
-			_particle_sys.setLoopCount(0, 1);
-			
-			_particle_sys.recenterMass(1, 40, 480);
-			_particle_sys.setMassActive(1, TRUE);
-			_particle_sys.setMode(1, particle_mode_props[eParticleModeSmokeTrail]);
-			_particle_sys.applyImpulse(1, 12, -25);
-			_particle_sys.setDrawCenter(1, FALSE);
-			// Don't release more than one set of particles since the trail moves off screen.
-			_particle_sys.setLoopCount(1, 1);
-		}
-			break;
-			
-		case eParticleDispMode_radar:	
-		{
-			_camera.reset();
-
-			_particle_sys.init(1, 200);
-			_particle_sys.recenterMass(0, 160, 240);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeCircle]);
-			_particle_sys.setDrawCenter(0, FALSE);
-		}
-			break;
-			
-		case eParticleDispMode_gravwell:
-		{
-			_camera.init();
-			
-			_particle_sys.init(1, 200);
-			_particle_sys.recenterMass(0, 160, 240, 0);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeShooter]);
-			_particle_sys.setDrawCenter(0, TRUE);
-			_particle_sys.setEnable3D(0, TRUE);
-			_particle_sys.setStrandLength(0, 5);
-		}
-			break;
-			
-		case eParticleDispMode_bigbang:
-		{
-			_camera.init();
-			
-			_particle_sys.init(1, 2000);
-			_particle_sys.recenterMass(0, 160, 240, 0);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeBigBang]);
-			_particle_sys.setDrawCenter(0, TRUE);
-			_particle_sys.setEnable3D(0, TRUE);
-		}
-			break;
-			
-		case eParticleDispMode_laser:
-		{
-			_camera.init();
-			
-			_particle_sys.init(1, 3);
-			_particle_sys.recenterMass(0, 160, 240, 0);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeShooter]);
-			_particle_sys.setDrawCenter(0, FALSE);
-			_particle_sys.setEnable3D(0, TRUE);
-			_particle_sys.setStrandLength(0, 2000);
-		}
-			break;
-			
-		case eParticleDispMode_snow:
-		{
-			_camera.reset();
-			
-			_particle_sys.init(1, 2000);
-			_particle_sys.recenterMass(0, 400, -50);
-			_particle_sys.setMassActive(0, TRUE);
-			_particle_sys.setMode(0, particle_mode_props[eParticleModeSnow]);
-			_particle_sys.setDrawCenter(0, FALSE);
-			_particle_sys.setEnable3D(0, FALSE);
-		}
-			
-		default:
-			break;
+		DPRINT_PARTICLESYS("CMainScreen::setMode failed: the effect library has no effect %s \n", mode_data[mode].effect_name);
+	}
+	
+	// Every mode sizes its masses differently, so the budget is told how many particles this one wants.
+	int desired_particles = 0;
+	
+	for (int i = 0; i < _particle_sys.getNumMasses(); ++i)
+	{
+		desired_particles += _particle_sys.getNumParticles(i);
 	}
 	
+	GET_PARTICLE_BUDGET->registerSystem(&_particle_sys, PARTICLE_BUDGET_PRIORITY, desired_particles);
+	
 	_particle_mode.mode = mode_data[mode].mode;
 	_particle_mode.name = mode_data[mode].name;
 	
@@ -443,6 +256,29 @@ void CMainScreen::setMode(int mode, bool reset_props)
 //	}
 }
 
+BOOL CMainScreen::setLibraryMode(int mode)
+{
+	size_t effect_size = 0;
+	const void* effect = _effect_library.getEffect(_effect_library.findEffect(mode_data[mode].effect_name), &effect_size);
+	const particleEffectHeader* header = getParticleEffectHeader(effect, effect_size);
+	
+	if (!header)
+	{
+		return FALSE;
+	}
+	
+	if (header->camera == eParticleEffectCameraReset)
+	{
+		_camera.reset();
+	}
+	else if (header->camera == eParticleEffectCameraInit)
+	{
+		_camera.init();
+	}
+	
+	return _particle_sys.loadEffect(effect, effect_size);
+}
+
 void CMainScreen::update()
 {
 	// Camera is always updated no matter what.
@@ -514,7 +350,7 @@ void CMainScreen::update()
 		{
 			for (int j = 0; j < NUM_GRAV_WELLS; ++j)
 			{
-				CPhysics::updateGravWell(&_grav_wells[j], &_particle_sys.getMass(0).particles[i].phys, _particle_sys.getMass(0).center.props.frame_skip);
+				CPhysics::updateGravWell(&_grav_wells[j], &_particle_sys.getMass(0).particles[i].phys, _particle_sys.getMass(0).props->frame_skip);
 			}
 		}
 	}
@@ -583,6 +419,9 @@ void CMainScreen::draw()
 	_camera.reset();
 	set2Dview();
 	
+	// Collect all of the text so that it is drawn in one go.
+	GET_FONT->beginBatch();
+	
 	// Draw left and right arrows.
 	GET_FONT->drawString(eFontCalibriBold_24x24, "<", _left_arrow_rect.x, _left_arrow_rect.y, _text_alpha);
 	GET_FONT->drawString(eFontCalibriBold_24x24, ">", _right_arrow_rect.x, _right_arrow_rect.y, _text_alpha);
@@ -623,6 +462,11 @@ void CMainScreen::draw()
 	
 #endif
 	
+	GET_FONT->endBatch();
+	
+	// The buttons are drawn together.
+	GET_SPRITE_BATCH->begin();
+	
 	if (_particle_mode.mode == eParticleDispMode_bigbang)
 	{
 		_rewind_sprite.setAlpha(_text_alpha);
@@ -651,7 +495,8 @@ void CMainScreen::draw()
 		// Draw resume button.
 		CGraphics::drawSprite(_resume_sprite);
 	}
-
+	
+	GET_SPRITE_BATCH->end();
 }
 
 void CMainScreen::handleTouch(float x, float y, eTouchPhase phase)
@@ -54,7 +54,7 @@ void CSplashScreen::init()
 
 void CSplashScreen::destroy()
 {
-	GET_IMGLOADER->unloadImagePack();
+	GET_IMGLOADER->unloadImagePack(image_pack_splash, (int)(sizeof(image_pack_splash) / sizeof(uint32)));
 }
 
 void CSplashScreen::update()
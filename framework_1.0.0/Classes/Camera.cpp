@@ -8,15 +8,19 @@
  */
 
 #include "string.h"
+#include <math.h>
 #include "Utils.h"
 #include "SystemDefines.h"
 #include "Camera.h"
 #include "MathUtil.h"
+#include "RotationQuaternion.h"
+#include "RotationTranslationMatrix.h"
 
 void CCamera::init()
 {
 	memset(&_pos, 0, sizeof(float) * 3);
-	memset(&_view_mat, 0, sizeof(float) * 16);
+	_view_mat.identity();
+	_is_dirty = TRUE;
 	_touch_pos_prev = Vector3(0.0f, 0.0f, 0.0f);
 	_touch_dist = Vector3(0.0f, 0.0f, 0.0f);
 	_mult_touch_dist_prev = 0;
@@ -43,42 +47,55 @@ void CCamera::reset()
 
 
 void CCamera::update()
-{			
-	
-	glLoadIdentity();
-	
-	_pos[0] += _touch_dist.x;
-	_pos[1] += _touch_dist.y;
-	_pos[2] += _touch_dist.z;
-	
-	// Don't let z go negative.
-	if (_pos[2] < CAMERA_ZOOM_LIMIT)
+{
+	// Only touch input moves the camera, so there is nothing to rebuild until a touch has moved it.
+	if ((_touch_dist.x != 0.0f) || (_touch_dist.y != 0.0f) || (_touch_dist.z != 0.0f))
 	{
-		_pos[2] = CAMERA_ZOOM_LIMIT;
+		_pos[0] += _touch_dist.x;
+		_pos[1] += _touch_dist.y;
+		_pos[2] += _touch_dist.z;
+		
+		// Don't let z go negative.
+		if (_pos[2] < CAMERA_ZOOM_LIMIT)
+		{
+			_pos[2] = CAMERA_ZOOM_LIMIT;
+		}
+		
+		_touch_dist.zero();
+		_is_dirty = TRUE;
 	}
 	
-	gluLookAt(0, 0, _pos[2],
-			  0, 0, 0,
-			  0, 1, 0);
-	
-	
-	//glTranslatef(0, 0, _touch_dist.z);
-	glRotatef(_pos[1], 1, 0, 0);
-	glRotatef(_pos[0], 0, 1, 0);
+	if (_is_dirty)
+	{
+		buildViewMatrix();
+		_is_dirty = FALSE;
+	}
 	
 	//DPRINT_CAMERA("_pos x:%f y:%f z:%f \n", _pos[0], _pos[1], _pos[2]);
 	
-	
-	_touch_dist.zero();
+	// The modelview matrix may have been changed since the last frame, so always load the view.
+	glLoadMatrixf(_view_mat.m);
+}
+
 
-	// Grab the projection matrix so we can update our world position values.
-	glGetFloatv(GL_MODELVIEW_MATRIX, _view_mat);
+void CCamera::buildViewMatrix()
+{
+	// Equivalent to looking at the origin from (0, 0, z), then calling glRotatef(_pos[1], 1, 0, 0) and glRotatef(_pos[0], 0, 1, 0).
+	RotationQuaternion pitch(DEGREES_TO_RADIANS(_pos[1]), 1.0f, 0.0f, 0.0f);
+	RotationQuaternion yaw(DEGREES_TO_RADIANS(_pos[0]), 0.0f, 1.0f, 0.0f);
+	RotationQuaternion rotation(yaw);
+	rotation *= pitch;
+	
+	RotationTranslationMatrix view(rotation);
+	// Looking down -z at the origin simply moves the world away from the eye.
+	view.SetPos(Vector3(0.0f, 0.0f, -_pos[2]));
+	_view_mat.set(view);
 
 //	DPRINT_CAMERA("===================\n");
-//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat[0], _view_mat[4], _view_mat[8], _view_mat[12]);
-//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat[1], _view_mat[5], _view_mat[9], _view_mat[13]);
-//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat[2], _view_mat[6], _view_mat[10], _view_mat[14]);
-//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat[3], _view_mat[7], _view_mat[11], _view_mat[15]);
+//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat.m[0], _view_mat.m[4], _view_mat.m[8], _view_mat.m[12]);
+//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat.m[1], _view_mat.m[5], _view_mat.m[9], _view_mat.m[13]);
+//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat.m[2], _view_mat.m[6], _view_mat.m[10], _view_mat.m[14]);
+//	DPRINT_CAMERA("viewmat %f %f %f %f \n", _view_mat.m[3], _view_mat.m[7], _view_mat.m[11], _view_mat.m[15]);
 //	DPRINT_CAMERA("===================\n");
 }
 
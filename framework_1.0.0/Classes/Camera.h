@@ -12,6 +12,8 @@
 
 #include "types.h"
 #include "physics_types.h"
+#include "Vector3.h"
+#include "Matrix4X4.h"
 
 // The camera z start position.
 static const int CAMERA_START_Z = 250;
@@ -32,10 +34,12 @@ class CCamera
 public:
 	
 	void init(void);
+	
+	// Applies any pending touch movement and loads the view matrix into the modelview matrix. The view matrix is only rebuilt when the camera has moved.
 	void update(void);
 	
-	// Set camera's world position.
-	float* getViewMatrix(void) {return (float*)_view_mat; }
+	// Returns the view matrix, in the same column-major layout that openGL uses.
+	float* getViewMatrix(void) {return _view_mat.m; }
 	
 	void reset();
 	
@@ -43,8 +47,14 @@ public:
 	void handleMultiTouch(float x1, float y1, eTouchPhase phase1, float x2, float y2, eTouchPhase phase2);
 	
 private:
+	// Rebuilds the view matrix from the camera position.
+	void buildViewMatrix(void);
+	
 	float _pos[3];
-	float _view_mat[16];
+	Matrix4X4 _view_mat;
+	
+	// Set when the camera has moved and the view matrix needs to be rebuilt.
+	BOOL _is_dirty;
 		
 	Vector3 _touch_pos_prev;
 	Vector3 _touch_dist;
@@ -0,0 +1,69 @@
+/*
+ *  CookedTexture.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __COOKEDTEXTURE_H__
+#define __COOKEDTEXTURE_H__
+
+// This header is shared with the texture cook tool, so it must not depend on anything else in the framework.
+
+#define COOKED_TEXTURE_EXTENSION	"ctex"	// Cooked textures are looked up next to the source image, with this extension in place of the image extension.
+
+const unsigned int COOKED_TEXTURE_MAGIC = 0x58455443;	/*!< "CTEX" when read as little endian bytes. */
+const unsigned int COOKED_TEXTURE_VERSION = 1;			/*!< Bumped whenever the layout of the container changes. */
+const int COOKED_TEXTURE_MAX_LEVELS = 12;				/*!< Enough mip levels for a 2048x2048 texture. */
+const int COOKED_TEXTURE_ALIGNMENT = 16;				/*!< Every level payload starts at a multiple of this many bytes from the start of the file. */
+
+/*! \enum eCookedTextureFormat
+ *	\brief The pixel formats that a cooked texture payload can be stored in.
+ */
+typedef enum _eCookedTextureFormat
+{
+	eCookedTextureFormatRGBA8888 = 0,	/*!< 32 bit RGBA, uploaded with glTexImage2D. */
+	eCookedTextureFormatMAX,			/*!< The total number of formats. */
+} eCookedTextureFormat;
+
+/*! \enum eCookedTextureFlags
+ *	\brief Describes how the payload of a cooked texture was prepared.
+ */
+typedef enum _eCookedTextureFlags
+{
+	eCookedTextureFlagPremultiplied = 1 << 0,	/*!< The color channels are already multiplied by alpha. */
+} eCookedTextureFlags;
+
+/*! \struct cookedTextureLevel
+ *	\brief The location and size of one mip level in a cooked texture.
+ */
+typedef struct cookedTextureLevel
+{
+	unsigned int offset;	/*!< The byte offset of the level payload from the start of the file. */
+	unsigned int size;		/*!< The byte size of the level payload. */
+	unsigned int width;		/*!< The pixel width of the level. */
+	unsigned int height;	/*!< The pixel height of the level. */
+} cookedTextureLevel;
+
+/*! \struct cookedTextureHeader
+ *	\brief The header at the start of every cooked texture.
+ *
+ * The level payloads follow the header and are stored exactly as they are uploaded, so the file can be mapped into memory and handed to OpenGL without decoding or copying.
+ * Rows are stored in the same order as images decoded at runtime, so sprites use the same texture coordinates for both.
+ */
+typedef struct cookedTextureHeader
+{
+	unsigned int magic;			/*!< Always #COOKED_TEXTURE_MAGIC. */
+	unsigned int version;		/*!< Always #COOKED_TEXTURE_VERSION. */
+	unsigned int format;		/*!< The payload format, one of #eCookedTextureFormat. */
+	unsigned int flags;			/*!< A combination of #eCookedTextureFlags. */
+	unsigned int width;			/*!< The pixel width of the base level. */
+	unsigned int height;		/*!< The pixel height of the base level. */
+	unsigned int num_levels;	/*!< The number of mip levels, at least one. */
+	unsigned int reserved;		/*!< Keeps the level index aligned. Always zero. */
+	cookedTextureLevel levels[COOKED_TEXTURE_MAX_LEVELS];	/*!< The level index, starting with the base level. */
+} cookedTextureHeader;
+
+
+#endif
@@ -13,6 +13,10 @@
 #include "Utils.h"
 #include "GameData.h"
 #include "Graphics.h"
+#include "SpriteBatch.h"
+#include "ParticleBudget.h"
+#include "QualityController.h"
+#include "FileIO.h"
 
 #if defined (ENABLE_UNITTESTING)
 #include "UnitTests.h"
@@ -62,6 +66,9 @@ void initApp()
 	// We can safely enable the vertex array state here since everything should be drawn using a vertex array.
 	glEnableClientState(GL_VERTEX_ARRAY);
 	
+	// Batched geometry is streamed through these buffers.
+	CGraphics::initStreamBuffers();
+	
 	// Do an initial clear screen so we don't have a flash of white (or whatever).
 	// Clear the drawing buffer.
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -75,6 +82,7 @@ void initApp()
 void destroyApp(void)
 {
 	engine->engineDestroy();
+	CGraphics::destroyStreamBuffers();
 }
 
 
@@ -91,11 +99,13 @@ void CEngine::engineDestroy(void)
 	
 	if (_image_loader)
 	{
-		_image_loader->unloadImagePack();
+		_image_loader->destroy();
 		delete _image_loader;
 		_image_loader = NULL;
 	}
 	
+	FileIO_Destroy();
+	
 	if (_menu_system)
 	{
 		_menu_system->destroy();
@@ -118,6 +128,28 @@ void CEngine::engineDestroy(void)
 		delete _font;
 		_font = NULL;
 	}
+	
+	if (_sprite_batch)
+	{
+		_sprite_batch->destroy();
+		delete _sprite_batch;
+		_sprite_batch = NULL;
+	}
+	
+#if defined (ENABLE_PARTICLESYSTEM)
+	if (_particle_budget)
+	{
+		_particle_budget->destroy();
+		delete _particle_budget;
+		_particle_budget = NULL;
+	}
+	
+	if (_quality_controller)
+	{
+		delete _quality_controller;
+		_quality_controller = NULL;
+	}
+#endif
 }
 
 
@@ -134,7 +166,11 @@ CEngine::~CEngine()
 
 void CEngine::engineInit()
 {	
+	// File reads are serviced by their own threads, and complete during engineUpdate().
+	FileIO_Init(FILEIO_DEFAULT_THREADS);
+	
 	_image_loader = new CImageLoader();
+	_image_loader->init();
 	_menu_system = new CMenuSystem();
 	_menu_system->init();
 	
@@ -146,11 +182,27 @@ void CEngine::engineInit()
 	_font = new CFont();
 	_font->init((const fontLoadInfo**)&fontLoadInfoData, eFontMAX);
 	
+	_sprite_batch = new CSpriteBatch();
+	_sprite_batch->init();
+	
+#if defined (ENABLE_PARTICLESYSTEM)
+	_particle_budget = new CParticleBudget();
+	_particle_budget->init();
+	_quality_controller = new CQualityController();
+	_quality_controller->init();
+#endif
+	
 	_curr_screen_stack_size = -1;
 	
 	_clear_screen_stack = FALSE;
 	_pop_screen = FALSE;
 	
+	// Register the screen image packs so that they start decoding as soon as their screen is queued.
+	memset(_screen_image_packs, 0, sizeof(_screen_image_packs));
+	memset(_screen_image_pack_sizes, 0, sizeof(_screen_image_pack_sizes));
+	setScreenImagePack(eScreenSplash, image_pack_splash, (int)(sizeof(image_pack_splash) / sizeof(uint32)));
+	setScreenImagePack(eScreenMain, image_pack_main, (int)(sizeof(image_pack_main) / sizeof(uint32)));
+	
 	// Always start at the splash screen.
 	queuePushScreen(eScreenSplash);
 	
@@ -183,6 +235,10 @@ void CEngine::engineInit()
 	_poly_count_rect.col.a = 0.5;
 #endif
 	
+#if defined (ENABLE_IMAGE_TRACE)
+	_image_trace_time = 0;
+#endif
+	
 	_is_initialized = TRUE;
 }
 
@@ -200,6 +256,36 @@ void CEngine::engineUpdate()
 		return;
 	}
 	
+	// Start writing this frame's streamed geometry into the next buffer.
+	CGraphics::beginStreamFrame();
+	
+	// Deliver the callbacks of any file reads that completed in the background.
+	FileIO_Update();
+	
+	// Upload the textures of any images that finished decoding in the background.
+	_image_loader->update();
+	
+#if defined (ENABLE_PARTICLESYSTEM)
+	// Hand out this frame's particle quotas from the costs measured last frame.
+	_particle_budget->update();
+	
+	// Step the quality tier from the recent frame times.
+	_quality_controller->update(TIME_LAST_FRAME);
+#endif
+	
+#if defined (ENABLE_IMAGE_TRACE)
+	// Print which images startup actually touched, and when, once startup has settled.
+	if (_image_trace_time < IMAGE_TRACE_TIME)
+	{
+		_image_trace_time += TIME_LAST_FRAME;
+		
+		if (_image_trace_time >= IMAGE_TRACE_TIME)
+		{
+			_image_loader->printImageTrace();
+		}
+	}
+#endif
+	
 	if (_curr_screen_stack_size < 0)
 	{
 		DPRINT_ENGINE("CEngine::engineUpdate error: _curr_screen_stack_size less than zero");
@@ -234,6 +320,11 @@ void CEngine::engineUpdate()
 		pushScreen();
 	}
 		
+#if defined (ENABLE_FPS) || defined (ENABLE_POLY_COUNT)
+	// All of the HUD text goes out in one draw.
+	_font->beginBatch();
+#endif
+	
 #if defined (ENABLE_FPS)
 	set2Dview();
 	// Update frames per second counters until one second has been reached.
@@ -279,8 +370,11 @@ void CEngine::engineUpdate()
 	memset(&polybuf, 0, sizeof(char) * 16);
 	sprintf(polybuf, "POLY COUNT: %d", _poly_count);
 	_font->drawString(eFontBlack8x12, polybuf, 1, _poly_count_rect.y + 1, 1.0);
+	_font->endBatch();
 	// Reset poly count for next frame.
 	_poly_count = 0;
+#elif defined (ENABLE_FPS)
+	_font->endBatch();
 #endif
 }
 
@@ -416,6 +510,19 @@ CBasicInterface* CEngine::createScreen(eScreens screenID)
 	return new_screen;
 }
 
+void CEngine::setScreenImagePack(eScreens screenID, const uint32* imagePack, int numImages)
+{
+	if ((screenID < 0) || (screenID >= eScreenMax))
+	{
+		DPRINT_ENGINE("CEngine::setScreenImagePack failed, invalid screen id");
+		return;
+	}
+	
+	_screen_image_packs[screenID] = imagePack;
+	_screen_image_pack_sizes[screenID] = (imagePack != NULL) ? numImages : 0;
+}
+
+
 void setScreen(CEngine::eScreens screenID)
 {
 	queueClearScreenStack();
@@ -426,6 +533,12 @@ void setScreen(CEngine::eScreens screenID)
 void queuePushScreen(CEngine::eScreens screenID)
 {
 	engine->_next_screen = screenID;
+	
+	// Start decoding the images of the new screen now, so that its loadImagePack call finds them ready.
+	if ((screenID > CEngine::eScreenNone) && (screenID < CEngine::eScreenMax) && (engine->_screen_image_pack_sizes[screenID] > 0))
+	{
+		engine->_image_loader->prefetchImagePack(engine->_screen_image_packs[screenID], engine->_screen_image_pack_sizes[screenID]);
+	}
 }
 
 void queuePopScreen()
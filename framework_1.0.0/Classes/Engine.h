@@ -6,12 +6,16 @@
 #include "types.h"
 
 #define SCREEN_STACK_MAX	8
+#define IMAGE_TRACE_TIME	5000	// The time after startup, in milliseconds, at which the image trace is printed when ENABLE_IMAGE_TRACE is defined.
 
 // Convenience macros for easier access to sub-systems.
 #define GET_FONT		engine->_font
 #define GET_IMGLOADER	engine->_image_loader
 #define GET_MENUSYS		engine->_menu_system
 #define GET_SOUND		engine->_sound_engine
+#define GET_SPRITE_BATCH	engine->_sprite_batch
+#define GET_PARTICLE_BUDGET	engine->_particle_budget
+#define GET_QUALITY		engine->_quality_controller
 
 
 class CBasicInterface;
@@ -20,6 +24,9 @@ class CMenuSystem;
 class CFont;
 class CPhysics;
 class CSoundEngine;
+class CSpriteBatch;
+class CParticleBudget;
+class CQualityController;
 
 
 /*! \class CEngine
@@ -154,6 +161,16 @@ public:
 	 */
 	void popScreen(void);
 	
+	/*! \fn setScreenImagePack(eScreens screenID, const uint32* imagePack, int numImages)
+	 *  \brief Registers the image pack that a screen loads, so that it can be prefetched as soon as the screen is queued.
+	 *  
+	 *	\param screenID The screen type.
+	 *	\param imagePack The array of image IDs, or NULL. The array must stay valid for as long as it is registered.
+	 *	\param numImages The number of images in the image ID array.
+	 *  \return n/a
+	 */
+	void setScreenImagePack(eScreens screenID, const uint32* imagePack, int numImages);
+	
 	/*! \fn getCurrentScreen(void)
 	 *  \brief Returns the current active screen.
 	 *	\param n/a
@@ -165,9 +182,14 @@ public:
 	CBasicInterface* _screen_stack[SCREEN_STACK_MAX];	/*!< The screen stack. The screen can hold up to SCREEN_STACK_MAX screens. */
 	int _curr_screen_stack_size;						/*!< Keeps track of the current active screen and is updated within the push and pop functions. */
 	CImageLoader* _image_loader;						/*!< Instance of the image loader that is used to help organize image loading. */
+	const uint32* _screen_image_packs[eScreenMax];		/*!< The image pack of every screen, which is prefetched when the screen is queued. */
+	int _screen_image_pack_sizes[eScreenMax];			/*!< The number of images in every screen image pack. */
 	CMenuSystem* _menu_system;							/*!< Instance of the menu system. */
 	CFont* _font;										/*!< Instance of the font class, used to draw custom fonts to the screen. */
 	CSoundEngine* _sound_engine;						/*!< Instance of the sound sytem class, used to play sounds. */
+	CSpriteBatch* _sprite_batch;						/*!< Instance of the sprite batch, used to draw many 2D sprites at once. */
+	CParticleBudget* _particle_budget;					/*!< Instance of the particle budget, which shares the frame between the particle systems that register with it. */
+	CQualityController* _quality_controller;			/*!< Instance of the quality controller, which lowers the particle quality when frames run long. */
 	BOOL _clear_screen_stack;							/*!< Indicates that upon the next update completetion, the screen stack must be cleared. */
 	eScreens _next_screen;								/*!< Holds the id to the next screen to be pushed onto the stack. */
 	BOOL _pop_screen;									/*!< Indicates the upon the next update completetion, the active screen will be popped. */
@@ -186,6 +208,9 @@ public:
 	// These are only used when ENABLE_POLY_COUNT is defined.
 	int _poly_count;
 	colorRect _poly_count_rect;
+	
+	// This is only used when ENABLE_IMAGE_TRACE is defined.
+	int _image_trace_time;	// Counts up to IMAGE_TRACE_TIME, after which the startup image trace is printed once.
 };
 
 
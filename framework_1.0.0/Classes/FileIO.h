@@ -6,6 +6,38 @@
 //  Copyright 2009 LlamaFace. All rights reserved.
 //
 
+#ifndef __FILEIO_H__
+#define __FILEIO_H__
+
+#include <stddef.h>
+
+#define FILEIO_MAX_THREADS		4		// The maximum number of I/O worker threads.
+#define FILEIO_DEFAULT_THREADS	2		// The number of I/O worker threads started by the engine.
+#define FILEIO_MAX_FILES		16		// The maximum number of files that can be open at once.
+#define FILEIO_MAX_REQUESTS		64		// The maximum number of requests that can be queued or waiting for their completion at once.
+#define FILEIO_MAX_COALESCE		8		// The maximum number of adjacent reads that are serviced by one system call.
+#define FILEIO_MAX_PATH			1024	// The maximum length of a resolved file path.
+
+
+// The result of a request, as passed to its completion callback.
+typedef enum eFileIOStatus
+{
+	eFileIOStatusOK = 0,		// The request completed.
+	eFileIOStatusError,			// The file could not be opened or read.
+	eFileIOStatusCancelled,		// The request was cancelled before it started. The buffer was not touched.
+} eFileIOStatus;
+
+
+// Called on the engine thread from FileIO_Update() once a request has completed.
+//
+// requestID    : the id returned when the request was started
+// fileHandle   : the file the request was made on
+// status       : an eFileIOStatus value
+// buf          : the buffer given to FileIO_StartRead, or NULL
+// bytesRead    : the number of bytes read into buf, which is less than the requested size at the end of the file
+// data         : the user data given when the request was started
+typedef void (*FileIOCallback)(int requestID, int fileHandle, int status, void* buf, long bytesRead, void* data);
+
 
 // Write to hard drive.  These writes do not go to the hard drive immediately,
 // but are cached in the system.  Reading from written files should not be
@@ -22,24 +54,82 @@
 extern bool FileIO_Write(const char *file_name, void *buf, unsigned long size);
 
 
+// Start the I/O worker threads. Requests can only be started after this.
+// Any previously running worker threads are stopped first.
+//
+// numThreads   : the number of worker threads, clamped to 1 to FILEIO_MAX_THREADS
+extern void FileIO_Init(int numThreads);
+
+
+// Stop and join the I/O worker threads and close every open file.
+// Requests that have not completed are dropped without calling their callbacks.
+extern void FileIO_Destroy(void);
+
+
+// Deliver the completion callbacks of every finished request. Called once a frame on the engine thread.
+// Callbacks may start new requests.
+extern void FileIO_Update(void);
+
+
 // Start asynchronous open file from hard drive.
+// Reads can be started on the returned handle right away, they are serviced once the open completes.
+//
+// file_name    : relative file name from volume to open, or an absolute path such as a bundle path
+// callback     : called once the open completes, may be NULL
+// data         : user data passed to the callback
 //
-// file_name    : relative file name from volume to open
+// return       : >= 0 return is the file handle
+//                < 0 return indicates lack of resources to start or error
+extern int FileIO_StartOpen(const char *file_name, FileIOCallback callback = NULL, void* data = NULL);
 
+
+// Start asynchronous read into the caller's buffer. The buffer must stay valid until the completion callback.
+// Queued reads that continue exactly where another queued read on the same file ends are serviced together.
+//
+// fileHandle   : the handle returned by FileIO_StartOpen
+// buf          : buffer to read into
+// size         : number of bytes to read
+// offset       : file offset to read from
+// callback     : called once the read completes, may be NULL
+// data         : user data passed to the callback
 //
-// return       : != 0 return indicates successful start
+// return       : != 0 return is the request id
 //                == 0 return indicates lack of resources to start or error
-extern FILE* FileIO_StartOpen(const char *file_name);
+extern int FileIO_StartRead(int fileHandle, void *buf, unsigned long size, long offset, FileIOCallback callback, void* data);
 
 
-// Start asynchronous close file
+// Start asynchronous close file. The file is closed once every read started on it has completed,
+// after which the handle can be reused.
 //
-// filePtr		: Pointer to the file to close.
+// fileHandle   : the handle returned by FileIO_StartOpen
+// callback     : called once the close completes, may be NULL
+// data         : user data passed to the callback
 //
 // return       : true return indicates successful start
 //                false return indicates lack of resources to start or error
-extern bool FileIO_StartClose(FILE* filePtr);
+extern bool FileIO_StartClose(int fileHandle, FileIOCallback callback = NULL, void* data = NULL);
+
+
+// Cancel a read that has not started yet. Its callback is still called, with eFileIOStatusCancelled.
+//
+// requestID    : the id returned by FileIO_StartRead
+//
+// return       : true return indicates the read was cancelled and its buffer will not be touched
+//                false return indicates the read has already started, completed, or does not exist
+extern bool FileIO_Cancel(int requestID);
+
+
+// Block until a request has completed. Its callback is still called from FileIO_Update().
+//
+// requestID    : the id of the request to wait for
+extern void FileIO_Wait(int requestID);
 
 
 // Read from the file and fill the given buffer with the data using the specified offset and size.
-extern void FileIO_Read(const char *file_name, void *buf, unsigned long size, long offset);
\ No newline at end of file
+// This blocks until the read completes, and no callback is called.
+//
+// return       : the number of bytes read, or -1 on error
+extern long FileIO_Read(int fileHandle, void *buf, unsigned long size, long offset);
+
+
+#endif
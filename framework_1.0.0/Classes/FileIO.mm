@@ -9,10 +9,16 @@
 #include "FileIO.h"
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "SystemDefines.h"
 #import <Foundation/NSFileHandle.h>
 #import <Foundation/NSBundle.h>
 #import <Foundation/NSFileManager.h>
 #import <Foundation/NSString.h>
+#import <Foundation/NSAutoreleasePool.h>
 
 bool FileIO_Write(const char *file_name, void *buf, unsigned long size)
 {
@@ -57,83 +63,611 @@ bool FileIO_Write(const char *file_name, void *buf, unsigned long size)
 	return ok;
 }
 
-static size_t file_size;	// The size of the most recent file read in
+// The kind of work a request does.
+typedef enum eFileIORequestType
+{
+	eFileIORequestOpen = 0,
+	eFileIORequestRead,
+	eFileIORequestClose,
+} eFileIORequestType;
 
-FILE* FileIO_StartOpen(const char *file_name)
+// Requests move from queued to in flight to complete, and are freed once their completion is delivered.
+typedef enum eFileIORequestState
 {
-	// Parse out the filename and extension type from the file_name pasfile://localhost/Users/daimatsumoto/projects/trunk/iphone_common/IPLStuff/IPLGeometry.csed in
-	NSString *nsFullFileName = [NSString stringWithUTF8String:file_name];
-//	NSString *nsFileName = [nsFullFileName stringByDeletingPathExtension];
-//	NSString *fileType = [nsFullFileName pathExtension];
+	eFileIORequestFree = 0,
+	eFileIORequestQueued,
+	eFileIORequestInFlight,
+	eFileIORequestComplete,
+} eFileIORequestState;
+
+typedef enum eFileIOFileState
+{
+	eFileIOFileFree = 0,
+	eFileIOFileOpening,
+	eFileIOFileOpen,
+	eFileIOFileFailed,
+} eFileIOFileState;
+
+typedef struct fileIORequest
+{
+	int id;						// Request ids only ever grow, so a lower id was started earlier.
+	int type;
+	int state;
+	int status;
+	int file_handle;
+	void* buf;
+	unsigned long size;
+	long offset;
+	long bytes_read;
+	bool is_waited;				// Set by FileIO_Read, which takes the result itself instead of a callback.
+	FileIOCallback callback;
+	void* data;
+} fileIORequest;
+
+typedef struct fileIOFile
+{
+	int fd;
+	int state;
+	bool is_closing;			// No more reads can be started once a close has been started.
+	char path[FILEIO_MAX_PATH];
+	pthread_mutex_t seek_mutex;	// Coalesced reads seek the shared descriptor, so they are serialized per file.
+} fileIOFile;
+
+
+static fileIORequest requests[FILEIO_MAX_REQUESTS];
+static fileIOFile files[FILEIO_MAX_FILES];
+static pthread_t threads[FILEIO_MAX_THREADS];
+static int num_threads = 0;
+static int next_request_id = 1;
+static bool is_shutting_down = false;
+static pthread_mutex_t io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;		// Signaled when a request may have become ready to start.
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;		// Signaled when a request completes.
+
+
+// All of the helpers below must be called with io_mutex locked.
+static fileIORequest* findRequest(int requestID)
+{
+	for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+	{
+		if ((requests[i].state != eFileIORequestFree) && (requests[i].id == requestID))
+		{
+			return &requests[i];
+		}
+	}
 	
-	NSString* filePath;
-	char *FileOpenMode = NULL;
+	return NULL;
+}
 
-	static char *FileOpenModeString = "rwb";
-	NSArray *pathForDirectories = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES); 
-	NSString *documentsDirectory = [pathForDirectories objectAtIndex:0];
+static fileIORequest* allocRequest(int type, int fileHandle, FileIOCallback callback, void* data)
+{
+	for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+	{
+		if (requests[i].state == eFileIORequestFree)
+		{
+			fileIORequest* req = &requests[i];
+			memset(req, 0, sizeof(fileIORequest));
+			req->id = next_request_id++;
+			req->type = type;
+			req->state = eFileIORequestQueued;
+			req->file_handle = fileHandle;
+			req->callback = callback;
+			req->data = data;
+			
+			// Zero is reserved to report a failed start.
+			if (next_request_id <= 0)
+			{
+				next_request_id = 1;
+			}
+			
+			return req;
+		}
+	}
 	
-	// Add the filename to the path
-	filePath = [documentsDirectory stringByAppendingPathComponent:nsFullFileName];
-	FileOpenMode = FileOpenModeString;
+	DPRINT_ENGINE("FileIO: out of requests \n");
+	return NULL;
+}
+
+static bool hasPendingRequests(int fileHandle, const fileIORequest* except)
+{
+	for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+	{
+		const fileIORequest* req = &requests[i];
+		
+		if ((req != except) && (req->file_handle == fileHandle) && ((req->state == eFileIORequestQueued) || (req->state == eFileIORequestInFlight)))
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+static bool isRequestReady(const fileIORequest* req)
+{
+	switch (req->type)
+	{
+		case eFileIORequestRead:
+			return (files[req->file_handle].state != eFileIOFileOpening);
+			
+		case eFileIORequestClose:
+			return !hasPendingRequests(req->file_handle, req);
+			
+		default:
+			return true;
+	}
+}
+
+// Requests start in the order they were made, except that a request waiting on its file does not hold up the others.
+static fileIORequest* nextReadyRequest(void)
+{
+	fileIORequest* next = NULL;
+	
+	for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+	{
+		fileIORequest* req = &requests[i];
+		
+		if ((req->state == eFileIORequestQueued) && ((next == NULL) || (req->id < next->id)) && (isRequestReady(req)))
+		{
+			next = req;
+		}
+	}
+	
+	return next;
+}
+
+// Takes every queued read that continues exactly where the batch ends, so one system call can fill all of their buffers.
+static int coalesceReads(fileIORequest* batch[])
+{
+	int num_batch = 1;
+	long end = batch[0]->offset + (long)batch[0]->size;
+	bool found = true;
+	
+	while ((found) && (num_batch < FILEIO_MAX_COALESCE))
+	{
+		found = false;
+		
+		for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+		{
+			fileIORequest* req = &requests[i];
+			
+			if ((req->state == eFileIORequestQueued) && (req->type == eFileIORequestRead) && (req->file_handle == batch[0]->file_handle) && (req->offset == end))
+			{
+				req->state = eFileIORequestInFlight;
+				batch[num_batch++] = req;
+				end += (long)req->size;
+				found = true;
+				break;
+			}
+		}
+	}
+	
+	return num_batch;
+}
+
+static void completeRequest(fileIORequest* req, int status, long bytesRead)
+{
+	req->state = eFileIORequestComplete;
+	req->status = status;
+	req->bytes_read = bytesRead;
+}
+
+static void releaseFile(int fileHandle)
+{
+	fileIOFile* file = &files[fileHandle];
+	
+	if (file->fd >= 0)
+	{
+		close(file->fd);
+	}
+	
+	file->fd = -1;
+	file->state = eFileIOFileFree;
+	file->is_closing = false;
+}
+
+
+static void* workerMain(void* arg)
+{
+	fileIORequest* batch[FILEIO_MAX_COALESCE];
+	
+	pthread_mutex_lock(&io_mutex);
+	
+	while (!is_shutting_down)
+	{
+		fileIORequest* req = nextReadyRequest();
+		
+		if (req == NULL)
+		{
+			pthread_cond_wait(&work_cond, &io_mutex);
+			continue;
+		}
+		
+		req->state = eFileIORequestInFlight;
+		batch[0] = req;
+		
+		int num_batch = 1;
+		fileIOFile* file = &files[req->file_handle];
+		int fd = file->fd;
+		
+		if ((req->type == eFileIORequestRead) && (file->state == eFileIOFileOpen))
+		{
+			num_batch = coalesceReads(batch);
+		}
+		
+		pthread_mutex_unlock(&io_mutex);
+		
+		// The actual I/O happens without the lock held.
+		int status = eFileIOStatusOK;
+		long bytes_read = 0;
+		
+		if (req->type == eFileIORequestOpen)
+		{
+			fd = open(file->path, O_RDONLY);
+			status = (fd >= 0) ? eFileIOStatusOK : eFileIOStatusError;
+		}
+		else if (req->type == eFileIORequestRead)
+		{
+			if (fd < 0)
+			{
+				status = eFileIOStatusError;
+			}
+			else if (num_batch == 1)
+			{
+				bytes_read = (long)pread(fd, req->buf, req->size, req->offset);
+			}
+			else
+			{
+				struct iovec iov[FILEIO_MAX_COALESCE];
+				
+				for (int i = 0; i < num_batch; ++i)
+				{
+					iov[i].iov_base = batch[i]->buf;
+					iov[i].iov_len = batch[i]->size;
+				}
+				
+				pthread_mutex_lock(&file->seek_mutex);
+				
+				if (lseek(fd, req->offset, SEEK_SET) == req->offset)
+				{
+					bytes_read = (long)readv(fd, iov, num_batch);
+				}
+				else
+				{
+					bytes_read = -1;
+				}
+				
+				pthread_mutex_unlock(&file->seek_mutex);
+			}
+			
+			if (bytes_read < 0)
+			{
+				status = eFileIOStatusError;
+				bytes_read = 0;
+			}
+		}
+		
+		pthread_mutex_lock(&io_mutex);
+		
+		if (req->type == eFileIORequestOpen)
+		{
+			file->fd = fd;
+			file->state = (fd >= 0) ? eFileIOFileOpen : eFileIOFileFailed;
+			completeRequest(req, status, 0);
+		}
+		else if (req->type == eFileIORequestRead)
+		{
+			// Hand the bytes read out to the batch in file order. Reads past the end of the file get whatever is left.
+			for (int i = 0; i < num_batch; ++i)
+			{
+				long len = (bytes_read < (long)batch[i]->size) ? bytes_read : (long)batch[i]->size;
+				completeRequest(batch[i], status, len);
+				bytes_read -= len;
+			}
+		}
+		else
+		{
+			releaseFile(req->file_handle);
+			completeRequest(req, status, 0);
+		}
+		
+		// A finished open or read can make reads or a close waiting on the file ready.
+		pthread_cond_broadcast(&work_cond);
+		pthread_cond_broadcast(&done_cond);
+	}
+	
+	pthread_mutex_unlock(&io_mutex);
+	
+	return NULL;
+}
+
+
+void FileIO_Init(int numThreads)
+{
+	FileIO_Destroy();
+	
+	for (int i = 0; i < FILEIO_MAX_FILES; ++i)
+	{
+		files[i].fd = -1;
+		files[i].state = eFileIOFileFree;
+		files[i].is_closing = false;
+		pthread_mutex_init(&files[i].seek_mutex, NULL);
+	}
+	
+	memset(requests, 0, sizeof(requests));
+	is_shutting_down = false;
+	
+	int thread_count = (numThreads < 1) ? 1 : ((numThreads > FILEIO_MAX_THREADS) ? FILEIO_MAX_THREADS : numThreads);
+	
+	for (int i = 0; i < thread_count; ++i)
+	{
+		if (pthread_create(&threads[i], NULL, workerMain, NULL) != 0)
+		{
+			DPRINT_ENGINE("FileIO_Init failed: Could not create worker thread %d \n", i);
+			break;
+		}
+		
+		num_threads++;
+	}
+}
+
+
+void FileIO_Destroy()
+{
+	if (num_threads <= 0)
+	{
+		return;
+	}
+	
+	pthread_mutex_lock(&io_mutex);
+	is_shutting_down = true;
+	pthread_cond_broadcast(&work_cond);
+	pthread_mutex_unlock(&io_mutex);
+	
+	for (int i = 0; i < num_threads; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	
+	num_threads = 0;
+	
+	// Wake anyone still waiting on a request, they will find it dropped.
+	pthread_mutex_lock(&io_mutex);
+	
+	for (int i = 0; i < FILEIO_MAX_FILES; ++i)
+	{
+		releaseFile(i);
+		pthread_mutex_destroy(&files[i].seek_mutex);
+	}
+	
+	memset(requests, 0, sizeof(requests));
+	pthread_cond_broadcast(&done_cond);
+	pthread_mutex_unlock(&io_mutex);
+}
+
+
+void FileIO_Update()
+{
+	pthread_mutex_lock(&io_mutex);
+	
+	for (int i = 0; i < FILEIO_MAX_REQUESTS; ++i)
+	{
+		fileIORequest* req = &requests[i];
+		
+		if ((req->state != eFileIORequestComplete) || (req->is_waited))
+		{
+			continue;
+		}
+		
+		// Free the request before the callback, so that the callback can start new requests.
+		fileIORequest done = *req;
+		req->state = eFileIORequestFree;
+		
+		if (done.callback)
+		{
+			pthread_mutex_unlock(&io_mutex);
+			done.callback(done.id, done.file_handle, done.status, done.buf, done.bytes_read, done.data);
+			pthread_mutex_lock(&io_mutex);
+		}
+	}
+	
+	pthread_mutex_unlock(&io_mutex);
+}
 
+
+int FileIO_StartOpen(const char *file_name, FileIOCallback callback, void* data)
+{
+	if (num_threads <= 0)
+	{
+		DPRINT_ENGINE("FileIO_StartOpen failed: FileIO_Init has not been called \n");
+		return -1;
+	}
+	
+	NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+	
+	// Relative file names are in the documents directory, absolute paths are used as they are.
+	NSString *filePath = [NSString stringWithUTF8String:file_name];
+	
+	if (![filePath isAbsolutePath])
+	{
+		NSArray *pathForDirectories = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES); 
+		NSString *documentsDirectory = [pathForDirectories objectAtIndex:0];
+		
+		// Add the filename to the path
+		filePath = [documentsDirectory stringByAppendingPathComponent:filePath];
+	}
 	
-	if (filePath != NULL)
+	const char* path = [filePath UTF8String];
+	int file_handle = -1;
+	
+	pthread_mutex_lock(&io_mutex);
+	
+	for (int i = 0; i < FILEIO_MAX_FILES; ++i)
+	{
+		if (files[i].state == eFileIOFileFree)
+		{
+			file_handle = i;
+			break;
+		}
+	}
+	
+	if ((file_handle >= 0) && (strlen(path) < FILEIO_MAX_PATH) && (allocRequest(eFileIORequestOpen, file_handle, callback, data) != NULL))
 	{
-		// Get the file size.
-		NSFileHandle* temp_handle = [NSFileHandle fileHandleForReadingAtPath:filePath];
-		NSData* temp_data = [temp_handle availableData];
-		file_size = [temp_data length];
+		fileIOFile* file = &files[file_handle];
+		strcpy(file->path, path);
+		file->fd = -1;
+		file->state = eFileIOFileOpening;
+		file->is_closing = false;
+		
+		pthread_cond_signal(&work_cond);
 	}
 	else
 	{
-		return NULL;
+		DPRINT_ENGINE("FileIO_StartOpen failed: Could not start opening %s \n", file_name);
+		file_handle = -1;
 	}
+	
+	pthread_mutex_unlock(&io_mutex);
+	[pool release];
+	
+	return file_handle;
+}
 
-	// Get the path as a c string so we can open it with fopen()
-	file_name = [filePath UTF8String];
+
+// FileIO_Read marks its request as waited before it can complete, so that FileIO_Update never frees it.
+static int startRead(int fileHandle, void *buf, unsigned long size, long offset, FileIOCallback callback, void* data, bool isWaited)
+{
+	if ((fileHandle < 0) || (fileHandle >= FILEIO_MAX_FILES) || (buf == NULL))
+	{
+		DPRINT_ENGINE("FileIO_StartRead failed: invalid arguments \n");
+		return 0;
+	}
+	
+	int request_id = 0;
 	
-	// Open the file.
-	FILE *fileptr = fopen(file_name, FileOpenMode);
+	pthread_mutex_lock(&io_mutex);
+	
+	if ((files[fileHandle].state != eFileIOFileFree) && (!files[fileHandle].is_closing))
+	{
+		fileIORequest* req = allocRequest(eFileIORequestRead, fileHandle, callback, data);
+		
+		if (req)
+		{
+			req->buf = buf;
+			req->size = size;
+			req->offset = offset;
+			req->is_waited = isWaited;
+			request_id = req->id;
+			
+			pthread_cond_signal(&work_cond);
+		}
+	}
 	
-	return fileptr;
+	pthread_mutex_unlock(&io_mutex);
+	
+	return request_id;
+}
+
+
+int FileIO_StartRead(int fileHandle, void *buf, unsigned long size, long offset, FileIOCallback callback, void* data)
+{
+	return startRead(fileHandle, buf, size, offset, callback, data, false);
 }
 
-void FileIO_Read(const char *file_name, void *buf, unsigned long size, long offset)
+
+bool FileIO_StartClose(int fileHandle, FileIOCallback callback, void* data)
 {
+	if ((fileHandle < 0) || (fileHandle >= FILEIO_MAX_FILES))
+	{
+		return false;
+	}
 	
-	// Parse out the filename and extension type from the file_name passed in
-	NSString *nsFullFileName = [NSString stringWithUTF8String:file_name];
-//	NSString *nsFileName = [nsFullFileName stringByDeletingPathExtension];
-//	NSString *fileType = [nsFullFileName pathExtension];
-	NSString* filePath;
+	bool is_started = false;
+	
+	pthread_mutex_lock(&io_mutex);
+	
+	if ((files[fileHandle].state != eFileIOFileFree) && (!files[fileHandle].is_closing) && (allocRequest(eFileIORequestClose, fileHandle, callback, data) != NULL))
+	{
+		files[fileHandle].is_closing = true;
+		is_started = true;
+		
+		pthread_cond_signal(&work_cond);
+	}
+	
+	pthread_mutex_unlock(&io_mutex);
+	
+	return is_started;
+}
 
-	NSArray *pathForDirectories = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES); 
-	NSString *documentsDirectory = [pathForDirectories objectAtIndex:0];
+
+bool FileIO_Cancel(int requestID)
+{
+	bool is_cancelled = false;
 	
-	// Add the filename to the path
-	filePath = [documentsDirectory stringByAppendingPathComponent:nsFullFileName];	
+	pthread_mutex_lock(&io_mutex);
+	
+	fileIORequest* req = findRequest(requestID);
+	
+	if ((req) && (req->type == eFileIORequestRead) && (req->state == eFileIORequestQueued))
+	{
+		completeRequest(req, eFileIOStatusCancelled, 0);
+		is_cancelled = true;
+		
+		// A close may have been waiting on this read.
+		pthread_cond_broadcast(&work_cond);
+		pthread_cond_broadcast(&done_cond);
+	}
+	
+	pthread_mutex_unlock(&io_mutex);
+	
+	return is_cancelled;
+}
+
 
+void FileIO_Wait(int requestID)
+{
+	pthread_mutex_lock(&io_mutex);
 	
-	// Get the path as a c string so we can open it with fopen()
-	file_name = [filePath UTF8String];
+	fileIORequest* req = findRequest(requestID);
 	
-	FILE *fileptr;
-	fileptr = fopen(file_name, "rb");
-	if (fileptr)
+	while ((req) && (req->state != eFileIORequestComplete) && (num_threads > 0))
 	{
-		fseek(fileptr, offset, SEEK_SET);
-		file_size = fread(buf, 1, size, fileptr); 
-		fclose(fileptr);
+		pthread_cond_wait(&done_cond, &io_mutex);
+		req = findRequest(requestID);
 	}
+	
+	pthread_mutex_unlock(&io_mutex);
 }
 
-bool FileIO_StartClose(FILE* filePtr)
+
+long FileIO_Read(int fileHandle, void *buf, unsigned long size, long offset)
 {
-	if (filePtr)
+	int request_id = startRead(fileHandle, buf, size, offset, NULL, NULL, true);
+	
+	if (request_id == 0)
 	{
-		// Close the file.
-		fclose(filePtr);
+		return -1;
 	}
-	return true;
-}
\ No newline at end of file
+	
+	pthread_mutex_lock(&io_mutex);
+	
+	fileIORequest* req = findRequest(request_id);
+	
+	while ((req) && (req->state != eFileIORequestComplete) && (num_threads > 0))
+	{
+		pthread_cond_wait(&done_cond, &io_mutex);
+		req = findRequest(request_id);
+	}
+	
+	long bytes_read = -1;
+	
+	if ((req) && (req->state == eFileIORequestComplete))
+	{
+		bytes_read = (req->status == eFileIOStatusOK) ? req->bytes_read : -1;
+		req->state = eFileIORequestFree;
+	}
+	
+	pthread_mutex_unlock(&io_mutex);
+	
+	return bytes_read;
+}
@@ -12,13 +12,17 @@
 #include "Sprite.h"
 #include "Graphics.h"
 #include <string.h>
+#include <stddef.h>
 #include "SystemDefines.h"
 
 
 
 CFont::CFont()
 {
-
+	_num_batch_vertices = 0;
+	_num_batch_strings = 0;
+	_batch_depth = 0;
+	_mesh_use_stamp = 0;
 }
 
 
@@ -62,6 +66,15 @@ void CFont::init(const fontLoadInfo** fontInfo, int numFonts)
 		_font_table[i]._font_table_offset_y = theFontInfo.font_table_offset_y;
 	}
 	
+	_batch_vertices = ArrayList<fontGlyphVertex>::alloc(FONT_BATCH_MAX_GLYPHS * FONT_GLYPH_VERTICES);
+	_sorted_vertices = ArrayList<fontGlyphVertex>::alloc(FONT_BATCH_MAX_GLYPHS * FONT_GLYPH_VERTICES);
+	_batch_strings = ArrayList<fontBatchString>::alloc(FONT_BATCH_MAX_STRINGS);
+	_mesh_cache = ArrayList<fontTextMesh>::alloc(FONT_MESH_CACHE_SIZE);
+	
+	_num_batch_vertices = 0;
+	_num_batch_strings = 0;
+	_batch_depth = 0;
+	_mesh_use_stamp = 0;
 }
 
 
@@ -72,6 +85,15 @@ void CFont::destroy()
 		_font_table[i]._font_sprite_table.destroy();
 	}
 	_font_table = NULL;
+	
+	_batch_vertices = NULL;
+	_sorted_vertices = NULL;
+	_batch_strings = NULL;
+	_mesh_cache = NULL;
+	
+	_num_batch_vertices = 0;
+	_num_batch_strings = 0;
+	_batch_depth = 0;
 }
 
 
@@ -101,19 +123,294 @@ int CFont::getStringWidth(int font, const char* str)
 
 void CFont::drawString(int font, const char* str, int x, int y, float alpha)
 {
-	int char_x = x;
-	
 	// Set the alpha value first before drawing the string.
 	_font_table[font]._font_sprite_table._color.a = alpha;
 	
-	for (int i = 0; i < strlen(str); ++i)
+	const CSprite& sprite = _font_table[font]._font_sprite_table;
+	
+	// Nothing is drawn for these, same as CGraphics::drawSprite().
+	if ((sprite.getImage() == NULL) || (!sprite.isVisible()) || (sprite._color.a <= 0.0))
 	{
-		drawFontChar(font, str[i], char_x, y);
-		char_x += _font_table[font]._font_char_width + _gap_offset;
+		return;
+	}
+	
+	int length = strlen(str);
+	
+	if (length <= 0)
+	{
+		return;
+	}
+	
+	// The batch only holds unrotated glyphs, so rotated fonts are still drawn one character at a time.
+	if ((sprite._angle.x != 0.0) || (sprite._angle.y != 0.0) || (sprite._angle.z != 0.0) || (length > FONT_BATCH_MAX_GLYPHS) || (_batch_vertices == NULL))
+	{
+		int char_x = x;
+		
+		for (int i = 0; i < length; ++i)
+		{
+			drawFontChar(font, str[i], char_x, y);
+			char_x += _font_table[font]._font_char_width + _gap_offset;
+		}
+		return;
+	}
+	
+	int num_vertices = length * FONT_GLYPH_VERTICES;
+	
+	// Make room in the batch if this string does not fit.
+	if (((_num_batch_vertices + num_vertices) > _batch_vertices.length()) || (_num_batch_strings >= FONT_BATCH_MAX_STRINGS))
+	{
+		flushBatch();
+	}
+	
+	fontGlyphVertex* vertices = &_batch_vertices[_num_batch_vertices];
+	
+	if (length <= FONT_MESH_MAX_CHARS)
+	{
+		fontTextMesh* mesh = getCachedMesh(font, str, length, x, y);
+		memcpy(vertices, mesh->vertices, sizeof(fontGlyphVertex) * num_vertices);
+	}
+	else
+	{
+		buildStringMesh(vertices, font, str, length, x, y);
+	}
+	
+	_batch_strings[_num_batch_strings].font = font;
+	_batch_strings[_num_batch_strings].first_vertex = _num_batch_vertices;
+	_batch_strings[_num_batch_strings].num_vertices = num_vertices;
+	_num_batch_strings++;
+	_num_batch_vertices += num_vertices;
+	
+	// Outside of a batch, every string is its own batch.
+	if (_batch_depth <= 0)
+	{
+		flushBatch();
+	}
+}
+
+
+void CFont::beginBatch()
+{
+	_batch_depth++;
+}
+
+
+void CFont::endBatch()
+{
+	if (_batch_depth <= 0)
+	{
+		DPRINT_GRAPHICS("CFont::endBatch error: endBatch called without beginBatch \n");
+		return;
+	}
+	
+	_batch_depth--;
+	
+	if (_batch_depth == 0)
+	{
+		flushBatch();
 	}
 }
 
 
+void CFont::flushBatch()
+{
+	if (_num_batch_strings <= 0)
+	{
+		return;
+	}
+	
+	// Group the strings by font so that each font texture only needs to be bound once.
+	int num_sorted_vertices = 0;
+	
+	for (int font = 0; font < _num_fonts; ++font)
+	{
+		for (int i = 0; i < _num_batch_strings; ++i)
+		{
+			if (_batch_strings[i].font != font)
+			{
+				continue;
+			}
+			
+			memcpy(
+				   &_sorted_vertices[num_sorted_vertices], 
+				   &_batch_vertices[_batch_strings[i].first_vertex], 
+				   sizeof(fontGlyphVertex) * _batch_strings[i].num_vertices);
+			num_sorted_vertices += _batch_strings[i].num_vertices;
+		}
+	}
+	
+	int offset = CGraphics::streamVertices(_sorted_vertices.getRawPtr(), num_sorted_vertices * sizeof(fontGlyphVertex));
+	const char* vertices = (offset >= 0) ? (const char*)(size_t)offset : (const char*)_sorted_vertices.getRawPtr();
+	
+	// The glyph positions are already in screen space.
+	glPushMatrix();
+	glLoadIdentity();
+	
+	// Make sure to enable the states that let us bind and draw the texture.
+	glEnable(GL_TEXTURE_2D);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	
+	int first_vertex = 0;
+	
+	for (int font = 0; font < _num_fonts; ++font)
+	{
+		int num_vertices = 0;
+		
+		for (int i = 0; i < _num_batch_strings; ++i)
+		{
+			if (_batch_strings[i].font == font)
+			{
+				num_vertices += _batch_strings[i].num_vertices;
+			}
+		}
+		
+		if (num_vertices <= 0)
+		{
+			continue;
+		}
+		
+		const char* font_vertices = vertices + (first_vertex * sizeof(fontGlyphVertex));
+		
+		glBindTexture(GL_TEXTURE_2D, _font_table[font]._font_sprite_table.getTexName());
+		
+		glVertexPointer(2, GL_FLOAT, sizeof(fontGlyphVertex), font_vertices + offsetof(fontGlyphVertex, x));
+		glTexCoordPointer(2, GL_FLOAT, sizeof(fontGlyphVertex), font_vertices + offsetof(fontGlyphVertex, u));
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(fontGlyphVertex), font_vertices + offsetof(fontGlyphVertex, r));
+		
+		CGraphics::drawQuads(num_vertices / FONT_GLYPH_VERTICES);
+		
+		first_vertex += num_vertices;
+	}
+	
+	CGraphics::unbindStreamBuffer();
+	
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisable(GL_TEXTURE_2D);
+	
+	// The color array leaves the current color undefined, so reset it for the next draw.
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	
+	glPopMatrix();
+	
+	_num_batch_vertices = 0;
+	_num_batch_strings = 0;
+}
+
+
+void CFont::buildStringMesh(fontGlyphVertex* vertices, int font, const char* str, int length, int x, int y)
+{
+	const fontType& font_type = _font_table[font];
+	const CSprite& sprite = font_type._font_sprite_table;
+	const CImage* image = sprite.getImage();
+	
+	GLubyte r = (GLubyte)(sprite._color.r * 255.0f);
+	GLubyte g = (GLubyte)(sprite._color.g * 255.0f);
+	GLubyte b = (GLubyte)(sprite._color.b * 255.0f);
+	GLubyte a = (GLubyte)(sprite._color.a * 255.0f);
+	
+	GLfloat quad[8];
+	GLfloat tex_coords[8];
+	
+	int char_x = x;
+	
+	for (int i = 0; i < length; ++i)
+	{
+		int font_offset_x = ((str[i] - font_type._font_start_char) % font_type._font_chars_per_row) * font_type._font_char_width;
+		int font_offset_y = ((str[i] - font_type._font_start_char) / font_type._font_chars_per_row) * font_type._font_char_height;
+		
+		CGraphics::buildQuadVertices(quad, char_x, y, font_type._font_char_width, font_type._font_char_height);
+		CGraphics::buildQuadTexCoords(
+									  tex_coords, 
+									  font_offset_x + font_type._font_table_offset_x, 
+									  font_offset_y + font_type._font_table_offset_y, 
+									  font_type._font_char_width, 
+									  font_type._font_char_height, 
+									  image);
+		
+		for (int j = 0; j < FONT_GLYPH_VERTICES; ++j)
+		{
+			fontGlyphVertex& vertex = vertices[(i * FONT_GLYPH_VERTICES) + j];
+			
+			// Scale about the string position, the same way CGraphics::drawSprite() does.
+			vertex.x = char_x + ((quad[(j * 2) + 0] - char_x) * sprite._scale.x);
+			vertex.y = y + ((quad[(j * 2) + 1] - y) * sprite._scale.y);
+			vertex.u = tex_coords[(j * 2) + 0];
+			vertex.v = tex_coords[(j * 2) + 1];
+			vertex.r = r;
+			vertex.g = g;
+			vertex.b = b;
+			vertex.a = a;
+		}
+		
+		char_x += font_type._font_char_width + _gap_offset;
+	}
+}
+
+
+fontTextMesh* CFont::getCachedMesh(int font, const char* str, int length, int x, int y)
+{
+	const CSprite& sprite = _font_table[font]._font_sprite_table;
+	
+	// FNV-1a hash of the string.
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < length; ++i)
+	{
+		hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+	}
+	
+	_mesh_use_stamp++;
+	
+	fontTextMesh* oldest = &_mesh_cache[0];
+	
+	for (int i = 0; i < FONT_MESH_CACHE_SIZE; ++i)
+	{
+		fontTextMesh* mesh = &_mesh_cache[i];
+		
+		if ((mesh->num_vertices == (length * FONT_GLYPH_VERTICES)) && 
+			(mesh->hash == hash) && 
+			(mesh->font == font) && 
+			(mesh->x == x) && 
+			(mesh->y == y) && 
+			(mesh->gap_offset == _gap_offset) && 
+			(mesh->col.r == sprite._color.r) && 
+			(mesh->col.g == sprite._color.g) && 
+			(mesh->col.b == sprite._color.b) && 
+			(mesh->col.a == sprite._color.a) && 
+			(mesh->scale.x == sprite._scale.x) && 
+			(mesh->scale.y == sprite._scale.y) && 
+			(strncmp(mesh->str, str, length) == 0))
+		{
+			mesh->last_used = _mesh_use_stamp;
+			return mesh;
+		}
+		
+		// Unused entries have a zero stamp, so they are always picked first.
+		if (mesh->last_used < oldest->last_used)
+		{
+			oldest = mesh;
+		}
+	}
+	
+	// Not cached, so build it into the least recently used entry.
+	oldest->hash = hash;
+	memcpy(oldest->str, str, length);
+	oldest->str[length] = '\0';
+	oldest->font = font;
+	oldest->x = x;
+	oldest->y = y;
+	oldest->gap_offset = _gap_offset;
+	oldest->col = sprite._color;
+	oldest->scale = sprite._scale;
+	oldest->num_vertices = length * FONT_GLYPH_VERTICES;
+	oldest->last_used = _mesh_use_stamp;
+	
+	buildStringMesh(oldest->vertices, font, str, length, x, y);
+	
+	return oldest;
+}
+
+
 void CFont::draw3DString(int font, const char* str, int x, int y, int z, float alpha)
 {
 	int char_x = x;
@@ -121,7 +418,9 @@ void CFont::draw3DString(int font, const char* str, int x, int y, int z, float a
 	// Set the alpha value first before drawing the string.
 	_font_table[font]._font_sprite_table._color.a = alpha;
 	
-	for (int i = 0; i < strlen(str); ++i)
+	int length = (int)strlen(str);
+	
+	for (int i = 0; i < length; ++i)
 	{
 		draw3DFontChar(font, str[i], char_x, y, z);
 		char_x += _font_table[font]._font_char_width + _gap_offset;
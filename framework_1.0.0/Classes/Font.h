@@ -15,6 +15,59 @@
 
 //class CSprite;
 
+static const int FONT_BATCH_MAX_GLYPHS = 2048;		// The maximum number of glyphs that are held in the batch before it is drawn.
+static const int FONT_BATCH_MAX_STRINGS = 256;		// The maximum number of strings that are held in the batch before it is drawn.
+static const int FONT_MESH_CACHE_SIZE = 32;			// The number of prebuilt string meshes that are kept around.
+static const int FONT_MESH_MAX_CHARS = 64;			// Strings longer than this are never cached.
+static const int FONT_GLYPH_VERTICES = 4;			// Every glyph is one quad.
+
+/*! \struct fontGlyphVertex
+ *	\brief A single vertex of a glyph quad.
+ *
+ * Glyphs of all strings are written into one interleaved array so that a whole batch can be drawn with one call per font.
+ */
+typedef struct fontGlyphVertex
+{
+	GLfloat x;		/*!< The x position. */
+	GLfloat y;		/*!< The y position. */
+	GLfloat u;		/*!< The u texture coordinate. */
+	GLfloat v;		/*!< The v texture coordinate. */
+	GLubyte r;		/*!< The red color component. */
+	GLubyte g;		/*!< The green color component. */
+	GLubyte b;		/*!< The blue color component. */
+	GLubyte a;		/*!< The alpha color component. */
+} fontGlyphVertex;
+
+/*! \struct fontBatchString
+ *	\brief A string waiting in the batch to be drawn.
+ */
+typedef struct fontBatchString
+{
+	int font;			/*!< The font type of the string. */
+	int first_vertex;	/*!< The index of the first vertex of the string in the batch. */
+	int num_vertices;	/*!< The number of vertices of the string. */
+} fontBatchString;
+
+/*! \struct fontTextMesh
+ *	\brief A prebuilt string mesh.
+ *
+ * The mesh is keyed by everything that affects the glyph quads, so a string drawn with the same settings as a previous frame can simply copy its vertices.
+ */
+typedef struct fontTextMesh
+{
+	unsigned int hash;		/*!< The hash of the string, used to skip most string compares. */
+	char str[FONT_MESH_MAX_CHARS + 1];	/*!< The string. */
+	int font;				/*!< The font type. */
+	int x;					/*!< The x location of the string. */
+	int y;					/*!< The y location of the string. */
+	float gap_offset;		/*!< The gap offset that the string was built with. */
+	color col;				/*!< The color that the string was built with. */
+	Vector3 scale;			/*!< The scale that the string was built with. */
+	int num_vertices;		/*!< The number of vertices in the mesh. Zero marks an unused entry. */
+	unsigned int last_used;	/*!< The batch use stamp of the last time this mesh was drawn, used to pick which mesh to replace. */
+	fontGlyphVertex vertices[FONT_MESH_MAX_CHARS * FONT_GLYPH_VERTICES];	/*!< The glyph quads. */
+} fontTextMesh;
+
 /*! \struct fontType
  *	\brief The font type.
  *
@@ -140,6 +193,25 @@ public:
 	 */
 	void drawString(int font, const char* str, int x, int y, float alpha = 1.0);
 	
+	/*! \fn beginBatch(void)
+	 *  \brief Starts collecting strings instead of drawing them right away.
+	 *
+	 * Every string drawn with drawString() until the matching endBatch() is added to one quad buffer, which is drawn with a single call per font.
+	 * Batches can be nested, only the outermost endBatch() draws.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void beginBatch(void);
+	
+	/*! \fn endBatch(void)
+	 *  \brief Draws all strings collected since beginBatch().
+	 *  
+	 * The strings are drawn in the 2D space, so the 2D view must be set.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void endBatch(void);
+	
 	/*! \fn draw3DString(int font, const char* str, int x, int y, int z, float alpha = 1.0)
 	 *  \brief Renders a string with the given font type on the screen.
 	 *  
@@ -229,6 +301,50 @@ private:
 	int _num_fonts;			/*!< The total number of font types loaded. */
 	
 	float _gap_offset;	/*!< Any extra spacing between letters. */
+	
+	/*! \fn flushBatch(void)
+	 *  \brief Draws and empties the batch.
+	 *
+	 * The strings are grouped by font so that every font texture is bound once.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void flushBatch(void);
+	
+	/*! \fn buildStringMesh(fontGlyphVertex* vertices, int font, const char* str, int length, int x, int y)
+	 *  \brief Builds the glyph quads of a string with the current font settings.
+	 *
+	 *	\param vertices The vertices to fill. Must hold length * #FONT_GLYPH_VERTICES vertices.
+	 *	\param font The font type.
+	 *	\param str The string.
+	 *	\param length The length of the string.
+	 *	\param x The x location on the screen to render the string.
+ 	 *	\param y The y location on the screen to render the string.
+	 *  \return n/a
+	 */
+	void buildStringMesh(fontGlyphVertex* vertices, int font, const char* str, int length, int x, int y);
+	
+	/*! \fn getCachedMesh(int font, const char* str, int length, int x, int y)
+	 *  \brief Returns the cached mesh of a string, building it into the least recently used cache entry if it is not cached yet.
+	 *
+	 *	\param font The font type.
+	 *	\param str The string.
+	 *	\param length The length of the string.
+	 *	\param x The x location on the screen to render the string.
+ 	 *	\param y The y location on the screen to render the string.
+	 *  \return The cached mesh.
+	 */
+	fontTextMesh* getCachedMesh(int font, const char* str, int length, int x, int y);
+	
+	ArrayList<fontGlyphVertex> _batch_vertices;	/*!< The glyph quads of all strings in the batch, in the order they were drawn. */
+	ArrayList<fontGlyphVertex> _sorted_vertices;	/*!< The glyph quads of the batch grouped by font, which is what gets drawn. */
+	ArrayList<fontBatchString> _batch_strings;	/*!< The strings in the batch. */
+	int _num_batch_vertices;	/*!< The number of vertices in the batch. */
+	int _num_batch_strings;		/*!< The number of strings in the batch. */
+	int _batch_depth;			/*!< The number of beginBatch() calls that have not been ended yet. */
+	
+	ArrayList<fontTextMesh> _mesh_cache;	/*!< The prebuilt string meshes. */
+	unsigned int _mesh_use_stamp;	/*!< Incremented on every cache lookup. */
 };
 
 
@@ -9,6 +9,8 @@
 #include "Utils.h"
 #include <string.h>
 #include "Engine.h"
+#include "ArrayList.h"
+#include "SpriteBatch.h"
 
 
 #if defined (ENABLE_PNGLOAD)
@@ -42,6 +44,17 @@ const GLfloat tex_coords[] =
 };
 #endif
 
+GLuint CGraphics::_stream_buffers[STREAM_BUFFER_COUNT] = {0};
+int CGraphics::_stream_buffer_index = 0;
+int CGraphics::_stream_buffer_offset = 0;
+int CGraphics::_stream_buffer_size = STREAM_BUFFER_SIZE;
+BOOL CGraphics::_is_stream_overflow_reported = FALSE;
+GLuint CGraphics::_quad_index_buffer = 0;
+CSpriteBatch* CGraphics::_sprite_batch = NULL;
+ArrayList<unitCircle> CGraphics::_unit_circles;
+ArrayList<shapeMesh> CGraphics::_shape_meshes;
+unsigned int CGraphics::_shape_use_stamp = 0;
+
 const float normals_3D[] =
 {
 	0, 1, 0,
@@ -239,38 +252,7 @@ void CGraphics::drawEllipse(GLfloat x, GLfloat y, GLfloat w, GLfloat h, const in
 		return;
 	}
 	
-	glPushMatrix();
-	glLoadIdentity();
-	glTranslatef(x, y, 0.0);
-	
-	GLfloat vertices[segments * 2];
-	
-	int count=0;
-	
-	for (GLfloat i = 0; i < 360.0f; i += (360.0f / segments))
-	{
-		vertices[count++] = (cos(DEGREES_TO_RADIANS(i)) * w);
-		vertices[count++] = (sin(DEGREES_TO_RADIANS(i)) * h);
-	}
-	
-	glColor4f(theColor.r, theColor.g, theColor.b, theColor.a);
-	glVertexPointer (2, GL_FLOAT , 0, vertices); 
-	
-	if (bFilled)
-	{
-		glDrawArrays (GL_TRIANGLE_FAN, 0, segments);
-	}
-	else
-	{
-		glDrawArrays (GL_LINE_LOOP, 0, segments);
-	}
-	
-
-	glPopMatrix();
-	
-#if defined (ENABLE_POLY_COUNT)
-	updatePolyCount(segments);
-#endif
+	drawShapeMesh(getShapeMesh(eShapeEllipse, segments, w, h, 0.0, 0.0), x, y, theColor, bFilled);
 }
 
 
@@ -288,45 +270,7 @@ void CGraphics::drawCircleSlice(GLfloat x, GLfloat y, GLfloat radius, const int
 		return;
 	}
 	
-	glPushMatrix();
-	glLoadIdentity();
-	glTranslatef(x, y, 0.0);
-	
-	GLfloat vertices[segments * 2];
-	
-	int count = 0;
-	
-	// GL circles draw from the left and as the degrees increase, it draws clockwise.
-	for (GLfloat i = 0.0; i < 360.0f; i += (360.0f / segments))
-	{
-		// Special case handling 360 to 0 vertex.
-		if ((endDeg == 360.0) && (i == 0.0))
-		{
-			vertices[count++] = (cos(DEGREES_TO_RADIANS(i)) * radius);
-			vertices[count++] = (sin(DEGREES_TO_RADIANS(i)) * radius);
-		}
-		else if ((i >= startDeg) && (i <= endDeg))
-		{
-			vertices[count++] = (cos(DEGREES_TO_RADIANS(i)) * radius);
-			vertices[count++] = (sin(DEGREES_TO_RADIANS(i)) * radius);
-		}
-		else
-		{
-			vertices[count++] = 0;
-			vertices[count++] = 0;
-		}
-	}
-	
-	glColor4f(theColor.r, theColor.g, theColor.b, theColor.a);
-	glVertexPointer (2, GL_FLOAT , 0, vertices); 
-	
-	glDrawArrays (GL_TRIANGLE_FAN, 0, segments);
-	
-	glPopMatrix();
-	
-#if defined (ENABLE_POLY_COUNT)
-	updatePolyCount(segments);
-#endif
+	drawShapeMesh(getShapeMesh(eShapeCircleSlice, segments, radius, radius, startDeg, endDeg), x, y, theColor, TRUE);
 }
 
 void CGraphics::drawRoundedRect(const float x, const float y, const float w, const float h, GLfloat cornerRadius, color theColor)
@@ -337,86 +281,8 @@ void CGraphics::drawRoundedRect(const float x, const float y, const float w, con
 		return;
 	}
 	
-	// First draw the four corner circles.
-	
-	// Starting with top left.
-	drawCircleSlice(
-					x + cornerRadius, 
-					y + cornerRadius, 
-					cornerRadius, 
-					ROUNDED_RECT_SEGMENTS, 
-					180.0,
-					270.0, 
-					theColor);
-	
-	// Top Right.
-	drawCircleSlice(
-					x + w - cornerRadius, 
-					y + cornerRadius, 
-					cornerRadius, 
-					ROUNDED_RECT_SEGMENTS, 
-					270.0,
-					360.0, 
-					theColor);
-	
-	// Bottom left.
-	drawCircleSlice(
-					x + cornerRadius, 
-					y + h - cornerRadius, 
-					cornerRadius, 
-					ROUNDED_RECT_SEGMENTS, 
-					90.0,
-					180.0, 
-					theColor);
-	
-	// Bottom right.
-	drawCircleSlice(
-					x + w - cornerRadius, 
-					y + h - cornerRadius, 
-					cornerRadius, 
-					ROUNDED_RECT_SEGMENTS, 
-					0.0,
-					90.0, 
-					theColor);
-	
-	// JC: This can and should be optimized more.
-	// Now draw the rects to fill out the middle.
-	// Top strip.
-	drawRect(
-			 x + cornerRadius, 
-			 y, 
-			 w - (cornerRadius * 2), 
-			 cornerRadius, 
-			 theColor);
-	// Left strip.
-	drawRect(
-			 x, 
-			 y + cornerRadius,
-			 cornerRadius, 
-			 h - (cornerRadius * 2), 
-			 theColor);
-	// Right strip.
-	drawRect(
-			 x + w - cornerRadius, 
-			 y + cornerRadius, 
-			 cornerRadius, 
-			 h - (cornerRadius * 2), 
-			 theColor);
-	// Bottom strip.
-	drawRect(
-			 x + cornerRadius,
-			 y + h - cornerRadius,
-			 w - (cornerRadius * 2),
-			 cornerRadius,
-			 theColor);
-	
-	// Finally, draw the middle rect.
-	drawRect(
-			 x + cornerRadius, 
-			 y + cornerRadius,
-			 w - (cornerRadius * 2),
-			 h - (cornerRadius * 2),
-			 theColor);
+	// The corners and the strips in between are all part of one cached mesh, so the whole rectangle is a single draw.
+	drawShapeMesh(getShapeMesh(eShapeRoundedRect, ROUNDED_RECT_SEGMENTS, w, h, cornerRadius, 0.0), x, y, theColor, TRUE);
 }
 
 // Since we want to support transparent rounded rects, we do a little extra work to make it look good.
@@ -900,6 +766,25 @@ void CGraphics::drawSprite(const CSprite* sprite, const float x, const float y)
 	{
 		return;
 	}
+	
+	// A flipbook sprite draws its frames as clips of the atlas, faded into each other when it is blended.
+	if (sprite->isFlipbook())
+	{
+		spriteClip clips[SPRITE_CLIPS_MAX];
+		int num_clips = sprite->getFlipbookClips(clips);
+		
+		for (int i = 0; i < num_clips; ++i)
+		{
+			drawSprite(sprite, x, y, clips[i].x, clips[i].y, clips[i].w, clips[i].h, clips[i].alpha);
+		}
+		return;
+	}
+	
+	if (_sprite_batch)
+	{
+		_sprite_batch->addSprite(sprite, x, y);
+		return;
+	}
 
 #if ENABLE_TRIANGLE_QUADS
 	// A quad consists of 2 triangles, so we need to create 6 vertices for it.
@@ -1037,7 +922,7 @@ void CGraphics::drawSprite(const CSprite* sprite)
 }
 
 
-void CGraphics::drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH)
+void CGraphics::drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale)
 {	
 	if (sprite == NULL)
 	{
@@ -1052,8 +937,14 @@ void CGraphics::drawSprite(const CSprite* sprite, const float x, const float y,
 	}
 	
 	// If the alpha is zero, don't bother drawing.
-	if (sprite->_color.a <= 0.0)
+	if ((sprite->_color.a * alphaScale) <= 0.0)
+	{
+		return;
+	}
+	
+	if (_sprite_batch)
 	{
+		_sprite_batch->addSprite(sprite, x, y, offsetX, offsetY, clipW, clipH, alphaScale);
 		return;
 	}
 	
@@ -1096,7 +987,7 @@ void CGraphics::drawSprite(const CSprite* sprite, const float x, const float y,
 	}
 	
 	// Set colors.
-	glColor4f(sprite->_color.r, sprite->_color.g, sprite->_color.b, sprite->_color.a);
+	glColor4f(sprite->_color.r, sprite->_color.g, sprite->_color.b, sprite->_color.a * alphaScale);
 	
 	// Make sure to enable the states that let us bind and draw the texture.
 	glEnable(GL_TEXTURE_2D);
@@ -1127,18 +1018,33 @@ void CGraphics::bindImage(const CImage* image)
 	glGenTextures (1, &texture_name);
 	glBindTexture (GL_TEXTURE_2D, texture_name);
 	
-	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);	// Linear Filtering
-	//glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);	// Linear Filtering
+	uploadImage(image);
+}
+
+
+void CGraphics::uploadImage(const CImage* image)
+{
+	int num_levels = image->getNumLevels();
+	
+	// Only cooked images carry mip levels.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (num_levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);	// Linear Filtering
 	
-	glTexImage2D (GL_TEXTURE_2D, 
-				  0, 
-				  image->getGLFormat(),
-				  image->getWidth(),
-				  image->getHeight(),
-				  0, 
-				  image->getGLFormat(), 
-				  GL_UNSIGNED_BYTE,
-				  image->getImageData());
+	for (int i = 0; i < num_levels; ++i)
+	{
+		unsigned long width, height;
+		const GLvoid* data = image->getLevelData(i, &width, &height);
+		
+		glTexImage2D (GL_TEXTURE_2D, 
+					  i, 
+					  image->getGLFormat(),
+					  width,
+					  height,
+					  0, 
+					  image->getGLFormat(), 
+					  GL_UNSIGNED_BYTE,
+					  data);
+	}
 }
 
 
@@ -1485,4 +1391,442 @@ void CGraphics::buildTriangleTexCoords(GLfloat* texCoords, const float x, const
 	texCoords[(5 * NUM_ELEMENTS_PER_VERTEX_2D) + 0] = (offsetX + clipW);	//	X
 	texCoords[(5 * NUM_ELEMENTS_PER_VERTEX_2D) + 1] = (offsetY);			//	Y
 #endif
-}
\ No newline at end of file
+}
+
+
+void CGraphics::initStreamBuffers()
+{
+	destroyStreamBuffers();
+	
+	glGenBuffers(STREAM_BUFFER_COUNT, _stream_buffers);
+	_stream_buffer_size = STREAM_BUFFER_SIZE;
+	
+	for (int i = 0; i < STREAM_BUFFER_COUNT; ++i)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, _stream_buffers[i]);
+		glBufferData(GL_ARRAY_BUFFER, _stream_buffer_size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	
+	_stream_buffer_index = 0;
+	_stream_buffer_offset = 0;
+	
+	// Every quad is made of the same 2 triangles, so the indices never change and only need to be uploaded once.
+	ArrayList<GLushort> indices = ArrayList<GLushort>::alloc(QUAD_INDEX_MAX_QUADS * 6);
+	
+	for (int i = 0; i < QUAD_INDEX_MAX_QUADS; ++i)
+	{
+		GLushort vertex = (GLushort)(i * 4);
+		
+		// First triangle: top left, top right, bottom left.
+		indices[(i * 6) + 0] = vertex + 0;
+		indices[(i * 6) + 1] = vertex + 1;
+		indices[(i * 6) + 2] = vertex + 2;
+		
+		// Second triangle: bottom left, top right, bottom right.
+		indices[(i * 6) + 3] = vertex + 2;
+		indices[(i * 6) + 4] = vertex + 1;
+		indices[(i * 6) + 5] = vertex + 3;
+	}
+	
+	glGenBuffers(1, &_quad_index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quad_index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.length(), indices.getRawPtr(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	
+	indices = NULL;
+}
+
+
+void CGraphics::destroyStreamBuffers()
+{
+	if (_stream_buffers[0] != 0)
+	{
+		glDeleteBuffers(STREAM_BUFFER_COUNT, _stream_buffers);
+		memset(_stream_buffers, 0, sizeof(GLuint) * STREAM_BUFFER_COUNT);
+	}
+	
+	if (_quad_index_buffer != 0)
+	{
+		glDeleteBuffers(1, &_quad_index_buffer);
+		_quad_index_buffer = 0;
+	}
+}
+
+
+void CGraphics::beginStreamFrame()
+{
+	if (_stream_buffers[0] == 0)
+	{
+		return;
+	}
+	
+	_stream_buffer_index = (_stream_buffer_index + 1) % STREAM_BUFFER_COUNT;
+	_stream_buffer_offset = 0;
+	
+	// Orphan the buffer. The driver hands us fresh storage while the GPU may still be reading the old contents.
+	glBindBuffer(GL_ARRAY_BUFFER, _stream_buffers[_stream_buffer_index]);
+	glBufferData(GL_ARRAY_BUFFER, _stream_buffer_size, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+int CGraphics::streamVertices(const void* data, const int size)
+{
+	if ((_stream_buffers[0] == 0) || (size <= 0))
+	{
+		return -1;
+	}
+	
+	if (size > STREAM_BUFFER_SIZE_MAX)
+	{
+		if (!_is_stream_overflow_reported)
+		{
+			DPRINT_GRAPHICS("CGraphics::streamVertices: %d bytes are more than STREAM_BUFFER_SIZE_MAX, drawing from client-side arrays instead \n", size);
+			_is_stream_overflow_reported = TRUE;
+		}
+		
+		return -1;
+	}
+	
+	glBindBuffer(GL_ARRAY_BUFFER, _stream_buffers[_stream_buffer_index]);
+	
+	if ((_stream_buffer_offset + size) > _stream_buffer_size)
+	{
+		// Grow the buffers to fit the upload. The other buffers take the new size when beginStreamFrame() orphans them.
+		while (_stream_buffer_size < size)
+		{
+			_stream_buffer_size = min(_stream_buffer_size * 2, STREAM_BUFFER_SIZE_MAX);
+		}
+		
+		// Everything written so far has already been drawn, so the buffer can be orphaned and written again from the start.
+		glBufferData(GL_ARRAY_BUFFER, _stream_buffer_size, NULL, GL_STREAM_DRAW);
+		_stream_buffer_offset = 0;
+	}
+	
+	int offset = _stream_buffer_offset;
+	
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	
+	// Keep the next range 4 byte aligned.
+	_stream_buffer_offset += (size + 3) & ~3;
+	
+	return offset;
+}
+
+
+void CGraphics::unbindStreamBuffer()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void CGraphics::drawQuads(const int numQuads)
+{
+	if ((numQuads <= 0) || (_quad_index_buffer == 0))
+	{
+		return;
+	}
+	
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quad_index_buffer);
+	glDrawElements(GL_TRIANGLES, min(numQuads, QUAD_INDEX_MAX_QUADS) * 6, GL_UNSIGNED_SHORT, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	
+#if defined (ENABLE_POLY_COUNT)
+	updatePolyCount(min(numQuads, QUAD_INDEX_MAX_QUADS) * 2);
+#endif
+}
+
+
+const GLfloat* CGraphics::getUnitCircle(const int segments)
+{
+	if (_unit_circles == NULL)
+	{
+		_unit_circles = ArrayList<unitCircle>::alloc(SHAPE_UNIT_CIRCLE_CACHE_SIZE);
+	}
+	
+	_shape_use_stamp++;
+	
+	unitCircle* oldest = &_unit_circles[0];
+	
+	for (int i = 0; i < SHAPE_UNIT_CIRCLE_CACHE_SIZE; ++i)
+	{
+		if (_unit_circles[i].segments == segments)
+		{
+			_unit_circles[i].last_used = _shape_use_stamp;
+			return _unit_circles[i].points;
+		}
+		
+		// Unused entries have a zero stamp, so they are always picked first.
+		if (_unit_circles[i].last_used < oldest->last_used)
+		{
+			oldest = &_unit_circles[i];
+		}
+	}
+	
+	oldest->segments = segments;
+	oldest->last_used = _shape_use_stamp;
+	
+	for (int i = 0; i < segments; ++i)
+	{
+		float angle = (FLOAT_2_PI * i) / segments;
+		
+		oldest->points[(i * 2) + 0] = cosf(angle);
+		oldest->points[(i * 2) + 1] = sinf(angle);
+	}
+	
+	return oldest->points;
+}
+
+
+void CGraphics::buildSliceFan(GLfloat* vertices, const int segments, const float radius, const float startDeg, const float endDeg)
+{
+	const GLfloat* circle = getUnitCircle(segments);
+	
+	// GL circles draw from the left and as the degrees increase, it draws clockwise.
+	for (int i = 0; i < segments; ++i)
+	{
+		float deg = (360.0f * i) / segments;
+		
+		// Special case handling 360 to 0 vertex.
+		if (((endDeg == 360.0) && (i == 0)) || ((deg >= startDeg) && (deg <= endDeg)))
+		{
+			vertices[(i * 2) + 0] = circle[(i * 2) + 0] * radius;
+			vertices[(i * 2) + 1] = circle[(i * 2) + 1] * radius;
+		}
+		else
+		{
+			vertices[(i * 2) + 0] = 0;
+			vertices[(i * 2) + 1] = 0;
+		}
+	}
+}
+
+
+// Returns TRUE if the triangle has no area, which happens when points of a circle slice collapse onto the center.
+static BOOL isTriangleEmpty(const GLfloat* a, const GLfloat* b, const GLfloat* c)
+{
+	float cross = ((b[0] - a[0]) * (c[1] - a[1])) - ((b[1] - a[1]) * (c[0] - a[0]));
+	
+	return (fabsf(cross) < 0.0001f);
+}
+
+
+int CGraphics::fanToQuads(GLfloat* quads, const int maxQuads, const GLfloat* fan, const int numFanVertices, const float x, const float y)
+{
+	int num_quads = 0;
+	int i = 1;
+	
+	// Fan triangle i is made of the first vertex, vertex i and vertex i + 1.
+	while (((i + 1) < numFanVertices) && (num_quads < maxQuads))
+	{
+		const GLfloat* pivot = &fan[0];
+		const GLfloat* curr = &fan[i * 2];
+		const GLfloat* next = &fan[(i + 1) * 2];
+		
+		if (isTriangleEmpty(pivot, curr, next))
+		{
+			++i;
+			continue;
+		}
+		
+		// The quad index order draws triangles (0, 1, 2) and (2, 1, 3), so the shared edge goes from vertex 1 to vertex 2.
+		const GLfloat* last = next;
+		
+		if (((i + 2) < numFanVertices) && !isTriangleEmpty(pivot, next, &fan[(i + 2) * 2]))
+		{
+			last = &fan[(i + 2) * 2];
+			i += 2;
+		}
+		else
+		{
+			// A lone triangle repeats its last vertex, which makes the second triangle of the quad empty.
+			i += 1;
+		}
+		
+		GLfloat* quad = &quads[num_quads * 4 * 2];
+		
+		quad[0] = curr[0] + x;
+		quad[1] = curr[1] + y;
+		quad[2] = pivot[0] + x;
+		quad[3] = pivot[1] + y;
+		quad[4] = next[0] + x;
+		quad[5] = next[1] + y;
+		quad[6] = last[0] + x;
+		quad[7] = last[1] + y;
+		
+		num_quads++;
+	}
+	
+	return num_quads;
+}
+
+
+const shapeMesh* CGraphics::getShapeMesh(eShapeType type, const int segments, const float w, const float h, const float param0, const float param1)
+{
+	if (_shape_meshes == NULL)
+	{
+		_shape_meshes = ArrayList<shapeMesh>::alloc(SHAPE_CACHE_SIZE);
+	}
+	
+	int num_segments = min(max(segments, 3), SHAPE_MAX_SEGMENTS);
+	
+	_shape_use_stamp++;
+	
+	shapeMesh* oldest = &_shape_meshes[0];
+	
+	for (int i = 0; i < SHAPE_CACHE_SIZE; ++i)
+	{
+		shapeMesh* mesh = &_shape_meshes[i];
+		
+		if ((mesh->last_used != 0) && 
+			(mesh->type == type) && 
+			(mesh->segments == num_segments) && 
+			(mesh->w == w) && 
+			(mesh->h == h) && 
+			(mesh->param0 == param0) && 
+			(mesh->param1 == param1))
+		{
+			mesh->last_used = _shape_use_stamp;
+			return mesh;
+		}
+		
+		// Unused entries have a zero stamp, so they are always picked first.
+		if (mesh->last_used < oldest->last_used)
+		{
+			oldest = mesh;
+		}
+	}
+	
+	// Not cached, so build it into the least recently used entry.
+	shapeMesh* mesh = oldest;
+	
+	mesh->type = type;
+	mesh->segments = num_segments;
+	mesh->w = w;
+	mesh->h = h;
+	mesh->param0 = param0;
+	mesh->param1 = param1;
+	mesh->last_used = _shape_use_stamp;
+	mesh->num_outline_vertices = 0;
+	mesh->num_quads = 0;
+	
+	switch (type)
+	{
+		case eShapeEllipse:
+		{
+			const GLfloat* circle = getUnitCircle(num_segments);
+			
+			for (int i = 0; i < num_segments; ++i)
+			{
+				mesh->outline[(i * 2) + 0] = circle[(i * 2) + 0] * w;
+				mesh->outline[(i * 2) + 1] = circle[(i * 2) + 1] * h;
+			}
+			
+			mesh->num_outline_vertices = num_segments;
+			mesh->num_quads = fanToQuads(mesh->quads, SHAPE_MAX_QUADS, mesh->outline, num_segments, 0.0, 0.0);
+		}
+			break;
+			
+		case eShapeCircleSlice:
+		{
+			buildSliceFan(mesh->outline, num_segments, w, param0, param1);
+			
+			mesh->num_outline_vertices = num_segments;
+			mesh->num_quads = fanToQuads(mesh->quads, SHAPE_MAX_QUADS, mesh->outline, num_segments, 0.0, 0.0);
+		}
+			break;
+			
+		case eShapeRoundedRect:
+		{
+			float radius = param0;
+			
+			// The four corners: top left, top right, bottom left, bottom right.
+			const float corners[4][4] = 
+			{
+				{radius, radius, 180.0, 270.0},
+				{w - radius, radius, 270.0, 360.0},
+				{radius, h - radius, 90.0, 180.0},
+				{w - radius, h - radius, 0.0, 90.0},
+			};
+			
+			GLfloat fan[SHAPE_MAX_SEGMENTS * 2];
+			
+			for (int i = 0; i < 4; ++i)
+			{
+				buildSliceFan(fan, num_segments, radius, corners[i][2], corners[i][3]);
+				
+				mesh->num_quads += fanToQuads(
+											  &mesh->quads[mesh->num_quads * 4 * 2], 
+											  SHAPE_MAX_QUADS - mesh->num_quads, 
+											  fan, 
+											  num_segments, 
+											  corners[i][0], 
+											  corners[i][1]);
+			}
+			
+			// The middle column covers the full height, the left and right strips fill in between the corners.
+			const float strips[3][4] = 
+			{
+				{radius, 0.0, w - (radius * 2), h},
+				{0.0, radius, radius, h - (radius * 2)},
+				{w - radius, radius, radius, h - (radius * 2)},
+			};
+			
+			for (int i = 0; (i < 3) && (mesh->num_quads < SHAPE_MAX_QUADS); ++i)
+			{
+				buildQuadVertices(&mesh->quads[mesh->num_quads * 4 * 2], strips[i][0], strips[i][1], strips[i][2], strips[i][3]);
+				mesh->num_quads++;
+			}
+		}
+			break;
+	}
+	
+	return mesh;
+}
+
+
+void CGraphics::drawShapeMesh(const shapeMesh* mesh, const float x, const float y, color theColor, BOOL bFilled)
+{
+	if (bFilled)
+	{
+		if (_sprite_batch)
+		{
+			_sprite_batch->addQuads(mesh->quads, mesh->num_quads, x, y, theColor);
+			return;
+		}
+		
+		glPushMatrix();
+		glLoadIdentity();
+		glTranslatef(x, y, 0.0);
+		
+		glColor4f(theColor.r, theColor.g, theColor.b, theColor.a);
+		glVertexPointer(2, GL_FLOAT, 0, mesh->quads);
+		
+		drawQuads(mesh->num_quads);
+		
+		glPopMatrix();
+	}
+	else
+	{
+		if (mesh->num_outline_vertices <= 0)
+		{
+			return;
+		}
+		
+		glPushMatrix();
+		glLoadIdentity();
+		glTranslatef(x, y, 0.0);
+		
+		glColor4f(theColor.r, theColor.g, theColor.b, theColor.a);
+		glVertexPointer(2, GL_FLOAT, 0, mesh->outline);
+		
+		glDrawArrays(GL_LINE_LOOP, 0, mesh->num_outline_vertices);
+		
+		glPopMatrix();
+		
+#if defined (ENABLE_POLY_COUNT)
+		updatePolyCount(mesh->num_outline_vertices);
+#endif
+	}
+}
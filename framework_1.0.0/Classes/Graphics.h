@@ -7,6 +7,7 @@
 #include "Sprite.h"
 #include "3DObj.h"
 #include "Utils.h"
+#include "ArrayList.h"
 
 
 #define NUM_ELEMENTS_PER_VERTEX_2D	2
@@ -15,6 +16,56 @@
 static const GLfloat ROUNDED_RECT_CORNER_RADIUS = 5.0;
 static const int ROUNDED_RECT_SEGMENTS = 8;
 static const color black_color = {0, 0, 0, 1.0};
+static const int STREAM_BUFFER_COUNT = 3;				// The number of streaming vertex buffers that are cycled through, one per frame.
+static const int STREAM_BUFFER_SIZE = 1024 * 1024;		// The starting size in bytes of each streaming vertex buffer.
+static const int STREAM_BUFFER_SIZE_MAX = 32 * 1024 * 1024;	// The largest that the streaming vertex buffers are grown to. Larger uploads fall back to client-side arrays.
+static const int QUAD_INDEX_MAX_QUADS = 65536 / 4;		// The number of quads in the quad index buffer. Limited by the range of 16 bit indices.
+static const int SHAPE_CACHE_SIZE = 16;				// The number of tessellated shapes that are kept around.
+static const int SHAPE_UNIT_CIRCLE_CACHE_SIZE = 8;	// The number of unit circle tables that are kept around, one per segment count.
+static const int SHAPE_MAX_SEGMENTS = 128;			// Shapes are never built with more segments than this.
+static const int SHAPE_MAX_QUADS = SHAPE_MAX_SEGMENTS;	// The most quads a tessellated shape can hold.
+
+class CSpriteBatch;
+
+/*! \enum eShapeType
+ * The shapes that are tessellated and cached.
+ */
+typedef enum _eShapeType
+{
+	eShapeEllipse = 0,		/*!< An ellipse or circle. */
+	eShapeCircleSlice,		/*!< A slice of a circle. */
+	eShapeRoundedRect,		/*!< A rounded rectangle. */
+} eShapeType;
+
+/*! \struct unitCircle
+ *	\brief The cos and sin of every segment angle of a circle with the given number of segments.
+ */
+typedef struct unitCircle
+{
+	int segments;			/*!< The number of segments. Zero marks an unused entry. */
+	unsigned int last_used;	/*!< The use stamp of the last lookup, used to pick which table to replace. */
+	GLfloat points[SHAPE_MAX_SEGMENTS * 2];	/*!< The x and y of every segment point on the unit circle. */
+} unitCircle;
+
+/*! \struct shapeMesh
+ *	\brief A tessellated shape, relative to its position.
+ *
+ * The mesh is keyed by everything that affects its vertices, so drawing the same shape again only needs to offset the cached vertices.
+ */
+typedef struct shapeMesh
+{
+	eShapeType type;		/*!< The shape. */
+	int segments;			/*!< The number of segments. */
+	GLfloat w;				/*!< The width of the shape, or the radius of a circle slice. */
+	GLfloat h;				/*!< The height of the shape. */
+	GLfloat param0;			/*!< The start angle of a circle slice, or the corner radius of a rounded rectangle. */
+	GLfloat param1;			/*!< The end angle of a circle slice. */
+	unsigned int last_used;	/*!< The use stamp of the last lookup, used to pick which mesh to replace. Zero marks an unused entry. */
+	int num_outline_vertices;	/*!< The number of outline vertices. */
+	int num_quads;				/*!< The number of filled quads. */
+	GLfloat outline[SHAPE_MAX_SEGMENTS * 2];	/*!< The outline of the shape, which is also the triangle fan that fills it. */
+	GLfloat quads[SHAPE_MAX_QUADS * 4 * 2];		/*!< The filled shape as quads, ready for CGraphics::drawQuads() or a CSpriteBatch. */
+} shapeMesh;
 
 /*! \class CGraphics
  * \brief The Graphics class.
@@ -350,6 +401,7 @@ public:
 	/*! \fn drawSprite(const CSprite* sprite, const float x, const float y)
 	 *  \brief Renders a sprite on the screen.
 	 *  
+	 * A flipbook sprite is rendered as the frames that are showing, faded into each other when the flipbook is blended.
 	 *	\param sprite The sprite to be rendered.
 	 *	\param x The x location where the sprite will be rendered.
 	 *	\param y The y location where the sprite will be rendered.
@@ -366,7 +418,7 @@ public:
 	 */
 	static void drawSprite(const CSprite* sprite);
 	
-	/*! \fn drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH)
+	/*! \fn drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale)
 	 *  \brief Renders a sprite on the screen.
 	 *  
 	 * This function allows for setting an internal clipping location and area of the sprite.
@@ -378,9 +430,10 @@ public:
 	 *	\param offsetY The y offset in the sprite where the blit will begin.
 	 *	\param clipW The clip width of the sprite blit.
 	 *	\param clipH The clip height of the sprite blit.
+	 *	\param alphaScale The share of the sprite alpha that the clip is drawn with, used to fade flipbook frames into each other.
 	 *  \return n/a
 	 */
-	static void drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH);
+	static void drawSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale = 1.0f);
 
 	/*! \fn drawSpriteCentered(const CSprite* sprite)
 	 *  \brief Renders a sprite on the screen.
@@ -409,6 +462,15 @@ public:
 	 */
 	static void bindImage(const CImage* image);
 	
+	/*! \fn uploadImage(const CImage* image)
+	 *  \brief Uploads the image data to the currently bound texture and sets its filtering.
+	 *  
+	 * Every mip level of a cooked image is uploaded straight from its mapping.
+	 *	\param image The image to upload.
+	 *  \return n/a
+	 */
+	static void uploadImage(const CImage* image);
+	
 	/*! \fn drawImage(const CImage* image, const float x, const float y, GLuint texName)
 	 *  \brief Renders an image on the screen.
 	 *  
@@ -542,6 +604,147 @@ public:
 	 *  \return n/a
 	 */
 	static void buildTriangleTexCoords(GLfloat* texCoords, const float x, const float y, const float w, const float h, const CImage* image);
+	
+	/*! \fn initStreamBuffers(void)
+	 *  \brief Creates the streaming vertex buffers and the static quad index buffer. Must be called after the GL context is created.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static void initStreamBuffers(void);
+	
+	/*! \fn destroyStreamBuffers(void)
+	 *  \brief Deletes the streaming vertex buffers and the static quad index buffer.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static void destroyStreamBuffers(void);
+	
+	/*! \fn beginStreamFrame(void)
+	 *  \brief Moves on to the next streaming vertex buffer. Called once at the start of every frame.
+	 *  
+	 * The next buffer is orphaned before it is written to, so the driver never has to wait for the GPU to finish with the previous contents.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static void beginStreamFrame(void);
+	
+	/*! \fn streamVertices(const void* data, const int size)
+	 *  \brief Copies vertex data into the current streaming vertex buffer and leaves that buffer bound.
+	 *  
+	 * While the buffer is bound, the pointers given to glVertexPointer and the like are offsets into the buffer. Call unbindStreamBuffer() once drawing is done.
+	 * The data must be drawn before the next call, since a buffer that is full is orphaned and written again from the start. The buffers grow, up to
+	 * #STREAM_BUFFER_SIZE_MAX, to fit the largest upload.
+	 *	\param data The vertex data to copy.
+	 *	\param size The size of the vertex data in bytes.
+	 *  \return The byte offset of the data within the buffer, or -1 if the data is larger than #STREAM_BUFFER_SIZE_MAX. The caller should fall back to client-side arrays in that case.
+	 */
+	static int streamVertices(const void* data, const int size);
+	
+	/*! \fn unbindStreamBuffer(void)
+	 *  \brief Unbinds the streaming vertex buffer so that client-side arrays can be used again.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static void unbindStreamBuffer(void);
+	
+	/*! \fn drawQuads(const int numQuads)
+	 *  \brief Draws quads using the static quad index buffer.
+	 *  
+	 * Each quad is made of 4 vertices in the order top left, top right, bottom left, bottom right, starting at the current vertex pointers.
+	 *	\param numQuads The number of quads to draw. Must not be more than #QUAD_INDEX_MAX_QUADS.
+	 *  \return n/a
+	 */
+	static void drawQuads(const int numQuads);
+	
+	/*! \fn setSpriteBatch(CSpriteBatch* batch)
+	 *  \brief Routes the 2D drawSprite() calls into the given sprite batch instead of drawing them right away.
+	 *  
+	 * This is normally set by CSpriteBatch::begin() and CSpriteBatch::end().
+	 *	\param batch The sprite batch, or NULL to draw sprites right away.
+	 *  \return n/a
+	 */
+	static inline void setSpriteBatch(CSpriteBatch* batch) { _sprite_batch = batch; }
+	
+	/*! \fn getSpriteBatch(void)
+	 *  \brief Returns the sprite batch that the 2D drawSprite() calls are routed into, or NULL if there is none.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static inline CSpriteBatch* getSpriteBatch(void) { return _sprite_batch; }
+	
+private:
+	/*! \fn getUnitCircle(const int segments)
+	 *  \brief Returns the unit circle table for the given number of segments, building it if it is not cached yet.
+	 *  
+	 *	\param segments The number of segments.
+	 *  \return The x and y of every segment point on the unit circle.
+	 */
+	static const GLfloat* getUnitCircle(const int segments);
+	
+	/*! \fn getShapeMesh(eShapeType type, const int segments, const float w, const float h, const float param0, const float param1)
+	 *  \brief Returns the tessellated shape, building it into the least recently used cache entry if it is not cached yet.
+	 *  
+	 *	\param type The shape.
+	 *	\param segments The number of segments.
+	 *	\param w The width of the shape, or the radius of a circle slice.
+	 *	\param h The height of the shape.
+	 *	\param param0 The start angle of a circle slice, or the corner radius of a rounded rectangle.
+	 *	\param param1 The end angle of a circle slice.
+	 *  \return The tessellated shape.
+	 */
+	static const shapeMesh* getShapeMesh(eShapeType type, const int segments, const float w, const float h, const float param0, const float param1);
+	
+	/*! \fn buildSliceFan(GLfloat* vertices, const int segments, const float radius, const float startDeg, const float endDeg)
+	 *  \brief Builds the triangle fan of a circle slice. Points outside of the slice collapse onto the center.
+	 *  
+	 *	\param vertices The vertices to fill. Must hold segments vertices.
+	 *	\param segments The number of segments.
+	 *	\param radius The radius of the circle slice.
+	 *	\param startDeg The start angle.
+	 *	\param endDeg The end angle.
+	 *  \return n/a
+	 */
+	static void buildSliceFan(GLfloat* vertices, const int segments, const float radius, const float startDeg, const float endDeg);
+	
+	/*! \fn fanToQuads(GLfloat* quads, const int maxQuads, const GLfloat* fan, const int numFanVertices, const float x, const float y)
+	 *  \brief Converts a triangle fan into quads. Every pair of neighbouring fan triangles shares an edge and becomes one quad, and triangles with no area are dropped.
+	 *  
+	 *	\param quads The quads to fill.
+	 *	\param maxQuads The number of quads that fit in quads.
+	 *	\param fan The triangle fan vertices.
+	 *	\param numFanVertices The number of triangle fan vertices.
+	 *	\param x The x offset added to every vertex.
+	 *	\param y The y offset added to every vertex.
+	 *  \return The number of quads written.
+	 */
+	static int fanToQuads(GLfloat* quads, const int maxQuads, const GLfloat* fan, const int numFanVertices, const float x, const float y);
+	
+	/*! \fn drawShapeMesh(const shapeMesh* mesh, const float x, const float y, color theColor, BOOL bFilled)
+	 *  \brief Draws a tessellated shape, or adds it to the current sprite batch.
+	 *  
+	 *	\param mesh The tessellated shape.
+	 *	\param x The x location of the shape.
+	 *	\param y The y location of the shape.
+	 *	\param theColor The color of the shape.
+	 *	\param bFilled Indicates whether the shape will be filled or be rendered as a frame.
+	 *  \return n/a
+	 */
+	static void drawShapeMesh(const shapeMesh* mesh, const float x, const float y, color theColor, BOOL bFilled);
+	
+	static GLuint _stream_buffers[STREAM_BUFFER_COUNT];	/*!< The streaming vertex buffers. */
+	static int _stream_buffer_index;	/*!< The streaming vertex buffer used for the current frame. */
+	static int _stream_buffer_offset;	/*!< The byte offset in the current streaming vertex buffer where the next data will be written. */
+	static int _stream_buffer_size;		/*!< The size in bytes of the streaming vertex buffers. */
+	static BOOL _is_stream_overflow_reported;	/*!< Indicates that an upload too large for the streaming vertex buffers has already been reported. */
+	static GLuint _quad_index_buffer;	/*!< The index buffer shared by all quad draws. */
+	static CSpriteBatch* _sprite_batch;	/*!< The sprite batch that 2D sprites are routed into, if any. */
+	static ArrayList<unitCircle> _unit_circles;	/*!< The cached unit circle tables. */
+	static ArrayList<shapeMesh> _shape_meshes;	/*!< The cached tessellated shapes. */
+	static unsigned int _shape_use_stamp;		/*!< Incremented on every shape cache lookup. */
 };
 
 
@@ -10,12 +10,15 @@
 #define __IMAGE_H__
 
 #include <OpenGLES/ES1/gl.h>
+#include <stddef.h>
+#include "CookedTexture.h"
 
 
 /*! \class CImage
  * \brief The Image class.
  *
  * The Image class is responsible for loading and holding image data loaded from the disk. It does not contain any rendering functionality; That is the responsibility of the CGraphics class.
+ * If a cooked texture (see CookedTexture.h) exists next to the image, it is memory mapped instead, and the image data points straight into the mapping.
  */
 class CImage
 {
@@ -28,6 +31,16 @@ private:
 	unsigned long _width;	/*!< The pixel width of the image. */
 	unsigned long _height;	/*!< The pixel height of the image. */
 	int _gl_format;			/*!< Retrieved from pngLoad, will either be GL_RGB or GL_RGBA. */
+	void* _mapped_data;		/*!< The memory mapped cooked texture, or NULL if the image was decoded. */
+	size_t _mapped_size;	/*!< The byte size of #_mapped_data. */
+	
+	/*! \fn loadCooked(const char* filePath)
+	 *  \brief Memory maps a cooked texture.
+	 *  
+	 *	\param filePath The absolute path to the cooked texture.
+	 *  \return TRUE if the cooked texture was valid and is now mapped.
+	 */
+	bool loadCooked(const char* filePath);
 	
 public:
 	
@@ -72,6 +85,32 @@ public:
 	 */
 	inline int getGLFormat(void) const {return _gl_format;}
 	
+	/*! \fn isCooked()
+	 *  \brief Returns true if the image data is mapped from a cooked texture.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline bool isCooked(void) const {return (_mapped_data != NULL);}
+	
+	/*! \fn getNumLevels()
+	 *  \brief Returns the number of mip levels in the image data. Decoded images only have the base level.
+	 *  
+	 *	\param n/a
+	 *  \return The number of mip levels.
+	 */
+	int getNumLevels(void) const;
+	
+	/*! \fn getLevelData(int level, unsigned long* width, unsigned long* height)
+	 *  \brief Returns the image data of one mip level.
+	 *  
+	 *	\param level The mip level, where zero is the base level.
+	 *	\param width Set to the pixel width of the level.
+	 *	\param height Set to the pixel height of the level.
+	 *  \return The image data of the level, or NULL if the level does not exist.
+	 */
+	const GLvoid* getLevelData(int level, unsigned long* width, unsigned long* height) const;
+	
 #if defined (ENABLE_PNGLOAD)
 	/*! \fn getImageData()
 	 *  \brief Returns the image data of the loaded image.
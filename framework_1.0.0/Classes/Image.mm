@@ -2,12 +2,18 @@
 #import <OpenGLES/ES1/gl.h>
 #import <OpenGLES/ES1/glext.h>
 #include "Image.h"
+#include "MappedFile.h"
 #include "Utils.h"
 //#include "SystemDefines.h"
 
 CImage::CImage()
 {
-	
+	_image_data = NULL;
+	_width = 0;
+	_height = 0;
+	_gl_format = GL_RGBA;
+	_mapped_data = NULL;
+	_mapped_size = 0;
 }
 
 CImage::~CImage()
@@ -17,6 +23,9 @@ CImage::~CImage()
 
 void CImage::load(const char* fileName)
 {
+	// Images can be decoded on the image loader threads, which have no autorelease pool of their own.
+	NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+	
 	char* file_name = (char*)fileName;
 	// Parse out the filename and extension type from the file_name passed in
 	NSString *nsFullFileName = [NSString stringWithUTF8String:file_name];
@@ -24,6 +33,16 @@ void CImage::load(const char* fileName)
 	NSString *fileType = [nsFullFileName pathExtension];
 	
 	NSString* filePath;
+	
+	// A cooked texture is ready to upload as it is, so it is used instead of decoding the image whenever it exists.
+	filePath = [[NSBundle mainBundle] pathForResource:nsFileName ofType:@COOKED_TEXTURE_EXTENSION];
+	
+	if ((filePath != nil) && (loadCooked([filePath UTF8String])))
+	{
+		[pool release];
+		return;
+	}
+	
 	// Get the absolute path to the file
 	filePath = [[NSBundle mainBundle] pathForResource:nsFileName ofType:fileType];
 	
@@ -78,11 +97,115 @@ void CImage::load(const char* fileName)
 		//free(spriteData);
 	}
 #endif
+	
+	[pool release];
+}
+
+
+bool CImage::loadCooked(const char* filePath)
+{
+	size_t file_size = 0;
+	
+	// The mapping is used as it is. Pages are only read from flash when OpenGL touches them.
+	const unsigned char* mapped_data = mapFile(filePath, &file_size);
+	
+	if (mapped_data == NULL)
+	{
+		return false;
+	}
+	
+	if (file_size < sizeof(cookedTextureHeader))
+	{
+		unmapFile(mapped_data, file_size);
+		return false;
+	}
+	
+	const cookedTextureHeader* header = (const cookedTextureHeader*)mapped_data;
+	bool is_valid = ((header->magic == COOKED_TEXTURE_MAGIC) &&
+					 (header->version == COOKED_TEXTURE_VERSION) &&
+					 (header->format == eCookedTextureFormatRGBA8888) &&
+					 (header->num_levels >= 1) &&
+					 (header->num_levels <= (unsigned int)COOKED_TEXTURE_MAX_LEVELS));
+	
+	for (unsigned int i = 0; (is_valid) && (i < header->num_levels); ++i)
+	{
+		const cookedTextureLevel* level = &header->levels[i];
+		
+		is_valid = ((level->offset <= file_size) &&
+					(level->size <= (file_size - level->offset)) &&
+					(level->size >= (level->width * level->height * 4)));
+	}
+	
+	if (!is_valid)
+	{
+#if defined (DEBUG_IMAGE_ERROR)
+		DPRINT_IMAGE("CImage::loadCooked failed: %s is not a valid cooked texture", filePath);
+#endif
+		unmapFile(mapped_data, file_size);
+		return false;
+	}
+	
+	_mapped_data = (void*)mapped_data;
+	_mapped_size = file_size;
+	_width = header->width;
+	_height = header->height;
+	_gl_format = GL_RGBA;
+#if defined (ENABLE_PNGLOAD)
+	_image_data = (char*)mapped_data + header->levels[0].offset;
+#else
+	_image_data = (GLubyte*)mapped_data + header->levels[0].offset;
+#endif
+	
+	return true;
+}
+
+
+int CImage::getNumLevels() const
+{
+	if (_mapped_data)
+	{
+		return (int)((const cookedTextureHeader*)_mapped_data)->num_levels;
+	}
+	
+	return (_image_data != NULL) ? 1 : 0;
+}
+
+
+const GLvoid* CImage::getLevelData(int level, unsigned long* width, unsigned long* height) const
+{
+	if ((level < 0) || (level >= getNumLevels()))
+	{
+		return NULL;
+	}
+	
+	if (_mapped_data)
+	{
+		const cookedTextureLevel* cooked_level = &((const cookedTextureHeader*)_mapped_data)->levels[level];
+		
+		*width = cooked_level->width;
+		*height = cooked_level->height;
+		
+		return (const char*)_mapped_data + cooked_level->offset;
+	}
+	
+	*width = _width;
+	*height = _height;
+	
+	return _image_data;
 }
 
 
 void CImage::unload()
 {
+	// Mapped image data belongs to the mapping.
+	if (_mapped_data)
+	{
+		unmapFile((const unsigned char*)_mapped_data, _mapped_size);
+		_mapped_data = NULL;
+		_mapped_size = 0;
+		_image_data = NULL;
+	}
+	
 	if (_image_data)
 	{
 		delete _image_data;
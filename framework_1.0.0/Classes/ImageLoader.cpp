@@ -2,48 +2,739 @@
 #include "ImageLoader.h"
 #include "Image.h"
 #include "Sprite.h"
+#include "SystemDefines.h"
+#include "ThreadPool.h"
+#include "Graphics.h"
 #include <string.h>
+#include <sys/time.h>
 #include "AppDefines.h"
 
 #if defined (ENABLE_IMAGELOADER_SYSTEM)
 
 CImageLoader::CImageLoader()
 {
-	memset(&_images, 0, sizeof(CImage*) * MAX_LOADED_IMAGES);
+	memset(_images, 0, sizeof(CImage) * MAX_LOADED_IMAGES);
+	memset(_image_states, 0, sizeof(int) * MAX_LOADED_IMAGES);
+	memset(_tex_names, 0, sizeof(GLuint) * MAX_LOADED_IMAGES);
+	memset(_packs, 0, sizeof(imagePackRequest) * IMAGE_LOADER_MAX_PACKS);
+	memset(_ref_counts, 0, sizeof(int) * MAX_LOADED_IMAGES);
+	memset(_last_used, 0, sizeof(uint32) * MAX_LOADED_IMAGES);
+	memset(&_stats, 0, sizeof(imageCacheStats));
+	_use_clock = 0;
+	_memory_budget = IMAGE_LOADER_MEMORY_BUDGET;
+	memset(&_queue, 0, sizeof(imageQueue));
+	memset(&_warm_queue, 0, sizeof(imageQueue));
+	memset(_load_sources, 0, sizeof(int) * MAX_LOADED_IMAGES);
+	memset(_first_use_waits, 0, sizeof(long) * MAX_LOADED_IMAGES);
+	gettimeofday(&_trace_start, NULL);
+	_next_pack_handle = 0;
+	_num_threads = 0;
+	_is_shutting_down = FALSE;
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+	{
+		_first_use_times[i] = -1;
+	}
+
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_work_cond, NULL);
+	pthread_cond_init(&_done_cond, NULL);
 }
 
 CImageLoader::~CImageLoader()
+{
+	destroy();
+
+	pthread_cond_destroy(&_done_cond);
+	pthread_cond_destroy(&_work_cond);
+	pthread_mutex_destroy(&_mutex);
+}
+
+void CImageLoader::init(const int numThreads)
+{
+	destroy();
+
+	// The image trace is measured from here.
+	gettimeofday(&_trace_start, NULL);
+
+	int num_threads = numThreads;
+
+	// Leave one core for the GL thread.
+	if (num_threads <= 0)
+	{
+		num_threads = CThreadPool::getNumCores() - 1;
+	}
+
+	num_threads = min(max(num_threads, 1), IMAGE_LOADER_MAX_THREADS);
+
+	for (int i = 0; i < num_threads; ++i)
+	{
+		if (pthread_create(&_threads[i], NULL, workerMain, this) != 0)
+		{
+			DPRINT_IMAGE("CImageLoader::init failed: Could not create decode thread %d \n", i);
+			break;
+		}
+
+		_num_threads++;
+	}
+}
+
+void CImageLoader::destroy()
 {
 	unloadImagePack();
+
+	pthread_mutex_lock(&_mutex);
+	memset(&_queue, 0, sizeof(imageQueue));
+	memset(&_warm_queue, 0, sizeof(imageQueue));
+	_is_shutting_down = TRUE;
+	pthread_cond_broadcast(&_work_cond);
+	pthread_mutex_unlock(&_mutex);
+
+	for (int i = 0; i < _num_threads; ++i)
+	{
+		pthread_join(_threads[i], NULL);
+	}
+
+	_num_threads = 0;
+	_is_shutting_down = FALSE;
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+	{
+		unloadImage(i);
+	}
 }
 
 void CImageLoader::loadImagePack(const uint32 imagePack[], int numImages)
 {
-	// Unload any currently loaded image pack.
-	unloadImagePack();
-	
+	// Reference and queue everything first so that the decode threads work on the pack while this thread waits.
+	for (int i = 0; i < numImages; ++i)
+	{
+		retainImage(imagePack[i]);
+	}
+
+	for (int i = 0; i < numImages; ++i)
+	{
+		finishImage(imagePack[i]);
+	}
+
+	trimCache(_memory_budget);
+}
+
+void CImageLoader::loadImagePackLazy(const uint32 imagePack[], int numImages, BOOL warmUp)
+{
+	pthread_mutex_lock(&_mutex);
+
+	for (int i = 0; i < numImages; ++i)
+	{
+		uint32 image_id = imagePack[i];
+
+		if (image_id >= MAX_LOADED_IMAGES)
+		{
+			continue;
+		}
+
+		// Only the reference is registered now, getImage() loads the image on first use.
+		_ref_counts[image_id]++;
+
+		if ((warmUp) && (_image_states[image_id] == eImageStateUnloaded))
+		{
+			_load_sources[image_id] = eImageLoadSourceWarmUp;
+			queueImage(image_id, TRUE);
+		}
+	}
+
+	pthread_cond_broadcast(&_work_cond);
+	pthread_mutex_unlock(&_mutex);
+}
+
+int CImageLoader::loadImagePackAsync(const uint32 imagePack[], int numImages, imagePackCallback callback, void* data)
+{
+	for (int i = 0; i < numImages; ++i)
+	{
+		retainImage(imagePack[i]);
+	}
+
+	for (int i = 0; i < IMAGE_LOADER_MAX_PACKS; ++i)
+	{
+		if (!_packs[i].is_active)
+		{
+			_packs[i].is_active = TRUE;
+			_packs[i].handle = _next_pack_handle++;
+			_packs[i].num_images = min(numImages, (int)MAX_LOADED_IMAGES);
+			_packs[i].callback = callback;
+			_packs[i].data = data;
+			memcpy(_packs[i].image_ids, imagePack, sizeof(uint32) * _packs[i].num_images);
+
+			return _packs[i].handle;
+		}
+	}
+
+	DPRINT_IMAGE("CImageLoader::loadImagePackAsync error: Too many pack loads are pending, the pack is loading without a handle \n");
+	return -1;
+}
+
+void CImageLoader::prefetchImagePack(const uint32 imagePack[], int numImages)
+{
+	pthread_mutex_lock(&_mutex);
+
 	for (int i = 0; i < numImages; ++i)
 	{
-		//_images[imagePack[i]] = new CImage();
-		
-		// Grab the filename here.
-		_images[imagePack[i]].load(imageFileNames[imagePack[i]]);
+		if (imagePack[i] < MAX_LOADED_IMAGES)
+		{
+			requestImage(imagePack[i], eImageLoadSourcePrefetch);
+		}
+	}
+
+	pthread_cond_broadcast(&_work_cond);
+	pthread_mutex_unlock(&_mutex);
+}
+
+BOOL CImageLoader::isImagePackLoaded(const int packHandle)
+{
+	imagePackRequest* pack = findPack(packHandle);
+
+	// Packs are forgotten once their callback has run.
+	if (pack == NULL)
+	{
+		return TRUE;
+	}
+
+	return isPackReady(*pack);
+}
+
+void CImageLoader::waitImagePack(const int packHandle)
+{
+	imagePackRequest* pack = findPack(packHandle);
+
+	if (pack == NULL)
+	{
+		return;
+	}
+
+	for (int i = 0; i < pack->num_images; ++i)
+	{
+		finishImage(pack->image_ids[i]);
+	}
+
+	pack->is_active = FALSE;
+
+	if (pack->callback)
+	{
+		pack->callback(pack->data, pack->handle);
+	}
+}
+
+void CImageLoader::update(const int budgetMS)
+{
+	struct timeval start_time, curr_time;
+	gettimeofday(&start_time, NULL);
+	BOOL did_upload = FALSE;
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+	{
+		pthread_mutex_lock(&_mutex);
+		BOOL is_decoded = (_image_states[i] == eImageStateDecoded);
+		pthread_mutex_unlock(&_mutex);
+
+		if (!is_decoded)
+		{
+			continue;
+		}
+
+		uploadImage(i);
+		did_upload = TRUE;
+
+		gettimeofday(&curr_time, NULL);
+		int elapsed_ms = ((curr_time.tv_sec - start_time.tv_sec) * 1000) + ((curr_time.tv_usec - start_time.tv_usec) / 1000);
+
+		// The rest of the uploads wait for the next frame.
+		if (elapsed_ms >= budgetMS)
+		{
+			break;
+		}
+	}
+
+	// Prefetched images add to the cache as they arrive.
+	if (did_upload)
+	{
+		trimCache(_memory_budget);
+	}
+
+	for (int i = 0; i < IMAGE_LOADER_MAX_PACKS; ++i)
+	{
+		if (_packs[i].is_active && isPackReady(_packs[i]))
+		{
+			// Free the slot first, so that the callback can start another pack load.
+			_packs[i].is_active = FALSE;
+
+			if (_packs[i].callback)
+			{
+				_packs[i].callback(_packs[i].data, _packs[i].handle);
+			}
+		}
 	}
 }
 
 void CImageLoader::unloadImagePack()
 {
-	for (int i = 0; i < MAX_LOADED_IMAGES; ++i)
+	memset(_ref_counts, 0, sizeof(int) * MAX_LOADED_IMAGES);
+
+	for (int i = 0; i < IMAGE_LOADER_MAX_PACKS; ++i)
+	{
+		_packs[i].is_active = FALSE;
+	}
+
+	trimCache(_memory_budget);
+}
+
+void CImageLoader::unloadImagePack(const uint32 imagePack[], int numImages)
+{
+	for (int i = 0; i < numImages; ++i)
+	{
+		releaseImage(imagePack[i]);
+	}
+
+	trimCache(_memory_budget);
+}
+
+void CImageLoader::retainImage(uint32 imageID)
+{
+	if (imageID >= MAX_LOADED_IMAGES)
+	{
+		return;
+	}
+
+	_ref_counts[imageID]++;
+
+	pthread_mutex_lock(&_mutex);
+	requestImage(imageID, eImageLoadSourcePack);
+	pthread_cond_broadcast(&_work_cond);
+	pthread_mutex_unlock(&_mutex);
+}
+
+void CImageLoader::releaseImage(uint32 imageID)
+{
+	if ((imageID >= MAX_LOADED_IMAGES) || (_ref_counts[imageID] <= 0))
+	{
+		DPRINT_IMAGE("CImageLoader::releaseImage error: Image %d is not referenced \n", (int)imageID);
+		return;
+	}
+
+	_ref_counts[imageID]--;
+}
+
+void CImageLoader::setMemoryBudget(const int bytes)
+{
+	_memory_budget = max(bytes, 0);
+
+	trimCache(_memory_budget);
+}
+
+void CImageLoader::purgeImageCache()
+{
+	trimCache(0);
+}
+
+imageCacheStats CImageLoader::getCacheStats()
+{
+	imageCacheStats stats = _stats;
+
+	stats.num_cached = 0;
+	stats.num_referenced = 0;
+	stats.memory_used = 0;
+	stats.memory_budget = _memory_budget;
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+	{
+		int bytes = getImageBytes(i);
+
+		if (bytes > 0)
+		{
+			stats.num_cached++;
+			stats.memory_used += bytes;
+
+			if (_ref_counts[i] > 0)
+			{
+				stats.num_referenced++;
+			}
+		}
+	}
+
+	return stats;
+}
+
+void CImageLoader::resetCacheStats()
+{
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.evictions = 0;
+	_stats.first_use_loads = 0;
+}
+
+void CImageLoader::printImageTrace()
+{
+	static const char* source_names[] = {"unloaded", "pack", "prefetch", "warm-up", "first use"};
+
+	DPRINT_IMAGE("CImageLoader image trace: \n");
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
 	{
-		_images[i].unload();
+		if ((_load_sources[i] == eImageLoadSourceNone) && (_first_use_times[i] < 0))
+		{
+			continue;
+		}
+
+		if (_first_use_times[i] < 0)
+		{
+			DPRINT_IMAGE("  %3d %-12s never used \n", (int)i, source_names[_load_sources[i]]);
+		}
+		else
+		{
+			DPRINT_IMAGE("  %3d %-12s first used at %ld ms, waited %ld us \n", (int)i, source_names[_load_sources[i]], _first_use_times[i] / 1000, _first_use_waits[i]);
+		}
 	}
 }
 
 CImage* CImageLoader::getImage(uint32 imageID)
 {
+	// The id is unsigned, so a negative id passed in by mistake shows up as a very large one.
+	if (((int)imageID < 0) || (imageID >= MAX_LOADED_IMAGES))
+	{
+		DPRINT_IMAGE("CImageLoader::getImage error: Image %d is out of range \n", (int)imageID);
+		return NULL;
+	}
+
+	BOOL is_first_use = (_first_use_times[imageID] < 0);
+	long start_time = getTraceTime();
+
+	pthread_mutex_lock(&_mutex);
+	requestImage(imageID, eImageLoadSourceFirstUse);
+	pthread_mutex_unlock(&_mutex);
+
+	finishImage(imageID);
+
+	if (is_first_use)
+	{
+		touchImage(imageID);
+		_first_use_waits[imageID] = getTraceTime() - start_time;
+	}
+
 	return &_images[imageID];
 }
 
+GLuint CImageLoader::getTexName(const CImage* image)
+{
+	if ((image < &_images[0]) || (image >= &_images[MAX_LOADED_IMAGES]))
+	{
+		return 0;
+	}
+
+	uint32 image_id = (uint32)(image - &_images[0]);
+
+	if (getImageState(image_id) == eImageStateUnloaded)
+	{
+		return 0;
+	}
+
+	touchImage(image_id);
+	finishImage(image_id);
+
+	return _tex_names[image_id];
+}
+
+int CImageLoader::getImageState(uint32 imageID)
+{
+	pthread_mutex_lock(&_mutex);
+	int state = _image_states[imageID];
+	pthread_mutex_unlock(&_mutex);
+
+	return state;
+}
+
+void CImageLoader::requestImage(uint32 imageID, const int source)
+{
+	_last_used[imageID] = ++_use_clock;
+
+	if (_image_states[imageID] == eImageStateUnloaded)
+	{
+		_stats.misses++;
+		_load_sources[imageID] = source;
+	}
+	else
+	{
+		_stats.hits++;
+	}
+
+	// A lazy image that the warm-up queue has not reached yet is loaded by its first use after all.
+	if ((source == eImageLoadSourceFirstUse) && ((_image_states[imageID] == eImageStateUnloaded) || (_image_states[imageID] == eImageStateQueued)))
+	{
+		_load_sources[imageID] = source;
+		_stats.first_use_loads++;
+	}
+
+	queueImage(imageID);
+}
+
+void CImageLoader::touchImage(uint32 imageID)
+{
+	if (_first_use_times[imageID] < 0)
+	{
+		_first_use_times[imageID] = getTraceTime();
+	}
+}
+
+long CImageLoader::getTraceTime()
+{
+	struct timeval curr_time;
+	gettimeofday(&curr_time, NULL);
+
+	return ((curr_time.tv_sec - _trace_start.tv_sec) * 1000000) + (curr_time.tv_usec - _trace_start.tv_usec);
+}
+
+void CImageLoader::trimCache(const int budget)
+{
+	int memory_used = 0;
+
+	for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+	{
+		memory_used += getImageBytes(i);
+	}
+
+	while (memory_used > budget)
+	{
+		int lru_id = -1;
+
+		// Only images that no pack references can be evicted. Images that are still being decoded are left alone.
+		for (uint32 i = 0; i < MAX_LOADED_IMAGES; ++i)
+		{
+			if ((_ref_counts[i] <= 0) && (getImageBytes(i) > 0) && ((lru_id < 0) || (_last_used[i] < _last_used[lru_id])))
+			{
+				lru_id = (int)i;
+			}
+		}
+
+		// Everything that is left is in use.
+		if (lru_id < 0)
+		{
+			break;
+		}
+
+		memory_used -= getImageBytes(lru_id);
+		unloadImage(lru_id);
+		_stats.evictions++;
+	}
+}
+
+int CImageLoader::getImageBytes(uint32 imageID)
+{
+	int state = getImageState(imageID);
+
+	if ((state != eImageStateDecoded) && (state != eImageStateReady))
+	{
+		return 0;
+	}
+
+	int bytes_per_pixel = (_images[imageID].getGLFormat() == GL_RGBA) ? 4 : 3;
+
+	return (int)(_images[imageID].getWidth() * _images[imageID].getHeight()) * bytes_per_pixel;
+}
+
+void CImageLoader::queueImage(uint32 imageID, const BOOL isWarmUp)
+{
+	if (_image_states[imageID] == eImageStateUnloaded)
+	{
+		_image_states[imageID] = eImageStateQueued;
+		pushQueue(isWarmUp ? &_warm_queue : &_queue, imageID);
+	}
+	else if ((_image_states[imageID] == eImageStateQueued) && (!isWarmUp))
+	{
+		// The image may only be waiting for warm-up, so make sure it is in the main queue too. Whichever entry is reached first loads it.
+		pushQueue(&_queue, imageID);
+	}
+}
+
+void CImageLoader::pushQueue(imageQueue* queue, uint32 imageID)
+{
+	// An image that was unloaded while queued may still be in the queue, it is picked up from there.
+	for (int i = 0; i < queue->count; ++i)
+	{
+		if (queue->ids[(queue->head + i) % MAX_LOADED_IMAGES] == imageID)
+		{
+			return;
+		}
+	}
+
+	queue->ids[(queue->head + queue->count) % MAX_LOADED_IMAGES] = imageID;
+	queue->count++;
+}
+
+uint32 CImageLoader::popQueue(imageQueue* queue)
+{
+	uint32 image_id = queue->ids[queue->head];
+	queue->head = (queue->head + 1) % MAX_LOADED_IMAGES;
+	queue->count--;
+
+	return image_id;
+}
+
+void CImageLoader::finishImage(uint32 imageID)
+{
+	if (imageID >= MAX_LOADED_IMAGES)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&_mutex);
+
+	if (_image_states[imageID] == eImageStateUnloaded)
+	{
+		queueImage(imageID);
+	}
+
+	if (_image_states[imageID] == eImageStateQueued)
+	{
+		// No decode thread has picked the image up yet, so decode it here rather than wait. The queue entry is skipped by the decode threads.
+		_image_states[imageID] = eImageStateDecoding;
+		pthread_mutex_unlock(&_mutex);
+
+		_images[imageID].load(imageFileNames[imageID]);
+
+		pthread_mutex_lock(&_mutex);
+		_image_states[imageID] = eImageStateDecoded;
+		pthread_cond_broadcast(&_done_cond);
+	}
+
+	waitForDecode(imageID);
+
+	BOOL is_decoded = (_image_states[imageID] == eImageStateDecoded);
+
+	pthread_mutex_unlock(&_mutex);
+
+	if (is_decoded)
+	{
+		uploadImage(imageID);
+	}
+}
+
+void CImageLoader::waitForDecode(uint32 imageID)
+{
+	while (_image_states[imageID] == eImageStateDecoding)
+	{
+		pthread_cond_wait(&_done_cond, &_mutex);
+	}
+}
+
+void CImageLoader::uploadImage(uint32 imageID)
+{
+	CImage* image = &_images[imageID];
+
+	// Only the GL thread changes a decoded image, so no lock is needed past this point.
+	if (getImageState(imageID) != eImageStateDecoded)
+	{
+		return;
+	}
+
+	if (image->getImageData())
+	{
+		glGenTextures(1, &_tex_names[imageID]);
+		glBindTexture(GL_TEXTURE_2D, _tex_names[imageID]);
+
+		CGraphics::uploadImage(image);
+	}
+	else
+	{
+		DPRINT_IMAGE("CImageLoader::uploadImage error: Image %d has no data \n", (int)imageID);
+	}
+
+	pthread_mutex_lock(&_mutex);
+	_image_states[imageID] = eImageStateReady;
+	pthread_mutex_unlock(&_mutex);
+}
+
+void CImageLoader::unloadImage(uint32 imageID)
+{
+	pthread_mutex_lock(&_mutex);
+
+	// An image can't be taken away from a decode thread, so wait for it to finish.
+	waitForDecode(imageID);
+
+	_image_states[imageID] = eImageStateUnloaded;
+
+	pthread_mutex_unlock(&_mutex);
+
+	if (_tex_names[imageID])
+	{
+		glDeleteTextures(1, &_tex_names[imageID]);
+		_tex_names[imageID] = 0;
+	}
+
+	_images[imageID].unload();
+}
+
+BOOL CImageLoader::isPackReady(const imagePackRequest& pack)
+{
+	for (int i = 0; i < pack.num_images; ++i)
+	{
+		if ((pack.image_ids[i] < MAX_LOADED_IMAGES) && (getImageState(pack.image_ids[i]) != eImageStateReady))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+imagePackRequest* CImageLoader::findPack(const int packHandle)
+{
+	for (int i = 0; i < IMAGE_LOADER_MAX_PACKS; ++i)
+	{
+		if (_packs[i].is_active && (_packs[i].handle == packHandle))
+		{
+			return &_packs[i];
+		}
+	}
+
+	return NULL;
+}
+
+void* CImageLoader::workerMain(void* loader)
+{
+	CImageLoader* image_loader = (CImageLoader*)loader;
+
+	pthread_mutex_lock(&image_loader->_mutex);
+
+	while (!image_loader->_is_shutting_down)
+	{
+		if ((image_loader->_queue.count <= 0) && (image_loader->_warm_queue.count <= 0))
+		{
+			pthread_cond_wait(&image_loader->_work_cond, &image_loader->_mutex);
+			continue;
+		}
+
+		// Warm-up images only load when nothing else is waiting.
+		uint32 image_id = (image_loader->_queue.count > 0) ? popQueue(&image_loader->_queue) : popQueue(&image_loader->_warm_queue);
+
+		// The image may have been unloaded, or taken by a thread that needed it right away.
+		if (image_loader->_image_states[image_id] != eImageStateQueued)
+		{
+			continue;
+		}
+
+		image_loader->_image_states[image_id] = eImageStateDecoding;
+		pthread_mutex_unlock(&image_loader->_mutex);
+
+		image_loader->_images[image_id].load(imageFileNames[image_id]);
+
+		pthread_mutex_lock(&image_loader->_mutex);
+		image_loader->_image_states[image_id] = eImageStateDecoded;
+		pthread_cond_broadcast(&image_loader->_done_cond);
+	}
+
+	pthread_mutex_unlock(&image_loader->_mutex);
+
+	return NULL;
+}
+
 #else
 
 CImageLoader::CImageLoader()
@@ -56,7 +747,47 @@ CImageLoader::~CImageLoader()
 
 }
 
-void CImageLoader::loadImagePack(int *imagePack, int numImages)
+void CImageLoader::init(const int numThreads)
+{
+
+}
+
+void CImageLoader::destroy()
+{
+
+}
+
+void CImageLoader::loadImagePack(const uint32 imagePack[], int numImages)
+{
+
+}
+
+void CImageLoader::loadImagePackLazy(const uint32 imagePack[], int numImages, BOOL warmUp)
+{
+
+}
+
+int CImageLoader::loadImagePackAsync(const uint32 imagePack[], int numImages, imagePackCallback callback, void* data)
+{
+	return -1;
+}
+
+void CImageLoader::prefetchImagePack(const uint32 imagePack[], int numImages)
+{
+
+}
+
+BOOL CImageLoader::isImagePackLoaded(const int packHandle)
+{
+	return TRUE;
+}
+
+void CImageLoader::waitImagePack(const int packHandle)
+{
+
+}
+
+void CImageLoader::update(const int budgetMS)
 {
 
 }
@@ -66,9 +797,62 @@ void CImageLoader::unloadImagePack()
 
 }
 
+void CImageLoader::unloadImagePack(const uint32 imagePack[], int numImages)
+{
+
+}
+
+void CImageLoader::retainImage(uint32 imageID)
+{
+
+}
+
+void CImageLoader::releaseImage(uint32 imageID)
+{
+
+}
+
+void CImageLoader::setMemoryBudget(const int bytes)
+{
+
+}
+
+void CImageLoader::purgeImageCache()
+{
+
+}
+
+imageCacheStats CImageLoader::getCacheStats()
+{
+	imageCacheStats stats;
+	memset(&stats, 0, sizeof(imageCacheStats));
+
+	return stats;
+}
+
+void CImageLoader::resetCacheStats()
+{
+
+}
+
+void CImageLoader::printImageTrace()
+{
+
+}
+
 CImage* CImageLoader::getImage(uint32 imageID)
 {
+	return NULL;
+}
 
+GLuint CImageLoader::getTexName(const CImage* image)
+{
+	return 0;
+}
+
+int CImageLoader::getImageState(uint32 imageID)
+{
+	return eImageStateUnloaded;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,18 +1,97 @@
 #ifndef __IMAGELOADER_H__
 #define __IMAGELOADER_H__
 
+#include <pthread.h>
+#include <sys/time.h>
+#include <OpenGLES/ES1/gl.h>
 #include "types.h"
 #include "Image.h"
 
 const uint32 MAX_LOADED_IMAGES = 256;	/*!< The maximum size of any image pack. */
+const int IMAGE_LOADER_MAX_THREADS = 4;	/*!< The maximum number of image decode threads. */
+const int IMAGE_LOADER_MAX_PACKS = 8;	/*!< The maximum number of asynchronous pack loads that can be waited on at once. */
+const int IMAGE_LOADER_UPLOAD_BUDGET_MS = 4;	/*!< The default time in milliseconds that update() may spend uploading textures each frame. */
+const int IMAGE_LOADER_MEMORY_BUDGET = 24 * 1024 * 1024;	/*!< The default number of bytes of image data that is kept cached after its packs are unloaded. */
 
 
 class CSprite;
 
+/*! \enum eImageState
+ *	\brief The loading state of an image in the image loader.
+ */
+typedef enum _eImageState
+{
+	eImageStateUnloaded = 0,	/*!< The image is not loaded. */
+	eImageStateQueued,			/*!< The image is waiting for a decode thread. */
+	eImageStateDecoding,		/*!< The image is being decoded. */
+	eImageStateDecoded,			/*!< The image data is loaded, but its texture has not been uploaded yet. */
+	eImageStateReady,			/*!< The image data is loaded and its texture is uploaded. */
+} eImageState;
+
+/*! \enum eImageLoadSource
+ *	\brief What caused an image to be loaded, as shown by the image trace.
+ */
+typedef enum _eImageLoadSource
+{
+	eImageLoadSourceNone = 0,	/*!< The image was never loaded. */
+	eImageLoadSourcePack,		/*!< The image was loaded up front by a pack. */
+	eImageLoadSourcePrefetch,	/*!< The image was prefetched for a screen. */
+	eImageLoadSourceWarmUp,		/*!< The lazy image was loaded by the background warm-up queue before it was used. */
+	eImageLoadSourceFirstUse,	/*!< The image was loaded when it was first used. */
+} eImageLoadSource;
+
+/*! \struct imageQueue
+ *	\brief A ring of images waiting for a decode thread.
+ */
+typedef struct imageQueue
+{
+	uint32 ids[MAX_LOADED_IMAGES];	/*!< The images, in the order they were queued. */
+	int head;						/*!< The index of the next image in #ids. */
+	int count;						/*!< The number of images in the queue. */
+} imageQueue;
+
+/*! \struct imageCacheStats
+ *	\brief Statistics of the image cache.
+ */
+typedef struct imageCacheStats
+{
+	int hits;				/*!< The number of image requests that found the image already loaded or loading. */
+	int misses;				/*!< The number of image requests that had to load the image from disk. */
+	int evictions;			/*!< The number of unreferenced images that were unloaded to stay within the memory budget. */
+	int first_use_loads;	/*!< The number of images that were not loaded until they were first used. */
+	int num_cached;			/*!< The number of images that are currently loaded. */
+	int num_referenced;		/*!< The number of loaded images that are referenced by at least one pack. */
+	int memory_used;		/*!< The number of bytes of image data currently loaded. */
+	int memory_budget;		/*!< The memory budget in bytes. */
+} imageCacheStats;
+
+/*! \typedef imagePackCallback
+ *	\brief Called on the GL thread when every image of an asynchronous pack load is ready.
+ */
+typedef void (*imagePackCallback)(void* data, int packHandle);
+
+/*! \struct imagePackRequest
+ *	\brief An asynchronous pack load that is waiting for its images.
+ */
+typedef struct imagePackRequest
+{
+	BOOL is_active;						/*!< Indicates that this request is in use. */
+	int handle;							/*!< The handle returned to the caller. */
+	uint32 image_ids[MAX_LOADED_IMAGES];	/*!< The images of the pack. */
+	int num_images;						/*!< The number of images in the pack. */
+	imagePackCallback callback;			/*!< The completion callback, or NULL. */
+	void* data;							/*!< The data passed to the completion callback. */
+} imagePackRequest;
+
+
 /*! \class CImageLoader
  * \brief The Image Loader class.
  *
  * The purpose of the Image Loader class is to organize image loading and unloading into packs, or groups of images. This enables more efficient use of memory and also better organization.
+ * Images are decoded on background threads, and their textures are uploaded on the GL thread in update() within a time budget, so packs can be loaded while the current screen keeps rendering.
+ * The loader owns one texture per image, which every sprite made from that image shares.
+ * Every image is reference counted by the packs that loaded it. Unloading a pack only releases its references, and unreferenced images stay cached until the memory budget
+ * is exceeded, when the least recently used ones are unloaded first. Going back to a screen whose images are still cached does not load anything from disk.
  */
 class CImageLoader
 {
@@ -35,32 +114,338 @@ public:
 	 */
 	~CImageLoader();
 	
+	/*! \fn init(const int numThreads = 0)
+	 *  \brief Starts the image decode threads.
+	 *
+	 *	\param numThreads The number of decode threads, clamped to #IMAGE_LOADER_MAX_THREADS. Zero uses one thread for every core besides the GL thread.
+	 *  \return n/a
+	 */
+	void init(const int numThreads = 0);
+
+	/*! \fn destroy(void)
+	 *  \brief Unloads every image and stops the decode threads.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void destroy(void);
+
 	/*! \fn loadImagePack(const uint32 imagePack[], int numImages)
 	 *  \brief Loads a group of images into memory.
 	 *  
-	 * This function takes an array of image IDs and loads all images from disk into the image array #_images.
+	 * This function takes an array of image IDs and loads all images from disk into the image array #_images, adding a reference to each of them.
+	 * Images that are already cached or prefetched are not loaded again. This call blocks until the whole pack is ready.
 	 *	\param imagePack The array of image IDs.
 	 *	\param numImages The number of images in the image ID array.
 	 *  \return n/a
 	 */
 	void loadImagePack(const uint32 imagePack[], int numImages);
 	
+	/*! \fn loadImagePackLazy(const uint32 imagePack[], int numImages, BOOL warmUp = TRUE)
+	 *  \brief Registers a group of images without loading them.
+	 *
+	 * A reference is added to every image of the pack, but an image is only loaded when getImage() first asks for it. This keeps images that a screen rarely needs off its first frame.
+	 *	\param imagePack The array of image IDs.
+	 *	\param numImages The number of images in the image ID array.
+	 *	\param warmUp If TRUE, the images are also loaded in the background once every other queued image is done, so first use rarely has to wait.
+	 *  \return n/a
+	 */
+	void loadImagePackLazy(const uint32 imagePack[], int numImages, BOOL warmUp = TRUE);
+
+	/*! \fn loadImagePackAsync(const uint32 imagePack[], int numImages, imagePackCallback callback = NULL, void* data = NULL)
+	 *  \brief Starts loading a group of images in the background.
+	 *
+	 * A reference is added to every image of the pack, as with loadImagePack(). The callback is called from update() once every image of the pack is ready.
+	 *	\param imagePack The array of image IDs.
+	 *	\param numImages The number of images in the image ID array.
+	 *	\param callback The completion callback, or NULL.
+	 *	\param data The data passed to the completion callback.
+	 *  \return A handle to wait on the pack with, or -1 if too many packs are already being waited on. The images are loaded either way.
+	 */
+	int loadImagePackAsync(const uint32 imagePack[], int numImages, imagePackCallback callback = NULL, void* data = NULL);
+
+	/*! \fn prefetchImagePack(const uint32 imagePack[], int numImages)
+	 *  \brief Starts loading a group of images in the background, without a handle to wait on.
+	 *
+	 * No references are added, so the images are cached but can be evicted until a pack that contains them is loaded.
+	 *	\param imagePack The array of image IDs.
+	 *	\param numImages The number of images in the image ID array.
+	 *  \return n/a
+	 */
+	void prefetchImagePack(const uint32 imagePack[], int numImages);
+
+	/*! \fn isImagePackLoaded(const int packHandle)
+	 *  \brief Returns TRUE if every image of an asynchronous pack load is ready.
+	 *
+	 *	\param packHandle The handle returned by loadImagePackAsync().
+	 *  \return n/a
+	 */
+	BOOL isImagePackLoaded(const int packHandle);
+
+	/*! \fn waitImagePack(const int packHandle)
+	 *  \brief Blocks until every image of an asynchronous pack load is ready, then calls its callback.
+	 *
+	 *	\param packHandle The handle returned by loadImagePackAsync().
+	 *  \return n/a
+	 */
+	void waitImagePack(const int packHandle);
+
+	/*! \fn update(const int budgetMS = IMAGE_LOADER_UPLOAD_BUDGET_MS)
+	 *  \brief Uploads the textures of decoded images and calls the callbacks of finished packs. This must be called on the GL thread once per frame.
+	 *
+	 * At least one texture is uploaded per call, so loading always makes progress.
+	 *	\param budgetMS The time in milliseconds that may be spent uploading textures.
+	 *  \return n/a
+	 */
+	void update(const int budgetMS = IMAGE_LOADER_UPLOAD_BUDGET_MS);
+
 	/*! \fn unloadImagePack()
-	 *  \brief Unloads all images that have been loaded into #_images.
+	 *  \brief Releases every image reference held by the loaded packs.
 	 *  
-	 * This can safely be called at any time, even if there are no images currently loaded.
+	 * This can safely be called at any time, even if there are no images currently loaded. The images stay cached until they are evicted, and prefetched images keep loading.
+	 * Pending asynchronous pack loads are forgotten without calling their callbacks.
 	 *	\param n/a
 	 *  \return n/a
 	 */
 	void unloadImagePack();
 
+	/*! \fn unloadImagePack(const uint32 imagePack[], int numImages)
+	 *  \brief Releases the image references added by loading a pack.
+	 *
+	 *	\param imagePack The array of image IDs.
+	 *	\param numImages The number of images in the image ID array.
+	 *  \return n/a
+	 */
+	void unloadImagePack(const uint32 imagePack[], int numImages);
+
+	/*! \fn retainImage(uint32 imageID)
+	 *  \brief Adds a reference to an image, starting to load it if it is not cached.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void retainImage(uint32 imageID);
+
+	/*! \fn releaseImage(uint32 imageID)
+	 *  \brief Removes a reference from an image. The image stays cached until it is evicted.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void releaseImage(uint32 imageID);
+
+	/*! \fn setMemoryBudget(const int bytes)
+	 *  \brief Sets the number of bytes of image data that may stay loaded, evicting unreferenced images if needed.
+	 *
+	 * Referenced images are never evicted, so the budget can be exceeded by the images that are in use.
+	 *	\param bytes The memory budget in bytes.
+	 *  \return n/a
+	 */
+	void setMemoryBudget(const int bytes);
+
+	/*! \fn purgeImageCache(void)
+	 *  \brief Unloads every unreferenced image, for instance when the system is low on memory.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void purgeImageCache(void);
+
+	/*! \fn getCacheStats(void)
+	 *  \brief Returns the statistics of the image cache.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	imageCacheStats getCacheStats(void);
+
+	/*! \fn printImageTrace(void)
+	 *  \brief Prints every image that was loaded or used since init(), with what loaded it, when it was first used and how long first use had to wait.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void printImageTrace(void);
+
+	/*! \fn resetCacheStats(void)
+	 *  \brief Resets the hit, miss and eviction counters.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void resetCacheStats(void);
+
 	/*! \fn getImage(uint32 imageID)
 	 *  \brief Retrieves an image from the group of loaded images.
 	 *  
+	 * If the image is still loading, this waits for it. An image that is not loaded at all is loaded on the spot.
 	 *	\param imageID The image ID of the image to be retrieved.
 	 *  \return Pointer to the image CImage.
 	 */
 	CImage* getImage(uint32 imageID);
+
+	/*! \fn getTexName(const CImage* image)
+	 *  \brief Returns the texture of an image that belongs to the image loader, uploading it first if needed.
+	 *
+	 *	\param image The image.
+	 *  \return The texture name, or zero if the image does not belong to the image loader or is not loaded.
+	 */
+	GLuint getTexName(const CImage* image);
+
+	/*! \fn getImageState(uint32 imageID)
+	 *  \brief Returns the loading state of an image, one of #eImageState.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	int getImageState(uint32 imageID);
+
+private:
+	/*! \fn requestImage(uint32 imageID, const int source)
+	 *  \brief Marks an image as used, counts a cache hit or miss and queues the image if it is not cached. The mutex must be locked when this is called.
+	 *
+	 *	\param imageID The image ID.
+	 *	\param source What the image is loaded for if it is not cached, one of #eImageLoadSource.
+	 *  \return n/a
+	 */
+	void requestImage(uint32 imageID, const int source);
+
+	/*! \fn touchImage(uint32 imageID)
+	 *  \brief Records the first use of an image for the image trace.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void touchImage(uint32 imageID);
+
+	/*! \fn getTraceTime(void)
+	 *  \brief Returns the time in microseconds since init().
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	long getTraceTime(void);
+
+	/*! \fn trimCache(const int budget)
+	 *  \brief Unloads the least recently used unreferenced images until the loaded image data fits in the budget.
+	 *
+	 *	\param budget The number of bytes that may stay loaded.
+	 *  \return n/a
+	 */
+	void trimCache(const int budget);
+
+	/*! \fn getImageBytes(uint32 imageID)
+	 *  \brief Returns the number of bytes of image data that an image holds, or zero if it is not decoded.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	int getImageBytes(uint32 imageID);
+
+	/*! \fn queueImage(uint32 imageID, const BOOL isWarmUp = FALSE)
+	 *  \brief Hands an unloaded image to the decode threads. The mutex must be locked when this is called.
+	 *
+	 * An image that is only queued for warm-up is moved up to the main queue when it is queued again normally.
+	 *	\param imageID The image ID.
+	 *	\param isWarmUp If TRUE, the image waits in the warm-up queue, which the decode threads only take from when the main queue is empty.
+	 *  \return n/a
+	 */
+	void queueImage(uint32 imageID, const BOOL isWarmUp = FALSE);
+
+	/*! \fn pushQueue(imageQueue* queue, uint32 imageID)
+	 *  \brief Adds an image to a queue, unless the queue already holds it.
+	 *
+	 *	\param queue The queue.
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	static void pushQueue(imageQueue* queue, uint32 imageID);
+
+	/*! \fn popQueue(imageQueue* queue)
+	 *  \brief Removes and returns the next image of a non-empty queue.
+	 *
+	 *	\param queue The queue.
+	 *  \return n/a
+	 */
+	static uint32 popQueue(imageQueue* queue);
+
+	/*! \fn finishImage(uint32 imageID)
+	 *  \brief Makes sure that an image is decoded and uploaded, decoding it on the calling thread if no decode thread has picked it up yet.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void finishImage(uint32 imageID);
+
+	/*! \fn waitForDecode(uint32 imageID)
+	 *  \brief Waits for a decode thread to finish an image that is being decoded. The mutex must be locked when this is called, and is locked when it returns.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void waitForDecode(uint32 imageID);
+
+	/*! \fn uploadImage(uint32 imageID)
+	 *  \brief Uploads the texture of a decoded image.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void uploadImage(uint32 imageID);
+
+	/*! \fn unloadImage(uint32 imageID)
+	 *  \brief Unloads a single image and deletes its texture.
+	 *
+	 *	\param imageID The image ID.
+	 *  \return n/a
+	 */
+	void unloadImage(uint32 imageID);
+
+	/*! \fn isPackReady(const imagePackRequest& pack)
+	 *  \brief Returns TRUE if every image of a pack is ready.
+	 *
+	 *	\param pack The pack.
+	 *  \return n/a
+	 */
+	BOOL isPackReady(const imagePackRequest& pack);
+
+	/*! \fn findPack(const int packHandle)
+	 *  \brief Returns the pending pack with the given handle, or NULL.
+	 *
+	 *	\param packHandle The pack handle.
+	 *  \return n/a
+	 */
+	imagePackRequest* findPack(const int packHandle);
+
+	/*! \fn workerMain(void* loader)
+	 *  \brief The entry point of every decode thread.
+	 *
+	 *	\param loader The image loader that owns the thread.
+	 *  \return n/a
+	 */
+	static void* workerMain(void* loader);
+
+	int _image_states[MAX_LOADED_IMAGES];		/*!< The loading state of every image, one of #eImageState. */
+	GLuint _tex_names[MAX_LOADED_IMAGES];		/*!< The texture of every ready image. */
+	imageQueue _queue;							/*!< The images waiting for a decode thread. */
+	imageQueue _warm_queue;						/*!< The lazy images waiting for a decode thread once #_queue is empty. */
+	int _load_sources[MAX_LOADED_IMAGES];		/*!< What caused every image to be loaded last, one of #eImageLoadSource. */
+	long _first_use_times[MAX_LOADED_IMAGES];	/*!< The time in microseconds since init() that every image was first used, or -1. */
+	long _first_use_waits[MAX_LOADED_IMAGES];	/*!< The time in microseconds that the first use of every image waited for it to load. */
+	struct timeval _trace_start;				/*!< The time init() was called. */
+	imagePackRequest _packs[IMAGE_LOADER_MAX_PACKS];	/*!< The asynchronous pack loads that are being waited on. */
+	int _next_pack_handle;						/*!< The handle of the next asynchronous pack load. */
+	int _ref_counts[MAX_LOADED_IMAGES];			/*!< The number of pack references to every image. */
+	uint32 _last_used[MAX_LOADED_IMAGES];		/*!< The value of #_use_clock when every image was last requested. */
+	uint32 _use_clock;							/*!< Counts image requests, to order the images from least to most recently used. */
+	int _memory_budget;							/*!< The number of bytes of image data that may stay loaded. */
+	imageCacheStats _stats;						/*!< The cache hit, miss and eviction counters. */
+	pthread_t _threads[IMAGE_LOADER_MAX_THREADS];	/*!< The decode threads. */
+	int _num_threads;							/*!< The number of decode threads. */
+	pthread_mutex_t _mutex;						/*!< Guards the image states and the queue. */
+	pthread_cond_t _work_cond;					/*!< Signaled when an image is queued or the loader is shutting down. */
+	pthread_cond_t _done_cond;					/*!< Signaled when an image finishes decoding. */
+	BOOL _is_shutting_down;						/*!< Tells the decode threads to exit. */
 };
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "Utils.h"
 #include "AppDefines.h"
 #include "GameData.h"
+#include "Engine.h"
+#include "SpriteBatch.h"
 
 #import "SoundEngine.h"
 
@@ -251,10 +253,15 @@ void CMenuSystem::draw(void)
 	// Draw the background menu rectangle first.
 	CGraphics::drawRoundedRect(_menu_stack[_curr_menu_stack_size]->_menu_rect);
 	
+	// The icons are collected and drawn together once all item rectangles are down.
+	GET_SPRITE_BATCH->begin();
+	
 	for (int i = 0; i < _menu_stack[_curr_menu_stack_size]->_num_menu_items; ++i)
 	{
 		drawMenuItem(_menu_stack[_curr_menu_stack_size]->_menu_items[i]);
 	}
+	
+	GET_SPRITE_BATCH->end();
 }
 
 void CMenuSystem::drawMenuItem(menuItem* pMenuItem)
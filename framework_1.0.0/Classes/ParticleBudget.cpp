@@ -0,0 +1,221 @@
+/*
+ *  ParticleBudget.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include "SystemDefines.h"
+#include "ParticleBudget.h"
+#include "ParticleSystem.h"
+
+
+CParticleBudget::CParticleBudget()
+{
+	_num_entries = 0;
+	_max_particles = PARTICLE_BUDGET_PARTICLES_DEFAULT;
+	_frame_time = PARTICLE_BUDGET_TIME_DEFAULT;
+	_particle_limit = PARTICLE_BUDGET_PARTICLES_DEFAULT;
+	_cost_per_particle = 0.0f;
+}
+
+
+CParticleBudget::~CParticleBudget()
+{
+	destroy();
+}
+
+
+void CParticleBudget::init(const int maxParticles, const int frameTime)
+{
+	destroy();
+
+	_max_particles = max(maxParticles, 0);
+	_frame_time = max(frameTime, 0);
+	_particle_limit = _max_particles;
+	_cost_per_particle = 0.0f;
+}
+
+
+void CParticleBudget::destroy()
+{
+	while (_num_entries > 0)
+	{
+		unregisterSystem(_entries[_num_entries - 1].system);
+	}
+}
+
+
+void CParticleBudget::update()
+{
+	int total_cost = 0;
+	int total_live = 0;
+
+	for (int i = 0; i < _num_entries; ++i)
+	{
+		particleBudgetEntry* entry = &_entries[i];
+
+		entry->avg_cost += (entry->frame_cost - entry->avg_cost) * PARTICLE_BUDGET_COST_SMOOTHING;
+		total_cost += entry->frame_cost;
+		total_live += entry->live_particles;
+		entry->frame_cost = 0;
+	}
+
+	// The cost per particle can only be measured on frames that had particles to measure.
+	if (total_live > 0)
+	{
+		float cost = (float)total_cost / total_live;
+
+		if (_cost_per_particle <= 0.0f)
+		{
+			_cost_per_particle = cost;
+		}
+		else
+		{
+			_cost_per_particle += (cost - _cost_per_particle) * PARTICLE_BUDGET_COST_SMOOTHING;
+		}
+	}
+
+	_particle_limit = _max_particles;
+
+	if (_cost_per_particle > 0.0f)
+	{
+		_particle_limit = min(_max_particles, (int)(_frame_time / _cost_per_particle));
+	}
+
+	// Hand out the particles in priority order. Systems with the same priority are served in the order they registered.
+	BOOL is_served[PARTICLE_BUDGET_SYSTEMS_MAX];
+	int remaining = _particle_limit;
+
+	memset(is_served, 0, sizeof(is_served));
+
+	for (int n = 0; n < _num_entries; ++n)
+	{
+		int next = -1;
+
+		for (int i = 0; i < _num_entries; ++i)
+		{
+			if (!is_served[i] && ((next < 0) || (_entries[i].priority > _entries[next].priority)))
+			{
+				next = i;
+			}
+		}
+
+		particleBudgetEntry* entry = &_entries[next];
+
+		is_served[next] = TRUE;
+		entry->quota = min(entry->desired, remaining);
+		remaining -= entry->quota;
+
+		entry->system->setParticleQuota(entry->quota, (entry->desired > 0) ? ((float)entry->quota / entry->desired) : 1.0f);
+	}
+}
+
+
+BOOL CParticleBudget::registerSystem(CParticleSystem* system, const int priority, const int desiredParticles)
+{
+	if (system == NULL)
+	{
+		return FALSE;
+	}
+
+	int index = findEntry(system);
+
+	if (index < 0)
+	{
+		if (_num_entries >= PARTICLE_BUDGET_SYSTEMS_MAX)
+		{
+			DPRINT_PARTICLESYS("CParticleBudget::registerSystem failed: PARTICLE_BUDGET_SYSTEMS_MAX systems are already registered \n");
+			return FALSE;
+		}
+
+		index = _num_entries++;
+		memset(&_entries[index], 0, sizeof(particleBudgetEntry));
+		_entries[index].system = system;
+		_entries[index].quota = -1;
+	}
+
+	_entries[index].priority = priority;
+	_entries[index].desired = max(desiredParticles, 0);
+
+	return TRUE;
+}
+
+
+void CParticleBudget::unregisterSystem(CParticleSystem* system)
+{
+	int index = findEntry(system);
+
+	if (index < 0)
+	{
+		return;
+	}
+
+	system->setParticleQuota(-1, 1.0f);
+
+	// Keep the registration order, since it breaks priority ties.
+	memmove(&_entries[index], &_entries[index + 1], sizeof(particleBudgetEntry) * (_num_entries - index - 1));
+	_num_entries--;
+}
+
+
+void CParticleBudget::reportCost(CParticleSystem* system, const int liveParticles, const int cost)
+{
+	int index = findEntry(system);
+
+	if (index < 0)
+	{
+		return;
+	}
+
+	if (liveParticles >= 0)
+	{
+		_entries[index].live_particles = liveParticles;
+	}
+
+	_entries[index].frame_cost += max(cost, 0);
+}
+
+
+int CParticleBudget::getQuota(const CParticleSystem* system) const
+{
+	int index = findEntry(system);
+
+	return (index < 0) ? -1 : _entries[index].quota;
+}
+
+
+const particleBudgetEntry* CParticleBudget::getEntry(const int index) const
+{
+	if ((index < 0) || (index >= _num_entries))
+	{
+		return NULL;
+	}
+
+	return &_entries[index];
+}
+
+
+int CParticleBudget::getElapsedTime(const timeval& startTime)
+{
+	timeval curr_time;
+	gettimeofday(&curr_time, NULL);
+
+	return ((curr_time.tv_sec - startTime.tv_sec) * 1000000) + (curr_time.tv_usec - startTime.tv_usec);
+}
+
+
+int CParticleBudget::findEntry(const CParticleSystem* system) const
+{
+	for (int i = 0; i < _num_entries; ++i)
+	{
+		if (_entries[i].system == system)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
@@ -0,0 +1,184 @@
+/*
+ *  ParticleBudget.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __PARTICLEBUDGET_H__
+#define __PARTICLEBUDGET_H__
+
+#include <sys/time.h>
+#include "types.h"
+
+class CParticleSystem;
+
+static const int PARTICLE_BUDGET_SYSTEMS_MAX = 16;			// The number of particle systems that can be registered at once.
+static const int PARTICLE_BUDGET_PARTICLES_DEFAULT = 6000;	// The default limit on live particles across every system, however cheap they are.
+static const int PARTICLE_BUDGET_TIME_DEFAULT = 8000;		// The default share of a frame, in microseconds, that particle updates and draws may take.
+static const float PARTICLE_BUDGET_COST_SMOOTHING = 0.1f;	// How far the measured costs move towards each new frame's measurement.
+
+/*! \struct particleBudgetEntry
+ *	\brief A particle system registered with the particle budget, and what it has been given.
+ */
+typedef struct particleBudgetEntry
+{
+	CParticleSystem* system;	/*!< The registered particle system. */
+	int priority;				/*!< Systems with a higher priority are given their particles first. */
+	int desired;				/*!< The number of live particles that the system would like to have. */
+	int quota;					/*!< The number of live particles that the system may have this frame. */
+	int live_particles;			/*!< The number of live particles that the system updated last frame. */
+	int frame_cost;				/*!< The time, in microseconds, that the system spent updating and drawing this frame so far. */
+	float avg_cost;				/*!< The smoothed time, in microseconds, that the system spends updating and drawing per frame. */
+} particleBudgetEntry;
+
+
+/*! \class CParticleBudget
+ * \brief The Particle Budget class.
+ *
+ * Every particle system sizes its masses on its own, so several heavy effects on one screen can easily take more of the frame than there is.
+ * Systems that register with the budget report what their updates and draws cost, and once a frame the budget turns the measured cost per particle into
+ * the number of live particles that fit in its share of the frame. That number is handed out as quotas in priority order, and each system throttles
+ * the release rate of its masses and stops releasing particles once it reaches its quota. Particles that are already alive are never killed.
+ */
+class CParticleBudget
+{
+public:
+	/*! \fn CParticleBudget()
+	 *  \brief The CParticleBudget class constructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	CParticleBudget();
+
+	/*! \fn ~CParticleBudget()
+	 *  \brief The CParticleBudget class destructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	~CParticleBudget();
+
+	/*! \fn init(const int maxParticles = PARTICLE_BUDGET_PARTICLES_DEFAULT, const int frameTime = PARTICLE_BUDGET_TIME_DEFAULT)
+	 *  \brief The CParticleBudget class initializer function.
+	 *
+	 *	\param maxParticles The most live particles across every registered system.
+	 *	\param frameTime The time, in microseconds, that the registered systems may spend updating and drawing each frame.
+	 *  \return n/a
+	 */
+	void init(const int maxParticles = PARTICLE_BUDGET_PARTICLES_DEFAULT, const int frameTime = PARTICLE_BUDGET_TIME_DEFAULT);
+
+	/*! \fn destroy(void)
+	 *  \brief Unregisters every system, lifting their quotas.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void destroy(void);
+
+	/*! \fn update(void)
+	 *  \brief Folds the costs measured last frame into the cost per particle, and hands out the quotas for this frame.
+	 *
+	 * This is called by the engine once per frame, before the screens are updated.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void update(void);
+
+	/*! \fn registerSystem(CParticleSystem* system, const int priority, const int desiredParticles)
+	 *  \brief Registers a particle system, or changes the priority and desired particles of one that is already registered.
+	 *
+	 * The system keeps its current quota until the next update().
+	 *	\param system The particle system.
+	 *	\param priority Systems with a higher priority are given their particles first.
+	 *	\param desiredParticles The number of live particles that the system would like to have.
+	 *  \return TRUE if the system is registered, FALSE if there is no room for another system.
+	 */
+	BOOL registerSystem(CParticleSystem* system, const int priority, const int desiredParticles);
+
+	/*! \fn unregisterSystem(CParticleSystem* system)
+	 *  \brief Unregisters a particle system and lifts its quota. Does nothing if the system is not registered.
+	 *
+	 *	\param system The particle system.
+	 *  \return n/a
+	 */
+	void unregisterSystem(CParticleSystem* system);
+
+	/*! \fn reportCost(CParticleSystem* system, const int liveParticles, const int cost)
+	 *  \brief Adds to the cost that a system has measured this frame. Ignored for systems that are not registered.
+	 *
+	 *	\param system The particle system.
+	 *	\param liveParticles The number of live particles that the system has, or -1 to keep the last count.
+	 *	\param cost The time, in microseconds, that the work took.
+	 *  \return n/a
+	 */
+	void reportCost(CParticleSystem* system, const int liveParticles, const int cost);
+
+	/*! \fn getQuota(const CParticleSystem* system)
+	 *  \brief Returns the number of live particles that a system may have this frame, or -1 if the system is not registered.
+	 *
+	 *	\param system The particle system.
+	 *  \return The quota of the system.
+	 */
+	int getQuota(const CParticleSystem* system) const;
+
+	/*! \fn getNumSystems(void)
+	 *  \brief Returns the number of registered systems.
+	 *
+	 *	\param n/a
+	 *  \return The number of registered systems.
+	 */
+	inline int getNumSystems(void) const { return _num_entries; }
+
+	/*! \fn getEntry(const int index)
+	 *  \brief Returns the priority, quota and measured cost of a registered system.
+	 *
+	 *	\param index The index of the system, from 0 to getNumSystems() - 1.
+	 *  \return The entry of the system, or NULL if the index is out of range.
+	 */
+	const particleBudgetEntry* getEntry(const int index) const;
+
+	/*! \fn getCostPerParticle(void)
+	 *  \brief Returns the smoothed time, in microseconds, that one live particle costs to update and draw, or 0 before anything was measured.
+	 *
+	 *	\param n/a
+	 *  \return The cost per particle.
+	 */
+	inline float getCostPerParticle(void) const { return _cost_per_particle; }
+
+	/*! \fn getParticleLimit(void)
+	 *  \brief Returns the number of live particles that were handed out as quotas this frame.
+	 *
+	 *	\param n/a
+	 *  \return The particle limit.
+	 */
+	inline int getParticleLimit(void) const { return _particle_limit; }
+
+	/*! \fn getElapsedTime(const timeval& startTime)
+	 *  \brief Returns the time, in microseconds, that has passed since the given time. Used by the systems to measure their costs.
+	 *
+	 *	\param startTime The time the work started, from gettimeofday().
+	 *  \return The elapsed time.
+	 */
+	static int getElapsedTime(const timeval& startTime);
+
+private:
+	/*! \fn findEntry(const CParticleSystem* system)
+	 *  \brief Returns the index of the entry of a system, or -1 if the system is not registered.
+	 *
+	 *	\param system The particle system.
+	 *  \return The index of the entry.
+	 */
+	int findEntry(const CParticleSystem* system) const;
+
+	particleBudgetEntry _entries[PARTICLE_BUDGET_SYSTEMS_MAX];	/*!< The registered systems, in registration order. */
+	int _num_entries;			/*!< The number of registered systems. */
+	int _max_particles;			/*!< The most live particles across every system. */
+	int _frame_time;			/*!< The time, in microseconds, that the systems may take each frame. */
+	int _particle_limit;		/*!< The number of live particles handed out this frame. */
+	float _cost_per_particle;	/*!< The smoothed time, in microseconds, of one live particle. */
+};
+
+#endif
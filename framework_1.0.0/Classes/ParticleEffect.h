@@ -0,0 +1,132 @@
+/*
+ *  ParticleEffect.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __PARTICLEEFFECT_H__
+#define __PARTICLEEFFECT_H__
+
+#include <stddef.h>
+#include "ParticleProperties.h"
+
+// This header is shared with the effect compile tool, so it must not depend on anything else in the framework.
+
+#define PARTICLE_EFFECT_EXTENSION	"pfx"	// Compiled effect libraries use this extension. The text form they are compiled from uses "pfxt".
+
+const unsigned int PARTICLE_EFFECT_MAGIC = 0x42584650;			/*!< "PFXB" when read as little endian bytes. Starts every compiled effect. */
+const unsigned int PARTICLE_EFFECT_LIBRARY_MAGIC = 0x4C584650;	/*!< "PFXL" when read as little endian bytes. Starts every effect library. */
+const unsigned int PARTICLE_EFFECT_VERSION = 2;					/*!< Bumped whenever the layout of an effect or library changes. */
+const int PARTICLE_EFFECT_NAME_MAX = 32;						/*!< The size of an effect name, including the terminator. */
+const int PARTICLE_EFFECT_IMAGE_NAME_MAX = 64;					/*!< The size of an image file name, including the terminator. */
+const int PARTICLE_EFFECT_ALIGNMENT = 8;						/*!< Every effect in a library starts at a multiple of this many bytes from the start of the file. */
+
+/*! \enum eParticleEffectCamera
+ *	\brief How the screen that plays an effect should set up its camera.
+ */
+typedef enum _eParticleEffectCamera
+{
+	eParticleEffectCameraNone = 0,	/*!< The camera is left as it is. */
+	eParticleEffectCameraReset,		/*!< The camera is reset to the default 2D view. */
+	eParticleEffectCameraInit,		/*!< The camera is initialized for 3D effects. */
+} eParticleEffectCamera;
+
+/*! \enum eParticleEffectMassFlags
+ *	\brief The per mass switches of an effect.
+ */
+typedef enum _eParticleEffectMassFlags
+{
+	eParticleEffectMassFlagActive = 1 << 0,		/*!< The mass starts active. */
+	eParticleEffectMassFlagPosition3D = 1 << 1,	/*!< The mass is placed, and pushed, with a z component. Whether the center is drawn and rendered in 3D are part of the properties. */
+} eParticleEffectMassFlags;
+
+/*! \struct particleEffectMass
+ *	\brief One mass of a compiled effect: its properties, its image and where its emitter is placed.
+ */
+typedef struct particleEffectMass
+{
+	particleProperties props;		/*!< The properties, stored exactly as CParticleSystem::setMode() takes them. */
+	char image_name[PARTICLE_EFFECT_IMAGE_NAME_MAX];	/*!< The image file name, resolved to an image id when the effect is loaded. If empty, props.image_id is used. */
+	int pos_x;						/*!< The emitter position. */
+	int pos_y;
+	int pos_z;
+	int impulse_x;					/*!< The impulse applied to the mass when the effect starts. */
+	int impulse_y;
+	int impulse_z;
+	int loop_count;					/*!< The number of times the mass releases its particles, or 0 to keep the default. */
+	unsigned int flags;				/*!< A combination of #eParticleEffectMassFlags. */
+} particleEffectMass;
+
+/*! \struct particleEffectHeader
+ *	\brief The header at the start of every compiled effect.
+ *
+ * The masses follow the header directly. Effects are used straight out of a memory mapped library, so nothing in them is parsed when they are loaded.
+ */
+typedef struct particleEffectHeader
+{
+	unsigned int magic;			/*!< Always #PARTICLE_EFFECT_MAGIC. */
+	unsigned int version;		/*!< Always #PARTICLE_EFFECT_VERSION. */
+	unsigned int props_size;	/*!< sizeof(particleProperties) of the compiler. Effects built for a different property layout are rejected. */
+	unsigned int size;			/*!< The byte size of the effect, including this header. */
+	char name[PARTICLE_EFFECT_NAME_MAX];	/*!< The effect name. */
+	int num_masses;				/*!< The number of masses that follow the header. */
+	int mass_size;				/*!< The number of particles in every mass. */
+	int camera;					/*!< One of #eParticleEffectCamera. */
+	unsigned int reserved;		/*!< Keeps the masses aligned. Always zero. */
+} particleEffectHeader;
+
+/*! \struct particleEffectLibraryEntry
+ *	\brief The location of one effect in an effect library.
+ */
+typedef struct particleEffectLibraryEntry
+{
+	char name[PARTICLE_EFFECT_NAME_MAX];	/*!< The effect name. */
+	unsigned int offset;		/*!< The byte offset of the effect from the start of the file. */
+	unsigned int size;			/*!< The byte size of the effect. */
+} particleEffectLibraryEntry;
+
+/*! \struct particleEffectLibraryHeader
+ *	\brief The header at the start of every effect library. The entry index follows it, then the effects.
+ */
+typedef struct particleEffectLibraryHeader
+{
+	unsigned int magic;			/*!< Always #PARTICLE_EFFECT_LIBRARY_MAGIC. */
+	unsigned int version;		/*!< Always #PARTICLE_EFFECT_VERSION. */
+	unsigned int num_effects;	/*!< The number of entries that follow the header. */
+	unsigned int reserved;		/*!< Always zero. */
+} particleEffectLibraryHeader;
+
+
+/*! \fn getParticleEffectHeader(const void* data, size_t size)
+ *  \brief Checks that the given memory holds a compiled effect that this build can use.
+ *
+ *	\param data The compiled effect.
+ *	\param size The number of bytes available at data.
+ *  \return The effect header, or NULL if the effect is invalid.
+ */
+inline const particleEffectHeader* getParticleEffectHeader(const void* data, size_t size)
+{
+	const particleEffectHeader* header = (const particleEffectHeader*)data;
+
+	if ((data == NULL) || (size < sizeof(particleEffectHeader)))
+	{
+		return NULL;
+	}
+
+	if ((header->magic != PARTICLE_EFFECT_MAGIC) || (header->version != PARTICLE_EFFECT_VERSION) || (header->props_size != sizeof(particleProperties)))
+	{
+		return NULL;
+	}
+
+	if ((header->size > size) || (header->num_masses <= 0) || (header->mass_size <= 0) || (sizeof(particleEffectHeader) + ((size_t)header->num_masses * sizeof(particleEffectMass)) > header->size))
+	{
+		return NULL;
+	}
+
+	return header;
+}
+
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ *  ParticleEffectLibrary.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include "SystemDefines.h"
+#include "MappedFile.h"
+#include "ParticleEffectLibrary.h"
+
+
+CParticleEffectLibrary::CParticleEffectLibrary()
+{
+	_mapped_data = NULL;
+	_mapped_size = 0;
+	_entries = NULL;
+	_num_effects = 0;
+}
+
+
+CParticleEffectLibrary::~CParticleEffectLibrary()
+{
+	unload();
+}
+
+
+BOOL CParticleEffectLibrary::load(const char* filePath)
+{
+	unload();
+
+	size_t file_size = 0;
+
+	// The mapping is used as it is. Pages are only read from flash when an effect is touched.
+	const unsigned char* mapped_data = mapFile(filePath, &file_size);
+
+	if (mapped_data == NULL)
+	{
+		return FALSE;
+	}
+
+	if (file_size < sizeof(particleEffectLibraryHeader))
+	{
+		unmapFile(mapped_data, file_size);
+		return FALSE;
+	}
+
+	const particleEffectLibraryHeader* header = (const particleEffectLibraryHeader*)mapped_data;
+	const particleEffectLibraryEntry* entries = (const particleEffectLibraryEntry*)(header + 1);
+	BOOL is_valid = ((header->magic == PARTICLE_EFFECT_LIBRARY_MAGIC) &&
+					 (header->version == PARTICLE_EFFECT_VERSION) &&
+					 (header->num_effects <= (file_size - sizeof(particleEffectLibraryHeader)) / sizeof(particleEffectLibraryEntry)));
+
+	// The index is only checked here, so that looking effects up later is plain pointer math.
+	for (unsigned int i = 0; (is_valid) && (i < header->num_effects); ++i)
+	{
+		const particleEffectLibraryEntry* entry = &entries[i];
+
+		is_valid = ((entry->offset <= file_size) &&
+					(entry->size <= (file_size - entry->offset)) &&
+					((entry->offset % PARTICLE_EFFECT_ALIGNMENT) == 0) &&
+					(memchr(entry->name, 0, PARTICLE_EFFECT_NAME_MAX) != NULL));
+	}
+
+	if (!is_valid)
+	{
+		DPRINT_PARTICLESYS("CParticleEffectLibrary::load failed: %s is not a valid effect library \n", filePath);
+		unmapFile(mapped_data, file_size);
+		return FALSE;
+	}
+
+	_mapped_data = mapped_data;
+	_mapped_size = file_size;
+	_entries = entries;
+	_num_effects = (int)header->num_effects;
+
+	return TRUE;
+}
+
+
+void CParticleEffectLibrary::unload()
+{
+	unmapFile(_mapped_data, _mapped_size);
+
+	_mapped_data = NULL;
+	_mapped_size = 0;
+	_entries = NULL;
+	_num_effects = 0;
+}
+
+
+int CParticleEffectLibrary::getNumEffects() const
+{
+	return _num_effects;
+}
+
+
+int CParticleEffectLibrary::findEffect(const char* name) const
+{
+	if (name == NULL)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < _num_effects; ++i)
+	{
+		if (strcmp(_entries[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+const void* CParticleEffectLibrary::getEffect(int index, size_t* size) const
+{
+	if ((index < 0) || (index >= _num_effects))
+	{
+		*size = 0;
+		return NULL;
+	}
+
+	*size = _entries[index].size;
+
+	return _mapped_data + _entries[index].offset;
+}
+
+
+const char* CParticleEffectLibrary::getEffectName(int index) const
+{
+	if ((index < 0) || (index >= _num_effects))
+	{
+		return NULL;
+	}
+
+	return _entries[index].name;
+}
@@ -0,0 +1,98 @@
+/*
+ *  ParticleEffectLibrary.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __PARTICLEEFFECTLIBRARY_H__
+#define __PARTICLEEFFECTLIBRARY_H__
+
+#include <stddef.h>
+#include "types.h"
+#include "ParticleEffect.h"
+
+/*! \class CParticleEffectLibrary
+ * \brief The Particle Effect Library class.
+ *
+ * An effect library is a file of compiled effects, built offline by the effect compile tool. The file is memory mapped as it is, and every effect is used straight out of the mapping,
+ * so opening a library and looking up its effects costs no parsing or copying. Pass an effect to CParticleSystem::loadEffect() to play it.
+ */
+class CParticleEffectLibrary
+{
+public:
+	/*! \fn CParticleEffectLibrary()
+	 *  \brief The CParticleEffectLibrary class constructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	CParticleEffectLibrary();
+
+	/*! \fn ~CParticleEffectLibrary()
+	 *  \brief The CParticleEffectLibrary class destructor. Unmaps the library.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	~CParticleEffectLibrary();
+
+	/*! \fn load(const char* filePath)
+	 *  \brief Maps an effect library into memory. Any previously loaded library is unloaded first.
+	 *
+	 *	\param filePath The absolute path to the library file.
+	 *  \return TRUE if the library was mapped and is valid.
+	 */
+	BOOL load(const char* filePath);
+
+	/*! \fn unload()
+	 *  \brief Unmaps the library. Effects returned by #getEffect() must not be used after this.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void unload(void);
+
+	/*! \fn getNumEffects()
+	 *  \brief Returns the number of effects in the library, or 0 if no library is loaded.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	int getNumEffects(void) const;
+
+	/*! \fn findEffect(const char* name)
+	 *  \brief Looks an effect up by name.
+	 *
+	 *	\param name The effect name.
+	 *  \return The index of the effect, or -1 if the library has no effect with that name.
+	 */
+	int findEffect(const char* name) const;
+
+	/*! \fn getEffect(int index, size_t* size)
+	 *  \brief Returns the compiled effect at the given index, as it is stored in the mapped file.
+	 *
+	 *	\param index The index of the effect.
+	 *	\param size Set to the byte size of the effect.
+	 *  \return The compiled effect, or NULL if the index is invalid.
+	 */
+	const void* getEffect(int index, size_t* size) const;
+
+	/*! \fn getEffectName(int index)
+	 *  \brief Returns the name of the effect at the given index, or NULL if the index is invalid.
+	 *
+	 *	\param index The index of the effect.
+	 *  \return n/a
+	 */
+	const char* getEffectName(int index) const;
+
+private:
+	const unsigned char* _mapped_data;				/*!< The mapped library file, or NULL. */
+	size_t _mapped_size;							/*!< The byte size of the mapping. */
+	const particleEffectLibraryEntry* _entries;		/*!< The entry index, inside the mapping. */
+	int _num_effects;								/*!< The number of entries in the index. */
+};
+
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ *  ParticleProperties.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __PARTICLEPROPERTIES_H__
+#define __PARTICLEPROPERTIES_H__
+
+// This header is shared with the effect compile tool, so apart from the basic types it must not depend on anything else in the framework.
+// The tool defines the few basic types it needs itself instead of including types.h.
+#include <stddef.h>
+#include "types.h"
+
+
+/*! \enum eParticleDrawMode
+ *	\brief The particle draw mode indicates the different ways that the particle system renders its particles.
+ */
+typedef enum eParticleDrawMode
+{
+	eParticleDrawModeNormal = 0,	/*!< Particles are rendered using normal textured quads. This mode is used when specialized particle effects are needed, such as rotation. */
+	eParticleDrawModeBillBoard,		/*!< Billboard mode is used when rendering particles in 3D mode. All particles are faced at the camera in this mode. */
+	eParticleDrawModePoint,	/*!< Point sprites are less expensive to render than quads since it consists of only one vertex (versus 4 for a quad). Specialized effects such as rotation are not possible in this mode. */
+	eParticleDrawModeMAX,			/*!< The total number of possible draw modes. */
+} eParticleDrawMode;
+
+
+/*! \struct particleProperties
+ *	\brief Particle properties is what defines the behavior of a particle.
+ *
+ * All particles must set these properties for it to function correctly.
+ */
+typedef struct particleProperties
+{
+	int life_time;		/*!< The amount of time that the particle is visible and being updated. This value can be set to #__INF for when the particle has an infinite life time. */
+	int fade_speed;		/*!< The speed at which the particle will fade in or out of visibility. This value can be set to #__INF for when the particle never fades. */
+	int fade_count;		/*!< The number of times that the particle will fade in and out of visibility. */
+	float slowdown_rate;/*!< The rate at which the velocity of the particle deteriorates. Calculated as a percentage from 1.0 (no deterioration) to 0.0 (full deterioration). */
+	int vel_base;		/*!< The base velocity of the particle when it is released from the mass. */
+	int vel_rand;		/*!< The particle velocity randomness when it is released from the mass. Higher value means larger random threshold. */
+	int angle_min;		/*!< Defines a bounding edge that particles can be released. */
+	int angle_max;		/*!< Defines the other bounding edge that particles can be released. Must be a larger value than #angle_min. */
+	int release_time;	/*!< The speed in MS at which the particles will be released from the mass. */
+	int release_rate;	/*!< The rate at which the particles will be released from the mass. */
+	int release_rand;	/*!< The release rate randomness in MS. */
+	float gravity;		/*!< The strength of gravity on the particle. */
+	int	rotation_speed;	/*!< The speed at which particles rotate, measured in the time it takes in MS to do one full rotation. */
+	int rotation_rand;	/*!< A random factor for the rotation speed. */
+	float size_start;	/*!< The initial size scale of the particle as it is ejected. The particle will pulse back and forth from this size to #size_end. The number of pulses and pulse duration is determined by #size_count and #size_speed. */
+	float size_end;		/*!< The end size scale of the particle during its size pulse loop. */
+	float size_speed;	/*!< The speed in MS at which the size scale changes from start to end. This value can be set to #__INF for when the particle never changes size. */
+	int size_count;		/*!< The number of times that the size scale changes from start to end. */
+	int blink_on_time;	/*!< The time that the particle is visible during a blink action. */
+	int blink_on_rand;	/*!< The random time value for the blink-on time. */
+	int blink_off_time;	/*!< The time that the particle is not visible during a blink action. */
+	int blink_off_rand;	/*!< The random time value for the blink-off time. */
+	int blink_count;	/*!< The number of times that the particle blinks in and out of visibility. This value can be set to #__INF for infinite blinks to occur. */
+	int release_dist;	/*!< The distance from the center of the mass to release the particle. */
+	int release_dist_rand;	/*!< The random value added to the release distance. */
+	BOOL glows;			/*!< Indicates whether to use the blend function GL_ONE or GL_ONE_MINUS_SRC_ALPHA. When set to GL_ONE, colors become additive when particles overlap each other, creating a "glow" effect.*/
+	float r;			/*!< The red color component of the particle. */
+	float g;			/*!< The green color component of the particle. */
+	float b;			/*!< The blue color component of the particle. */
+	bool color_rand;	/*!< Indicates whether colors are randomized. */
+	BOOL is_3D_enabled;	/*!< Indicates whether to render this particle in 3d mode. */
+	int strand_length;	/*!< Used for making a trail of particles. Indicates the length of the strand in particles. */
+	bool frame_skip;	/*!< Indicates whether to allow skipping of physics frames, to have time-accurate rendering, or showing all frames. */
+	bool draw_emitter;	/*!< Draws the center point of the mass, also known as the particle emitter. */
+	short draw_mode;	/*!< The rendering mode for this particle. */
+	int image_id;		/*!< The file image file ID found in gamedata.h */
+	int flip_cols;		/*!< The number of flipbook frame columns in the particle image. Zero turns the flipbook off. */
+	int flip_rows;		/*!< The number of flipbook frame rows in the particle image. Zero turns the flipbook off. */
+	int flip_frames;	/*!< The number of flipbook frames used, or zero for #flip_cols * #flip_rows. */
+	int flip_frame_time;	/*!< The time in milliseconds that each flipbook frame is shown. */
+	BOOL flip_looping;	/*!< Indicates that the flipbook starts over after the last frame. Otherwise it stays on the last frame. */
+	BOOL flip_blended;	/*!< Indicates that each flipbook frame fades into the next one. */
+} particleProperties;
+
+
+/*! \def PROP_FIELD(field)
+ *	\brief The offset of a field of #particleProperties, for the property list below.
+ */
+#define PROP_FIELD(field)	offsetof(particleProperties, field)
+
+/*! \def PROP_NO_FIELD
+ *	\brief Used in place of #PROP_FIELD for properties that are not stored in #particleProperties.
+ */
+#define PROP_NO_FIELD		0
+
+/*! \def PARTICLE_PROPERTY_LIST(X)
+ *	\brief Every particle property that can be queried and set by id, in order.
+ *
+ * Each entry is X(id, offset, key, storage, data type, limit, min, max, increment, dependencies, name, description).
+ * The key is the name of the property in the text form of particle effects, which is the name of its field where it has one.
+ * The list generates #eParticlePropertyName, the property descriptor table of CParticleSystem and the property table of the effect compile tool, so none of them can disagree.
+ * The limits may use ids from GameData.h. They are only evaluated where the descriptor table is built, so the tool never sees them.
+ * The data type decides which member of #propVal holds the value, and the storage decides how it is kept in #particleProperties.
+ */
+#define PARTICLE_PROPERTY_LIST(X) \
+	X(PROP_LIFE, PROP_FIELD(life_time), "life_time", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitInfinite, 0, 0, 1.0f, 0, "Life Span", "Life span of the particle, measured in milliseconds. Range: 0 to INF") \
+	X(PROP_FADE_SPEED, PROP_FIELD(fade_speed), "fade_speed", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitInfinite, 0, 0, 1.0f, 0, "Fade Speed", "Time in milliseconds that the particle fades out of visibility. Range: 0 to INF") \
+	X(PROP_FADE_COUNT, PROP_FIELD(fade_count), "fade_count", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Fade Count", "The number times the particle fades in and out of visibility. Range: 0 to INF") \
+	X(PROP_SLOWDOWN_RATE, PROP_FIELD(slowdown_rate), "slowdown_rate", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitWrap, 0.0f, 100.0f, 0.01f, 0, "Slowdown Rate", "Speed deterioration of the particle. Range: 0.0 to 100.0") \
+	X(PROP_VEL_BASE, PROP_FIELD(vel_base), "vel_base", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Base Velocity", "Initial velocity of the particle, measured in pixels per frame. Range: 0 to INF") \
+	X(PROP_VEL_RAND, PROP_FIELD(vel_rand), "vel_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Velocity Randomness", "Randomness factor of the particle velocity. The value determines the range of the randomness. Range: 0 to INF") \
+	X(PROP_ANGLE_MIN, PROP_FIELD(angle_min), "angle_min", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitWrap, 0, 360, 1.0f, eParticlePropDependAngles, "Start Angle", "The starting angle at which particles may be released. Range: 0 to 360") \
+	X(PROP_ANGLE_MAX, PROP_FIELD(angle_max), "angle_max", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitWrap, 0, 360, 1.0f, eParticlePropDependAngles, "End Angle", "The ending angle at which particles may be released. Range: 0 to 360") \
+	X(PROP_REL_TIME, PROP_FIELD(release_time), "release_time", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Release Time Interval", "Time in milliseconds at which particles are emitted. Range: 0 to INF") \
+	X(PROP_REL_RATE, PROP_FIELD(release_rate), "release_rate", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Release Rate", "The number of particles emitted at each time interval. Range: 0 to number of particles") \
+	X(PROP_REL_RAND, PROP_FIELD(release_rand), "release_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Release Time Randomness", "The random time factor at which particle are released, measured in milliseconds. Range: 0 to INF") \
+	X(PROP_GRAVITY, PROP_FIELD(gravity), "gravity", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitNone, 0.0f, 0.0f, 0.1f, 0, "Gravity", "Gravity is measured in pixels/second^2. Range: 0.0 to INF") \
+	X(PROP_ROT_SPEED, PROP_FIELD(rotation_speed), "rotation_speed", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Rotation Speed", "One full rotation occurs at the given millisecond value. Range: 0 to INF") \
+	X(PROP_ROT_RAND, PROP_FIELD(rotation_rand), "rotation_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Rotation Speed Randomness", "the randomness time factor for rotation speed. Range: 0 to INF") \
+	X(PROP_SIZE_START, PROP_FIELD(size_start), "size_start", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitMin, 0.0f, 0.0f, 0.1f, 0, "Starting Size", "Initial size of the particle. 1.0 represents the original size of the particle. Range: 0.0 to INF") \
+	X(PROP_SIZE_END, PROP_FIELD(size_end), "size_end", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitMin, 0.0f, 0.0f, 0.1f, 0, "Ending Size", "Ending size of the particle. 1.0 represents the original size of the particle. Range: 0.0 to INF") \
+	X(PROP_SIZE_SPEED, PROP_FIELD(size_speed), "size_speed", eParticlePropStorageFloat, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Size Change Speed", "The time in milliseconds that the particle size changes from start to end. Range: 0 to INF") \
+	X(PROP_SIZE_COUNT, PROP_FIELD(size_count), "size_count", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Size Change Count", "The number of times the the particle will change sizes. Range: 0 to INF") \
+	X(PROP_BLINK_ON_TIME, PROP_FIELD(blink_on_time), "blink_on_time", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitInfinite, 0, 0, 1.0f, 0, "Blink-On Time", "The time in milliseconds that the particle is visible during a blink action. Range: 0 to INF") \
+	X(PROP_BLINK_ON_RAND, PROP_FIELD(blink_on_rand), "blink_on_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Blink-On Randomness", "The random time factor of the blink-on action. Range: 0 to INF") \
+	X(PROP_BLINK_OFF_TIME, PROP_FIELD(blink_off_time), "blink_off_time", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitInfinite, 0, 0, 1.0f, 0, "Blink-Off Time", "The time in milliseconds that the particle is not visible during a blink action. Range: 0 to INF") \
+	X(PROP_BLINK_OFF_RAND, PROP_FIELD(blink_off_rand), "blink_off_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Blink-Off Randomness", "The random time factor of the blink-off action. Range: 0 to INF") \
+	X(PROP_BLINK_COUNT, PROP_FIELD(blink_count), "blink_count", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitInfinite, 0, 0, 1.0f, 0, "Blink Count", "The number of times the the particle blinks. Range: 0 to INF") \
+	X(PROP_REL_DIST, PROP_FIELD(release_dist), "release_dist", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Release Distance", "The distance that the particle are emitted from the particle mass center, measure in pixels. Range: 0 to INF") \
+	X(PROP_REL_DIST_RAND, PROP_FIELD(release_dist_rand), "release_dist_rand", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, 0, "Release Distance Randomness", "A random range value for release distance. Range: 0 to INF") \
+	X(PROP_GLOWS, PROP_FIELD(glows), "glows", eParticlePropStorageBOOL, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, 0, "Glow", "Disables/enables the Open GL alpha function, resulting in a glow effect (or not).") \
+	X(PROP_COLOR_R, PROP_FIELD(r), "r", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitRange, 0.0f, 1.0f, 0.01f, eParticlePropDependColor, "Red Component", "The red color component of the particle. Range: 0.0 to 1.0") \
+	X(PROP_COLOR_G, PROP_FIELD(g), "g", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitRange, 0.0f, 1.0f, 0.01f, eParticlePropDependColor, "Green Component", "The green color component of the particle. Range: 0.0 to 1.0") \
+	X(PROP_COLOR_B, PROP_FIELD(b), "b", eParticlePropStorageFloat, PROP_DATA_TYPE_FLOAT, eParticlePropLimitRange, 0.0f, 1.0f, 0.01f, eParticlePropDependColor, "Blue Component", "The blue color component of the particle. Range: 0.0 to 1.0") \
+	X(PROP_COLOR_RAND, PROP_FIELD(color_rand), "color_rand", eParticlePropStorageBool, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, 0, "Color Randomization", "Disables/enables color randomization.") \
+	X(PROP_IMAGE_ID, PROP_FIELD(image_id), "image_id", eParticlePropStorageInt, PROP_DATA_TYPE_GENERIC, eParticlePropLimitReject, 0, FILE_ID_IMAGE_MAX - 1, 0.0f, eParticlePropDependImage, "Particle Image", "The image used in the current active particle mode.") \
+	X(PROP_MASS_SIZE, PROP_NO_FIELD, "mass_size", eParticlePropStorageNone, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependMassSize, "Particle Count", "The total number of particles in the current particle mass. When a particle dissappears, it becomes emittable again. Range: 0 to 4000") \
+	X(PROP_STRAND_LENGTH, PROP_FIELD(strand_length), "strand_length", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependStrand, "Strand Length", "The length of the strand of the particles. This creates a trail or streak effect. Range: 0 to 4000") \
+	X(PROP_3D_MODE, PROP_FIELD(is_3D_enabled), "is_3D_enabled", eParticlePropStorageBOOL, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, 0, "Enable 3D", "Disables/enables 3D rendering mode. Touch controls are enabled when this mode is enabled.") \
+	X(PROP_DRAW_MODE, PROP_FIELD(draw_mode), "draw_mode", eParticlePropStorageShort, PROP_DATA_TYPE_STR, eParticlePropLimitNone, 0, 0, 1.0f, 0, "Draw Mode", "Quad mode is used for 2D rendering, billboard mode is used for 3D, and point sprite mode can be used for both.") \
+	X(PROP_DRAW_EMITTER, PROP_FIELD(draw_emitter), "draw_emitter", eParticlePropStorageBool, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, 0, "Draw Emitter", "Disables/enables the point of origin of the particle mass; the emitter.") \
+	X(PROP_FRAME_SKIP, PROP_FIELD(frame_skip), "frame_skip", eParticlePropStorageBool, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, 0, "Frame Skip", "Disables/enables skipping of physics frames. Skipping keeps the particles on time when the frame rate drops, instead of showing every frame.") \
+	X(PROP_FLIP_COLS, PROP_FIELD(flip_cols), "flip_cols", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependFlipbook, "Flipbook Columns", "The number of flipbook frame columns in the particle image. Zero turns the flipbook off. Range: 0 to INF") \
+	X(PROP_FLIP_ROWS, PROP_FIELD(flip_rows), "flip_rows", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependFlipbook, "Flipbook Rows", "The number of flipbook frame rows in the particle image. Zero turns the flipbook off. Range: 0 to INF") \
+	X(PROP_FLIP_FRAMES, PROP_FIELD(flip_frames), "flip_frames", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependFlipbook, "Flipbook Frames", "The number of flipbook frames used. Zero uses every cell of the image. Range: 0 to columns * rows") \
+	X(PROP_FLIP_FRAME_TIME, PROP_FIELD(flip_frame_time), "flip_frame_time", eParticlePropStorageInt, PROP_DATA_TYPE_INT, eParticlePropLimitMin, 0, 0, 1.0f, eParticlePropDependFlipbook, "Flipbook Frame Time", "The time in milliseconds that each flipbook frame is shown. Range: 0 to INF") \
+	X(PROP_FLIP_LOOPING, PROP_FIELD(flip_looping), "flip_looping", eParticlePropStorageBOOL, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, eParticlePropDependFlipbook, "Flipbook Looping", "Disables/enables starting the flipbook over after its last frame.") \
+	X(PROP_FLIP_BLENDED, PROP_FIELD(flip_blended), "flip_blended", eParticlePropStorageBOOL, PROP_DATA_TYPE_BOOL, eParticlePropLimitNone, 0, 0, 0.0f, eParticlePropDependFlipbook, "Flipbook Blending", "Disables/enables fading each flipbook frame into the next one.")
+
+#define PROP_ENUM(id, offset, key, storage, dataType, limit, minValue, maxValue, increment, dependencies, name, description)	id,
+
+/*! \enum eParticlePropertyName
+ *	\brief Used as a reference when querying the string name of a specific particle property.
+ */
+typedef enum eParticlePropertyName
+{
+	PARTICLE_PROPERTY_LIST(PROP_ENUM)
+	PROP_MAX,
+} eParticlePropertyName;
+
+#undef PROP_ENUM
+
+/*! \enum eParticlePropertyDataType
+ *	\brief Used as a reference when querying the data type of a specific particle property.
+ */
+typedef enum eParticlePropertyDataType
+{
+	PROP_DATA_TYPE_INT = 0,
+	PROP_DATA_TYPE_FLOAT,
+	PROP_DATA_TYPE_BOOL,
+	PROP_DATA_TYPE_STR,
+	PROP_DATA_TYPE_GENERIC,
+}eParticlePropertyDataType;
+
+/*! \enum eParticlePropertyStorage
+ *	\brief How a particle property is kept in #particleProperties.
+ */
+typedef enum eParticlePropertyStorage
+{
+	eParticlePropStorageInt = 0,	/*!< An int. */
+	eParticlePropStorageFloat,		/*!< A float. */
+	eParticlePropStorageBOOL,		/*!< A BOOL, which is a signed char. */
+	eParticlePropStorageBool,		/*!< A C++ bool. */
+	eParticlePropStorageShort,		/*!< A short. */
+	eParticlePropStorageNone,		/*!< The property is part of the mass rather than its properties. */
+} eParticlePropertyStorage;
+
+/*! \enum eParticlePropertyLimit
+ *	\brief What happens to a property value that is outside of its range when it is set.
+ */
+typedef enum eParticlePropertyLimit
+{
+	eParticlePropLimitNone = 0,		/*!< Any value is kept. */
+	eParticlePropLimitMin,			/*!< Values below the minimum are raised to it. */
+	eParticlePropLimitRange,		/*!< Values are clamped to the minimum and maximum. */
+	eParticlePropLimitInfinite,		/*!< Values below the minimum become #__INF. */
+	eParticlePropLimitWrap,			/*!< Values below the minimum become the maximum, and values at or above the maximum become the minimum. */
+	eParticlePropLimitReject,		/*!< Values outside of the minimum and maximum are ignored. */
+} eParticlePropertyLimit;
+
+/*! \enum eParticlePropertyDependency
+ *	\brief The mass state that must be updated after a property changes.
+ *
+ * When several properties are set at once, each dependency is only updated once, however many of the properties share it.
+ */
+typedef enum eParticlePropertyDependency
+{
+	eParticlePropDependImage = 1 << 0,		/*!< The sprites are switched to the new image. */
+	eParticlePropDependStrand = 1 << 1,		/*!< The position histories are fitted to the new strand length. */
+	eParticlePropDependAngles = 1 << 2,		/*!< The end angle is kept after the start angle. */
+	eParticlePropDependColor = 1 << 3,		/*!< The emitter sprite takes on the mass color. */
+	eParticlePropDependMassSize = 1 << 4,	/*!< The mass is resized. */
+	eParticlePropDependFlipbook = 1 << 5,	/*!< The sprites take on the new flipbook layout. */
+} eParticlePropertyDependency;
+
+
+#endif
@@ -13,6 +13,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include "MathUtil.h"
 #include "Utils.h"
 #include "Engine.h"
@@ -26,50 +27,54 @@
 #include "GameData.h"
 #include "Graphics.h"
 #include "ParticleSystem.h"
+#include "ParticleBudget.h"
+#include "QualityController.h"
 
 
 #if defined (ENABLE_PARTICLESYSTEM)
-// Used as a reference when querying the string name of a specific particle property.
-const particlePropNames propNames[PROP_MAX] = 
-{
-	{ PROP_LIFE, PROP_DATA_TYPE_INT, 1.0f, "Life Span", "Life span of the particle, measured in milliseconds. Range: 0 to INF", },
-	{ PROP_FADE_SPEED, PROP_DATA_TYPE_INT, 1.0f, "Fade Speed", "Time in milliseconds that the particle fades out of visibility. Range: 0 to INF", },
-	{ PROP_FADE_COUNT, PROP_DATA_TYPE_INT, 1.0f, "Fade Count", "The number times the particle fades in and out of visibility. Range: 0 to INF", },
-	{ PROP_SLOWDOWN_RATE, PROP_DATA_TYPE_FLOAT, 0.01f, "Slowdown Rate", "Speed deterioration of the particle. Range: 0.0 to 100.0" },
-	{ PROP_VEL_BASE, PROP_DATA_TYPE_INT, 1.0f, "Base Velocity", "Initial velocity of the particle, measured in pixels per frame. Range: 0 to INF", },
-	{ PROP_VEL_RAND, PROP_DATA_TYPE_INT, 1.0f, "Velocity Randomness", "Randomness factor of the particle velocity. The value determines the range of the randomness. Range: 0 to INF", },
-	{ PROP_ANGLE_MIN, PROP_DATA_TYPE_INT, 1.0f, "Start Angle", "The starting angle at which particles may be released. Range: 0 to 360", },
-	{ PROP_ANGLE_MAX, PROP_DATA_TYPE_INT, 1.0f, "End Angle", "The ending angle at which particles may be released. Range: 0 to 360", },
-	{ PROP_REL_TIME, PROP_DATA_TYPE_INT, 1.0f, "Release Time Interval", "Time in milliseconds at which particles are emitted. Range: 0 to INF", },
-	{ PROP_REL_RATE, PROP_DATA_TYPE_INT, 1.0f, "Release Rate", "The number of particles emitted at each time interval. Range: 0 to number of particles", },
-	{ PROP_REL_RAND, PROP_DATA_TYPE_INT, 1.0f, "Release Time Randomness", "The random time factor at which particle are released, measured in milliseconds. Range: 0 to INF", },
-	{ PROP_GRAVITY, PROP_DATA_TYPE_FLOAT, 0.1f, "Gravity", "Gravity is measured in pixels/second^2. Range: 0.0 to INF", },
-	{ PROP_ROT_SPEED, PROP_DATA_TYPE_INT, 1.0f, "Rotation Speed", "One full rotation occurs at the given millisecond value. Range: 0 to INF", },
-	{ PROP_ROT_RAND, PROP_DATA_TYPE_INT, 1.0f, "Rotation Speed Randomness", "the randomness time factor for rotation speed. Range: 0 to INF", },
-	{ PROP_SIZE_START, PROP_DATA_TYPE_FLOAT, 0.1f, "Starting Size", "Initial size of the particle. 1.0 represents the original size of the particle. Range: 0.0 to INF", },
-	{ PROP_SIZE_END, PROP_DATA_TYPE_FLOAT, 0.1f, "Ending Size", "Ending size of the particle. 1.0 represents the original size of the particle. Range: 0.0 to INF", },
-	{ PROP_SIZE_SPEED, PROP_DATA_TYPE_INT, 1.0f, "Size Change Speed", "The time in milliseconds that the particle size changes from start to end. Range: 0 to INF", },
-	{ PROP_SIZE_COUNT, PROP_DATA_TYPE_INT, 1.0f, "Size Change Count", "The number of times the the particle will change sizes. Range: 0 to INF", },
-	{ PROP_BLINK_ON_TIME, PROP_DATA_TYPE_INT, 1.0f, "Blink-On Time", "The time in milliseconds that the particle is visible during a blink action. Range: 0 to INF", },
-	{ PROP_BLINK_ON_RAND, PROP_DATA_TYPE_INT, 1.0f, "Blink-On Randomness", "The random time factor of the blink-on action. Range: 0 to INF", },
-	{ PROP_BLINK_OFF_TIME, PROP_DATA_TYPE_INT, 1.0f, "Blink-Off Time", "The time in milliseconds that the particle is not visible during a blink action. Range: 0 to INF", },
-	{ PROP_BLINK_OFF_RAND, PROP_DATA_TYPE_INT, 1.0f, "Blink-Off Randomness", "The random time factor of the blink-off action. Range: 0 to INF", },
-	{ PROP_BLINK_COUNT, PROP_DATA_TYPE_INT, 1.0f, "Blink Count", "The number of times the the particle blinks. Range: 0 to INF", },
-	{ PROP_REL_DIST, PROP_DATA_TYPE_INT, 1.0f, "Release Distance", "The distance that the particle are emitted from the particle mass center, measure in pixels. Range: 0 to INF", },
-	{ PROP_REL_DIST_RAND, PROP_DATA_TYPE_INT, 1.0f, "Release Distance Randomness", "A random range value for release distance. Range: 0 to INF", },
-	{ PROP_GLOWS, PROP_DATA_TYPE_BOOL, 0.0f, "Glow", "Disables/enables the Open GL alpha function, resulting in a glow effect (or not).",  },
-	{ PROP_COLOR_R, PROP_DATA_TYPE_FLOAT, 0.01f, "Red Component", "The red color component of the particle. Range: 0.0 to 1.0", },
-	{ PROP_COLOR_G, PROP_DATA_TYPE_FLOAT, 0.01f, "Green Component", "The green color component of the particle. Range: 0.0 to 1.0", },
-	{ PROP_COLOR_B, PROP_DATA_TYPE_FLOAT, 0.01f, "Blue Component", "The blue color component of the particle. Range: 0.0 to 1.0", },
-	{ PROP_COLOR_RAND, PROP_DATA_TYPE_BOOL, 0.0f, "Color Randomization", "Disables/enables color randomization.", },
-	{ PROP_IMAGE_ID, PROP_DATA_TYPE_GENERIC, 0.0f, "Particle Image", "The image used in the current active particle mode.", },
-	{ PROP_MASS_SIZE, PROP_DATA_TYPE_INT, 1.0f, "Particle Count", "The total number of particles in the current particle mass. When a particle dissappears, it becomes emittable again. Range: 0 to 4000", },
-	{ PROP_STRAND_LENGTH, PROP_DATA_TYPE_INT, 1.0f, "Strand Length", "The length of the strand of the particles. This creates a trail or streak effect. Range: 0 to 4000", },
-	{ PROP_3D_MODE, PROP_DATA_TYPE_BOOL, 0.0f, "Enable 3D", "Disables/enables 3D rendering mode. Touch controls are enabled when this mode is enabled.", },
-	{ PROP_DRAW_MODE, PROP_DATA_TYPE_STR, 1.0f, "Draw Mode", "Quad mode is used for 2D rendering, billboard mode is used for 3D, and point sprite mode can be used for both.", },
-	{ PROP_DRAW_EMITTER, PROP_DATA_TYPE_BOOL, 0.0f, "Draw Emitter", "Disables/enables the point of origin of the particle mass; the emitter.", },
+#define PROP_DESC(id, offset, key, storage, dataType, limit, minValue, maxValue, increment, dependencies, name, description) \
+	{ id, dataType, increment, name, description, offset, storage, limit, minValue, maxValue, dependencies, },
+
+// Describes every particle property that can be queried and set by id.
+const particlePropDesc propDescs[PROP_MAX] = 
+{
+	PARTICLE_PROPERTY_LIST(PROP_DESC)
 };
 
+#undef PROP_DESC
+
+// Wrap a value for setPropertyValue(). The per property setters all go through setProperties(), so the limits and dependencies of every property
+// are only ever taken from the property list.
+static inline propVal intPropVal(const int value)
+{
+	propVal val;
+	
+	val.intVal = value;
+	
+	return val;
+}
+
+
+static inline propVal floatPropVal(const float value)
+{
+	propVal val;
+	
+	val.floatVal = value;
+	
+	return val;
+}
+
+
+// Hands a measured cost to the particle budget. Particle systems can be used without the engine, such as in tools and tests, and then there is no budget.
+static inline void reportBudgetCost(CParticleSystem* system, const int liveParticles, const int cost)
+{
+	if (engine && GET_PARTICLE_BUDGET)
+	{
+		GET_PARTICLE_BUDGET->reportCost(system, liveParticles, cost);
+	}
+}
+
+
 // Used as a reference when querying the string name of the current draw mode.
 const char* drawModeStr[eParticleDrawModeMAX] =
 {
@@ -78,9 +83,23 @@ const char* drawModeStr[eParticleDrawModeMAX] =
 	"POINT SPRITE",	
 };
 
+// The default level of detail bands of 3D masses, from full detail to the least detail. Distances are in 3D view units, where the camera starts
+// CAMERA_START_Z / SCRN_D away from the scene, and the size scales roughly make up for the area of the particles that are left out.
+static const particleLodBand lod_bands_default[] =
+{
+	// distance, projected size, particle step, size scale, alpha scale, strand scale, update interval
+	{ 0.0f, 0.0f, 1, 1.0f, 1.0f, 1.0f, 1, },
+	{ 6.0f, 4.0f, 2, 1.4f, 1.0f, 0.5f, 1, },
+	{ 12.0f, 2.0f, 4, 2.0f, 1.0f, 0.25f, 2, },
+};
+
+// The property blocks that masses share, in this and every other particle system. The cache holds a reference to each
+// block, so a mass always copies a cached block before editing it, and the cached contents never change.
+static Reference<particleProperties> shared_props[PARTICLE_SHARED_PROPS_MAX];
+
 const char* CParticleSystem::getPropName(int id)
 {
-	return propNames[id].type_name;
+	return propDescs[id].type_name;
 }
 
 const char* CParticleSystem::getDrawModeStr(int id)
@@ -90,17 +109,17 @@ const char* CParticleSystem::getDrawModeStr(int id)
 
 const int CParticleSystem::getPropDataType(int id)
 {
-	return propNames[id].data_type;
+	return propDescs[id].data_type;
 }
 
 const char* CParticleSystem::getPropDesc(int id)
 {
-	return propNames[id].description;
+	return propDescs[id].description;
 }
 
 const float CParticleSystem::getPropIncrementValue(int id)
 {
-	return propNames[id].increment_value;
+	return propDescs[id].increment_value;
 }
 
 CParticleSystem::CParticleSystem()
@@ -109,12 +128,34 @@ CParticleSystem::CParticleSystem()
 	_num_masses = 0;
 	_is_running = FALSE;
 	memset(&_point_sizes, 0, sizeof(GLfloat) * 2);
+	_num_vertices = 0;
+	_num_jobs = 0;
+	_is_thread_pool_init = FALSE;
+	_cam_mat = NULL;
+	_is_fused_update = FALSE;
+	_are_vertices_built = FALSE;
+	_particle_quota = -1;
+	_release_scale = 1.0f;
+	_num_live_particles = 0;
+	_is_background = FALSE;
+	_update_counter = 0;
+	_skipped_time = 0;
+	_num_lod_bands = (int)(sizeof(lod_bands_default) / sizeof(particleLodBand));
+	memcpy(_lod_bands, lod_bands_default, sizeof(lod_bands_default));
 }
 
 
 CParticleSystem::~CParticleSystem()
 {
+	// A system that is still registered must not be handed any more quotas.
+	if (engine && GET_PARTICLE_BUDGET)
+	{
+		GET_PARTICLE_BUDGET->unregisterSystem(this);
+	}
 	
+	_thread_pool.destroy();
+	_vertices = NULL;
+	_jobs = NULL;
 }
 
 
@@ -140,20 +181,46 @@ void CParticleSystem::initMass(const int massID, const int massSize)
 
 	// Allocate memory for the individual particles.
 	_mass[massID].particles = ArrayList<particle>::alloc(massSize);
+	_mass[massID].num_initialized = massSize;
 	
 	for (int j = 0; j < massSize; ++j)
 	{	
-		// Init individual particle sprite and physics object.
-		_mass[massID].particles[j].sprite.init();
-		_mass[massID].particles[j].sprite.loadSpriteImage(particle_image);
-		CPhysics::initCircleObject((POCircle*)&_mass[massID].particles[j].phys, PARTICLE_RADIUS_DEFAULT);
-		_mass[massID].particles[j].id = _mass[massID].center.id;
-		_mass[massID].particles[j].pos_history_counter = 0;
-		_mass[massID].particles[j].pos_history_active_count = 0;
+		initParticle(massID, j, particle_image);
 	}
 	
 	// This essentially means that this mass will keep ejecting it's particle indefinitely.
 	_mass[massID].loop_count = __INF;
+	
+	// Start out with empty properties until a mode is set.
+	particleProperties props;
+	memset(&props, 0, sizeof(particleProperties));
+	shareProperties(massID, props);
+	
+	// The sprites show the default particle image, and no histories have been allocated yet.
+	_mass[massID].dirty_flags = 0;
+	_mass[massID].sprite_image_id = FILE_ID_IMAGE_PARTICLE;
+	_mass[massID].history_length = 0;
+	
+	// Every mass starts out at full detail.
+	_mass[massID].lod_band = 0;
+	_mass[massID].lod_prev_band = 0;
+	_mass[massID].lod_fade = 1.0f;
+	_mass[massID].lod_update_counter = 0;
+	_mass[massID].lod_skipped_time = 0;
+}
+
+
+void CParticleSystem::initParticle(const int massID, const int particleID, CImage* image)
+{
+	particle* part = &_mass[massID].particles[particleID];
+	
+	// Init individual particle sprite and physics object.
+	part->sprite.init();
+	part->sprite.loadSpriteImage(image);
+	CPhysics::initCircleObject((POCircle*)&part->phys, PARTICLE_RADIUS_DEFAULT);
+	part->id = _mass[massID].center.id;
+	part->pos_history_counter = 0;
+	part->pos_history_active_count = 0;
 }
 
 
@@ -171,6 +238,20 @@ void CParticleSystem::init(const int numMasses)
 	_mass = ArrayList<particleMass>::alloc(numMasses);
 	
 	_num_masses = numMasses;
+	
+	// Start out with empty properties until a mode is set.
+	particleProperties props;
+	memset(&props, 0, sizeof(particleProperties));
+	
+	for (int i = 0; i < numMasses; ++i)
+	{
+		shareProperties(i, props);
+		_mass[i].num_particles = 0;
+		_mass[i].num_initialized = 0;
+		_mass[i].dirty_flags = 0;
+		_mass[i].sprite_image_id = FILE_ID_IMAGE_PARTICLE;
+		_mass[i].history_length = 0;
+	}
 }
 
 
@@ -217,417 +298,763 @@ void CParticleSystem::destroy()
 }
 
 
-void CParticleSystem::draw(void* data)
-{	
-	if (_mass.length() <= 0)
+void CParticleSystem::setNumThreads(const int numThreads)
+{
+	_thread_pool.init(numThreads);
+	_is_thread_pool_init = TRUE;
+}
+
+
+int CParticleSystem::getImageVertexCount(const particleMass& mass, const CSprite& sprite)
+{
+	// Point sprites only need one vertex per particle.
+	if (mass.draw_mode == eParticleDrawModePoint)
 	{
-		return;
+		return 1;
+	}
+	
+	// Blended flipbook frames are drawn as two quads, the current frame fading into the next one.
+	if (sprite.isFlipbook() && sprite.getFlipbook().is_blended)
+	{
+		return PARTICLE_QUAD_VERTICES * 2;
+	}
+	
+	return PARTICLE_QUAD_VERTICES;
+}
+
+
+int CParticleSystem::getVertexCount(const particleMass& mass, const int particleID)
+{
+	const particle& part = mass.particles[particleID];
+	float size_scale, alpha_scale;
+	
+	if (!part.is_active || !part.sprite.isVisible() || (part.sprite._color.a <= 0.0))
+	{
+		return 0;
+	}
+	
+	if (getLodWeight(mass, particleID, &size_scale, &alpha_scale) <= 0.0f)
+	{
+		return 0;
+	}
+	
+	int num_vertices = getImageVertexCount(mass, part.sprite);
+	int num_images = 1;
+	
+	// Strands are drawn as extra particle images.
+	if (part.strand_length > 0)
+	{
+		num_images += part.pos_history_active_count;
+	}
+	
+	return num_images * num_vertices;
+}
+
+
+particleVertex* CParticleSystem::buildParticleVertices(particleVertex* vertices, const particleMass& mass, const CSprite& sprite, const float x, const float y, const float z, const float sizeScale, const float alphaScale)
+{
+	// The corners of the quad, in the same order as tex_coords: top left, top right, bottom left, bottom right.
+	static const float corners[PARTICLE_QUAD_VERTICES][4] =
+	{
+		{-1.0f, 1.0f, 0.0f, 1.0f},
+		{1.0f, 1.0f, 1.0f, 1.0f},
+		{-1.0f, -1.0f, 0.0f, 0.0f},
+		{1.0f, -1.0f, 1.0f, 0.0f},
+	};
+	
+	eParticleDrawMode draw_mode = mass.draw_mode;
+	BOOL is_3D = mass.props->is_3D_enabled;
+	GLubyte r = (GLubyte)(min(max(sprite._color.r, 0.0f), 1.0f) * 255.0f);
+	GLubyte g = (GLubyte)(min(max(sprite._color.g, 0.0f), 1.0f) * 255.0f);
+	GLubyte b = (GLubyte)(min(max(sprite._color.b, 0.0f), 1.0f) * 255.0f);
+	GLubyte a = (GLubyte)(min(max(sprite._color.a * alphaScale, 0.0f), 1.0f) * 255.0f);
+	float center_x = x;
+	float center_y = y;
+	float center_z = z;
+	
+	if (is_3D)
+	{
+		// Translate the coordinates to the 3d view coordinates.
+		coordsScreenTo3D(x, y, z, &center_x, &center_y, &center_z);
 	}
+	
+	// Point sprites always show the whole texture, so flipbooks only animate in the quad draw modes.
+	if (draw_mode == eParticleDrawModePoint)
+	{
+		vertices->x = center_x;
+		vertices->y = center_y;
+		vertices->z = center_z;
+		vertices->u = 0.0f;
+		vertices->v = 0.0f;
+		vertices->r = r;
+		vertices->g = g;
+		vertices->b = b;
+		vertices->a = a;
+		// We use just the width and x scale here since a point sprite can only be resized in one dimension.
+		vertices->size = sprite.getWidth() * sprite._scale.x * sizeScale;
 		
+		return vertices + 1;
+	}
+	
+	float right[3] = {1.0f, 0.0f, 0.0f};
+	float up[3] = {0.0f, 1.0f, 0.0f};
+	float half_w, half_h;
+	
+	if (draw_mode == eParticleDrawModeBillBoard)
+	{
+		// Position the particle to always front-face the camera/viewer.
+		right[0] = _cam_mat[0];
+		right[1] = _cam_mat[4];
+		right[2] = _cam_mat[8];
+		up[0] = _cam_mat[1];
+		up[1] = _cam_mat[5];
+		up[2] = _cam_mat[9];
+		
+		half_w = ((const float)sprite.getWidth() / SCRN_W) * sprite._scale.x;
+		half_h = ((const float)sprite.getWidth() / SCRN_W) * sprite._scale.y;
+	}
+	else if (is_3D)
+	{
+		// Translate the dimensions to the 3d view coordinates.
+		half_w = ((const float)sprite.getHalfWidth() / SCRN_W) * sprite._scale.x;
+		half_h = ((const float)sprite.getHalfHeight() / SCRN_H) * sprite._scale.y;
+	}
+	else
+	{
+		half_w = sprite.getHalfWidth() * sprite._scale.x;
+		half_h = sprite.getHalfHeight() * sprite._scale.y;
+	}
+	
+	half_w *= sizeScale;
+	half_h *= sizeScale;
+	
+	float angle = DEGREES_TO_RADIANS(sprite._angle.z);
+	float cos_angle = cosf(angle);
+	float sin_angle = sinf(angle);
+	
+	// Flipbook particles map the quad to the frame cells of the atlas, so every frame still uses the same texture and the mass stays one draw.
+	int frames[2] = {0, 0};
+	float frame_alphas[2] = {1.0f, 0.0f};
+	float frame_u[2] = {0.0f, 0.0f};
+	float frame_v[2] = {0.0f, 0.0f};
+	float frame_du = 1.0f;
+	float frame_dv = 1.0f;
+	int num_frames = 1;
+	
+	if (sprite.isFlipbook() && sprite.getImage())
+	{
+		float blend;
+		float frame_x, frame_y, frame_w, frame_h;
+		
+		sprite.getFlipbookFrame(&frames[0], &frames[1], &blend);
+		
+		if (sprite.getFlipbook().is_blended)
+		{
+			num_frames = 2;
+			frame_alphas[0] = 1.0f - blend;
+			frame_alphas[1] = blend;
+		}
+		
+		for (int k = 0; k < num_frames; ++k)
+		{
+			sprite.getFlipbookFrameRect(frames[k], &frame_x, &frame_y, &frame_w, &frame_h);
+			frame_u[k] = frame_x / sprite.getImage()->getWidth();
+			frame_v[k] = frame_y / sprite.getImage()->getHeight();
+			frame_du = frame_w / sprite.getImage()->getWidth();
+			frame_dv = frame_h / sprite.getImage()->getHeight();
+		}
+	}
+	
+	for (int k = 0; k < num_frames; ++k)
+	{
+		GLubyte frame_a = (GLubyte)(a * frame_alphas[k]);
+		
+		for (int i = 0; i < PARTICLE_QUAD_VERTICES; ++i)
+		{
+			// Rotate the corner around the center of the particle.
+			float corner_x = corners[i][0] * half_w;
+			float corner_y = corners[i][1] * half_h;
+			float rot_x = (corner_x * cos_angle) - (corner_y * sin_angle);
+			float rot_y = (corner_x * sin_angle) + (corner_y * cos_angle);
+			float v = corners[i][3];
+			
+			vertices[i].x = center_x + (right[0] * rot_x) + (up[0] * rot_y);
+			vertices[i].y = center_y + (right[1] * rot_x) + (up[1] * rot_y);
+			vertices[i].z = center_z + (right[2] * rot_x) + (up[2] * rot_y);
+			
+			// The y axis is flipped in 3d mode, so the texture needs to be flipped as well.
+			if (is_3D)
+			{
+				v = 1.0f - v;
+			}
+			
+			vertices[i].u = frame_u[k] + (corners[i][2] * frame_du);
+			vertices[i].v = frame_v[k] + (v * frame_dv);
+#if defined (ENABLE_PNGLOAD)
+			// Pixel data is loaded in a different order when using png load.
+			vertices[i].v = 1.0f - vertices[i].v;
+#endif
+			
+			vertices[i].r = r;
+			vertices[i].g = g;
+			vertices[i].b = b;
+			vertices[i].a = frame_a;
+			vertices[i].size = 0.0f;
+		}
+		
+		vertices += PARTICLE_QUAD_VERTICES;
+	}
+	
+	return vertices;
+}
+
+
+int CParticleSystem::getEmitterVertexCount(const particleMass& mass)
+{
+	if (!mass.props->draw_emitter || !mass.center.sprite.isVisible() || (mass.center.sprite._color.a <= 0.0))
+	{
+		return 0;
+	}
+	
+	return getImageVertexCount(mass, mass.center.sprite);
+}
+
+
+particleVertex* CParticleSystem::emitParticle(particleVertex* vertices, const particleMass& mass, const int particleID)
+{
+	const particle& part = mass.particles[particleID];
+	float size_scale, alpha_scale;
+	
+	if (getVertexCount(mass, particleID) <= 0)
+	{
+		return vertices;
+	}
+	
+	getLodWeight(mass, particleID, &size_scale, &alpha_scale);
+	
+	// Draw strands if enabled.
+	if (part.strand_length > 0)
+	{
+		for (int k = 0; k < part.pos_history_active_count; ++k)
+		{
+			vertices = buildParticleVertices(vertices, mass, part.sprite, part.pos_history[k].x, part.pos_history[k].y, part.pos_history[k].z, size_scale, alpha_scale);
+		}
+	}
+	
+	return buildParticleVertices(vertices, mass, part.sprite, part.phys.pos.x, part.phys.pos.y, part.phys.pos.z, size_scale, alpha_scale);
+}
+
+
+float CParticleSystem::getLodWeight(const particleMass& mass, const int particleID, float* sizeScale, float* alphaScale)
+{
+	const particleLodBand& band = _lod_bands[mass.lod_band];
+	
+	*sizeScale = band.size_scale;
+	*alphaScale = band.alpha_scale;
+	
+	if ((mass.lod_fade >= 1.0f) || (mass.lod_band == mass.lod_prev_band))
+	{
+		return ((particleID % band.particle_step) == 0) ? 1.0f : 0.0f;
+	}
+	
+	// While the mass crossfades, particles that only one of the bands draws fade with that band, and the scales blend between the bands.
+	const particleLodBand& prev_band = _lod_bands[mass.lod_prev_band];
+	float weight = 0.0f;
+	
+	if ((particleID % prev_band.particle_step) == 0)
+	{
+		weight += 1.0f - mass.lod_fade;
+	}
+	
+	if ((particleID % band.particle_step) == 0)
+	{
+		weight += mass.lod_fade;
+	}
+	
+	*sizeScale = prev_band.size_scale + ((band.size_scale - prev_band.size_scale) * mass.lod_fade);
+	*alphaScale = (prev_band.alpha_scale + ((band.alpha_scale - prev_band.alpha_scale) * mass.lod_fade)) * weight;
+	
+	return weight;
+}
+
+
+BOOL CParticleSystem::getMassDepth(const particleMass& mass, float* depth)
+{
+	if ((_cam_mat == NULL) || !mass.props->is_3D_enabled)
+	{
+		return FALSE;
+	}
+	
+	float x, y, z;
+	coordsScreenTo3D(mass.center.phys.pos.x, mass.center.phys.pos.y, mass.center.phys.pos.z, &x, &y, &z);
+	
+	// The camera looks down the negative z axis.
+	*depth = -((_cam_mat[2] * x) + (_cam_mat[6] * y) + (_cam_mat[10] * z) + _cam_mat[14]);
+	
+	return TRUE;
+}
+
+
+void CParticleSystem::updateLodBands(const int frameTime)
+{
+	// Half the height of the view at a depth of one, for turning sizes into pixels.
+	float view_scale = tanf(DEGREES_TO_RADIANS(PERSPECTIVE_FOVY * 0.5f));
+	
 	for (int i = 0; i < _num_masses; ++i)
 	{
-		eParticleDrawMode drawMode = (eParticleDrawMode)_mass[i].center.props.draw_mode;
+		particleMass& mass = _mass[i];
+		int band = 0;
+		float depth;
 		
-		switch (drawMode)
+		if ((_num_lod_bands > 1) && getMassDepth(mass, &depth) && (depth > 0.0f))
 		{
-			case eParticleDrawModeNormal:
+			// The particles are sized the same way as billboards, at the largest size that they pulse to.
+			float half_size = ((float)mass.center.sprite.getWidth() / SCRN_W) * max(mass.props->size_start, mass.props->size_end);
+			float projected_size = (half_size * SCRN_H) / (depth * view_scale);
+			
+			for (int b = 1; b < _num_lod_bands; ++b)
 			{
-				if (!_mass[i].center.is_active)
-				{
-					continue;
-				}
+				float band_distance = _lod_bands[b].distance;
+				float band_size = _lod_bands[b].projected_size;
 				
-				if (_mass[i].center.props.glows)
+				// Staying in a band is easier than entering it.
+				if (b <= mass.lod_band)
 				{
-					// This causes colors to be additive when particles overlap each other, creating a "glow" effect.
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-					// Turn off depth masking so particles in front will not occlude particles behind them.
-					glDepthMask(GL_FALSE);				
+					band_distance *= PARTICLE_LOD_HYSTERESIS;
+					band_size /= PARTICLE_LOD_HYSTERESIS;
 				}
 				
-				for (int j = 0; j < _mass[i].num_particles; ++j)
+				if (((band_distance > 0.0f) && (depth > band_distance)) || ((band_size > 0.0f) && (projected_size < band_size)))
 				{
-					if (_mass[i].particles[j].is_active)
-					{
-						// Call different rendering methods depending on which mode is enabled.
-						if (_mass[i].center.props.is_3D_enabled)
-						{
-							// Draw strands if enabled.
-							if (_mass[i].particles[j].props.strand_length > 0)
-							{
-								for (int k = 0; k < _mass[i].particles[j].pos_history_active_count; ++k)
-								{
-									CGraphics::draw3DSpriteCentered(
-																	&_mass[i].particles[j].sprite, 
-																	_mass[i].particles[j].pos_history[k].x,
-																	_mass[i].particles[j].pos_history[k].y, 
-																	_mass[i].particles[j].pos_history[k].z);									
-								}
-							}
-							
-							// Draw the particle itself in 3d.
-							CGraphics::draw3DSpriteCentered(
-															&_mass[i].particles[j].sprite, 
-															_mass[i].particles[j].phys.pos.x, 
-															_mass[i].particles[j].phys.pos.y, 
-															_mass[i].particles[j].phys.pos.z);
-							
-						}
-						else
-						{
-							// Draw strands if enabled.
-							if (_mass[i].particles[j].props.strand_length > 0)
-							{
-								for (int k = 0; k < _mass[i].particles[j].pos_history_active_count; ++k)
-								{
-									CGraphics::drawSpriteCentered(
-																  &_mass[i].particles[j].sprite, 
-																  _mass[i].particles[j].pos_history[k].x,
-																  _mass[i].particles[j].pos_history[k].y);									
-								}
-							}
-							
-							// Draw the particle itself in 2d.
-							CGraphics::drawSpriteCentered(
-														  &_mass[i].particles[j].sprite, 
-														  _mass[i].particles[j].phys.pos.x, 
-														  _mass[i].particles[j].phys.pos.y);
-						}
-					}
-				}
-				
-				if (_mass[i].center.props.draw_emitter)
-				{
-					// Call different rendering methods depending on which mode is enabled.
-					if (_mass[i].center.props.is_3D_enabled)
-					{
-						CGraphics::draw3DSpriteCentered(
-														&_mass[i].center.sprite, 
-														_mass[i].center.phys.pos.x, 
-														_mass[i].center.phys.pos.y, 
-														_mass[i].center.phys.pos.z);
-					}
-					else
-					{
-						CGraphics::drawSpriteCentered(
-													  &_mass[i].center.sprite, 
-													  _mass[i].center.phys.pos.x, 
-													  _mass[i].center.phys.pos.y);
-					}
-				}
-				
-				// The 'glow' effect is actually just a different blend function.
-				if (_mass[i].center.props.glows)
-				{
-					glDepthMask(GL_TRUE);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);			
+					band = b;
 				}
 			}
-				break;
-				
-			case eParticleDrawModeBillBoard:
-			{			
-				float* camMat = (float*)data;
-				
-				if (!_mass[i].center.is_active)
-				{
-					continue;
-				}
-				
-				// The billboard drawing mode only draws in 3D mode. This is because it is useless to front-face the particles towards the camera if we are in 2D mode.
-				if (!_mass[i].center.props.is_3D_enabled)
-				{
-					DPRINT_PARTICLESYS("CParticleSystem::draw billboard mode is only available when 3D is enabled! \n");
-					continue;
-				}
-				
-				if (_mass[i].center.props.glows)
-				{
-					// This causes colors to be additive when particles overlap each other, creating a "glow" effect.
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-					// Turn off depth masking so particles in front will not occlude particles behind them.
-					glDepthMask(GL_FALSE);				
-				}
-				
-				for (int j = 0; j < _mass[i].num_particles; ++j)
-				{
-					if (_mass[i].particles[j].is_active)
-					{
-						// Draw strands if enabled.
-						if (_mass[i].particles[j].props.strand_length > 0)
-						{
-							for (int k = 0; k < _mass[i].particles[j].pos_history_active_count; ++k)
-							{
-								CGraphics::draw3DSpriteCenteredLookAt(
-																	  &_mass[i].particles[j].sprite, 
-																	  _mass[i].particles[j].pos_history[k].x,
-																	  _mass[i].particles[j].pos_history[k].y, 
-																	  _mass[i].particles[j].pos_history[k].z,
-																	  camMat);
-							}
-						}
-						
-						// Draw the particle itself in 3d.
-						CGraphics::draw3DSpriteCenteredLookAt(
-															  &_mass[i].particles[j].sprite, 
-															  _mass[i].particles[j].phys.pos.x, 
-															  _mass[i].particles[j].phys.pos.y, 
-															  _mass[i].particles[j].phys.pos.z, 
-															  camMat);
-					}
-				}
-				
-				if (_mass[i].center.props.draw_emitter)
-				{					
-					CGraphics::draw3DSpriteCenteredLookAt(
-														  &_mass[i].center.sprite, 
-														  _mass[i].center.phys.pos.x, 
-														  _mass[i].center.phys.pos.y, 
-														  _mass[i].center.phys.pos.z, 
-														  camMat);
-				}
-				
-				if (_mass[i].center.props.glows)
-				{
-					glDepthMask(GL_TRUE);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);			
-				}
+		}
+		
+		if (band != mass.lod_band)
+		{
+			// Turning back to the band that is fading out picks the fade up where it is, instead of starting it over.
+			if (band == mass.lod_prev_band)
+			{
+				mass.lod_fade = 1.0f - mass.lod_fade;
 			}
-				break;
-				
-			case eParticleDrawModePoint:
+			else
 			{
-				glEnable(GL_POINT_SPRITE_OES);
-				glTexEnvi(GL_POINT_SPRITE_OES, GL_COORD_REPLACE_OES, GL_TRUE);
-				glEnable(GL_TEXTURE_2D);
-				// Get the maximum and minimum sizes that the point sprite can be.
-				glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, _point_sizes);
-				
-				// Set point sizes.
-				glPointParameterfv(GL_POINT_SIZE_MIN, &_point_sizes[0]);
-				glPointParameterfv(GL_POINT_SIZE_MAX, &_point_sizes[1]);
-				
-				// Iterate through the particles, setting color and specifying their positions.
-				
-				if (!_mass[i].center.is_active)
-				{
-					continue;
-				}
-				
+				mass.lod_fade = 0.0f;
+			}
+			
+			mass.lod_prev_band = mass.lod_band;
+			mass.lod_band = band;
+		}
+		else if (mass.lod_fade < 1.0f)
+		{
+			mass.lod_fade = min(mass.lod_fade + ((float)frameTime / PARTICLE_LOD_FADE_TIME), 1.0f);
+		}
+	}
+}
+
+
+void CParticleSystem::updateDrawModes()
+{
+	float distance = GET_QUALITY->getSettings()->point_sprite_distance;
+	float depth;
+	
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		particleMass& mass = _mass[i];
+		
+		mass.draw_mode = (eParticleDrawMode)mass.props->draw_mode;
+		
+		// Only 3D masses have a distance from the camera, and point sprites are already the cheapest mode.
+		if ((distance <= 0.0f) || (mass.draw_mode == eParticleDrawModePoint) || !getMassDepth(mass, &depth))
+		{
+			continue;
+		}
+		
+		if (depth > distance)
+		{
+			mass.draw_mode = eParticleDrawModePoint;
+		}
+	}
+}
+
+
+BOOL CParticleSystem::reserveFusedVertices()
+{
+	int max_vertices = 0;
+	
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		_mass[i].first_vertex = 0;
+		_mass[i].num_vertices = 0;
+		
+		if (!_mass[i].center.is_active)
+		{
+			continue;
+		}
+		
+		// Without a view matrix, billboards can only be built at draw time.
+		if ((_mass[i].draw_mode == eParticleDrawModeBillBoard) && (!_mass[i].props->is_3D_enabled || (_cam_mat == NULL)))
+		{
+			return FALSE;
+		}
+		
+		// Reserve room for every particle being alive with a full strand, plus the emitter.
+		int num_images = (_mass[i].num_particles * (1 + max(_mass[i].props->strand_length, 0))) + 1;
+		max_vertices += num_images * ((_mass[i].draw_mode == eParticleDrawModePoint) ? 1 : PARTICLE_QUAD_VERTICES);
+	}
+	
+	if (_vertices.length() < max_vertices)
+	{
+		_vertices = ArrayList<particleVertex>::alloc(max(max_vertices, _vertices.length() * 2));
+	}
+	
+	_num_vertices = 0;
+	
+	return TRUE;
+}
+
+
+void CParticleSystem::countVerticesJob(void* data, int jobIndex)
+{
+	CParticleSystem* particle_sys = (CParticleSystem*)data;
+	particleVertexJob& job = particle_sys->_jobs[jobIndex];
+	const particleMass& mass = particle_sys->_mass[job.mass_id];
+	
+	job.num_vertices = 0;
+	
+	// The emitter job only counts the center of the mass.
+	if (job.first_particle < 0)
+	{
+		job.num_vertices = particle_sys->getEmitterVertexCount(mass);
+		return;
+	}
+	
+	for (int j = job.first_particle; j < job.last_particle; ++j)
+	{
+		job.num_vertices += particle_sys->getVertexCount(mass, j);
+	}
+}
+
+
+void CParticleSystem::fillVerticesJob(void* data, int jobIndex)
+{
+	CParticleSystem* particle_sys = (CParticleSystem*)data;
+	const particleVertexJob& job = particle_sys->_jobs[jobIndex];
+	const particleMass& mass = particle_sys->_mass[job.mass_id];
+	
+	if (job.num_vertices <= 0)
+	{
+		return;
+	}
+	
+	// Every job writes to its own slice of the vertex buffer, so no locking is needed here.
+	particleVertex* vertices = particle_sys->_vertices.getRawPtr() + job.first_vertex;
+	
+	if (job.first_particle < 0)
+	{
+		particle_sys->buildParticleVertices(vertices, mass, mass.center.sprite, mass.center.phys.pos.x, mass.center.phys.pos.y, mass.center.phys.pos.z);
+		return;
+	}
+	
+	for (int j = job.first_particle; j < job.last_particle; ++j)
+	{
+		vertices = particle_sys->emitParticle(vertices, mass, j);
+	}
+}
+
+
+void CParticleSystem::buildVertices(const float* camMat)
+{
+	_num_vertices = 0;
+	_num_jobs = 0;
+	_cam_mat = camMat;
+	
+	if (_mass.length() <= 0)
+	{
+		return;
+	}
+	
+	updateDrawModes();
+	
+	if (!_is_thread_pool_init)
+	{
+		setNumThreads(CThreadPool::getNumCores());
+	}
+	
+	// Split every mass into jobs of particle ranges, plus one job for the emitter.
+	int max_jobs = 0;
+	
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		max_jobs += ((_mass[i].num_particles + PARTICLE_VERTEX_JOB_SIZE - 1) / PARTICLE_VERTEX_JOB_SIZE) + 1;
+	}
+	
+	if (_jobs.length() < max_jobs)
+	{
+		_jobs = ArrayList<particleVertexJob>::alloc(max(max_jobs, _jobs.length() * 2));
+	}
+	
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		_mass[i].first_vertex = 0;
+		_mass[i].num_vertices = 0;
+		
+		if (!_mass[i].center.is_active)
+		{
+			continue;
+		}
+		
+		// The billboard drawing mode only draws in 3D mode. This is because it is useless to front-face the particles towards the camera if we are in 2D mode.
+		if (_mass[i].draw_mode == eParticleDrawModeBillBoard)
+		{
+			if (!_mass[i].props->is_3D_enabled || (camMat == NULL))
+			{
+				DPRINT_PARTICLESYS("CParticleSystem::buildVertices billboard mode is only available when 3D is enabled and a view matrix is given! \n");
+				continue;
+			}
+		}
+		
+		for (int j = 0; j < _mass[i].num_particles; j += PARTICLE_VERTEX_JOB_SIZE)
+		{
+			_jobs[_num_jobs].mass_id = i;
+			_jobs[_num_jobs].first_particle = j;
+			_jobs[_num_jobs].last_particle = min(j + PARTICLE_VERTEX_JOB_SIZE, _mass[i].num_particles);
+			++_num_jobs;
+		}
+		
+		_jobs[_num_jobs].mass_id = i;
+		_jobs[_num_jobs].first_particle = -1;
+		_jobs[_num_jobs].last_particle = -1;
+		++_num_jobs;
+	}
+	
+	if (_num_jobs <= 0)
+	{
+		return;
+	}
+	
+	_thread_pool.runJobs(countVerticesJob, this, _num_jobs);
+	
+	// Jobs of the same mass are contiguous, so a running sum hands every job its own slice and keeps every mass in one range.
+	for (int i = 0; i < _num_jobs; ++i)
+	{
+		particleMass& mass = _mass[_jobs[i].mass_id];
+		
+		if (mass.num_vertices == 0)
+		{
+			mass.first_vertex = _num_vertices;
+		}
+		
+		_jobs[i].first_vertex = _num_vertices;
+		_num_vertices += _jobs[i].num_vertices;
+		mass.num_vertices = _num_vertices - mass.first_vertex;
+	}
+	
+	if (_num_vertices <= 0)
+	{
+		return;
+	}
+	
+	if (_vertices.length() < _num_vertices)
+	{
+		_vertices = ArrayList<particleVertex>::alloc(max(_num_vertices, _vertices.length() * 2));
+	}
+	
+	_thread_pool.runJobs(fillVerticesJob, this, _num_jobs);
+}
+
+
+void CParticleSystem::draw(void* data)
+{	
+	if (_mass.length() <= 0)
+	{
+		reportBudgetCost(this, 0, 0);
+		return;
+	}
+	
+	// The draw is timed for the particle budget, along with the update.
+	timeval start_time;
+	gettimeofday(&start_time, NULL);
+	
+	// In fused mode, update() has already written this frame's vertices.
+	if (_are_vertices_built)
+	{
+		_cam_mat = (const float*)data;
+	}
+	else
+	{
+		buildVertices((const float*)data);
+	}
+	_are_vertices_built = FALSE;
+	
+	if (_num_vertices <= 0)
+	{
+		// Live particles can still leave nothing to draw, such as when they are blinked off or skipped by the level of detail, so the live count
+		// that update() reported is kept. The time spent building no vertices still counts.
+		reportBudgetCost(this, -1, CParticleBudget::getElapsedTime(start_time));
+		return;
+	}
+	
+	// Upload the whole frame of particle vertices in one contiguous write. If it doesn't fit, draw straight from the client-side buffer.
+	int offset = CGraphics::streamVertices(_vertices.getRawPtr(), _num_vertices * sizeof(particleVertex));
+	const char* vertices = (offset >= 0) ? (const char*)(size_t)offset : (const char*)_vertices.getRawPtr();
+	
+	// Make sure to enable the states that let us bind and draw the texture.
+	glEnable(GL_TEXTURE_2D);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		if (_mass[i].num_vertices <= 0)
+		{
+			continue;
+		}
+		
+		if (_mass[i].props->glows)
+		{
+			// This causes colors to be additive when particles overlap each other, creating a "glow" effect.
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+			// Turn off depth masking so particles in front will not occlude particles behind them.
+			glDepthMask(GL_FALSE);				
+		}
+		
+		// We are using the center mass's sprite texture for all particles in this mass.
+		glBindTexture(GL_TEXTURE_2D, _mass[i].center.sprite.getTexName());
+		
+		const char* mass_vertices = vertices + (_mass[i].first_vertex * sizeof(particleVertex));
+		
+		if (_mass[i].draw_mode == eParticleDrawModePoint)
+		{
+			glEnable(GL_POINT_SPRITE_OES);
+			glTexEnvi(GL_POINT_SPRITE_OES, GL_COORD_REPLACE_OES, GL_TRUE);
+			glEnableClientState(GL_POINT_SIZE_ARRAY_OES);
+			
+			glVertexPointer(3, GL_FLOAT, sizeof(particleVertex), mass_vertices + offsetof(particleVertex, x));
+			glTexCoordPointer(2, GL_FLOAT, sizeof(particleVertex), mass_vertices + offsetof(particleVertex, u));
+			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(particleVertex), mass_vertices + offsetof(particleVertex, r));
+			glPointSizePointerOES(GL_FLOAT, sizeof(particleVertex), mass_vertices + offsetof(particleVertex, size));
+			
+			// Get the maximum and minimum sizes that the point sprite can be.
+			glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, _point_sizes);
+			
+			// Set point sizes.
+			glPointParameterfv(GL_POINT_SIZE_MIN, &_point_sizes[0]);
+			glPointParameterfv(GL_POINT_SIZE_MAX, &_point_sizes[1]);
+			
 #if !defined (GL_ATTENUATION_NOT_SUPPORTED)
-				float coeffs[] =  { 1.0f, 0.0f, 0.0f };
-				if (_mass[i].center.props.is_3D_enabled)
-				{
-					// We are concerned with the z parameter for 3d mode.
-					coeffs[0] = 0.0f;
-					coeffs[1] = 0.0f;
-					coeffs[2] = 1.0f;
-				}
-				glPointParameterfv( GL_POINT_DISTANCE_ATTENUATION, coeffs );
-#endif
-				
-				if (_mass[i].center.props.glows)
-				{
-					// This causes colors to be additive when particles overlap each other, creating a "glow" effect.
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-					// Turn off depth masking so particles in front will not occlude particles behind them.
-					glDepthMask(GL_FALSE);				
-				}
-				
-				// We are using the center mass's sprite texture for all particles in this mass.
-				glBindTexture(GL_TEXTURE_2D, _mass[i].center.sprite.getTexName());
-				
-				// Save the current transform.
-				glPushMatrix();
-				
-				// These will hold the translated particle coordinates.
-				float trans_x, trans_y, trans_z;
-				GLfloat vertices[3];
-				
-				for (int j = 0; j < _mass[i].num_particles; ++j)
-				{
-					if (_mass[i].particles[j].is_active)
-					{						
-						// The sprite contains all the animation information. This includes color (alpha) and size, so grab that info and apply it here.
-						glColor4f( 
-								  _mass[i].particles[j].sprite._color.r,
-								  _mass[i].particles[j].sprite._color.g,
-								  _mass[i].particles[j].sprite._color.b,
-								  _mass[i].particles[j].sprite._color.a);
-						
-						if (_mass[i].center.props.is_3D_enabled)
-						{
-							// Draw strands if enabled.
-							if (_mass[i].particles[j].props.strand_length > 0)
-							{
-								for (int k = 0; k < _mass[i].particles[j].pos_history_active_count; ++k)
-								{
-									coordsScreenTo3D(
-													 _mass[i].particles[j].pos_history[k].x,
-													 _mass[i].particles[j].pos_history[k].y, 
-													 _mass[i].particles[j].pos_history[k].z,
-													 &trans_x, 
-													 &trans_y, 
-													 &trans_z);
-									vertices[0] = trans_x;
-									vertices[1] = trans_y;
-									vertices[2] = trans_z;
-									
-									glVertexPointer(3, GL_FLOAT, 0, vertices);
-									glDrawArrays(GL_POINTS, 0, 1);
-#if defined (ENABLE_POLY_COUNT)
-									updatePolyCount(1);
-#endif
-								}
-							}
-							
-							//float* camMat = (float*)data;
-							// Translate the coordinates to the 3d view coordinates.
-							coordsScreenTo3D(
-											 _mass[i].particles[j].phys.pos.x, 
-											 _mass[i].particles[j].phys.pos.y, 
-											 _mass[i].particles[j].phys.pos.z, 
-											 &trans_x, 
-											 &trans_y, 
-											 &trans_z);
-							vertices[0] = trans_x;
-							vertices[1] = trans_y;
-							vertices[2] = trans_z;
-							
-							float size = _mass[i].center.sprite.getWidth() * _mass[i].particles[j].sprite._scale.x;
-							
-#if defined (GL_ATTENUATION_NOT_SUPPORTED)
-							// JC: TODO: This is broken, fix this.
-							float a = 1.0f;
-							float b = 0.0f;
-							float c = 0.0f;
-							float cam_x = camMat[0];
-							float cam_y = camMat[1];
-							float cam_z = camMat[2];
-							float d = sqrt( ((cam_x - _mass[i].particles[j].phys.pos.x) * (cam_x - _mass[i].particles[j].phys.pos.x)) +
-										   ((cam_y - _mass[i].particles[j].phys.pos.y) * (cam_y - _mass[i].particles[j].phys.pos.y)) +
-										   ((cam_z - _mass[i].particles[j].phys.pos.z) * (cam_z - _mass[i].particles[j].phys.pos.z)) );
-							size *= sqrt((float)1 / (a + (b * d) + (c * d * d)));
-							// Optimized formula.
-							//size *= (1.0f / (d * d));
-#endif
-							// Set point sprite size.
-							glPointSize(size);
-							
-							glVertexPointer(3, GL_FLOAT, 0, vertices);
-							glDrawArrays(GL_POINTS, 0, 1);
-						}
-						else 
-						{
-							// Draw strands if enabled.
-							if (_mass[i].particles[j].props.strand_length > 0)
-							{
-								for (int k = 0; k < _mass[i].particles[j].pos_history_active_count; ++k)
-								{
-									vertices[0] = _mass[i].particles[j].pos_history[k].x;
-									vertices[1] = _mass[i].particles[j].pos_history[k].y;
-									vertices[2] = _mass[i].particles[j].pos_history[k].z;
-									
-									glVertexPointer(3, GL_FLOAT, 0, vertices);
-									glDrawArrays(GL_POINTS, 0, 1);
-#if defined (ENABLE_POLY_COUNT)
-									updatePolyCount(1);
-#endif
-								}
-							}
-							
-							
-							vertices[0] = _mass[i].particles[j].phys.pos.x;
-							vertices[1] = _mass[i].particles[j].phys.pos.y;
-							vertices[2] = _mass[i].particles[j].phys.pos.z;
-							// Set point sprite size. We use just the width and x scale here since a point sprite can only be resized in one dimension.
-							glPointSize(_mass[i].particles[j].sprite.getWidth() * _mass[i].particles[j].sprite._scale.x);
-							
-							glVertexPointer(3, GL_FLOAT, 0, vertices);
-							glDrawArrays(GL_POINTS, 0, 1);
-						}
-						
-#if defined (ENABLE_POLY_COUNT)
-						updatePolyCount(1);
+			float coeffs[] =  { 1.0f, 0.0f, 0.0f };
+			if (_mass[i].props->is_3D_enabled)
+			{
+				// We are concerned with the z parameter for 3d mode.
+				coeffs[0] = 0.0f;
+				coeffs[1] = 0.0f;
+				coeffs[2] = 1.0f;
+			}
+			glPointParameterfv( GL_POINT_DISTANCE_ATTENUATION, coeffs );
 #endif
-						
-					}
-				}
-				
-				if (_mass[i].center.props.draw_emitter)
-				{
-					// The sprite contains all the animation information. This includes color (alpha) and size, so grab that info and apply it here.
-					glColor4f( 
-							  _mass[i].center.sprite._color.r,
-							  _mass[i].center.sprite._color.g,
-							  _mass[i].center.sprite._color.b,
-							  _mass[i].center.sprite._color.a);
-					
-					// Set point sprite size. We use just the width and x scale here since a point sprite can only be resized in one dimension.
-					glPointSize(_mass[i].center.sprite.getWidth() * _mass[i].center.sprite._scale.x);
-					
-					if (_mass[i].center.props.is_3D_enabled)
-					{
-						coordsScreenTo3D(
-										 _mass[i].center.phys.pos.x, 
-										 _mass[i].center.phys.pos.y, 
-										 _mass[i].center.phys.pos.z, 
-										 &trans_x, 
-										 &trans_y, 
-										 &trans_z);
-						vertices[0] = trans_x;
-						vertices[1] = trans_y;
-						vertices[2] = trans_z;
-						
-						// JC: TODO: Calculate size based on z distance from the camera.
-					}
-					else
-					{
-						vertices[0] = _mass[i].center.phys.pos.x;
-						vertices[1] = _mass[i].center.phys.pos.y;
-						vertices[2] = _mass[i].center.phys.pos.z;
-					}
-					
-					glVertexPointer(3, GL_FLOAT, 0, vertices);
-					glDrawArrays(GL_POINTS, 0, 1);
+			
+			glDrawArrays(GL_POINTS, 0, _mass[i].num_vertices);
+			
+			glDisableClientState(GL_POINT_SIZE_ARRAY_OES);
+			glDisable(GL_POINT_SPRITE_OES);
+			glTexEnvi(GL_POINT_SPRITE_OES, GL_COORD_REPLACE_OES, GL_FALSE);
+			
 #if defined (ENABLE_POLY_COUNT)
-					updatePolyCount(1);
+			updatePolyCount(_mass[i].num_vertices);
 #endif
-				}
-				
-				glPopMatrix();
+		}
+		else
+		{
+			int num_quads = _mass[i].num_vertices / PARTICLE_QUAD_VERTICES;
+			
+			// The quad index buffer only reaches so many vertices, so large masses are drawn in several pieces.
+			for (int j = 0; j < num_quads; j += QUAD_INDEX_MAX_QUADS)
+			{
+				const char* quad_vertices = mass_vertices + (j * PARTICLE_QUAD_VERTICES * sizeof(particleVertex));
 				
-				if (_mass[i].center.props.glows)
-				{
-					glDepthMask(GL_TRUE);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);			
-				}
+				glVertexPointer(3, GL_FLOAT, sizeof(particleVertex), quad_vertices + offsetof(particleVertex, x));
+				glTexCoordPointer(2, GL_FLOAT, sizeof(particleVertex), quad_vertices + offsetof(particleVertex, u));
+				glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(particleVertex), quad_vertices + offsetof(particleVertex, r));
 				
-				glDisable(GL_POINT_SPRITE_OES);
-				glTexEnvi(GL_POINT_SPRITE_OES, GL_COORD_REPLACE_OES, GL_FALSE);
-				glDisable(GL_TEXTURE_2D);
+				CGraphics::drawQuads(min(num_quads - j, QUAD_INDEX_MAX_QUADS));
 			}
-				break;
-				
-			default:
-				break;
+		}
+		
+		// The 'glow' effect is actually just a different blend function.
+		if (_mass[i].props->glows)
+		{
+			glDepthMask(GL_TRUE);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);			
 		}
 	}
+	
+	CGraphics::unbindStreamBuffer();
+	
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisable(GL_TEXTURE_2D);
+	
+	// The color array leaves the current color undefined, so reset it for the next draw.
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	
+	reportBudgetCost(this, -1, CParticleBudget::getElapsedTime(start_time));
 }
 
 
 void CParticleSystem::update()
 {
-	if (!_is_running)
+	if (_mass.length() <= 0)
 	{
 		return;
 	}
 	
-	if (_mass.length() <= 0)
+	// Apply property changes even while paused, so that they show up straight away.
+	for (int i = 0; i < _num_masses; ++i)
+	{
+		if (_mass[i].dirty_flags)
+		{
+			applyDirtyProperties(i);
+		}
+	}
+	
+	if (!_is_running)
 	{
 		return;
 	}
 	
+	const qualitySettings* quality = GET_QUALITY->getSettings();
+	int frame_time = TIME_LAST_FRAME;
+	
+	// At the lower quality tiers, background systems skip updates and make up the skipped time in one larger step.
+	if (_is_background)
+	{
+		_skipped_time += TIME_LAST_FRAME;
+		
+		if (++_update_counter < quality->background_update_interval)
+		{
+			return;
+		}
+		
+		frame_time = _skipped_time;
+		_update_counter = 0;
+		_skipped_time = 0;
+	}
+	
+	// The update is timed for the particle budget.
+	timeval start_time;
+	gettimeofday(&start_time, NULL);
+	int num_live = 0;
+	
+	// The level of detail and the fused vertices use the view matrix of the previous draw.
+	updateLodBands(frame_time);
+	updateDrawModes();
+	
+	// In fused mode, the render vertices are written while the particles are updated, saving draw() another pass over every particle.
+	BOOL is_fused = _is_fused_update && reserveFusedVertices();
+	particleVertex* vertices = _vertices.getRawPtr();
+	
 	int rel_time = 0;
 	for (int i = 0; i < _num_masses; ++i)
 	{
@@ -641,30 +1068,69 @@ void CParticleSystem::update()
 			continue;
 		}
 		
-		_mass[i].rel_counter += TIME_LAST_FRAME;
-		rel_time = _mass[i].center.props.release_time;
-		if (_mass[i].center.props.release_rand > 0)
+		if (is_fused)
 		{
-			rel_time += (rand() % _mass[i].center.props.release_rand);
+			_mass[i].first_vertex = _num_vertices;
 		}
 		
-		// When the release time counter reaches the relase time, we will set the next available particle to be active.
-		if (_mass[i].rel_counter >= rel_time)
+		// Masses in the less detailed bands are simulated less often, and make up the skipped time in one larger step.
+		int mass_time = frame_time + _mass[i].lod_skipped_time;
+		BOOL is_simulated = (++_mass[i].lod_update_counter >= _lod_bands[_mass[i].lod_band].update_interval);
+		float strand_scale = _lod_bands[_mass[i].lod_band].strand_scale;
+		
+		if (is_simulated)
+		{
+			_mass[i].lod_update_counter = 0;
+			_mass[i].lod_skipped_time = 0;
+			
+			_mass[i].rel_counter += mass_time;
+			rel_time = _mass[i].props->release_time;
+			if (_mass[i].props->release_rand > 0)
+			{
+				rel_time += (rand() % _mass[i].props->release_rand);
+			}
+			
+			// When the release time counter reaches the relase time, we will set the next available particle to be active.
+			if (_mass[i].rel_counter >= rel_time)
+			{
+				_mass[i].rel_counter = 0;
+				releaseNextParticle(i);
+			}
+			
+			// JC: Put this back in later if needed.
+			_mass[i].center.sprite.stepAction(mass_time);
+			_mass[i].center.sprite.stepFlipbook(mass_time);
+			CPhysics::updatePhysics(&_mass[i].center.phys, mass_time, _mass[i].props->frame_skip);
+		}
+		else
 		{
-			_mass[i].rel_counter = 0;
-			releaseNextParticle(i);
+			_mass[i].lod_skipped_time = mass_time;
 		}
 		
-		// JC: Put this back in later if needed.
-		_mass[i].center.sprite.updateAction();
-		CPhysics::updatePhysics(&_mass[i].center.phys, _mass[i].center.props.frame_skip);
 		for (int j = 0; j < _mass[i].num_particles; ++j)
 		{
+			// The particles of a mass that skips this update are still counted and drawn.
+			if (!is_simulated)
+			{
+				if (_mass[i].particles[j].is_active)
+				{
+					num_live++;
+					
+					if (is_fused)
+					{
+						_num_vertices = emitParticle(vertices + _num_vertices, _mass[i], j) - vertices;
+					}
+				}
+				
+				continue;
+			}
+			
 			// Check for death of the particle.
-			if (_mass[i].particles[j].props.life_time != __INF)
+			if (_mass[i].particles[j].life_time != __INF)
 			{
-				_mass[i].particles[j].props.life_time -= TIME_LAST_FRAME;
-				if (_mass[i].particles[j].props.life_time <= 0)
+				// Rewinding physics gives the particle its life time back.
+				_mass[i].particles[j].life_time -= (mass_time * _mass[i].particles[j].phys.movement_state);
+				if (_mass[i].particles[j].life_time <= 0)
 				{
 					// Reset the life time of the particle and set it to inactive.
 					killParticle(i, j);
@@ -684,7 +1150,7 @@ void CParticleSystem::update()
 				
 				// Check the alpha value to determine particle death. We will also never kill the particle if it's lifetime is infinite.
 				//if (_mass[i].particles[j].sprite._color.a <= 0.0)
-				if ((_mass[i].particles[j].sprite.getCurrentNumColorPulses() <= 0) && (_mass[i].particles[j].props.fade_speed != __INF))
+				if ((_mass[i].particles[j].sprite.getCurrentNumColorPulses() <= 0) && (_mass[i].props->fade_speed != __INF))
 				{
 					killParticle(i, j);
 				}
@@ -692,32 +1158,67 @@ void CParticleSystem::update()
 			
 			if (_mass[i].particles[j].is_active)
 			{
+				num_live++;
+				
 				// If the strand value is greater than zero, then we are rendering strands, and we must save off the last position before updating.
-				if (_mass[i].particles[j].props.strand_length > 0)
+				if (_mass[i].particles[j].strand_length > 0)
 				{
+					// The quality tier and the level of detail can shorten the strand. The history keeps its size, so the strand grows back once they allow it.
+					int strand_length = _mass[i].particles[j].strand_length;
+					
+					if (quality->max_strand_length >= 0)
+					{
+						strand_length = min(strand_length, quality->max_strand_length);
+					}
+					
+					// Shortening never turns a strand off.
+					strand_length = max((int)(strand_length * strand_scale), 1);
+					
 					_mass[i].particles[j].pos_history[_mass[i].particles[j].pos_history_counter].set(_mass[i].particles[j].phys.pos);
 					_mass[i].particles[j].pos_history_counter++;
 					_mass[i].particles[j].pos_history_active_count++;
 					
 					// Wrap around back to the start of the counter once we reach the strand length.
 					// NOTE: If this happens, then it indicates that the strand length should be increased.
-					if (_mass[i].particles[j].pos_history_counter >= _mass[i].particles[j].props.strand_length)
+					if (_mass[i].particles[j].pos_history_counter >= strand_length)
 					{
 						_mass[i].particles[j].pos_history_counter = 0;
 						
 					}
 					
-					if (_mass[i].particles[j].pos_history_active_count >= _mass[i].particles[j].props.strand_length)
+					if (_mass[i].particles[j].pos_history_active_count >= strand_length)
 					{
-						_mass[i].particles[j].pos_history_active_count = _mass[i].particles[j].props.strand_length;
+						_mass[i].particles[j].pos_history_active_count = strand_length;
 					}
 				}
 				
-				_mass[i].particles[j].sprite.updateAction();
-				CPhysics::updatePhysics(&_mass[i].particles[j].phys, _mass[i].particles[j].props.frame_skip);
+				// The sprite actions follow the physics time direction, so rewinding also rewinds color, size and rotation.
+				_mass[i].particles[j].sprite.stepAction(mass_time * _mass[i].particles[j].phys.movement_state);
+				_mass[i].particles[j].sprite.stepFlipbook(mass_time * _mass[i].particles[j].phys.movement_state);
+				CPhysics::updatePhysics(&_mass[i].particles[j].phys, mass_time, _mass[i].particles[j].frame_skip);
+				
+				if (is_fused)
+				{
+					_num_vertices = emitParticle(vertices + _num_vertices, _mass[i], j) - vertices;
+				}
+			}
+		}
+		
+		if (is_fused)
+		{
+			if (getEmitterVertexCount(_mass[i]) > 0)
+			{
+				_num_vertices = buildParticleVertices(vertices + _num_vertices, _mass[i], _mass[i].center.sprite, _mass[i].center.phys.pos.x, _mass[i].center.phys.pos.y, _mass[i].center.phys.pos.z) - vertices;
 			}
+			
+			_mass[i].num_vertices = _num_vertices - _mass[i].first_vertex;
 		}
 	}
+	
+	_are_vertices_built = is_fused;
+	_num_live_particles = num_live;
+	
+	reportBudgetCost(this, num_live, CParticleBudget::getElapsedTime(start_time));
 }
 
 
@@ -735,13 +1236,27 @@ void CParticleSystem::releaseNextParticle(int massID)
 		return;
 	}
 	
+	// A system over its particle budget, or running at a lower quality tier, releases fewer particles at a time, and none once it reaches its quota.
+	int release_rate = _mass[massID].props->release_rate;
+	float release_scale = _release_scale * GET_QUALITY->getSettings()->release_scale;
+	
+	if ((release_scale < 1.0f) && (release_rate > 0))
+	{
+		release_rate = max((int)(release_rate * release_scale), 1);
+	}
+	
 	for (int i = 0; i < _mass[massID].num_particles; ++i)
 	{
 		if (!_mass[massID].particles[i].is_active)
 		{			
+			if ((_particle_quota >= 0) && (_num_live_particles >= _particle_quota))
+			{
+				return;
+			}
+			
 			rate_counter++;
 			// Check wheter we have reached the release limit for this mass.
-			if (rate_counter > _mass[massID].center.props.release_rate)
+			if (rate_counter > release_rate)
 			{
 				return;
 			}
@@ -757,13 +1272,14 @@ void CParticleSystem::releaseNextParticle(int massID)
 				}
 			}
 			
-			_mass[massID].particles[i].props.life_time = _mass[massID].center.props.life_time;
+			_mass[massID].particles[i].life_time = _mass[massID].props->life_time;
+			_num_live_particles++;
 			// Center the particle on the center of the mass.
 			_mass[massID].particles[i].phys.pos = _mass[massID].center.phys.pos;
 			_mass[massID].particles[i].is_active = TRUE;
 			
 			// Check for color randomization mode.
-			if (_mass[massID].center.props.color_rand)
+			if (_mass[massID].props->color_rand)
 			{
 				// Set a random color.
 				_mass[massID].particles[i].sprite.setColor(
@@ -780,7 +1296,10 @@ void CParticleSystem::releaseNextParticle(int massID)
 			// Ensure that a newly ejected particle is fully visible.
 			_mass[massID].particles[i].sprite._color.a = 1.0;
 			
-			if ((_mass[massID].center.props.fade_speed > 0) && (_mass[massID].center.props.fade_speed != __INF))
+			// The flipbook frame of a particle follows its age, so a reused particle starts over from the first frame.
+			_mass[massID].particles[i].sprite.setFlipbookTime(0);
+			
+			if ((_mass[massID].props->fade_speed > 0) && (_mass[massID].props->fade_speed != __INF))
 			{
 				// This will run any fade of the particle.
 				_mass[massID].particles[i].sprite.setColorPulseAction(
@@ -788,11 +1307,11 @@ void CParticleSystem::releaseNextParticle(int massID)
 																		_mass[massID].particles[i].sprite._color.g,
 																		_mass[massID].particles[i].sprite._color.b,
 																		0,
-																		_mass[massID].center.props.fade_speed,
-																		_mass[massID].center.props.fade_count);
+																		_mass[massID].props->fade_speed,
+																		_mass[massID].props->fade_count);
 			}
 
-			if ((_mass[massID].center.props.rotation_speed > 0) && (_mass[massID].center.props.rotation_speed != __INF))
+			if ((_mass[massID].props->rotation_speed > 0) && (_mass[massID].props->rotation_speed != __INF))
 			{
 				// JC: For now, just set continuous rotation.
 				_mass[massID].particles[i].sprite._angle.zero();
@@ -809,53 +1328,53 @@ void CParticleSystem::releaseNextParticle(int massID)
 				}
 				
 				// Factor in any randomness in rotation speed.
-				if (_mass[massID].center.props.rotation_rand > 0)
+				if (_mass[massID].props->rotation_rand > 0)
 				{
 					_mass[massID].particles[i].sprite.setRotateAction(
 																		temp_vec,
 																		rot_dir, 
-																		_mass[massID].center.props.rotation_speed + (rand() % _mass[massID].center.props.rotation_rand),
+																		_mass[massID].props->rotation_speed + (rand() % _mass[massID].props->rotation_rand),
 																		__INF);
 				}
 				else
 				{
-					_mass[massID].particles[i].sprite.setRotateAction(temp_vec, rot_dir, _mass[massID].center.props.rotation_speed, __INF);
+					_mass[massID].particles[i].sprite.setRotateAction(temp_vec, rot_dir, _mass[massID].props->rotation_speed, __INF);
 				}
 			}
 			
 			// Reset scale.
 			_mass[massID].particles[i].sprite._scale = Vector3(
-																 _mass[massID].center.props.size_start, 
-																 _mass[massID].center.props.size_start, 
-																 _mass[massID].center.props.size_start);
+																 _mass[massID].props->size_start, 
+																 _mass[massID].props->size_start, 
+																 _mass[massID].props->size_start);
 			// Check for whether we need to run scaling actions at all.
-			if ((_mass[massID].center.props.size_speed > 0) && (_mass[massID].center.props.size_speed != __INF))
+			if ((_mass[massID].props->size_speed > 0) && (_mass[massID].props->size_speed != __INF))
 			{
 				// Run scaling actions.
 				_mass[massID].particles[i].sprite.setSizeScaleAction(
-																	   _mass[massID].center.props.size_end, 
-																	   _mass[massID].center.props.size_end, 
-																	   _mass[massID].center.props.size_end,
-																	   _mass[massID].center.props.size_speed,
-																	   _mass[massID].center.props.size_count);
+																	   _mass[massID].props->size_end, 
+																	   _mass[massID].props->size_end, 
+																	   _mass[massID].props->size_end,
+																	   _mass[massID].props->size_speed,
+																	   _mass[massID].props->size_count);
 			}
 			
 			// Check for whether we need to apply a blink action.
-			if ((_mass[massID].center.props.blink_count > 0) && (_mass[massID].center.props.blink_count != __INF))
+			if ((_mass[massID].props->blink_count > 0) && (_mass[massID].props->blink_count != __INF))
 			{
 				_mass[massID].particles[i].sprite.setBlinkAction(
-																   _mass[massID].center.props.blink_on_time,
-																   _mass[massID].center.props.blink_on_rand,
-																   _mass[massID].center.props.blink_off_time,
-																   _mass[massID].center.props.blink_off_rand,
-																   _mass[massID].center.props.blink_count);
+																   _mass[massID].props->blink_on_time,
+																   _mass[massID].props->blink_on_rand,
+																   _mass[massID].props->blink_off_time,
+																   _mass[massID].props->blink_off_rand,
+																   _mass[massID].props->blink_count);
 			}
 			
 			// Check for whether the particle has some starting distance from the center.
-			dist_from_center = _mass[massID].center.props.release_dist;
-			if (_mass[massID].center.props.release_dist_rand > 0)
+			dist_from_center = _mass[massID].props->release_dist;
+			if (_mass[massID].props->release_dist_rand > 0)
 			{
-				dist_from_center += (rand() % _mass[massID].center.props.release_dist_rand);
+				dist_from_center += (rand() % _mass[massID].props->release_dist_rand);
 			}
 			// Only set release distance if it is some value larger than zero.
 			if (dist_from_center > 0)
@@ -867,16 +1386,16 @@ void CParticleSystem::releaseNextParticle(int massID)
 			dist_from_center = 0;
 			
 			// Set strand length if any.
-			if (_mass[massID].center.props.strand_length > 0)
+			if (_mass[massID].props->strand_length > 0)
 			{
-				_mass[massID].particles[i].props.strand_length = _mass[massID].center.props.strand_length;
+				_mass[massID].particles[i].strand_length = _mass[massID].props->strand_length;
 				// Clear out some values.
 				_mass[massID].particles[i].pos_history_counter = 0;
 				_mass[massID].particles[i].pos_history_active_count = 0;
 			}
 			
 			// Set frame skip, to be inherited by mass center.
-			_mass[massID].particles[i].props.frame_skip = _mass[massID].center.props.frame_skip;
+			_mass[massID].particles[i].frame_skip = _mass[massID].props->frame_skip;
 			
 			applyProperties(massID, i);																	
 		}
@@ -957,12 +1476,12 @@ void CParticleSystem::applyProperties(int massID, int particleID)
 	// updated on the particle until it becomes active.
 	int angle = 0;
 	int vel = 0;
-	particleProperties *props = &_mass[massID].center.props;
+	const particleProperties *props = _mass[massID].props.getRawPtr();
 	
 	// Apply the properties to the particle.
 	CPhysics::resetVelocity(&_mass[massID].particles[particleID].phys);
 	
-	if (_mass[massID].center.props.is_3D_enabled)
+	if (_mass[massID].props->is_3D_enabled)
 	{
 		int phi = 0;
 		int theta = 0;
@@ -1024,7 +1543,7 @@ void CParticleSystem::applyProperties(int massID, int particleID)
 	}
 	
 	_mass[massID].particles[particleID].phys.acc.y = pixel(props->gravity);
-	_mass[massID].particles[particleID].props.life_time = props->life_time;
+	_mass[massID].particles[particleID].life_time = props->life_time;
 	
 	_mass[massID].particles[particleID].phys.resistance = props->slowdown_rate;
 }
@@ -1039,49 +1558,264 @@ void CParticleSystem::reset(const int massID)
 	//memcpy(&massTmp, &_mass[massID], sizeof(particleMass));
 	
 	// Save off temp copy of properties.
-	memcpy(&props, &_mass[massID].center.props, sizeof(particleProperties));
+	memcpy(&props, _mass[massID].props.getRawPtr(), sizeof(particleProperties));
+	
+	recenterMass(massID, _mass[massID].initial_pos.x, _mass[massID].initial_pos.y, _mass[massID].initial_pos.z);
+	recenterParticles(massID);
+	setMassActive(massID, TRUE);
+	
+	setMode(massID, props);	
+}
+
+
+void CParticleSystem::setMode(int massID, const particleProperties &modeData, const char* imageName)
+{
+	// The particles read the mass properties, so a mode is never copied into each of them.
+	shareProperties(massID, modeData);
+	
+	// The sprites keep their images, so only the state that the previous mode left on them is cleared.
+	_mass[massID].center.sprite.resetState();
+	_mass[massID].center.sprite.setColor(_mass[massID].props->r, _mass[massID].props->g, _mass[massID].props->b);
+	
+	for (int i = 0; i < _mass[massID].num_particles; ++i)
+	{
+		killParticle(massID, i);
+		
+		// The rest of the particle is set up by applyProperties() when it is released.
+		_mass[massID].particles[i].sprite.resetState();
+	}
+	
+	// The images and histories are only rebuilt if the new mode needs different ones. The flipbook of the mode is given to the sprites as well.
+	_mass[massID].dirty_flags |= (eParticleDirtyImage | eParticleDirtyStrand | eParticleDirtyFlipbook);
+	
+	// Save the image name.
+	_mass[massID].image_name = (char*)imageName;
+}
+
+
+void CParticleSystem::shareProperties(const int massID, const particleProperties& props)
+{
+	int free_slot = -1;
+	
+	for (int i = 0; i < PARTICLE_SHARED_PROPS_MAX; ++i)
+	{
+		if (shared_props[i] == NULL)
+		{
+			if (free_slot < 0)
+			{
+				free_slot = i;
+			}
+			continue;
+		}
+		
+		// Blocks are compared byte for byte, so properties that only differ in their padding are not shared. That only costs a copy.
+		if (memcmp(shared_props[i].getRawPtr(), &props, sizeof(particleProperties)) == 0)
+		{
+			_mass[massID].props = shared_props[i];
+			return;
+		}
+		
+		// A block that only the cache holds is no longer used by any mass, so it can be replaced.
+		if ((free_slot < 0) && (shared_props[i].getRefCount() == 1))
+		{
+			free_slot = i;
+		}
+	}
+	
+	particleProperties* block = new particleProperties;
+	memcpy(block, &props, sizeof(particleProperties));
+	_mass[massID].props = block;
+	
+	// When the cache is full of blocks that are in use, the mass simply keeps a block of its own.
+	if (free_slot >= 0)
+	{
+		shared_props[free_slot] = _mass[massID].props;
+	}
+}
+
+
+particleProperties* CParticleSystem::editProperties(const int massID)
+{
+	Reference<particleProperties>& props = _mass[massID].props;
+	
+	// Copy on write. A block that another mass or the cache still holds is never changed.
+	if (props.getRefCount() > 1)
+	{
+		particleProperties* block = new particleProperties;
+		memcpy(block, props.getRawPtr(), sizeof(particleProperties));
+		props = block;
+	}
+	
+	return props.getRawPtr();
+}
+
+
+void CParticleSystem::applyDirtyProperties(const int massID)
+{
+	particleMass* mass = &_mass[massID];
+	int retry_flags = 0;
+	
+	if (mass->dirty_flags & eParticleDirtyImage)
+	{
+		CImage* particle_image = GET_IMGLOADER->getImage(mass->props->image_id);
+		
+		if (!particle_image)
+		{
+			// The image change is kept, so it is tried again at the next update in case the image is loaded by then.
+			DPRINT_PARTICLESYS("CParticleSystem::applyDirtyProperties: Image %d is not present \n", mass->props->image_id);
+			retry_flags |= eParticleDirtyImage;
+		}
+		else if (mass->sprite_image_id != mass->props->image_id)
+		{
+			// Swapping the image keeps the color, size, rotation and flipbook of every live particle.
+			mass->center.sprite.setSpriteImage(particle_image);
+			
+			for (int i = 0; i < mass->num_particles; ++i)
+			{
+				mass->particles[i].sprite.setSpriteImage(particle_image);
+			}
+			
+			mass->sprite_image_id = mass->props->image_id;
+		}
+	}
+	
+	if (mass->dirty_flags & eParticleDirtyStrand)
+	{
+		int length = mass->props->strand_length;
+		
+		// Histories are only reallocated when they grow, and the positions that live particles have already recorded are kept.
+		if (length > mass->history_length)
+		{
+			for (int i = 0; i < mass->num_particles; ++i)
+			{
+				particle* part = &mass->particles[i];
+				
+				// Slots that were added by setMassSize() may already have been given a history of the new length.
+				if (part->pos_history.length() >= length)
+				{
+					continue;
+				}
+				
+				ArrayList<Vector3> history = ArrayList<Vector3>::alloc(length);
+				
+				if (part->pos_history_active_count > 0)
+				{
+					memcpy(history.getRawPtr(), part->pos_history.getRawPtr(), sizeof(Vector3) * part->pos_history_active_count);
+				}
+				
+				// Continue writing after the recorded positions, which are in no particular order since the strand is drawn as a set of points.
+				part->pos_history = history;
+				part->pos_history_counter = part->pos_history_active_count;
+			}
+			
+			mass->history_length = length;
+		}
+		
+		for (int i = 0; i < mass->num_particles; ++i)
+		{
+			particle* part = &mass->particles[i];
+			
+			part->strand_length = length;
+			
+			// Drop the positions that no longer fit a shorter strand.
+			if (part->pos_history_active_count > max(length, 0))
+			{
+				part->pos_history_active_count = max(length, 0);
+			}
+			
+			if (part->pos_history_counter >= length)
+			{
+				part->pos_history_counter = 0;
+			}
+		}
+	}
 	
-	recenterMass(massID, _mass[massID].initial_pos.x, _mass[massID].initial_pos.y, _mass[massID].initial_pos.z);
-	recenterParticles(massID);
-	setMassActive(massID, TRUE);
+	if (mass->dirty_flags & eParticleDirtyFlipbook)
+	{
+		const particleProperties* props = mass->props.getRawPtr();
+		
+		// The emitter holds the checked flipbook, and the particles copy it, as added particles do in setMassSize().
+		mass->center.sprite.setFlipbook(props->flip_cols, props->flip_rows, props->flip_frames, props->flip_frame_time, props->flip_looping, props->flip_blended);
+		
+		for (int i = 0; i < mass->num_particles; ++i)
+		{
+			mass->particles[i].sprite.setFlipbook(mass->center.sprite.getFlipbook());
+		}
+	}
 	
-	setMode(massID, props);	
+	mass->dirty_flags = retry_flags;
 }
 
 
-void CParticleSystem::setMode(int massID, const particleProperties &modeData, const char* imageName)
+BOOL CParticleSystem::loadEffect(const void* data, size_t size)
 {
-	memcpy(&_mass[massID].center.props, &modeData, sizeof(particleProperties));
-
-	CImage* particle_image = GET_IMGLOADER->getImage(modeData.image_id);
+	const particleEffectHeader* header = getParticleEffectHeader(data, size);
 	
-	_mass[massID].center.sprite.destroy();
-	_mass[massID].center.sprite.init();
-	_mass[massID].center.sprite.loadSpriteImage(particle_image);
-	_mass[massID].center.sprite.setColor(modeData.r, modeData.g, modeData.b);
+	if (!header)
+	{
+		DPRINT_PARTICLESYS("CParticleSystem::loadEffect failed: Invalid effect data \n");
+		return FALSE;
+	}
 	
-	for (int i = 0; i < _mass[massID].num_particles; ++i)
+	const particleEffectMass* masses = (const particleEffectMass*)(header + 1);
+	
+	init(header->num_masses, header->mass_size);
+	
+	for (int i = 0; i < header->num_masses; ++i)
 	{
-		killParticle(massID, i);
+		const particleEffectMass* mass = &masses[i];
+		particleProperties props = mass->props;
+		
+		// Images are referenced by file name, since image ids can change from build to build.
+		if (mass->image_name[0] != '\0')
+		{
+			for (int j = 0; j < FILE_ID_IMAGE_MAX; ++j)
+			{
+				if (strncmp(imageFileNames[j], mass->image_name, PARTICLE_EFFECT_IMAGE_NAME_MAX) == 0)
+				{
+					props.image_id = j;
+					break;
+				}
+			}
+		}
+		
+		if ((props.image_id < 0) || (props.image_id >= FILE_ID_IMAGE_MAX))
+		{
+			DPRINT_PARTICLESYS("CParticleSystem::loadEffect: Unknown image in effect %.32s \n", header->name);
+			props.image_id = FILE_ID_IMAGE_PARTICLE;
+		}
 		
-		// Copy the properties to each individual particle in case we need to grab it for any reason.
-		memcpy(&_mass[massID].particles[i].props, &modeData, sizeof(particleProperties));
+		if (mass->flags & eParticleEffectMassFlagPosition3D)
+		{
+			recenterMass(i, mass->pos_x, mass->pos_y, mass->pos_z);
+		}
+		else
+		{
+			recenterMass(i, mass->pos_x, mass->pos_y);
+		}
 		
-		applyProperties(massID, i);
+		setMassActive(i, (mass->flags & eParticleEffectMassFlagActive) ? TRUE : FALSE);
+		setMode(i, props);
 		
-		_mass[massID].particles[i].sprite.destroy();
-		_mass[massID].particles[i].sprite.init();
-		_mass[massID].particles[i].sprite.loadSpriteImage(particle_image);
+		if ((mass->impulse_x != 0) || (mass->impulse_y != 0) || (mass->impulse_z != 0))
+		{
+			if (mass->flags & eParticleEffectMassFlagPosition3D)
+			{
+				applyImpulse(i, mass->impulse_x, mass->impulse_y, mass->impulse_z);
+			}
+			else
+			{
+				applyImpulse(i, mass->impulse_x, mass->impulse_y);
+			}
+		}
 		
-		// Set up position history array.
-		if (modeData.strand_length > 0)
+		if (mass->loop_count > 0)
 		{
-			_mass[massID].particles[i].pos_history = ArrayList<Vector3>::alloc(modeData.strand_length);
+			setLoopCount(i, mass->loop_count);
 		}
 	}
 	
-	// Save the image name.
-	_mass[massID].image_name = (char*)imageName;
+	return TRUE;
 }
 
 
@@ -1094,7 +1828,7 @@ void CParticleSystem::setAngles(int massID, int numAngles, ...)
 	
 	int angle = 0;
 	int vel = 0;
-	particleProperties *props = (particleProperties*)&_mass[massID].center.props;
+	const particleProperties *props = _mass[massID].props.getRawPtr();
 	for (int i = 0; i < numAngles; ++i)
 	{
 		angle = va_arg(ap, int);
@@ -1133,27 +1867,8 @@ void CParticleSystem::applyImpulse(int massID, int xImp, int yImp, int zImp)
 
 void CParticleSystem::setImageID(const int massID, const int imageID)
 {	
-	CImage* particle_image = GET_IMGLOADER->getImage(imageID);
-	_mass[massID].center.sprite.destroy();
-	_mass[massID].center.sprite.init();
-	_mass[massID].center.sprite.loadSpriteImage(particle_image);
-	
-	// Set image colors.
-	_mass[massID].center.sprite.setColor(_mass[massID].center.props.r, _mass[massID].center.props.g, _mass[massID].center.props.b);
-	
-	for (int i = 0; i < _mass[massID].num_particles; ++i)
-	{
-		_mass[massID].particles[i].sprite.destroy();
-		_mass[massID].particles[i].sprite.init();
-		_mass[massID].particles[i].sprite.loadSpriteImage(particle_image);
-		
-		// Set image colors.
-		_mass[massID].particles[i].sprite.setColor(_mass[massID].center.props.r, _mass[massID].center.props.g, _mass[massID].center.props.b);
-	}	
-	
-	_mass[massID].center.props.image_id = imageID;
-	
-	
+	// The sprites are switched to the new image on the next update, however many times the image changes before then.
+	setPropertyValue(massID, PROP_IMAGE_ID, intPropVal(imageID));
 }
 
 
@@ -1166,59 +1881,137 @@ void CParticleSystem::setMassSize(const int massID, const int massSize)
 		numParticles = 0;
 	}
 	
-	// Save off current mass properties. This will need to be re-set after we delete the old mass and reinitialize the new one.
-	particleProperties props;
-	memcpy(&props, &_mass[massID].center.props, sizeof(particleProperties));
+	particleMass* mass = &_mass[massID];
+	CImage* particle_image = GET_IMGLOADER->getImage(mass->sprite_image_id);
+	
+	if (!particle_image)
+	{
+		DPRINT_PARTICLESYS("CParticleSystem::setMassSize failed: Particle image not present");
+		return;
+	}
 	
-	// Also save off current position.
-	float x = _mass[massID].center.phys.pos.x;
-	float y = _mass[massID].center.phys.pos.y;
-	float z = _mass[massID].center.phys.pos.z;
+	// Grow geometrically, so that tuning the size a few particles at a time only allocates now and then.
+	// Shrink lazily, so that storage is only released once most of it is unused.
+	if (numParticles > mass->particles.length())
+	{
+		resizeMassStorage(massID, max(numParticles, mass->particles.length() * 2));
+	}
+	else if (numParticles < mass->particles.length() / PARTICLE_MASS_SHRINK_RATIO)
+	{
+		resizeMassStorage(massID, numParticles);
+	}
 	
-	BOOL is_active = _mass[massID].center.is_active;
-	BOOL draw_center = _mass[massID].center.props.draw_emitter; 
+	// Added slots start out dead with the mass properties, and are set up like the other particles when they are released.
+	for (int i = mass->num_particles; i < numParticles; ++i)
+	{
+		particle* part = &mass->particles[i];
+		
+		if (i >= mass->num_initialized)
+		{
+			// Only slots that have never been used need their sprites initialized.
+			initParticle(massID, i, particle_image);
+		}
+		else
+		{
+			// A reused slot is put back the way initParticle() leaves it, keeping its image if the mass image has not changed since.
+			part->sprite.resetState();
+			
+			if (part->sprite.getImage() != particle_image)
+			{
+				part->sprite.setSpriteImage(particle_image);
+			}
+			
+			CPhysics::initCircleObject((POCircle*)&part->phys, PARTICLE_RADIUS_DEFAULT);
+			part->pos_history_counter = 0;
+			part->pos_history_active_count = 0;
+		}
+		
+		part->is_active = FALSE;
+		part->life_time = mass->props->life_time;
+		part->strand_length = mass->props->strand_length;
+		part->frame_skip = mass->props->frame_skip;
+		part->sprite.setFlipbook(mass->center.sprite.getFlipbook());
+		
+		if (part->pos_history.length() < mass->history_length)
+		{
+			part->pos_history = ArrayList<Vector3>::alloc(mass->history_length);
+		}
+	}
 	
-	// Destroy any previous exising mass.
-	for (int j = 0; j < _mass[massID].num_particles; ++j)
+	// Removed particles die straight away. The particles that remain keep flying.
+	for (int i = numParticles; i < mass->num_particles; ++i)
 	{
-		_mass[massID].particles[j].sprite.destroy();
+		killParticle(massID, i);
 	}
-	_mass[massID].center.sprite.destroy();
-	_mass[massID].particles = NULL;
 	
-	// Re-initialize mass.
-	initMass(massID, numParticles);
+	mass->num_initialized = max(mass->num_initialized, numParticles);
+	mass->num_particles = numParticles;
+}
+
+
+void CParticleSystem::resizeMassStorage(const int massID, const int capacity)
+{
+	particleMass* mass = &_mass[massID];
+	int num_kept = min(mass->num_initialized, capacity);
+	ArrayList<particle> particles;
 	
-	// Re-set properties.
-	setMode(massID, props);
+	// Fresh slots are zeroed, the same as any slot that has never been initialized.
+	if (capacity > 0)
+	{
+		particles = ArrayList<particle>::alloc(capacity);
+	}
 	
-	// Re-set positions.
-	_mass[massID].center.phys.pos.x = x;
-	_mass[massID].center.phys.pos.y = y;
-	_mass[massID].center.phys.pos.z = z;
+	// Move the particles bit for bit, so that their sprites and histories change owner instead of being copied.
+	// The old slots are zeroed, so that freeing the old storage releases nothing that was moved.
+	if (num_kept > 0)
+	{
+		memcpy(particles.getRawPtr(), mass->particles.getRawPtr(), sizeof(particle) * num_kept);
+		memset(mass->particles.getRawPtr(), 0, sizeof(particle) * num_kept);
+	}
 	
-	_mass[massID].center.is_active = is_active;
-	_mass[massID].center.props.draw_emitter = draw_center;
+	mass->particles = particles;
+	mass->num_initialized = num_kept;
+	mass->num_particles = min(mass->num_particles, capacity);
 }
 
 
 void CParticleSystem::setStrandLength(const int massID, const int length)
 {	
-	_mass[massID].center.props.strand_length = length;
+	// The histories are fitted to the new length on the next update.
+	setPropertyValue(massID, PROP_STRAND_LENGTH, intPropVal(length));
+}
+
+
+void CParticleSystem::setParticleQuota(const int quota, const float releaseScale)
+{
+	_particle_quota = quota;
+	_release_scale = min(max(releaseScale, 0.0f), 1.0f);
+}
 
-	if (_mass[massID].center.props.strand_length < 0)
+
+void CParticleSystem::setLodBands(const particleLodBand* bands, const int numBands)
+{
+	if ((bands == NULL) || (numBands < 1) || (numBands > PARTICLE_LOD_BANDS_MAX))
 	{
-		_mass[massID].center.props.strand_length = 0;
+		DPRINT_PARTICLESYS("CParticleSystem::setLodBands failed: there must be from 1 to PARTICLE_LOD_BANDS_MAX bands \n");
+		return;
 	}
 	
-	// Clear previous history and reinit.
-	for (int i = 0; i < _mass[massID].num_particles; ++i)
+	memcpy(_lod_bands, bands, sizeof(particleLodBand) * numBands);
+	_num_lod_bands = numBands;
+	
+	for (int i = 0; i < _num_lod_bands; ++i)
+	{
+		_lod_bands[i].particle_step = max(_lod_bands[i].particle_step, 1);
+		_lod_bands[i].strand_scale = min(max(_lod_bands[i].strand_scale, 0.0f), 1.0f);
+		_lod_bands[i].update_interval = max(_lod_bands[i].update_interval, 1);
+	}
+	
+	// Masses in bands that no longer exist settle into the least detailed band that is left.
+	for (int i = 0; i < _num_masses; ++i)
 	{
-		_mass[massID].particles[i].pos_history = NULL;
-		_mass[massID].particles[i].pos_history_counter = 0;
-		_mass[massID].particles[i].pos_history_active_count = 0;
-		_mass[massID].particles[i].pos_history = ArrayList<Vector3>::alloc(length);
-		_mass[massID].particles[i].props.strand_length = length;
+		_mass[i].lod_band = min(_mass[i].lod_band, _num_lod_bands - 1);
+		_mass[i].lod_prev_band = min(_mass[i].lod_prev_band, _num_lod_bands - 1);
 	}
 }
 
@@ -1232,525 +2025,402 @@ void CParticleSystem::setPhysicsState(int massID, ePhysicsMovementState state)
 }
 
 
-void CParticleSystem::setLifeTime(const int massID, const int lifeTime)
+void CParticleSystem::seekActions(const int massID, const int time)
 {
-	_mass[massID].center.props.life_time = lifeTime; 
-			
-	if (_mass[massID].center.props.life_time < 0)
+	if ((massID < 0) || (massID >= _num_masses))
 	{
-		_mass[massID].center.props.life_time = __INF;
+		DPRINT_PARTICLESYS("CParticleSystem::seekActions failed: massID out of bounds");
+		return;
 	}
-}
-
-
-void CParticleSystem::setFadeSpeed(const int massID, const int fadeSpeed) 
-{ 
-	_mass[massID].center.props.fade_speed = fadeSpeed;
 	
-	if (_mass[massID].center.props.fade_speed < 0)
+	for (int j = 0; j < _mass[massID].num_particles; ++j)
 	{
-		_mass[massID].center.props.fade_speed = __INF;
+		if (_mass[massID].particles[j].is_active)
+		{
+			_mass[massID].particles[j].sprite.setActionTime(time);
+		}
 	}
 }
 
 
-void CParticleSystem::setFadeCount(const int massID, const int fadeCount) 
+void CParticleSystem::setFlipbook(const int massID, const int cols, const int rows, const int numFrames, const int frameTime, const BOOL isLooping, const BOOL isBlended)
 {
-	_mass[massID].center.props.fade_count = fadeCount;
+	particlePropertyChange changes[6];
 	
-	if (_mass[massID].center.props.fade_count < 0)
-	{
-		_mass[massID].center.props.fade_count = 0;
-	}
+	changes[0].prop_id = PROP_FLIP_COLS;
+	changes[0].value.intVal = cols;
+	changes[1].prop_id = PROP_FLIP_ROWS;
+	changes[1].value.intVal = rows;
+	changes[2].prop_id = PROP_FLIP_FRAMES;
+	changes[2].value.intVal = numFrames;
+	changes[3].prop_id = PROP_FLIP_FRAME_TIME;
+	changes[3].value.intVal = frameTime;
+	changes[4].prop_id = PROP_FLIP_LOOPING;
+	changes[4].value.boolVal = (isLooping != FALSE);
+	changes[5].prop_id = PROP_FLIP_BLENDED;
+	changes[5].value.boolVal = (isBlended != FALSE);
+	
+	setProperties(massID, changes, 6);
+}
+
+
+void CParticleSystem::setLifeTime(const int massID, const int lifeTime)
+{
+	setPropertyValue(massID, PROP_LIFE, intPropVal(lifeTime));
+}
+
+
+void CParticleSystem::setFadeSpeed(const int massID, const int fadeSpeed)
+{
+	setPropertyValue(massID, PROP_FADE_SPEED, intPropVal(fadeSpeed));
+}
+
+
+void CParticleSystem::setFadeCount(const int massID, const int fadeCount)
+{
+	setPropertyValue(massID, PROP_FADE_COUNT, intPropVal(fadeCount));
 }
 
 
 void CParticleSystem::setSlowdownRate(const int massID, const float slowdownRate)
 {
-	_mass[massID].center.props.slowdown_rate = slowdownRate; 
-	
-	if (_mass[massID].center.props.slowdown_rate < 0.0f)
-	{
-		_mass[massID].center.props.slowdown_rate = 100.0f;
-	}
-	else if (_mass[massID].center.props.slowdown_rate >= 100.0f)
-	{
-		_mass[massID].center.props.slowdown_rate = 0.0f;
-	}
+	setPropertyValue(massID, PROP_SLOWDOWN_RATE, floatPropVal(slowdownRate));
 }
 
 
-void CParticleSystem::setVelBase(const int massID, const int velBase) 
+void CParticleSystem::setVelBase(const int massID, const int velBase)
 {
-	_mass[massID].center.props.vel_base = velBase;
-	
-	if (_mass[massID].center.props.vel_base < 0)
-	{
-		_mass[massID].center.props.vel_base = 0;
-	}
+	setPropertyValue(massID, PROP_VEL_BASE, intPropVal(velBase));
 }
 
 
-void CParticleSystem::setVelRand(const int massID, const int velRand) 
-{ 
-	_mass[massID].center.props.vel_rand = velRand; 
-	
-	if (_mass[massID].center.props.vel_rand < 0)
-	{
-		_mass[massID].center.props.vel_rand = 0;
-	}
+void CParticleSystem::setVelRand(const int massID, const int velRand)
+{
+	setPropertyValue(massID, PROP_VEL_RAND, intPropVal(velRand));
 }
 
 
-void CParticleSystem::setAngleMin(const int massID, const int angleMin) 
+void CParticleSystem::setAngleMin(const int massID, const int angleMin)
 {
-	_mass[massID].center.props.angle_min = angleMin; 
-	
-	if (_mass[massID].center.props.angle_min < 0)
-	{
-		_mass[massID].center.props.angle_min = 360;
-	}
-	else if (_mass[massID].center.props.angle_min >= 360)
-	{
-		_mass[massID].center.props.angle_min = 0;
-	}
-	
-	// Make sure that the min angle is never greater than the max angle.
-	if (_mass[massID].center.props.angle_min > _mass[massID].center.props.angle_max)
-	{
-		// Just adjust the max angle to one degree greater than angle min.
-		_mass[massID].center.props.angle_max = _mass[massID].center.props.angle_min + 1;
-	}
+	setPropertyValue(massID, PROP_ANGLE_MIN, intPropVal(angleMin));
 }
 
 
-void CParticleSystem::setAngleMax(const int massID, const int angleMax) 
+void CParticleSystem::setAngleMax(const int massID, const int angleMax)
 {
-	_mass[massID].center.props.angle_max = angleMax; 
-	
-	if (_mass[massID].center.props.angle_max < 0)
-	{
-		_mass[massID].center.props.angle_max = 360;
-	}
-	else if (_mass[massID].center.props.angle_max >= 360)
-	{
-		_mass[massID].center.props.angle_max = 0;
-	}
-	
-	// Make sure that the min angle is never greater than the max angle.
-	if (_mass[massID].center.props.angle_min > _mass[massID].center.props.angle_max)
-	{
-		// Just adjust the max angle to one degree greater than angle min.
-		_mass[massID].center.props.angle_max = _mass[massID].center.props.angle_min + 1;
-	}
+	setPropertyValue(massID, PROP_ANGLE_MAX, intPropVal(angleMax));
 }
 
 
-void CParticleSystem::setReleaseTime(const int massID, const int releaseTime) 
+void CParticleSystem::setReleaseTime(const int massID, const int releaseTime)
 {
-	_mass[massID].center.props.release_time = releaseTime;
-	
-	if (_mass[massID].center.props.release_time < 0)
-	{
-		_mass[massID].center.props.release_time = 0;
-	}
+	setPropertyValue(massID, PROP_REL_TIME, intPropVal(releaseTime));
 }
 
 
-void CParticleSystem::setReleaseRate(const int massID, const int releaseRate) 
+void CParticleSystem::setReleaseRate(const int massID, const int releaseRate)
 {
-	_mass[massID].center.props.release_rate = releaseRate; 
-	
-	if (_mass[massID].center.props.release_rate < 0)
-	{
-		_mass[massID].center.props.release_rate = 0;
-	}
+	setPropertyValue(massID, PROP_REL_RATE, intPropVal(releaseRate));
 }
 
 
 void CParticleSystem::setReleaseRand(const int massID, const int releaseRand)
 {
-	_mass[massID].center.props.release_rand = releaseRand;
-	
-	if (_mass[massID].center.props.release_rand < 0)
-	{
-		_mass[massID].center.props.release_rand = 0;
-	}
+	setPropertyValue(massID, PROP_REL_RAND, intPropVal(releaseRand));
 }
 
 
 void CParticleSystem::setGravity(const int massID, const float gravity)
 {
-	_mass[massID].center.props.gravity = gravity; 
+	setPropertyValue(massID, PROP_GRAVITY, floatPropVal(gravity));
 }
 
 
 void CParticleSystem::setRotationSpeed(const int massID, const int rotationSpeed)
 {
-	_mass[massID].center.props.rotation_speed = rotationSpeed; 
-	
-	if (_mass[massID].center.props.rotation_speed < 0)
-	{
-		_mass[massID].center.props.rotation_speed = 0;
-	}
+	setPropertyValue(massID, PROP_ROT_SPEED, intPropVal(rotationSpeed));
 }
 
 
-void CParticleSystem::setRotationRand(const int massID, const int rotationRand) 
-{ 
-	_mass[massID].center.props.rotation_rand = rotationRand; 
-	
-	if (_mass[massID].center.props.rotation_rand < 0)
-	{
-		_mass[massID].center.props.rotation_rand = 0;
-	}
+void CParticleSystem::setRotationRand(const int massID, const int rotationRand)
+{
+	setPropertyValue(massID, PROP_ROT_RAND, intPropVal(rotationRand));
 }
 
 
-void CParticleSystem::setSizeStart(const int massID, const float sizeStart) 
+void CParticleSystem::setSizeStart(const int massID, const float sizeStart)
 {
-	_mass[massID].center.props.size_start = sizeStart; 
-	
-	if (_mass[massID].center.props.size_start < 0)
-	{
-		_mass[massID].center.props.size_start = 0;
-	}
+	setPropertyValue(massID, PROP_SIZE_START, floatPropVal(sizeStart));
 }
 
 
 void CParticleSystem::setSizeEnd(const int massID, const float sizeEnd)
 {
-	_mass[massID].center.props.size_end = sizeEnd; 
-	
-	if (_mass[massID].center.props.size_end < 0)
-	{
-		_mass[massID].center.props.size_end = 0;
-	}
+	setPropertyValue(massID, PROP_SIZE_END, floatPropVal(sizeEnd));
 }
 
 
 void CParticleSystem::setSizeSpeed(const int massID, const float sizeSpeed)
 {
-	_mass[massID].center.props.size_speed = sizeSpeed; 
-	
-	if (_mass[massID].center.props.size_speed < 0)
-	{
-		_mass[massID].center.props.size_speed = 0;
-	}
+	setPropertyValue(massID, PROP_SIZE_SPEED, intPropVal((int)sizeSpeed));
 }
 
 
 void CParticleSystem::setSizeCount(const int massID, const int sizeCount)
 {
-	_mass[massID].center.props.size_count = sizeCount; 
+	setPropertyValue(massID, PROP_SIZE_COUNT, intPropVal(sizeCount));
+}
+
+
+void CParticleSystem::setBlinkOnTime(const int massID, const int blinkOnTime)
+{
+	setPropertyValue(massID, PROP_BLINK_ON_TIME, intPropVal(blinkOnTime));
+}
+
+
+void CParticleSystem::setBlinkOnRand(const int massID, const int blinkOnRand)
+{
+	setPropertyValue(massID, PROP_BLINK_ON_RAND, intPropVal(blinkOnRand));
+}
+
+
+void CParticleSystem::setBlinkOffTime(const int massID, const int blinkOffTime)
+{
+	setPropertyValue(massID, PROP_BLINK_OFF_TIME, intPropVal(blinkOffTime));
+}
+
+
+void CParticleSystem::setBlinkOffRand(const int massID, const int blinkOffRand)
+{
+	setPropertyValue(massID, PROP_BLINK_OFF_RAND, intPropVal(blinkOffRand));
+}
+
+
+void CParticleSystem::setBlinkCount(const int massID, const int blinkCount)
+{
+	setPropertyValue(massID, PROP_BLINK_COUNT, intPropVal(blinkCount));
+}
+
+
+void CParticleSystem::setReleaseDist(const int massID, const int releaseDist)
+{
+	setPropertyValue(massID, PROP_REL_DIST, intPropVal(releaseDist));
+}
+
+
+void CParticleSystem::setReleaseDistRand(const int massID, const int releaseDistRand)
+{
+	setPropertyValue(massID, PROP_REL_DIST_RAND, intPropVal(releaseDistRand));
+}
+
+
+void CParticleSystem::setColor(const int massID, float r, float g, float b)
+{
+	particlePropertyChange changes[3];
 	
-	if (_mass[massID].center.props.size_count < 0)
-	{
-		_mass[massID].center.props.size_count = 0;
-	}
+	changes[0].prop_id = PROP_COLOR_R;
+	changes[0].value.floatVal = r;
+	changes[1].prop_id = PROP_COLOR_G;
+	changes[1].value.floatVal = g;
+	changes[2].prop_id = PROP_COLOR_B;
+	changes[2].value.floatVal = b;
+	
+	// Setting the components together updates the color of the emitter sprite once.
+	setProperties(massID, changes, 3);
 }
 
 
-void CParticleSystem::setBlinkOnTime(const int massID, const int blinkOnTime) 
+// Applies the limit of a property to a value of the type that the property data type uses.
+// Returns false if the value must be ignored.
+template <typename T>
+static bool limitPropertyValue(const particlePropDesc* desc, T* value)
 {
-	_mass[massID].center.props.blink_on_time = blinkOnTime; 
-		
-	if (_mass[massID].center.props.blink_on_time < 0)
+	const T min_value = (T)desc->min_value;
+	const T max_value = (T)desc->max_value;
+	
+	switch (desc->limit)
 	{
-		_mass[massID].center.props.blink_on_time = __INF;
+		case eParticlePropLimitMin:
+			if (*value < min_value)
+			{
+				*value = min_value;
+			}
+			break;
+			
+		case eParticlePropLimitRange:
+			if (*value < min_value)
+			{
+				*value = min_value;
+			}
+			else if (*value > max_value)
+			{
+				*value = max_value;
+			}
+			break;
+			
+		case eParticlePropLimitInfinite:
+			if (*value < min_value)
+			{
+				*value = (T)__INF;
+			}
+			break;
+			
+		case eParticlePropLimitWrap:
+			if (*value < min_value)
+			{
+				*value = max_value;
+			}
+			else if (*value >= max_value)
+			{
+				*value = min_value;
+			}
+			break;
+			
+		case eParticlePropLimitReject:
+			if ((*value < min_value) || (*value > max_value))
+			{
+				return false;
+			}
+			break;
 	}
+	
+	return true;
 }
 
 
-void CParticleSystem::setBlinkOnRand(const int massID, const int blinkOnRand) 
+// Stores a value in a property field, converting it to the way the field is stored.
+template <typename T>
+static void writePropertyField(unsigned char* field, const int storage, const T value)
 {
-	_mass[massID].center.props.blink_on_rand = blinkOnRand; 
-	
-	if (_mass[massID].center.props.blink_on_rand < 0)
+	switch (storage)
 	{
-		_mass[massID].center.props.blink_on_rand = 0;
+		case eParticlePropStorageInt:		*(int*)field = (int)value;			break;
+		case eParticlePropStorageFloat:		*(float*)field = (float)value;		break;
+		case eParticlePropStorageBOOL:		*(BOOL*)field = (BOOL)value;		break;
+		case eParticlePropStorageBool:		*(bool*)field = (value != 0);		break;
+		case eParticlePropStorageShort:		*(short*)field = (short)value;		break;
 	}
 }
 
 
-void CParticleSystem::setBlinkOffTime(const int massID, const int blinkOffTime)
+// Reads a property field, converting it to the type that the property data type uses.
+template <typename T>
+static T readPropertyField(const unsigned char* field, const int storage)
 {
-	_mass[massID].center.props.blink_off_time = blinkOffTime; 
-
-	if (_mass[massID].center.props.blink_off_time < 0)
+	switch (storage)
 	{
-		_mass[massID].center.props.blink_off_time = __INF;
+		case eParticlePropStorageInt:		return (T)*(const int*)field;
+		case eParticlePropStorageFloat:		return (T)*(const float*)field;
+		case eParticlePropStorageBOOL:		return (T)*(const BOOL*)field;
+		case eParticlePropStorageBool:		return (T)*(const bool*)field;
+		case eParticlePropStorageShort:		return (T)*(const short*)field;
 	}
+	
+	return (T)0;
 }
 
 
-void CParticleSystem::setBlinkOffRand(const int massID, const int blinkOffRand) 
+// Checks a property value against its limit and stores it in the given properties.
+// Returns false if the value was ignored.
+static bool storePropertyValue(particleProperties* props, const particlePropDesc* desc, const propVal value)
 {
-	_mass[massID].center.props.blink_off_rand = blinkOffRand; 
+	unsigned char* field = (unsigned char*)props + desc->offset;
 	
-	if (_mass[massID].center.props.blink_off_rand < 0)
+	if (desc->data_type == PROP_DATA_TYPE_FLOAT)
 	{
-		_mass[massID].center.props.blink_off_rand = 0;
+		float float_val = value.floatVal;
+		
+		if (!limitPropertyValue(desc, &float_val))
+		{
+			return false;
+		}
+		
+		writePropertyField(field, desc->storage, float_val);
 	}
-}
-
-
-void CParticleSystem::setBlinkCount(const int massID, const int blinkCount)
-{
-	_mass[massID].center.props.blink_count = blinkCount; 
-	
-	if (_mass[massID].center.props.blink_count < 0)
+	else if (desc->data_type == PROP_DATA_TYPE_BOOL)
 	{
-		_mass[massID].center.props.blink_count = __INF;
+		writePropertyField(field, desc->storage, (int)value.boolVal);
 	}
-}
-
-
-void CParticleSystem::setReleaseDist(const int massID, const int releaseDist)
-{
-	_mass[massID].center.props.release_dist = releaseDist; 
-	
-	if (_mass[massID].center.props.release_dist < 0)
+	else
 	{
-		_mass[massID].center.props.release_dist = 0;
+		// Every other data type, including the image id and the draw mode, is set through intVal.
+		int int_val = value.intVal;
+		
+		if (!limitPropertyValue(desc, &int_val))
+		{
+			return false;
+		}
+		
+		writePropertyField(field, desc->storage, int_val);
 	}
+	
+	return true;
 }
 
 
-void CParticleSystem::setReleaseDistRand(const int massID, const int releaseDistRand)
-{ 
-	_mass[massID].center.props.release_dist_rand = releaseDistRand; 
+void CParticleSystem::setPropertyValue(const int massID, const int propID, const propVal value)
+{	
+	particlePropertyChange change;
 	
-	if (_mass[massID].center.props.release_dist_rand < 0)
-	{
-		_mass[massID].center.props.release_dist_rand = 0;
-	}
+	change.prop_id = propID;
+	change.value = value;
+	
+	setProperties(massID, &change, 1);
 }
 
 
-void CParticleSystem::setColor(const int massID, float r, float g, float b)
+void CParticleSystem::setProperties(const int massID, const particlePropertyChange* changes, const int numChanges)
 {
-	// Adjust the red color component of the particle mass.
-	_mass[massID].center.props.r = r;
+	particleMass* mass = &_mass[massID];
+	particleProperties* props = editProperties(massID);
+	unsigned int dependencies = 0;
+	int mass_size = 0;
 	
-	if (_mass[massID].center.props.r < 0.0f)
+	for (int i = 0; i < numChanges; ++i)
 	{
-		_mass[massID].center.props.r = 0.0f;
-	}
-	else if (_mass[massID].center.props.r > 1.0f)
-	{
-		_mass[massID].center.props.r = 1.0f;
+		const int prop_id = changes[i].prop_id;
+		
+		if ((prop_id < 0) || (prop_id >= PROP_MAX))
+		{
+			DPRINT_PARTICLESYS("CParticleSystem::setProperties failed: property %d out of bounds \n", prop_id);
+			continue;
+		}
+		
+		const particlePropDesc* desc = &propDescs[prop_id];
+		
+		if (desc->storage == eParticlePropStorageNone)
+		{
+			// The mass size is the only property that is not stored in the properties, and it is applied below.
+			mass_size = changes[i].value.intVal;
+		}
+		else if (!storePropertyValue(props, desc, changes[i].value))
+		{
+			DPRINT_PARTICLESYS("CParticleSystem::setProperties failed: value of %s out of bounds \n", desc->type_name);
+			continue;
+		}
+		
+		dependencies |= desc->dependencies;
 	}
 	
-	// Adjust the green color component of the particle mass.
-	_mass[massID].center.props.g = g;
-	
-	if (_mass[massID].center.props.g < 0.0f)
+	// Make sure that the min angle is never greater than the max angle.
+	if ((dependencies & eParticlePropDependAngles) && (props->angle_min > props->angle_max))
 	{
-		_mass[massID].center.props.g = 0.0f;
+		// Just adjust the max angle to one degree greater than angle min.
+		props->angle_max = props->angle_min + 1;
 	}
-	else if (_mass[massID].center.props.g > 1.0f)
+	
+	if (dependencies & eParticlePropDependColor)
 	{
-		_mass[massID].center.props.g = 1.0f;
+		mass->center.sprite.setColor(props->r, props->g, props->b);
 	}
 	
-	// Adjust the blue color component of the particle mass.
-	_mass[massID].center.props.b = b;
+	// The image, the strands and the flipbook are rebuilt on the next update.
+	mass->dirty_flags |= (dependencies & (eParticleDirtyImage | eParticleDirtyStrand | eParticleDirtyFlipbook));
 	
-	if (_mass[massID].center.props.b < 0.0f)
-	{
-		_mass[massID].center.props.b = 0.0f;
-	}
-	else if (_mass[massID].center.props.b > 1.0f)
+	if (dependencies & eParticlePropDependMassSize)
 	{
-		_mass[massID].center.props.b = 1.0f;
+		setMassSize(massID, mass_size);
 	}
-	
-	// Set the color of the sprite.
-	_mass[massID].center.sprite.setColor(r, g, b);
-}
-
-
-void CParticleSystem::setPropertyValue(const int massID, const int propID, const propVal value)
-{	
-	switch (propID)
-	{
-		case PROP_LIFE:
-			// Adjust life time of the particles.
-			setLifeTime(massID, value.intVal);
-			break;
-			
-		case PROP_FADE_SPEED:
-			// Adjust fade speed of the particles.
-			setFadeSpeed(massID, value.intVal);
-			break;
-			
-		case PROP_FADE_COUNT:
-			// Adjust fade loop count of the particles.
-			setFadeCount(massID, value.intVal);
-			break;
-			
-		case PROP_SLOWDOWN_RATE:
-			// Adjust speed deterioration of the particles.
-			setSlowdownRate(massID, value.floatVal);
-			break;
-			
-		case PROP_VEL_BASE:
-			// Adjust base velocity of the particles.
-			setVelBase(massID, value.intVal);
-			break;
-			
-		case PROP_VEL_RAND:
-			// Adjust velocity randomness of the particles.
-			setVelRand(massID, value.intVal);
-			break;
-			
-		case PROP_ANGLE_MIN:
-			// Adjust ejection angle of the particles.
-			setAngleMin(massID, value.intVal);
-			break;
-			
-		case PROP_ANGLE_MAX:
-			// Adjust ejection angle of the particles.
-			setAngleMax(massID, value.intVal);
-			break;
-			
-		case PROP_REL_TIME:
-			// Adjust the speed in MS at which particles are released.
-			setReleaseTime(massID, value.intVal);
-			break;
-			
-		case PROP_REL_RATE:
-			// Adjust the number of particles that are released at each interval.
-			setReleaseRate(massID, value.intVal);
-			break;
-			
-		case PROP_REL_RAND:
-			// Adjust release rate randomness.
-			setReleaseRand(massID, value.intVal);
-			break;
-			
-		case PROP_GRAVITY:
-			// Adjust gravity on the particles.
-			setGravity(massID, value.floatVal);
-			break;
-			
-		case PROP_ROT_SPEED:
-			// Adjust rotation speed of the particles.
-			setRotationSpeed(massID, value.intVal);
-			break;
-			
-		case PROP_ROT_RAND:
-			// Adjust rotation randomness of the particles.
-			setRotationRand(massID, value.intVal);
-			break;
-			
-		case PROP_SIZE_START:
-			// Adjust the starting size of the particles as they are ejected.
-			setSizeStart(massID, value.floatVal);
-			break;
-			
-		case PROP_SIZE_END:
-			// Adjust the ending size of the particles.
-			setSizeEnd(massID, value.floatVal);
-			break;
-			
-		case PROP_SIZE_SPEED:
-			// Adjust the speed at which the particle size changes.
-			setSizeSpeed(massID, value.intVal);
-			break;
-			
-		case PROP_SIZE_COUNT:
-			// Adjust the number of times that the size changes from start to end within the size_speed time.
-			setSizeCount(massID, value.intVal);
-			break;
-			
-		case PROP_BLINK_ON_TIME:
-			// Adjust the time that the particle is visible during a blink action.
-			setBlinkOnTime(massID, value.intVal);
-			break;
-			
-		case PROP_BLINK_ON_RAND:
-			// Adjust the random time value for the blink-on time.
-			setBlinkOnRand(massID, value.intVal);
-			break;
-			
-		case PROP_BLINK_OFF_TIME:
-			// Adjust the time that the particle is not visible during a blink action.
-			setBlinkOffTime(massID, value.intVal);
-			break;
-			
-		case PROP_BLINK_OFF_RAND:
-			// Adjust the random time value for the blink-off time.
-			setBlinkOffRand(massID, value.intVal);
-			break;
-			
-		case PROP_BLINK_COUNT:
-			// Adjust the number of times that the particle blinks in and out of visibility.			
-			setBlinkCount(massID, value.intVal);
-			break;
-			
-		case PROP_REL_DIST:
-			// Adjust the release distance from the center mass.
-			setReleaseDist(massID, value.intVal);
-			break;
-			
-		case PROP_REL_DIST_RAND:
-			// Adjust the release distance randomness from the center mass.
-			setReleaseDistRand(massID, value.intVal);
-			break;
-			
-		case PROP_GLOWS:
-			// Changes the gl alpha function. Makes particle rendering additive or not.
-			setGlows(massID, value.boolVal);
-			break;
-			
-		case PROP_COLOR_R:
-			// Adjust the red color component of the particle mass.
-			setColor(massID, value.floatVal, _mass[massID].center.props.g, _mass[massID].center.props.b);
-			break;
-			
-		case PROP_COLOR_G:
-			// Adjust the green color component of the particle mass.
-			setColor(massID, _mass[massID].center.props.r, value.floatVal, _mass[massID].center.props.b);
-			break;
-			
-		case PROP_COLOR_B:
-			// Adjust the blue color component of the particle mass.
-			setColor(massID, _mass[massID].center.props.r, _mass[massID].center.props.g, value.floatVal);
-			break;
-			
-		case PROP_COLOR_RAND:
-			// Toggle color randomization mode.
-			setRandColor(massID, value.boolVal);
-			break;
-			
-		case PROP_IMAGE_ID:
-			// Changes the particle image.
-			setImageID(massID, value.intVal);
-			break;
-			
-		case PROP_MASS_SIZE:
-			setMassSize(massID, value.intVal);
-			break;
-			
-		case PROP_STRAND_LENGTH:		
-			setStrandLength(massID, value.intVal);
-			break;
-			
-		case PROP_3D_MODE:
-			setEnable3D(massID, value.boolVal);
-			break;
-			
-		case PROP_DRAW_MODE:
-			setDrawMode(massID, (eParticleDrawMode) value.intVal);
-			break;
-			
-		case PROP_DRAW_EMITTER:
-			//setDrawEmitter(massID, value.boolVal);
-			setDrawCenter(massID, value.boolVal);
-			break;			
-	}	
 }
 
 
@@ -1758,163 +2428,38 @@ const propVal CParticleSystem::getPropertyValue(const int massID, const int prop
 {
 	propVal retVal;
 	
-	switch (propID)
+	retVal.intVal = 0;
+	
+	if ((propID < 0) || (propID >= PROP_MAX))
 	{
-		case PROP_LIFE:
-			retVal.intVal = _mass[massID].center.props.life_time;
-			break;
-			
-		case PROP_FADE_SPEED:
-			retVal.intVal = _mass[massID].center.props.fade_speed;
-			break;
-			
-		case PROP_FADE_COUNT:
-			retVal.intVal = _mass[massID].center.props.fade_count;
-			break;
-			
-		case PROP_SLOWDOWN_RATE:
-			retVal.floatVal = _mass[massID].center.props.slowdown_rate;
-			break;
-			
-		case PROP_VEL_BASE:
-			retVal.intVal = _mass[massID].center.props.vel_base;
-			break;
-			
-		case PROP_VEL_RAND:
-			retVal.intVal = _mass[massID].center.props.vel_rand;
-			break;
-			
-		case PROP_ANGLE_MIN:
-			retVal.intVal = _mass[massID].center.props.angle_min;
-			break;
-			
-		case PROP_ANGLE_MAX:
-			retVal.intVal = _mass[massID].center.props.angle_max;
-			break;
-			
-		case PROP_REL_TIME:
-			retVal.intVal = _mass[massID].center.props.release_time;
-			break;
-			
-		case PROP_REL_RATE:
-			retVal.intVal = _mass[massID].center.props.release_rate;
-			break;
-			
-		case PROP_REL_RAND:
-			retVal.intVal = _mass[massID].center.props.release_rand;
-			break;
-			
-		case PROP_GRAVITY:
-			retVal.floatVal = _mass[massID].center.props.gravity;
-			break;
-			
-		case PROP_ROT_SPEED:
-			retVal.intVal = _mass[massID].center.props.rotation_speed;
-			break;
-			
-		case PROP_ROT_RAND:
-			retVal.intVal = _mass[massID].center.props.rotation_rand;
-			break;
-			
-		case PROP_SIZE_START:
-			retVal.floatVal = _mass[massID].center.props.size_start;
-			break;
-			
-		case PROP_SIZE_END:
-			retVal.floatVal = _mass[massID].center.props.size_end;
-			break;
-			
-		case PROP_SIZE_SPEED:
-			retVal.intVal = _mass[massID].center.props.size_speed;
-			break;
-			
-		case PROP_SIZE_COUNT:
-			retVal.intVal = _mass[massID].center.props.size_count;
-			break;
-			
-		case PROP_BLINK_ON_TIME:
-			retVal.intVal = _mass[massID].center.props.blink_on_time;
-			break;
-			
-		case PROP_BLINK_ON_RAND:
-			retVal.intVal = _mass[massID].center.props.blink_on_rand;
-			break;
-			
-		case PROP_BLINK_OFF_TIME:
-			retVal.intVal = _mass[massID].center.props.blink_off_time;
-			break;
-			
-		case PROP_BLINK_OFF_RAND:
-			retVal.intVal = _mass[massID].center.props.blink_off_rand;
-			break;
-			
-		case PROP_BLINK_COUNT:
-			retVal.intVal = _mass[massID].center.props.blink_count;
-			break;
-			
-		case PROP_REL_DIST:
-			retVal.intVal = _mass[massID].center.props.release_dist;
-			break;
-			
-		case PROP_REL_DIST_RAND:
-			retVal.intVal = _mass[massID].center.props.release_dist_rand;
-			break;
-			
-		case PROP_GLOWS:
-			retVal.boolVal = _mass[massID].center.props.glows;
-			break;
-			
-		case PROP_COLOR_R:
-			retVal.floatVal = _mass[massID].center.props.r;
-			break;
-			
-		case PROP_COLOR_G:
-			retVal.floatVal = _mass[massID].center.props.g;
-			break;
-			
-		case PROP_COLOR_B:
-			retVal.floatVal = _mass[massID].center.props.b;
-			break;
-			
-		case PROP_COLOR_RAND:
-			retVal.boolVal = _mass[massID].center.props.color_rand;
-			break;
-			
-		case PROP_IMAGE_ID:
-			retVal.strVal = (char*)getImageName(massID);
-			retVal.intVal = _mass[massID].center.props.image_id;
-			break;
-			
-		case PROP_MASS_SIZE:
-			retVal.intVal = getNumParticles(massID);
-			break;
-			
-		case PROP_STRAND_LENGTH:
-			retVal.intVal = _mass[massID].center.props.strand_length;
-			break;
-			
-		case PROP_3D_MODE:
-			retVal.boolVal = _mass[massID].center.props.is_3D_enabled;
-			break;
-			
-		case PROP_DRAW_MODE:
-			// Notice that the draw mode contains both a string and an id.
-			retVal.strVal = (char*)getDrawModeStr(getDrawMode(massID));
-			retVal.intVal = getDrawMode(massID);
-			break;
-			
-		case PROP_DRAW_EMITTER:
-			retVal.boolVal = _mass[massID].center.props.draw_emitter;
-			break;
+		DPRINT_PARTICLESYS("CParticleSystem::getPropertyValue failed: property %d out of bounds \n", propID);
+		return retVal;
 	}
 	
-	return retVal;
+	const particlePropDesc* desc = &propDescs[propID];
+	const unsigned char* field = (const unsigned char*)_mass[massID].props.getRawPtr() + desc->offset;
+	
+	if (desc->storage == eParticlePropStorageNone)
+	{
+		retVal.intVal = getNumParticles(massID);
+	}
+	else if (desc->data_type == PROP_DATA_TYPE_FLOAT)
+	{
+		retVal.floatVal = readPropertyField<float>(field, desc->storage);
+	}
+	else if (desc->data_type == PROP_DATA_TYPE_BOOL)
+	{
+		retVal.boolVal = (readPropertyField<int>(field, desc->storage) != 0);
+	}
+	else
+	{
+		// The image id and the draw mode are given as ids, like they are set.
+		retVal.intVal = readPropertyField<int>(field, desc->storage);
+	}
 	
+	return retVal;
 }
 
-
-
-
 #else
 
 
@@ -1961,6 +2506,18 @@ void CParticleSystem::draw(eParticleDrawMode drawMode, void* data)
 }
 
 
+void CParticleSystem::buildVertices(const float* camMat)
+{
+
+}
+
+
+void CParticleSystem::setNumThreads(const int numThreads)
+{
+
+}
+
+
 void CParticleSystem::update()
 {
 
@@ -2003,6 +2560,13 @@ void CParticleSystem::applyProperties(int massID, int particleID)
 }
 
 
+void CParticleSystem::applyDirtyProperties(const int massID)
+{
+
+}
+
+
+
 void CParticleSystem::setMode(int massID, eParticleMode mode)
 {
 
@@ -2014,6 +2578,11 @@ void CParticleSystem::setMode(int massID, particleProperties *modeData)
 
 }
 
+BOOL CParticleSystem::loadEffect(const void* data, size_t size)
+{
+	return FALSE;
+}
+
 void CParticleSystem::setAngles(int massID, int numAngles, ...)
 {
 
@@ -2039,5 +2608,26 @@ void CParticleSystem::setPhysicsState(int massID, ePhysicsMovementState state)
 	
 }
 
+void CParticleSystem::seekActions(const int massID, const int time)
+{
+	
+}
+
+void CParticleSystem::setParticleQuota(const int quota, const float releaseScale)
+{
+	
+}
+
+
+void CParticleSystem::setLodBands(const particleLodBand* bands, const int numBands)
+{
+	
+}
+
+void CParticleSystem::setFlipbook(const int massID, const int cols, const int rows, const int numFrames, const int frameTime, const BOOL isLooping, const BOOL isBlended)
+{
+	
+}
+
 
 #endif
\ No newline at end of file
@@ -11,139 +11,55 @@
 #define __PARTICLESYSTEM_H__
 
 #include "physics_types.h"
+#include "ParticleProperties.h"
+#include "ParticleEffect.h"
 #include "ArrayList.h"
+#include "Reference.h"
 #include "physics.h"
 #include "Sprite.h"
+#include "ThreadPool.h"
 
 static const int PARTICLE_RADIUS_DEFAULT = 8;
+static const int PARTICLE_QUAD_VERTICES = 4;		// A particle quad has 4 corners, which its 2 triangles share through the quad index buffer.
+static const int PARTICLE_VERTEX_JOB_SIZE = 256;	// The number of particles that each vertex building job is responsible for.
+static const int PARTICLE_MASS_SHRINK_RATIO = 4;	// The particle storage of a mass is only released once less than 1 / PARTICLE_MASS_SHRINK_RATIO of it is used.
+static const int PARTICLE_SHARED_PROPS_MAX = 32;	// The number of distinct property blocks that masses can share across every particle system.
+static const int PARTICLE_LOD_BANDS_MAX = 4;		// The most level of detail bands that a particle system can have, including the full detail band.
+static const int PARTICLE_LOD_FADE_TIME = 400;		// The time, in milliseconds, that a mass takes to crossfade from one level of detail band to the next.
+static const float PARTICLE_LOD_HYSTERESIS = 0.85f;	// A mass only returns to a more detailed band once it is this much inside the band's thresholds, so it does not flicker on the border.
 
 
-/*! \enum eParticleDrawMode
- *	\brief The particle draw mode indicates the different ways that the particle system renders its particles.
- */
-typedef enum eParticleDrawMode
-{
-	eParticleDrawModeNormal = 0,	/*!< Particles are rendered using normal textured quads. This mode is used when specialized particle effects are needed, such as rotation. */
-	eParticleDrawModeBillBoard,		/*!< Billboard mode is used when rendering particles in 3D mode. All particles are faced at the camera in this mode. */
-	eParticleDrawModePoint,	/*!< Point sprites are less expensive to render than quads since it consists of only one vertex (versus 4 for a quad). Specialized effects such as rotation are not possible in this mode. */
-	eParticleDrawModeMAX,			/*!< The total number of possible draw modes. */
-} eParticleDrawMode;
-
-
-/*! \struct particleProperties
- *	\brief Particle properties is what defines the behavior of a particle.
+/*! \enum eParticleDirtyFlags
+ *	\brief The groups of mass state that are derived from the mass properties.
  *
- * All particles must set these properties for it to function correctly.
+ * Setters only mark the groups that a property change affects, and applyDirtyProperties() rebuilds just those groups once, however many changes were made since.
  */
-typedef struct particleProperties
+typedef enum eParticleDirtyFlags
 {
-	int life_time;		/*!< The amount of time that the particle is visible and being updated. This value can be set to #__INF for when the particle has an infinite life time. */
-	int fade_speed;		/*!< The speed at which the particle will fade in or out of visibility. This value can be set to #__INF for when the particle never fades. */
-	int fade_count;		/*!< The number of times that the particle will fade in and out of visibility. */
-	float slowdown_rate;/*!< The rate at which the velocity of the particle deteriorates. Calculated as a percentage from 1.0 (no deterioration) to 0.0 (full deterioration). */
-	int vel_base;		/*!< The base velocity of the particle when it is released from the mass. */
-	int vel_rand;		/*!< The particle velocity randomness when it is released from the mass. Higher value means larger random threshold. */
-	int angle_min;		/*!< Defines a bounding edge that particles can be released. */
-	int angle_max;		/*!< Defines the other bounding edge that particles can be released. Must be a larger value than #angle_min. */
-	int release_time;	/*!< The speed in MS at which the particles will be released from the mass. */
-	int release_rate;	/*!< The rate at which the particles will be released from the mass. */
-	int release_rand;	/*!< The release rate randomness in MS. */
-	float gravity;		/*!< The strength of gravity on the particle. */
-	int	rotation_speed;	/*!< The speed at which particles rotate, measured in the time it takes in MS to do one full rotation. */
-	int rotation_rand;	/*!< A random factor for the rotation speed. */
-	float size_start;	/*!< The initial size scale of the particle as it is ejected. The particle will pulse back and forth from this size to #size_end. The number of pulses and pulse duration is determined by #size_count and #size_speed. */
-	float size_end;		/*!< The end size scale of the particle during its size pulse loop. */
-	float size_speed;	/*!< The speed in MS at which the size scale changes from start to end. This value can be set to #__INF for when the particle never changes size. */
-	int size_count;		/*!< The number of times that the size scale changes from start to end. */
-	int blink_on_time;	/*!< The time that the particle is visible during a blink action. */
-	int blink_on_rand;	/*!< The random time value for the blink-on time. */
-	int blink_off_time;	/*!< The time that the particle is not visible during a blink action. */
-	int blink_off_rand;	/*!< The random time value for the blink-off time. */
-	int blink_count;	/*!< The number of times that the particle blinks in and out of visibility. This value can be set to #__INF for infinite blinks to occur. */
-	int release_dist;	/*!< The distance from the center of the mass to release the particle. */
-	int release_dist_rand;	/*!< The random value added to the release distance. */
-	BOOL glows;			/*!< Indicates whether to use the blend function GL_ONE or GL_ONE_MINUS_SRC_ALPHA. When set to GL_ONE, colors become additive when particles overlap each other, creating a "glow" effect.*/
-	float r;			/*!< The red color component of the particle. */
-	float g;			/*!< The green color component of the particle. */
-	float b;			/*!< The blue color component of the particle. */
-	bool color_rand;	/*!< Indicates whether colors are randomized. */
-	BOOL is_3D_enabled;	/*!< Indicates whether to render this particle in 3d mode. */
-	int strand_length;	/*!< Used for making a trail of particles. Indicates the length of the strand in particles. */
-	bool frame_skip;	/*!< Indicates whether to allow skipping of physics frames, to have time-accurate rendering, or showing all frames. */
-	bool draw_emitter;	/*!< Draws the center point of the mass, also known as the particle emitter. */
-	short draw_mode;	/*!< The rendering mode for this particle. */
-	int image_id;		/*!< The file image file ID found in gamedata.h */
-} particleProperties;
-
-/*! \struct particlePropNames
- *	\brief This is used for querying a specific property of the particle properties.
- *
- */
-typedef struct particlePropNames
-{
-	int type_id;
-	int data_type;
-	float increment_value;
-	const char* type_name;
-	const char* description;
-} particlePropNames;
-
+	eParticleDirtyImage = eParticlePropDependImage,		/*!< The sprites must be switched to the image in the image_id property. */
+	eParticleDirtyStrand = eParticlePropDependStrand,	/*!< The position histories must be fitted to the strand_length property. */
+	eParticleDirtyFlipbook = eParticlePropDependFlipbook,	/*!< The sprites must be given the flipbook in the flip_* properties. */
+} eParticleDirtyFlags;
 
-/*! \enum eParticlePropertyName
- *	\brief Used as a reference when querying the string name of a specific particle property.
- */
-typedef enum eParticlePropertyName
-{
-	PROP_LIFE = 0,
-	PROP_FADE_SPEED,
-	PROP_FADE_COUNT,
-	PROP_SLOWDOWN_RATE,
-	PROP_VEL_BASE,
-	PROP_VEL_RAND,
-	PROP_ANGLE_MIN,
-	PROP_ANGLE_MAX,
-	PROP_REL_TIME,
-	PROP_REL_RATE,
-	PROP_REL_RAND,
-	PROP_GRAVITY,
-	PROP_ROT_SPEED,
-	PROP_ROT_RAND,
-	PROP_SIZE_START,
-	PROP_SIZE_END,
-	PROP_SIZE_SPEED,
-	PROP_SIZE_COUNT,
-	PROP_BLINK_ON_TIME,
-	PROP_BLINK_ON_RAND,
-	PROP_BLINK_OFF_TIME,
-	PROP_BLINK_OFF_RAND,
-	PROP_BLINK_COUNT,
-	PROP_REL_DIST,
-	PROP_REL_DIST_RAND,
-	PROP_GLOWS,
-	PROP_COLOR_R,
-	PROP_COLOR_G,
-	PROP_COLOR_B,
-	PROP_COLOR_RAND,
-	PROP_IMAGE_ID,
-	PROP_MASS_SIZE,
-	PROP_STRAND_LENGTH,
-	PROP_3D_MODE,
-	PROP_DRAW_MODE,
-	PROP_DRAW_EMITTER,
-	PROP_MAX,
-} eParticlePropertyName;
-
-/*! \enum eParticlePropertyDataType
- *	\brief Used as a reference when querying the data type of a specific particle property.
+/*! \struct particlePropDesc
+ *	\brief Describes one particle property: how it is presented, where it is stored and how it is checked.
+ *
+ * The descriptor table is generated from #PARTICLE_PROPERTY_LIST.
  */
-typedef enum eParticlePropertyDataType
+typedef struct particlePropDesc
 {
-	PROP_DATA_TYPE_INT = 0,
-	PROP_DATA_TYPE_FLOAT,
-	PROP_DATA_TYPE_BOOL,
-	PROP_DATA_TYPE_STR,
-	PROP_DATA_TYPE_GENERIC,
-}eParticlePropertyDataType;
+	int type_id;				/*!< The #eParticlePropertyName of the property. */
+	int data_type;				/*!< The #eParticlePropertyDataType of the property. */
+	float increment_value;		/*!< The step used when the property is adjusted one increment at a time. */
+	const char* type_name;		/*!< The display name of the property. */
+	const char* description;	/*!< The description of the property. */
+	size_t offset;				/*!< The offset of the property in #particleProperties. */
+	int storage;				/*!< The #eParticlePropertyStorage of the property. */
+	int limit;					/*!< The #eParticlePropertyLimit of the property. */
+	float min_value;			/*!< The minimum value, if the limit uses one. */
+	float max_value;			/*!< The maximum value, if the limit uses one. */
+	unsigned int dependencies;	/*!< A combination of #eParticlePropertyDependency. */
+} particlePropDesc;
 
 // This is used to a general return type when querying for a property.
 union propVal
@@ -154,6 +70,15 @@ union propVal
 	char* strVal;
 };
 
+/*! \struct particlePropertyChange
+ *	\brief One property value to set with CParticleSystem::setProperties().
+ */
+typedef struct particlePropertyChange
+{
+	int prop_id;		/*!< The #eParticlePropertyName of the property. */
+	propVal value;		/*!< The new value, in the #propVal member that the property data type uses. */
+} particlePropertyChange;
+
 /*! \struct particle
  *	\brief Each particle sets its properties according to the mass center that ejects it.
  *
@@ -167,25 +92,83 @@ typedef struct particle
 	ArrayList<Vector3> pos_history;	/*!< Stores the history of the particle rendered positions to enable drawing of strands. */
 	int pos_history_counter;	/*!< Used to keep track of how many particles are to be rendered in the strand. */
 	int pos_history_active_count;	/*!< This value is used to ensure that particle strands that haven't been set yet won't render. */
-	particleProperties props;	/*!< The particle properties associated with this particle. */
+	int life_time;				/*!< The time that the particle has left to live, or #__INF. Starts at the mass life time when the particle is released. */
+	int strand_length;			/*!< The strand length that the history of this particle has been fitted to. */
+	bool frame_skip;			/*!< Indicates whether the physics of this particle may skip frames. Taken from the mass when the particle is released. */
 	int id;						/*!< Specifies which mass this particle belongs to. */
 } particle;
 
 
+/*! \struct particleVertex
+ *	\brief One vertex of the particle vertex buffer.
+ *
+ * The vertices of every particle are built into one interleaved buffer so that each mass can be submitted with a single draw call.
+ */
+typedef struct particleVertex
+{
+	GLfloat x, y, z;		/*!< The vertex position. */
+	GLfloat u, v;			/*!< The texture coordinates of the vertex. */
+	GLubyte r, g, b, a;		/*!< The vertex color. */
+	GLfloat size;			/*!< The point size of the vertex. Only used in point sprite draw mode eParticleDrawModePoint. */
+} particleVertex;
+
+/*! \struct particleVertexJob
+ *	\brief A range of particles of one mass whose vertices are built by a single thread.
+ */
+typedef struct particleVertexJob
+{
+	int mass_id;			/*!< The mass that the particles belong to. */
+	int first_particle;		/*!< The first particle of the range. A value of -1 indicates that this job builds the mass emitter instead. */
+	int last_particle;		/*!< One past the last particle of the range. */
+	int first_vertex;		/*!< The offset into the vertex buffer where this job writes its vertices. */
+	int num_vertices;		/*!< The number of vertices that this job writes. */
+} particleVertexJob;
+
+/*! \struct particleLodBand
+ *	\brief A level of detail that 3D masses are drawn and simulated at.
+ *
+ * A mass enters a band once it is further from the camera than the band distance, or once its particles project smaller than the band size.
+ * Drawing every n-th particle larger keeps the mass covering about the same area of the screen.
+ */
+typedef struct particleLodBand
+{
+	float distance;			/*!< The camera distance, in 3D view units, beyond which a mass uses this band, or 0.0 to ignore the distance. */
+	float projected_size;	/*!< The size, in pixels, that the particles of a mass must project smaller than for the mass to use this band, or 0.0 to ignore the size. */
+	int particle_step;		/*!< Only every n-th particle is drawn. */
+	float size_scale;		/*!< The scale applied to the size of the particles that are drawn. */
+	float alpha_scale;		/*!< The scale applied to the alpha of the particles that are drawn. */
+	float strand_scale;		/*!< The fraction, from 0.0 to 1.0, of the strand length that is recorded and drawn. */
+	int update_interval;	/*!< The mass is simulated once every this many updates, making up the skipped time in one larger step. */
+} particleLodBand;
+
+
 /*! \struct particleMass
  *	\brief A particle mass represents the center particle and the mass of particles that are attached to it.
  */
 typedef struct particleMass
 {
-	ArrayList<particle> particles;	/*!< The particles associated with this particle mass. */
+	ArrayList<particle> particles;	/*!< The particle storage of this particle mass. Its length is the capacity, which can be larger than #num_particles. */
 	int num_particles;		/*!< The total number of particles that this mass contains. */
+	int num_initialized;	/*!< The number of particle slots whose sprites and physics objects have been initialized. Slots from #num_particles up to this are kept for when the mass grows again. */
 	particle center;		/*!< The center of the particle mass is where the rest of the particle will be ejected from. */
+	Reference<particleProperties> props;	/*!< The properties of this mass. The block is shared by every mass with the same properties, and is copied before it is edited. */
 	int rel_counter;		/*!< The release rate time counter. */
 	int loop_count;			/*!< The number of times the mass will release its set of particles. */
 	int loop_counter;		/*!< Holds the current loop count. */
 	int rel_particle_counter;	/*!< Counter for the number of particles that have been released from the mass. Used to help determine when to increment the loop_counter. */
 	Vector3 initial_pos;	/*!< The initial position of the particle mass. */
 	char* image_name;		/*!< The image name of the particle. */
+	int first_vertex;		/*!< The offset into the vertex buffer where the vertices of this mass start. */
+	int num_vertices;		/*!< The number of vertices that this mass has in the vertex buffer for the current frame. */
+	unsigned int dirty_flags;	/*!< The #eParticleDirtyFlags groups that are waiting for applyDirtyProperties(). */
+	int sprite_image_id;	/*!< The image that the sprites of this mass currently show. */
+	int history_length;		/*!< The number of positions that the history of every particle in this mass can hold. Never shrinks, so that strands can grow back without allocating. */
+	eParticleDrawMode draw_mode;	/*!< The draw mode used for the current frame. This is the draw mode of the properties, unless the quality tier draws the mass as point sprites. */
+	int lod_band;			/*!< The level of detail band that the mass is in. */
+	int lod_prev_band;		/*!< The level of detail band that the mass is fading out of. */
+	float lod_fade;			/*!< How far the crossfade from #lod_prev_band to #lod_band has gone, from 0.0 to 1.0. */
+	int lod_update_counter;	/*!< Counts the updates up to the next simulation of the mass, in bands with an update interval. */
+	int lod_skipped_time;	/*!< The time, in milliseconds, that the mass has skipped since it was last simulated. */
 } particleMass;
 
 /*! \class CParticleSystem
@@ -252,6 +235,7 @@ public:
 	/*! \fn update()
 	 *  \brief Updates physics and particle animations for all active particle and particle masses.
 	 *  
+	 * Any property changes made since the last update are applied first, even while the system is paused.
 	 *	\param n/a
 	 *  \return n/a
 	 */
@@ -265,6 +249,117 @@ public:
 	 */
 	void draw(void* data = NULL);
 	
+	/*! \fn buildVertices(const float* camMat)
+	 *  \brief Builds the vertices of every active mass into the vertex buffer.
+	 *  
+	 * The vertex counts of all masses are computed first so that every mass, and every job within a mass, gets its own slice of the buffer. The slices are then filled in parallel on the thread pool.
+	 *	\param camMat The camera view matrix. Only needed by the billboard draw mode.
+	 *  \return n/a
+	 */
+	void buildVertices(const float* camMat);
+	
+	/*! \fn setNumThreads(const int numThreads)
+	 *  \brief Sets the number of threads used to build the particle vertices.
+	 *  
+	 * By default, one thread is used for every processor core.
+	 *	\param numThreads The number of threads, including the rendering thread.
+	 *  \return n/a
+	 */
+	void setNumThreads(const int numThreads);
+	
+	/*! \fn getNumThreads(void)
+	 *  \brief Returns the number of threads used to build the particle vertices.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline int getNumThreads(void) { return _thread_pool.getNumThreads(); }
+	
+	/*! \fn setFusedUpdate(BOOL fused)
+	 *  \brief Sets whether update() also writes the render vertices of every particle as it is updated.
+	 *  
+	 * This saves draw() from walking through every particle again, but the vertices are built on a single thread. The billboard draw mode uses the view matrix of the previous draw() call.
+	 *	\param fused TRUE to build the vertices during update(), FALSE to build them during draw().
+	 *  \return n/a
+	 */
+	inline void setFusedUpdate(BOOL fused) { _is_fused_update = fused; }
+	
+	/*! \fn isFusedUpdate(void)
+	 *  \brief Returns whether update() writes the render vertices.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline BOOL isFusedUpdate(void) { return _is_fused_update; }
+	
+	/*! \fn setParticleQuota(const int quota, const float releaseScale)
+	 *  \brief Limits the number of live particles. This is set by CParticleBudget every frame for systems that are registered with it.
+	 *  
+	 * Once the limit is reached, no more particles are released until some of them die. Particles that are already alive are never killed.
+	 *	\param quota The most live particles across every mass, or -1 for no limit.
+	 *	\param releaseScale The scale, from 0.0 to 1.0, applied to the release rate of every mass.
+	 *  \return n/a
+	 */
+	void setParticleQuota(const int quota, const float releaseScale);
+	
+	/*! \fn getParticleQuota(void)
+	 *  \brief Returns the most live particles that the system may have, or -1 if there is no limit.
+	 *  
+	 *	\param n/a
+	 *  \return The particle quota.
+	 */
+	inline int getParticleQuota(void) { return _particle_quota; }
+	
+	/*! \fn getNumLiveParticles(void)
+	 *  \brief Returns the number of live particles across every mass, as of the last update().
+	 *  
+	 *	\param n/a
+	 *  \return The number of live particles.
+	 */
+	inline int getNumLiveParticles(void) { return _num_live_particles; }
+	
+	/*! \fn setBackground(BOOL background)
+	 *  \brief Marks the system as a background effect. At the lower quality tiers, background systems are only updated every few frames.
+	 *  
+	 * The skipped time is made up in one larger step on the next update, so the effect keeps its speed.
+	 *	\param background TRUE for a background effect, FALSE otherwise.
+	 *  \return n/a
+	 */
+	inline void setBackground(BOOL background) { _is_background = background; }
+	
+	/*! \fn isBackground(void)
+	 *  \brief Returns whether the system is a background effect.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline BOOL isBackground(void) { return _is_background; }
+	
+	/*! \fn setLodBands(const particleLodBand* bands, const int numBands)
+	 *  \brief Sets the level of detail bands of 3D masses. The first band is full detail, and every later band should start further away or at a smaller size.
+	 *  
+	 *	\param bands The bands, from the most detailed to the least.
+	 *	\param numBands The number of bands, from 1 to #PARTICLE_LOD_BANDS_MAX. Passing 1 turns the level of detail off.
+	 *  \return n/a
+	 */
+	void setLodBands(const particleLodBand* bands, const int numBands);
+	
+	/*! \fn getNumLodBands(void)
+	 *  \brief Returns the number of level of detail bands, including the full detail band.
+	 *  
+	 *	\param n/a
+	 *  \return The number of bands.
+	 */
+	inline int getNumLodBands(void) { return _num_lod_bands; }
+	
+	/*! \fn getLodBand(const int massID)
+	 *  \brief Returns the level of detail band that the given mass is in, where 0 is full detail.
+	 *  
+	 *	\param massID The particle mass ID.
+	 *  \return The band of the mass.
+	 */
+	inline int getLodBand(const int massID) { return _mass[massID].lod_band; }
+	
 	/*! \fn recenterMass(int massID, int x, int y)
 	 *  \brief Centers the mass and all particles belonging to the mass to the given coordinates.
 	 *  
@@ -297,6 +392,8 @@ public:
 	/*! \fn setMode(int massID, particleProperties &modeData)
 	 *  \brief Sets non-pre-defined custom particle properties.
 	 *  
+	 * Every particle of the mass is killed, and released again under the new properties. The sprite images and strand histories are only rebuilt if the new properties need different ones.
+	 * The flipbook is one of the properties, so the flip_* values of the mode replace a flipbook that was set with setFlipbook() before. A mode without a flipbook turns it off.
 	 *	\param massID The particle mass ID.
 	 *	\param modeData The particle data to apply to the mass.
 	 *	\param imageName The image name is used for editing purposes and can be null.
@@ -304,6 +401,16 @@ public:
 	 */
 	void setMode(int massID, const particleProperties &modeData, const char* imageName = "");
 	
+	/*! \fn loadEffect(const void* data, size_t size)
+	 *  \brief Replaces all masses with the masses of a compiled effect, as built by the effect compile tool.
+	 *  
+	 * The effect is used as it is stored, normally straight out of a memory mapped CParticleEffectLibrary, so it is not parsed or copied first.
+	 *	\param data The compiled effect.
+	 *	\param size The byte size of the effect.
+	 *  \return TRUE if the effect was valid and has been loaded.
+	 */
+	BOOL loadEffect(const void* data, size_t size);
+	
 	/*! \fn applyProperties(int massID, int particleID)
 	 *  \brief Applies the properties of the center mass particle to a specific particle in same mass.
 	 *  
@@ -313,6 +420,15 @@ public:
 	 */
 	void applyProperties(int massID, int particleID);
 	
+	/*! \fn applyDirtyProperties(const int massID)
+	 *  \brief Rebuilds the mass state that was marked as dirty by property changes. Live particles keep flying.
+	 *  
+	 * This is called for every mass at the start of update(), so it only needs to be called directly when the changes must show before then. An image that is not loaded yet stays dirty and is tried again.
+	 *	\param massID The particle mass ID.
+	 *  \return n/a
+	 */
+	void applyDirtyProperties(const int massID);
+	
 	/*! \fn releaseNextParticle(int massID)
 	 *  \brief Releases one non-active particle from the given mass.
 	 *  
@@ -402,7 +518,7 @@ public:
 	 *	\param drawCenter TRUE to render the particle mass center, FALSE otherwise.
 	 *  \return n/a
 	 */
-	inline void setDrawCenter(int massID, BOOL drawCenter) { _mass[massID].center.props.draw_emitter = drawCenter; }
+	inline void setDrawCenter(int massID, BOOL drawCenter) { editProperties(massID)->draw_emitter = drawCenter; }
 	
 	/*! \fn setLoopCount(int massID, int count)
 	 *  \brief This is used to control how many times the mass will release its set of particles.
@@ -457,13 +573,13 @@ public:
 	
 	inline const particleMass& getMass(int massID) {return _mass[massID]; }
 	
-	inline const eParticleDrawMode getDrawMode(int massID) { return (eParticleDrawMode)_mass[massID].center.props.draw_mode; }
+	inline const eParticleDrawMode getDrawMode(int massID) { return (eParticleDrawMode)_mass[massID].props->draw_mode; }
 	
-	inline void setDrawMode(const int massID, eParticleDrawMode mode) { _mass[massID].center.props.draw_mode = mode; }
+	inline void setDrawMode(const int massID, eParticleDrawMode mode) { editProperties(massID)->draw_mode = mode; }
 	
-	inline void setEnable3D(int massID, BOOL enable) { _mass[massID].center.props.is_3D_enabled = enable; }
+	inline void setEnable3D(int massID, BOOL enable) { editProperties(massID)->is_3D_enabled = enable; }
 	
-	inline BOOL is3DEnabled(int massID) {return _mass[massID].center.props.is_3D_enabled; }
+	inline BOOL is3DEnabled(int massID) {return _mass[massID].props->is_3D_enabled; }
 	
 	void setLifeTime(const int massID, const int lifeTime);
 	
@@ -515,11 +631,11 @@ public:
 	
 	void setReleaseDistRand(const int massID, const int releaseDistRand);
 	
-	inline void setGlows(const int massID, const BOOL glows) { _mass[massID].center.props.glows = glows; }
+	inline void setGlows(const int massID, const BOOL glows) { editProperties(massID)->glows = glows; }
 	
 	void setColor(const int massID, float r, float g, float b);
 	
-	inline void setRandColor(const int massID, const bool rand) { _mass[massID].center.props.color_rand = rand; }
+	inline void setRandColor(const int massID, const bool rand) { editProperties(massID)->color_rand = rand; }
 	
 	void setStrandLength(const int massID, const int length);
 	
@@ -528,7 +644,7 @@ public:
 	void setMassSize(const int massID, const int massSize);
 
 	// Get the mass' particle properties.
-	const particleProperties getParticleModeData(int massID) { return _mass[massID].center.props; }
+	const particleProperties getParticleModeData(int massID) { return *_mass[massID].props; }
 	
 	// Returns the name of the given property id.
 	static const char* getPropName(int id);
@@ -547,6 +663,19 @@ public:
 	
 	void setPropertyValue(const int massID, const int propID, const propVal value);
 	
+	/*! \fn setProperties(const int massID, const particlePropertyChange* changes, const int numChanges)
+	 *  \brief Sets many properties of the given mass in one pass.
+	 *  
+	 * Every value is checked the same way setPropertyValue() checks it, but state that depends on the properties, such as the
+	 * mass size or the emitter color, is only updated once at the end, however many of the changes affect it.
+	 *
+	 *	\param massID The particle mass ID.
+	 *	\param changes The properties to set, applied in order.
+	 *	\param numChanges The number of changes.
+	 *  \return n/a
+	 */
+	void setProperties(const int massID, const particlePropertyChange* changes, const int numChanges);
+	
 	const propVal getPropertyValue(const int massID, const int propID);
 	
 	/*! \fn setPhysicsState(int state)
@@ -557,12 +686,205 @@ public:
 	 *  \return n/a
 	 */
 	void setPhysicsState(int massID, ePhysicsMovementState state);
+	
+	/*! \fn seekActions(const int massID, const int time)
+	 *  \brief Sets the sprite actions of every active particle of the given mass to the given time since they started.
+	 *  
+	 * The actions are evaluated directly at the new time, so a jump of any size, in either direction, costs the same as one frame.
+	 *	\param massID The particle mass ID.
+ 	 *	\param time The time in milliseconds since the actions started. Zero puts every action back at its start.
+	 *  \return n/a
+	 */
+	void seekActions(const int massID, const int time);
+	
+	/*! \fn setFlipbook(const int massID, const int cols, const int rows, const int numFrames, const int frameTime, const BOOL isLooping, const BOOL isBlended)
+	 *  \brief Animates the particles of the given mass as a flipbook of the frame cells of their image.
+	 *  
+	 * Each particle picks its frame from its age, and the whole mass still uses one texture. Flipbooks only animate in the quad draw modes, point sprites show the whole image.
+	 * The flipbook is kept in the flip_* mass properties, so it survives reset() and can be part of an effect. The sprites take it on at the next update.
+	 * A later setMode() replaces it with the flipbook of the new mode, so set the flipbook after the mode.
+	 *	\param massID The particle mass ID.
+	 *	\param cols The number of frame columns in the image.
+	 *	\param rows The number of frame rows in the image.
+	 *	\param numFrames The number of frames used, or zero for cols * rows. Zero cols or rows turns the flipbook off.
+	 *	\param frameTime The time in milliseconds that each frame is shown.
+	 *	\param isLooping TRUE to start over after the last frame, FALSE to stay on the last frame.
+	 *	\param isBlended TRUE to fade each frame into the next one.
+	 *  \return n/a
+	 */
+	void setFlipbook(const int massID, const int cols, const int rows, const int numFrames, const int frameTime, const BOOL isLooping = TRUE, const BOOL isBlended = FALSE);
 
 private:
 	ArrayList<particleMass> _mass;	/*!< The pointer to the particle masses in the particle system. */
 	int _num_masses;		/*!< The number of particle masses in the particle system. */
 	BOOL _is_running;		/*!< Used to indicate whether update() is run on the particle system. When set to FALSE, all particles will essentially pause, until explicitly told to resume. */
 	GLfloat _point_sizes[2];	/*!< Holds the max and min sizes that a point sprite can be. Only used in point sprite draw mode eParticleDrawModePoint. */
+	ArrayList<particleVertex> _vertices;	/*!< The vertex buffer that holds the vertices of all masses for the current frame. */
+	int _num_vertices;		/*!< The number of vertices in the vertex buffer that are used for the current frame. */
+	ArrayList<particleVertexJob> _jobs;	/*!< The vertex building jobs for the current frame. */
+	int _num_jobs;			/*!< The number of vertex building jobs for the current frame. */
+	CThreadPool _thread_pool;	/*!< The threads that build the particle vertices. */
+	BOOL _is_thread_pool_init;	/*!< Indicates whether the thread pool has been started. */
+	const float* _cam_mat;	/*!< The camera view matrix for the current frame, used by the vertex building jobs. */
+	BOOL _is_fused_update;	/*!< Indicates whether update() writes the render vertices. */
+	BOOL _are_vertices_built;	/*!< Indicates that update() has written the vertices for the next draw(). */
+	int _particle_quota;	/*!< The most live particles that the system may have, or -1 for no limit. */
+	float _release_scale;	/*!< The scale applied to the release rate of every mass to keep the system within its quota. */
+	int _num_live_particles;	/*!< The number of live particles across every mass. */
+	BOOL _is_background;	/*!< Indicates that the system is a background effect, which the quality tier can update less often. */
+	particleLodBand _lod_bands[PARTICLE_LOD_BANDS_MAX];	/*!< The level of detail bands of 3D masses, from the most detailed to the least. */
+	int _num_lod_bands;		/*!< The number of level of detail bands. */
+	int _update_counter;	/*!< Counts the frames up to the next update of a background system. */
+	int _skipped_time;		/*!< The frame time, in milliseconds, that a background system has skipped since its last update. */
+	
+	/*! \fn countVerticesJob(void* data, int jobIndex)
+	 *  \brief Thread pool entry point that counts the vertices of one job.
+	 *  
+	 *	\param data The particle system.
+	 *	\param jobIndex The index of the job.
+	 *  \return n/a
+	 */
+	static void countVerticesJob(void* data, int jobIndex);
+	
+	/*! \fn fillVerticesJob(void* data, int jobIndex)
+	 *  \brief Thread pool entry point that fills the vertex buffer slice of one job.
+	 *  
+	 *	\param data The particle system.
+	 *	\param jobIndex The index of the job.
+	 *  \return n/a
+	 */
+	static void fillVerticesJob(void* data, int jobIndex);
+	
+	/*! \fn getImageVertexCount(const particleMass& mass, const CSprite& sprite)
+	 *  \brief Returns the number of vertices that one image of a particle needs in the current draw mode.
+	 *  
+	 *	\param mass The particle mass.
+	 *	\param sprite The particle sprite.
+	 *  \return n/a
+	 */
+	int getImageVertexCount(const particleMass& mass, const CSprite& sprite);
+	
+	/*! \fn getVertexCount(const particleMass& mass, const int particleID)
+	 *  \brief Returns the number of vertices that the given particle needs, including its strand. Particles that the level of detail leaves out need none.
+	 *  
+	 *	\param mass The mass that the particle belongs to.
+	 *	\param particleID The particle slot.
+	 *  \return n/a
+	 */
+	int getVertexCount(const particleMass& mass, const int particleID);
+	
+	/*! \fn getEmitterVertexCount(const particleMass& mass)
+	 *  \brief Returns the number of vertices that the emitter of the given mass needs.
+	 *  
+	 *	\param mass The mass.
+	 *  \return n/a
+	 */
+	int getEmitterVertexCount(const particleMass& mass);
+	
+	/*! \fn emitParticle(particleVertex* vertices, const particleMass& mass, const int particleID)
+	 *  \brief Builds the vertices of a particle and its strand, scaled for the level of detail band of the mass.
+	 *  
+	 *	\param vertices The vertices to write to.
+	 *	\param mass The mass that the particle belongs to.
+	 *	\param particleID The particle slot.
+	 *  \return A pointer to the vertex after the last vertex written.
+	 */
+	particleVertex* emitParticle(particleVertex* vertices, const particleMass& mass, const int particleID);
+	
+	/*! \fn getLodWeight(const particleMass& mass, const int particleID, float* sizeScale, float* alphaScale)
+	 *  \brief Returns how much of a particle is drawn in the level of detail band of its mass, blending the bands while the mass crossfades.
+	 *  
+	 *	\param mass The mass that the particle belongs to.
+	 *	\param particleID The particle slot.
+	 *	\param sizeScale Set to the scale of the particle size.
+	 *	\param alphaScale Set to the scale of the particle alpha.
+	 *  \return The weight of the particle, or 0.0 if it is not drawn at all.
+	 */
+	float getLodWeight(const particleMass& mass, const int particleID, float* sizeScale, float* alphaScale);
+	
+	/*! \fn getMassDepth(const particleMass& mass, float* depth)
+	 *  \brief Finds how far in front of the camera the center of a 3D mass is.
+	 *  
+	 *	\param mass The mass.
+	 *	\param depth Set to the view space depth of the mass center, in 3D view units.
+	 *  \return FALSE if the mass is not 3D or no view matrix is known, TRUE otherwise.
+	 */
+	BOOL getMassDepth(const particleMass& mass, float* depth);
+	
+	/*! \fn updateLodBands(const int frameTime)
+	 *  \brief Moves every 3D mass into the level of detail band for its camera distance and projected size, and advances the crossfades.
+	 *  
+	 *	\param frameTime The time since the last update, in milliseconds.
+	 *  \return n/a
+	 */
+	void updateLodBands(const int frameTime);
+	
+	/*! \fn updateDrawModes(void)
+	 *  \brief Picks the draw mode of every mass for the current frame, falling back to point sprites for 3D masses past the point sprite distance of the quality tier.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void updateDrawModes(void);
+	
+	/*! \fn reserveFusedVertices(void)
+	 *  \brief Makes sure that the vertex buffer can hold the vertices of every mass before a fused update.
+	 *  
+	 *	\param n/a
+	 *  \return FALSE if the vertices can not be built during update(), TRUE otherwise.
+	 */
+	BOOL reserveFusedVertices(void);
+	
+	/*! \fn initParticle(const int massID, const int particleID, CImage* image)
+	 *  \brief Initializes the sprite and physics object of a particle slot that has never been used.
+	 *  
+	 *	\param massID The particle mass ID.
+	 *	\param particleID The particle slot.
+	 *	\param image The image of the mass.
+	 *  \return n/a
+	 */
+	void initParticle(const int massID, const int particleID, CImage* image);
+	
+	/*! \fn resizeMassStorage(const int massID, const int capacity)
+	 *  \brief Moves the particles of a mass into storage of the given capacity, without copying or reinitializing them.
+	 *  
+	 *	\param massID The particle mass ID.
+	 *	\param capacity The number of particle slots. Initialized slots beyond it are destroyed.
+	 *  \return n/a
+	 */
+	void resizeMassStorage(const int massID, const int capacity);
+
+	/*! \fn shareProperties(const int massID, const particleProperties& props)
+	 *  \brief Gives a mass the shared property block that holds the given properties, creating the block if no mass uses them yet.
+	 *
+	 *	\param massID The particle mass ID.
+	 *	\param props The properties of the mass.
+	 *  \return n/a
+	 */
+	void shareProperties(const int massID, const particleProperties& props);
+
+	/*! \fn editProperties(const int massID)
+	 *  \brief Returns the properties of a mass for writing. If the block is shared, the mass is first given a copy of its own.
+	 *
+	 *	\param massID The particle mass ID.
+	 *  \return The properties of the mass, which no other mass uses.
+	 */
+	particleProperties* editProperties(const int massID);
+
+	/*! \fn buildParticleVertices(particleVertex* vertices, const particleMass& mass, const CSprite& sprite, const float x, const float y, const float z, const float sizeScale = 1.0f, const float alphaScale = 1.0f)
+	 *  \brief Builds the vertices of one particle image at the given location.
+	 *  
+	 *	\param vertices The vertices to write to.
+	 *	\param mass The mass that the particle belongs to.
+	 *	\param sprite The sprite of the particle.
+	 *	\param x The x location of the particle.
+	 *	\param y The y location of the particle.
+	 *	\param z The z location of the particle.
+	 *	\param sizeScale The scale applied to the size of the sprite.
+	 *	\param alphaScale The scale applied to the alpha of the sprite.
+	 *  \return A pointer to the vertex after the last vertex written.
+	 */
+	particleVertex* buildParticleVertices(particleVertex* vertices, const particleMass& mass, const CSprite& sprite, const float x, const float y, const float z, const float sizeScale = 1.0f, const float alphaScale = 1.0f);
 };
 
 
@@ -0,0 +1,180 @@
+/*
+ *  QualityController.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include "SystemDefines.h"
+#include "QualityController.h"
+
+
+// The settings of every quality tier, from the best quality to the cheapest. The point sprite distances are in 3D view units,
+// where the camera starts CAMERA_START_Z / SCRN_D away from the scene.
+static const qualitySettings quality_tiers[eQualityTierMAX] =
+{
+	// release scale, max strand length, point sprite distance, background update interval
+	{ 1.0f, -1, 0.0f, 1, },
+	{ 0.75f, 32, 0.0f, 1, },
+	{ 0.5f, 16, 8.0f, 2, },
+	{ 0.25f, 4, 5.0f, 2, },
+};
+
+
+CQualityController::CQualityController()
+{
+	init();
+}
+
+
+CQualityController::~CQualityController()
+{
+
+}
+
+
+void CQualityController::init(const int targetFrameTime)
+{
+	memset(_frame_times, 0, sizeof(_frame_times));
+	_num_samples = 0;
+	_next_sample = 0;
+	_eval_counter = 0;
+	_target_frame_time = max(targetFrameTime, 1);
+	_slow_evals = 0;
+	_fast_evals = 0;
+	_improve_evals = QUALITY_IMPROVE_EVALS;
+	_stable_evals = 0;
+	_did_improve = FALSE;
+	_tier = eQualityTierHigh;
+	_min_quality = eQualityTierLowest;
+}
+
+
+void CQualityController::update(const int frameTime)
+{
+	_frame_times[_next_sample] = max(frameTime, 0);
+	_next_sample = (_next_sample + 1) % QUALITY_FRAME_SAMPLES;
+	_num_samples = min(_num_samples + 1, QUALITY_FRAME_SAMPLES);
+
+	if (++_eval_counter < QUALITY_EVAL_FRAMES)
+	{
+		return;
+	}
+
+	_eval_counter = 0;
+
+	// Spikes matter more than the average, so the decision is made on the 90th percentile.
+	int frame_time = getFrameTimePercentile(90);
+
+	if (frame_time > _target_frame_time * QUALITY_DEGRADE_RATIO)
+	{
+		_fast_evals = 0;
+		_stable_evals = 0;
+
+		if ((++_slow_evals >= QUALITY_DEGRADE_EVALS) && (_tier < _min_quality))
+		{
+			// A rise that is undone straight away makes the next rise wait longer.
+			if (_did_improve)
+			{
+				_improve_evals = min(_improve_evals * 2, QUALITY_IMPROVE_EVALS_MAX);
+			}
+
+			DPRINT_ENGINE("CQualityController::update: frame time %d ms, lowering quality to tier %d \n", frame_time, _tier + 1);
+			setTier((eQualityTier)(_tier + 1));
+			_did_improve = FALSE;
+		}
+
+		return;
+	}
+
+	_slow_evals = 0;
+
+	// A rise that lasts one evaluation was not undone straight away, so a later drop does not count against it.
+	_did_improve = FALSE;
+
+	// A long stable stretch earns back some of the wait that undone rises have built up.
+	if (++_stable_evals >= QUALITY_STABLE_EVALS)
+	{
+		_improve_evals = max(_improve_evals / 2, QUALITY_IMPROVE_EVALS);
+		_stable_evals = 0;
+	}
+
+	if (frame_time <= _target_frame_time * QUALITY_IMPROVE_RATIO)
+	{
+		if ((++_fast_evals >= _improve_evals) && (_tier > eQualityTierHigh))
+		{
+			DPRINT_ENGINE("CQualityController::update: frame time %d ms, raising quality to tier %d \n", frame_time, _tier - 1);
+			setTier((eQualityTier)(_tier - 1));
+			_did_improve = TRUE;
+		}
+	}
+	else
+	{
+		// Between the two thresholds the tier holds, and the run of fast evaluations starts over.
+		_fast_evals = 0;
+	}
+}
+
+
+void CQualityController::setMinimumQuality(const eQualityTier tier)
+{
+	_min_quality = (eQualityTier)min(max((int)tier, (int)eQualityTierHigh), (int)eQualityTierLowest);
+
+	if (_tier > _min_quality)
+	{
+		setTier(_min_quality);
+		_did_improve = FALSE;
+	}
+}
+
+
+const qualitySettings* CQualityController::getSettings() const
+{
+	return &quality_tiers[_tier];
+}
+
+
+int CQualityController::getFrameTimePercentile(const int percentile) const
+{
+	if (_num_samples <= 0)
+	{
+		return 0;
+	}
+
+	// Sort a copy of the samples. There are few enough of them for an insertion sort.
+	int sorted[QUALITY_FRAME_SAMPLES];
+	int start = (_next_sample - _num_samples + QUALITY_FRAME_SAMPLES) % QUALITY_FRAME_SAMPLES;
+
+	for (int i = 0; i < _num_samples; ++i)
+	{
+		int value = _frame_times[(start + i) % QUALITY_FRAME_SAMPLES];
+		int j = i;
+
+		while ((j > 0) && (sorted[j - 1] > value))
+		{
+			sorted[j] = sorted[j - 1];
+			--j;
+		}
+
+		sorted[j] = value;
+	}
+
+	int index = (min(max(percentile, 0), 100) * (_num_samples - 1)) / 100;
+
+	return sorted[index];
+}
+
+
+void CQualityController::setTier(const eQualityTier tier)
+{
+	_tier = tier;
+
+	// Frames from the previous tier say nothing about this one.
+	_num_samples = 0;
+	_eval_counter = 0;
+	_slow_evals = 0;
+	_fast_evals = 0;
+	_stable_evals = 0;
+}
@@ -0,0 +1,157 @@
+/*
+ *  QualityController.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __QUALITYCONTROLLER_H__
+#define __QUALITYCONTROLLER_H__
+
+#include "types.h"
+
+static const int QUALITY_FRAME_SAMPLES = 60;			// The number of recent frame times that the percentiles are taken from.
+static const int QUALITY_EVAL_FRAMES = 30;				// The number of frames between evaluations of the quality tier.
+static const int QUALITY_TARGET_FRAME_TIME_DEFAULT = 17;	// The default target frame time in milliseconds, which is a frame rate of 60.
+static const float QUALITY_DEGRADE_RATIO = 1.2f;		// The quality drops when the 90th percentile frame time is above the target times this.
+static const float QUALITY_IMPROVE_RATIO = 1.05f;		// The quality rises when the 90th percentile frame time is at or below the target times this.
+static const int QUALITY_DEGRADE_EVALS = 2;				// The number of evaluations in a row that must be over budget before the quality drops.
+static const int QUALITY_IMPROVE_EVALS = 4;				// The number of evaluations in a row that must be within budget before the quality rises.
+static const int QUALITY_IMPROVE_EVALS_MAX = 32;		// The most evaluations that a rise can be made to wait after rises have been undone.
+static const int QUALITY_STABLE_EVALS = 16;				// The number of evaluations in a row without a slow one after which the wait for a rise is halved again.
+
+/*! \enum eQualityTier
+ *	\brief The quality tiers, from the best quality to the cheapest.
+ */
+typedef enum eQualityTier
+{
+	eQualityTierHigh = 0,	/*!< Everything is drawn and simulated as it was set up. */
+	eQualityTierMedium,		/*!< Fewer particles are released, and strands are shortened. */
+	eQualityTierLow,		/*!< Distant 3D masses are drawn as point sprites, and background systems are simulated at half rate. */
+	eQualityTierLowest,		/*!< The cheapest settings of every kind. */
+	eQualityTierMAX,		/*!< The number of quality tiers. */
+} eQualityTier;
+
+/*! \struct qualitySettings
+ *	\brief What a quality tier changes. The particle systems read these every frame.
+ */
+typedef struct qualitySettings
+{
+	float release_scale;			/*!< The scale, from 0.0 to 1.0, applied to the release rate of every mass. */
+	int max_strand_length;			/*!< The longest strand that is recorded and drawn, or -1 for no limit. */
+	float point_sprite_distance;	/*!< 3D masses further than this from the camera, in 3D view units, are drawn as point sprites, or 0.0 to never fall back. */
+	int background_update_interval;	/*!< Background particle systems are simulated once every this many frames. */
+} qualitySettings;
+
+
+/*! \class CQualityController
+ * \brief The Quality Controller class.
+ *
+ * The quality controller watches the frame time and steps through the quality tiers to keep the frame rate near its target.
+ * The 90th percentile of the recent frame times is evaluated every #QUALITY_EVAL_FRAMES frames. The quality drops after #QUALITY_DEGRADE_EVALS
+ * slow evaluations in a row, and only rises again after a longer run of fast ones. Each time a rise is undone straight away, the next rise has to
+ * wait twice as long, so the tiers do not oscillate around the point where the frame rate breaks. After #QUALITY_STABLE_EVALS evaluations in a row
+ * without a slow one, the wait is halved again, so the controller keeps recovering quality over a long session. Game code can pin a minimum quality,
+ * for example while an effect that must look right is on screen.
+ */
+class CQualityController
+{
+public:
+	/*! \fn CQualityController()
+	 *  \brief The CQualityController class constructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	CQualityController();
+
+	/*! \fn ~CQualityController()
+	 *  \brief The CQualityController class destructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	~CQualityController();
+
+	/*! \fn init(const int targetFrameTime = QUALITY_TARGET_FRAME_TIME_DEFAULT)
+	 *  \brief The CQualityController class initializer function. Starts at the best quality.
+	 *
+	 *	\param targetFrameTime The frame time to keep to, in milliseconds.
+	 *  \return n/a
+	 */
+	void init(const int targetFrameTime = QUALITY_TARGET_FRAME_TIME_DEFAULT);
+
+	/*! \fn update(const int frameTime)
+	 *  \brief Records the time of the last frame, and changes the quality tier if the recent frame times call for it.
+	 *
+	 * This is called by the engine once per frame with #TIME_LAST_FRAME.
+	 *	\param frameTime The time that the last frame took, in milliseconds.
+	 *  \return n/a
+	 */
+	void update(const int frameTime);
+
+	/*! \fn setMinimumQuality(const eQualityTier tier)
+	 *  \brief Pins the quality so that it never drops below the given tier. If it already has, it rises to the tier straight away.
+	 *
+	 *	\param tier The cheapest tier that is allowed. Pass #eQualityTierLowest to unpin the quality.
+	 *  \return n/a
+	 */
+	void setMinimumQuality(const eQualityTier tier);
+
+	/*! \fn getMinimumQuality(void)
+	 *  \brief Returns the cheapest tier that is allowed.
+	 *
+	 *	\param n/a
+	 *  \return The minimum quality tier.
+	 */
+	inline eQualityTier getMinimumQuality(void) const { return _min_quality; }
+
+	/*! \fn getTier(void)
+	 *  \brief Returns the current quality tier.
+	 *
+	 *	\param n/a
+	 *  \return The current tier.
+	 */
+	inline eQualityTier getTier(void) const { return _tier; }
+
+	/*! \fn getSettings(void)
+	 *  \brief Returns the settings of the current quality tier.
+	 *
+	 *	\param n/a
+	 *  \return The current settings.
+	 */
+	const qualitySettings* getSettings(void) const;
+
+	/*! \fn getFrameTimePercentile(const int percentile)
+	 *  \brief Returns a percentile of the recent frame times.
+	 *
+	 *	\param percentile The percentile, from 0 to 100.
+	 *  \return The frame time in milliseconds, or 0 if no frames have been recorded.
+	 */
+	int getFrameTimePercentile(const int percentile) const;
+
+private:
+	/*! \fn setTier(const eQualityTier tier)
+	 *  \brief Changes the quality tier and starts collecting frame times for it from scratch.
+	 *
+	 *	\param tier The new tier.
+	 *  \return n/a
+	 */
+	void setTier(const eQualityTier tier);
+
+	int _frame_times[QUALITY_FRAME_SAMPLES];	/*!< The recent frame times, as a ring buffer. */
+	int _num_samples;			/*!< The number of frame times recorded since the tier last changed, up to #QUALITY_FRAME_SAMPLES. */
+	int _next_sample;			/*!< The ring buffer slot that the next frame time goes into. */
+	int _eval_counter;			/*!< Counts the frames up to the next evaluation. */
+	int _target_frame_time;		/*!< The frame time to keep to, in milliseconds. */
+	int _slow_evals;			/*!< The number of evaluations in a row that were over budget. */
+	int _fast_evals;			/*!< The number of evaluations in a row that were within budget. */
+	int _improve_evals;			/*!< The number of fast evaluations that a rise currently waits for. */
+	int _stable_evals;			/*!< The number of evaluations in a row that were not over budget. */
+	BOOL _did_improve;			/*!< Indicates that the tier rose at the last evaluation that changed anything, and no evaluation has kept it since. */
+	eQualityTier _tier;			/*!< The current quality tier. */
+	eQualityTier _min_quality;	/*!< The cheapest tier that is allowed. */
+};
+
+#endif
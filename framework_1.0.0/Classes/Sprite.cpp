@@ -24,12 +24,27 @@ void CSprite::init()
 	memset(_images, 0, sizeof(CImage*) * SPRITE_ANIM_FRAMES_MAX);
 	memset(&_did_allocate_image_mem, 0, sizeof(BOOL) * SPRITE_ANIM_FRAMES_MAX);
 	memset(&_anim_texture_names, 0, sizeof(GLuint) * SPRITE_ANIM_FRAMES_MAX);
+	memset(&_did_generate_texture, 0, sizeof(BOOL) * SPRITE_ANIM_FRAMES_MAX);
 	_x = 0;
 	_y = 0;
 	_z = 0;
 	_num_anim_frames = 0;
 	_curr_anim_frame = 0;
 	memset(&_anim_frame_speeds_ms, 0, sizeof(int) * SPRITE_ANIM_FRAMES_MAX);
+	_largest_width = 0;
+	_largest_height = 0;
+	_largest_depth = 0;	
+	_largest_half_width = 0;
+	_largest_half_height = 0;
+	_largest_half_depth = 0;
+	_is_animated = FALSE;
+	_anim_type = ANIM_TYPE_NONE;	
+	memset(&_flipbook, 0, sizeof(spriteFlipbook));
+	resetState();
+}
+
+void CSprite::resetState()
+{
 	_anim_frame_time = 0;
 	_anim_dir = ANIM_DIR_POS;
 	_anim_alpha = 0;
@@ -45,36 +60,12 @@ void CSprite::init()
 	_orig_angle = Vector3(0.0f, 0.0f, 0.0f);
 	_dest_angle = Vector3(0.0f, 0.0f, 0.0f);
 	_delta_angle = Vector3(0.0f, 0.0f, 0.0f);
-	_largest_width = 0;
-	_largest_height = 0;
-	_largest_depth = 0;	
-	_largest_half_width = 0;
-	_largest_half_height = 0;
-	_largest_half_depth = 0;
 	_is_visible = TRUE;
-	_is_animated = FALSE;
-	_action_scale_time = 0;
-	_action_scale_time_counter = 0;
-	_action_scale_num_pulses = 0;
-	_action_color_time = 0;
-	_action_color_time_counter = 0;
-	_action_color_num_pulses = 0;
-	_action_rotate_time = 0;
-	_action_rotate_time_counter = 0;
-	_action_rotate_num_rots = 0;
-	_action_blink_on_time = 0;
-	_action_blink_on_time_rand = 0;
-	_action_blink_on_time_rand_val = 0;
-	_action_blink_on_time_counter = 0;
-	_action_blink_off_time = 0;
-	_action_blink_off_time_rand = 0;
-	_action_blink_off_time_rand_val = 0;
-	_action_blink_off_time_counter = 0;
-	_num_blinks = 0;
+	memset(_tracks, 0, sizeof(tweenTrack) * eSpriteTrackMAX);
 	_action = 0;
-	_action_state = 0;
-	_rot_dir = eSpriteRotNone;
-	_anim_type = ANIM_TYPE_NONE;	
+	
+	// The flipbook layout describes the image, so like the image it is kept. Only the animation starts over.
+	_flip_time = 0;
 }
 
 
@@ -131,6 +122,12 @@ void CSprite::loadSpriteImage(char* fileName)
 
 void CSprite::loadSpriteImage(CImage* image)
 {
+	if (image == NULL)
+	{
+		DPRINT_SPRITE("CSprite::loadSpriteImage error: No image given \n");
+		return;
+	}
+	
 	if (_num_anim_frames >= SPRITE_ANIM_FRAMES_MAX)
 	{
 		DPRINT_SPRITE("CSprite::loadSpriteFrameImage animation frame limit reached");
@@ -145,24 +142,21 @@ void CSprite::loadSpriteImage(CImage* image)
 	_largest_half_height = image->getHeight() / 2;
 	_largest_half_depth = 0;
 	
-	// Bind the image to a texture name for drawing the texture.
-	if (_images[_num_anim_frames])
+	// Images from the image loader already have a texture, which every sprite of that image shares.
+	if ((_images[_num_anim_frames]) && (engine) && (GET_IMGLOADER))
 	{
+		_anim_texture_names[_num_anim_frames] = GET_IMGLOADER->getTexName(image);
+	}
+	
+	// Otherwise, bind the image to a texture name for drawing the texture.
+	if ((_images[_num_anim_frames]) && (_anim_texture_names[_num_anim_frames] == 0))
+	{
+		_did_generate_texture[_num_anim_frames] = TRUE;
+		
 		glGenTextures (1, &_anim_texture_names[_num_anim_frames]);
 		glBindTexture (GL_TEXTURE_2D, _anim_texture_names[_num_anim_frames]);
 		
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);	// Linear Filtering
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);	// Linear Filtering
-		
-		glTexImage2D (GL_TEXTURE_2D, 
-					  0, 
-					  image->getGLFormat(),
-					  image->getWidth(),
-					  image->getHeight(),
-					  0, 
-					  image->getGLFormat(), 
-					  GL_UNSIGNED_BYTE,
-					  image->getImageData());
+		CGraphics::uploadImage(image);
 	}
 	
 	// Increment the animation frames count.
@@ -170,13 +164,38 @@ void CSprite::loadSpriteImage(CImage* image)
 }
 
 
+void CSprite::setSpriteImage(CImage* image)
+{
+	// Release the current images the same way destroy() does, but leave the rest of the sprite as it is.
+	destroy();
+	memset(_images, 0, sizeof(CImage*) * SPRITE_ANIM_FRAMES_MAX);
+	memset(&_did_allocate_image_mem, 0, sizeof(BOOL) * SPRITE_ANIM_FRAMES_MAX);
+	memset(&_anim_texture_names, 0, sizeof(GLuint) * SPRITE_ANIM_FRAMES_MAX);
+	_num_anim_frames = 0;
+	_curr_anim_frame = 0;
+	
+	loadSpriteImage(image);
+}
+
+
 int CSprite::getWidth() const
 {
+	// A flipbook sprite is the size of one frame of the atlas.
+	if (isFlipbook())
+	{
+		return _images[_curr_anim_frame]->getWidth() / _flipbook.cols;
+	}
+	
 	return _images[_curr_anim_frame]->getWidth();
 }
 
 int CSprite::getHeight() const
 {
+	if (isFlipbook())
+	{
+		return _images[_curr_anim_frame]->getHeight() / _flipbook.rows;
+	}
+	
 	return _images[_curr_anim_frame]->getHeight();
 }
 
@@ -187,12 +206,12 @@ int CSprite::getDepth() const
 
 int CSprite::getHalfWidth() const
 {
-	return _images[_curr_anim_frame]->getWidth() >> 1;
+	return getWidth() >> 1;
 }
 
 int CSprite::getHalfHeight() const
 {
-	return _images[_curr_anim_frame]->getHeight() >> 1;
+	return getHeight() >> 1;
 }
 
 int CSprite::getHalfDepth() const
@@ -205,8 +224,12 @@ void CSprite::destroy()
 {
 	for (int i = 0; i < SPRITE_ANIM_FRAMES_MAX; ++i)
 	{
-		// Delete the texture before attempting to delete the image itself.
-		glDeleteTextures(1, &_anim_texture_names[i]);
+		// Delete the texture before attempting to delete the image itself. Shared image loader textures are deleted by the image loader.
+		if (_did_generate_texture[i])
+		{
+			glDeleteTextures(1, &_anim_texture_names[i]);
+			_did_generate_texture[i] = FALSE;
+		}
 		
 		if ((_images[i]) && (_did_allocate_image_mem[i]))
 		{
@@ -251,7 +274,12 @@ void CSprite::draw()
 
 void CSprite::draw(float x, float y)
 {	
-	if (_is_visible)
+	if (_is_visible && isFlipbook())
+	{
+		// The frames are drawn as clips of the atlas, so the sprite can still be batched.
+		CGraphics::drawSprite(this, x, y);
+	}
+	else if (_is_visible)
 	{
 		switch (_anim_type)
 		{
@@ -381,24 +409,23 @@ void CSprite::setSizeScaleAction(float destScaleX, float destScaleY, float destS
 	_dest_scale.y = destScaleY;
 	_dest_scale.z = destScaleZ;
 	
-	_action_scale_time = time;
-	_action_scale_time_counter = 0;
-	
 	_action |= eSpriteActScale;
-	_action_scale_num_pulses = numPulses;
 	
 	// Figure out how much we need to change the scale during each speed tick.
 	_delta_scale.x = GLfloat((destScaleX - _scale.x) / time);
 	_delta_scale.y = GLfloat((destScaleY - _scale.y) / time);
 	_delta_scale.z = GLfloat((destScaleZ - _scale.z) / time);
 	
-	// This is set every time to state 1 so that in the case of a loop action, we can change back and forth between states 1 and 2.
-	_action_state |= (int)eSpriteActStatePulse1;
+	float from[3] = { _orig_scale.x, _orig_scale.y, _orig_scale.z };
+	float to[3] = { _dest_scale.x, _dest_scale.y, _dest_scale.z };
+	
+	// Every pulse is one half of the back and forth cycle, so the pulse count is the tween cycle count.
+	CTween::setPingPong(&_tracks[eSpriteTrackScale], from, to, 3, time, numPulses);
 }
 
 void CSprite::setSizeScaleAction(Vector3 destScale, int time, int numPulses)
 {
-	setSizeScaleAction(destScale.x, destScale.y, destScale.z, time);
+	setSizeScaleAction(destScale.x, destScale.y, destScale.z, time, numPulses);
 }
 
 
@@ -412,11 +439,7 @@ void CSprite::setColorPulseAction(float r, float g, float b, float a, int time,
 	_dest_color.b = b;
 	_dest_color.a = a;
 	
-	_action_color_time = time;
-	_action_color_time_counter = 0;
-	
 	_action |= eSpriteActColorPulse;
-	_action_color_num_pulses = numPulses;
 	
 	// Figure out how much we need to change the color during each speed tick.
 	_delta_color.r = (r - _color.r) / time;
@@ -424,8 +447,10 @@ void CSprite::setColorPulseAction(float r, float g, float b, float a, int time,
 	_delta_color.b = (b - _color.b) / time;
 	_delta_color.a = (a - _color.a) / time;
 	
-	// This is set every time to state 1 so that in the case of a loop action, we can change back and forth between states 1 and 2.
-	_action_state |= (int)eSpriteActStateColPulse1;
+	float from[4] = { _orig_color.r, _orig_color.g, _orig_color.b, _orig_color.a };
+	float to[4] = { r, g, b, a };
+	
+	CTween::setPingPong(&_tracks[eSpriteTrackColor], from, to, 4, time, numPulses);
 }
 
 void CSprite::setColorPulseAction(color destColor, int time, int numPulses)
@@ -440,336 +465,304 @@ void CSprite::setRotateAction(Vector3 destAngle, eSpriteRotateDir direction, int
 	_orig_angle = _angle;
 	_dest_angle = destAngle;
 	
-	_action_rotate_time = time;
-	_action_rotate_time_counter = 0;
-	
 	_action |= eSpriteActRotate;
-	_action_rotate_num_rots = numRots;
 	
 	// Figure out how much we need to change the angle during each speed tick.
 	_delta_angle = (_dest_angle - _angle) / time;
 	
-	_rot_dir = direction;
+	// The sprite keeps turning the same way, by the span between the angles every rotation.
+	float dir = 0.0f;
+	if (direction == eSpriteRotClock)
+	{
+		dir = 1.0f;
+	}
+	else if (direction == eSpriteRotCounterClock)
+	{
+		dir = -1.0f;
+	}
 	
-	// This is set every time to state 1 so that in the case of a loop action, we can change back and forth between states 1 and 2.
-	_action_state |= (int)eSpriteActStateRotate1;
+	float from[3] = { _orig_angle.x, _orig_angle.y, _orig_angle.z };
+	float to[3] = {
+		_orig_angle.x + (dir * (_dest_angle.x - _orig_angle.x)),
+		_orig_angle.y + (dir * (_dest_angle.y - _orig_angle.y)),
+		_orig_angle.z + (dir * (_dest_angle.z - _orig_angle.z)) };
+	
+	CTween::setContinuous(&_tracks[eSpriteTrackRotate], from, to, 3, time, numRots);
 }
 
 
 void CSprite::setBlinkAction(int onTime, int randOnTime, int offTime, int randOffTime, int numBlinks)
 {
-	_action_blink_on_time = onTime;
-	_action_blink_on_time_counter = 0;
-	_action_blink_on_time_rand = 0;
-	_action_blink_on_time_rand_val = 0;
-	// Apply any randomness. Subsequent randomness is applied in updateAction().
-	if (randOnTime > 0)
+	// The random times are drawn from the seed whenever the track is evaluated, so the seed is the only random value needed here.
+	CTween::setBlink(&_tracks[eSpriteTrackBlink], onTime, randOnTime, offTime, randOffTime, numBlinks, (unsigned int)rand());
+	
+	_action |= eSpriteActBlink;
+}
+
+
+void CSprite::resetAction()
+{
+	for (int i = 0; i < eSpriteTrackMAX; ++i)
 	{
-		_action_blink_on_time_rand_val = randOnTime;
-		_action_blink_on_time_rand = (rand() % _action_blink_on_time_rand_val);
+		CTween::stop(&_tracks[i]);
 	}
 	
-	_action_blink_off_time = offTime;
-	_action_blink_off_time_counter = 0;
-	_action_blink_off_time_rand = 0;
-	_action_blink_off_time_rand_val = 0;
-	// Apply any randomness. Subsequent randomness is applied in updateAction().
-	if (randOffTime > 0)
+	_action = 0;
+}
+
+
+void CSprite::setCurrentNumColorPulses(int numPulses)
+{
+	tweenTrack* track = &_tracks[eSpriteTrackColor];
+	
+	if (!CTween::isActive(track))
 	{
-		_action_blink_off_time_rand_val = randOffTime;
-		_action_blink_off_time_rand = (rand() % _action_blink_off_time_rand_val);
+		return;
 	}
 	
-	_num_blinks = numBlinks;
-	
-	_action |= eSpriteActBlink;
-	_action_state |= (int)eSpriteActStateBlink1;
+	if (numPulses == __INF)
+	{
+		track->num_cycles = __INF;
+	}
+	else
+	{
+		track->num_cycles = CTween::getCyclesDone(track, track->elapsed) + ((numPulses > 0) ? numPulses : 0);
+	}
 }
 
 
 void CSprite::updateAction()
 {	
-	if (_action & eSpriteActScale)
+	stepAction(TIME_LAST_FRAME);
+}
+
+
+void CSprite::stepAction(int time)
+{
+	for (int i = 0; i < eSpriteTrackMAX; ++i)
 	{
-		if ((_action_scale_num_pulses <= 0) && (_action_scale_num_pulses != __INF))
+		// Finished tracks only come back to life when stepping backwards.
+		if (CTween::isActive(&_tracks[i]) && ((_action & getTrackAction(i)) || (time < 0)))
 		{
-			// JC: This doesn't work since the destination size might not be correct depending on the number of pulses.
-			// Set the scale to destination scale to account for any error.
-			//_scale = _dest_scale;
-			
-			// Return to the first action state.
-			_action_scale_time_counter = 0;
-			_action_state &= ~(eSpriteActStatePulse1 | eSpriteActStatePulse2);
-			_action &= ~eSpriteActScale;
-		}
-		else
-		{		
-			_action_scale_time_counter += TIME_LAST_FRAME;
-			
-			if (_action_state & eSpriteActStatePulse1)
-			{
-				_scale += (_delta_scale * TIME_LAST_FRAME);
-				
-				if (_action_scale_time_counter >= _action_scale_time)
-				{
-					// Set the scale to destination scale to account for any error.
-					//_scale = _dest_scale;
-					// Go to the next action state.
-					_action_scale_time_counter = 0;
-					_action_state &= ~eSpriteActStatePulse1;
-					_action_state |= eSpriteActStatePulse2;
-					
-					if (_action_scale_num_pulses != __INF)
-					{
-						_action_scale_num_pulses--;
-					}
-				}
-			}
-			else if (_action_state & eSpriteActStatePulse2)
-			{
-				_scale -= (_delta_scale * TIME_LAST_FRAME);
-				
-				if (_action_scale_time_counter >= _action_scale_time)
-				{
-					// Set the scale to destination scale to account for any error.
-					//_scale = _orig_scale;
-					// Return to the first action state.
-					_action_scale_time_counter = 0;
-					_action_state &= ~eSpriteActStatePulse2;
-					_action_state |= eSpriteActStatePulse1;
-					
-					if (_action_scale_num_pulses != __INF)
-					{
-						_action_scale_num_pulses--;
-					}
-				}
-			}
+			seekTrack(i, _tracks[i].elapsed + time);
 		}
 	}
-	
-	if (_action & eSpriteActColorPulse)
+}
+
+
+void CSprite::setActionTime(int time)
+{
+	for (int i = 0; i < eSpriteTrackMAX; ++i)
 	{
-		if ((_action_color_num_pulses <= 0) && (_action_color_num_pulses != __INF))
+		if (CTween::isActive(&_tracks[i]))
 		{
-			// JC: This doesn't work since the destination color might not be correct depending on the number of pulses.
-			// Set the color to destination color to account for any error.
-			//_color = _dest_color;
-			
-			// Reset action properties.
-			_action_color_time_counter = 0;
-			_action_color_time = 0;
-			_action &= ~eSpriteActColorPulse;
-			_action_state &= ~(eSpriteActStateColPulse1 | eSpriteActStateColPulse2);
+			seekTrack(i, time);
 		}
-		else
-		{
-			_action_color_time_counter += TIME_LAST_FRAME;
+	}
+}
+
+
+int CSprite::getTrackAction(int track)
+{
+	switch (track)
+	{
+		case eSpriteTrackScale:
+			return eSpriteActScale;
 			
-			if (_action_state & eSpriteActStateColPulse1)
-			{
-				_color += (_delta_color * TIME_LAST_FRAME);
-				
-				if (_action_color_time_counter >= _action_color_time)
-				{
-					// Set the color to destination color to account for any error.
-					//_color = _dest_color;
-					// Go to the next action state.
-					_action_color_time_counter = 0;
-					_action_state &= ~eSpriteActStateColPulse1;
-					_action_state |= eSpriteActStateColPulse2;
-					
-					if (_action_color_num_pulses != __INF)
-					{
-						_action_color_num_pulses--;
-					}
-				}
-			}
-			else if (_action_state & eSpriteActStateColPulse2)
-			{
-				_color -= (_delta_color * TIME_LAST_FRAME);
-				
-				if (_action_color_time_counter >= _action_color_time)
-				{
-					// Set the color to destination color to account for any error.
-					//_color = _orig_color;
-					// Return to the first action state.
-					_action_color_time_counter = 0;
-					_action_state &= ~eSpriteActStateColPulse2;
-					_action_state |= eSpriteActStateColPulse1;
-					
-					if (_action_color_num_pulses != __INF)
-					{
-						_action_color_num_pulses--;
-					}
-				}
-			}
-		}
+		case eSpriteTrackColor:
+			return eSpriteActColorPulse;
+			
+		case eSpriteTrackRotate:
+			return eSpriteActRotate;
+			
+		case eSpriteTrackBlink:
+			return eSpriteActBlink;
+			
+		default:
+			return eSpriteActNone;
 	}
+}
+
+
+void CSprite::seekTrack(int track, int time)
+{
+	tweenTrack* tween = &_tracks[track];
+	float prev[TWEEN_MAX_VALUES];
+	float curr[TWEEN_MAX_VALUES];
+	
+	// The track is evaluated from its elapsed time, and only the change since the last evaluation is applied.
+	// This keeps the values exact in both directions while still letting other code move the sprite at the same time, the way the per-frame deltas used to.
+	CTween::evaluate(tween, tween->elapsed, prev);
+	tween->elapsed = (time > 0) ? time : 0;
+	BOOL is_running = CTween::evaluate(tween, tween->elapsed, curr);
 	
-	if (_action & eSpriteActRotate)
+	switch (track)
 	{
-		// Check for whether the rotation count has been reached.
-		if ((_action_rotate_num_rots <= 0) && (_action_rotate_num_rots != __INF))
-		{
-			// JC: This doesn't work since the destination angle might not be correct depending on the number of pulses.
-			// Set the rotation angle to the destination angle to account for any error.
-			//_angle = _dest_angle;
+		case eSpriteTrackScale:
+			_scale.x += curr[0] - prev[0];
+			_scale.y += curr[1] - prev[1];
+			_scale.z += curr[2] - prev[2];
+			break;
 			
-			// Reset action properties.
-			_action_rotate_time_counter = 0;
-			_action_rotate_time = 0;
-			_action &= ~eSpriteActRotate;
-			_action_state &= ~(eSpriteActStateRotate1 | eSpriteActStateRotate2);
-		}
-		else
-		{
-			_action_rotate_time_counter += TIME_LAST_FRAME;
+		case eSpriteTrackColor:
+			_color.r += curr[0] - prev[0];
+			_color.g += curr[1] - prev[1];
+			_color.b += curr[2] - prev[2];
+			_color.a += curr[3] - prev[3];
+			break;
 			
-			if (_action_state & eSpriteActStateRotate1)
-			{
-				if (_rot_dir == eSpriteRotClock)
-				{
-					_angle += (_delta_angle * TIME_LAST_FRAME);
-				}
-				else if (_rot_dir == eSpriteRotCounterClock)
-				{
-					_angle -= (_delta_angle * TIME_LAST_FRAME);
-				}
-				
-				if (_action_rotate_time_counter >= _action_rotate_time)
-				{
-					// Reverse rotation directions.
-					if (_rot_dir == eSpriteRotClock)
-					{
-						_rot_dir = eSpriteRotCounterClock;
-					}
-					else if (_rot_dir == eSpriteRotCounterClock)
-					{
-						_rot_dir = eSpriteRotClock;
-					}
-					
-					// Set the rotation angle to the destination angle to account for any error.
-					//_angle = _dest_angle;
-					// Reset action properties.
-					_action_rotate_time_counter = 0;
-					_action_state &= ~eSpriteActStateRotate1;
-					_action_state |= eSpriteActStateRotate2;
-					
-					if (_action_rotate_num_rots != __INF)
-					{
-						_action_rotate_num_rots--;
-					}
-				}
-			}
-			else if (_action_state & eSpriteActStateRotate2)
-			{
-				if (_rot_dir == eSpriteRotClock)
-				{
-					_angle -= (_delta_angle * TIME_LAST_FRAME);
-				}
-				else if (_rot_dir == eSpriteRotCounterClock)
-				{
-					_angle += (_delta_angle * TIME_LAST_FRAME);
-				}
-				
-				if (_action_rotate_time_counter >= _action_rotate_time)
-				{
-					// Reverse rotation directions.
-					if (_rot_dir == eSpriteRotClock)
-					{
-						_rot_dir = eSpriteRotCounterClock;
-					}
-					else if (_rot_dir == eSpriteRotCounterClock)
-					{
-						_rot_dir = eSpriteRotClock;
-					}
-					
-					// Set the rotation angle to the destination angle to account for any error.
-					//_angle = _orig_angle;
-					// Reset action properties.
-					_action_rotate_time_counter = 0;
-					_action_state &= ~eSpriteActStateRotate2;
-					_action_state |= eSpriteActStateRotate1;
-					
-					if (_action_rotate_num_rots != __INF)
-					{
-						_action_rotate_num_rots--;
-					}
-				}
-			}
-		}
+		case eSpriteTrackRotate:
+			_angle.x += curr[0] - prev[0];
+			_angle.y += curr[1] - prev[1];
+			_angle.z += curr[2] - prev[2];
+			break;
+			
+		case eSpriteTrackBlink:
+			// Blinking is a state rather than an amount, so it is applied directly. A finished track always ends with the sprite being visible.
+			_is_visible = (curr[0] > 0.5f);
+			break;
 	}
 	
-	if (_action & eSpriteActBlink)
+	// A finished track keeps its time and keys so that it can still be rewound, it is just no longer stepped forward.
+	if (is_running)
 	{
-		if ((_num_blinks <= 0) && (_num_blinks != __INF))
-		{
-			// Always end with the sprite being visible.
-			_is_visible = TRUE;
-			_action_state &= ~(eSpriteActStateBlink1 | eSpriteActStateBlink2);
-			_action &= ~eSpriteActBlink;
-		}
-		else
-		{
-			if (_action_state & eSpriteActStateBlink1)
-			{
-				_action_blink_on_time_counter += TIME_LAST_FRAME;
-				// Once we have reached the end of this action state, we will go to the next, which will make the sprite invisible.
-				if (_action_blink_on_time_counter >= (_action_blink_on_time + _action_blink_on_time_rand))
-				{
-					// Check if there is a randomness time to be added.
-					if (_action_blink_off_time_rand_val > 0)
-					{
-						_action_blink_off_time_rand = (rand() % _action_blink_off_time_rand_val);
-					}
-					// Set the next action state.
-					_action_state &= ~eSpriteActStateBlink1;
-					_action_state |= eSpriteActStateBlink2;
-					// Set visibility to off here.
-					_is_visible = FALSE;
-					// Decrement the blink counter if it is not infinity.
-					if (_num_blinks != __INF)
-					{
-						_num_blinks--;
-					}
-				}
-			}
-			else if (_action_state & eSpriteActStateBlink2)
-			{
-				_action_blink_off_time_counter += TIME_LAST_FRAME;
-				// Once we have reached the end of this action state, we will go to the next, which will make the sprite invisible.
-				if (_action_blink_off_time_counter >= (_action_blink_off_time + _action_blink_off_time_rand))
-				{
-					// Check if there is a randomness time to be added.
-					if (_action_blink_on_time_rand_val > 0)
-					{
-						_action_blink_on_time_rand = (rand() % _action_blink_on_time_rand_val);
-					}
-					// Set the next action state.
-					_action_state &= ~eSpriteActStateBlink2;
-					_action_state |= eSpriteActStateBlink1;
-					// Set visibility to on here.
-					_is_visible = TRUE;
-					// Decrement the blink counter if it is not infinity.
-					if (_num_blinks != __INF)
-					{
-						_num_blinks--;
-					}
-				}
-			}
-		}
-		
+		_action |= getTrackAction(track);
+	}
+	else
+	{
+		_action &= ~getTrackAction(track);
+	}
+}
+
+
+void CSprite::setFlipbook(int cols, int rows, int numFrames, int frameTime, BOOL isLooping, BOOL isBlended)
+{
+	spriteFlipbook flipbook;
+	
+	flipbook.cols = cols;
+	flipbook.rows = rows;
+	flipbook.num_frames = (numFrames > 0) ? numFrames : (cols * rows);
+	
+	// An empty layout turns the flipbook off.
+	if ((cols <= 0) || (rows <= 0))
+	{
+		flipbook.num_frames = 0;
+	}
+	flipbook.frame_time = frameTime;
+	flipbook.is_looping = isLooping;
+	flipbook.is_blended = isBlended;
+	
+	setFlipbook(flipbook);
+}
+
+
+void CSprite::setFlipbook(const spriteFlipbook& flipbook)
+{
+	if ((flipbook.num_frames > 0) && ((flipbook.cols <= 0) || (flipbook.rows <= 0) || (flipbook.num_frames > (flipbook.cols * flipbook.rows))))
+	{
+		DPRINT_SPRITE("CSprite::setFlipbook error: The frame count does not fit the atlas layout \n");
+		return;
+	}
+	
+	_flipbook = flipbook;
+	
+	if (_flipbook.frame_time <= 0)
+	{
+		_flipbook.frame_time = SPRITE_ACTION_SPEED_DEFAULT;
+	}
+	
+	_flip_time = 0;
+}
+
+
+void CSprite::getFlipbookFrame(int* frame, int* nextFrame, float* blend) const
+{
+	*frame = 0;
+	*nextFrame = 0;
+	*blend = 0.0f;
+	
+	if (!isFlipbook())
+	{
+		return;
+	}
+	
+	// The frame is derived from the time alone, so any time can be shown without stepping through the frames before it.
+	int index = _flip_time / _flipbook.frame_time;
+	
+	if (_flipbook.is_looping)
+	{
+		*frame = index % _flipbook.num_frames;
+		*nextFrame = (*frame + 1) % _flipbook.num_frames;
+	}
+	else if (index >= _flipbook.num_frames - 1)
+	{
+		// Stay on the last frame.
+		*frame = _flipbook.num_frames - 1;
+		*nextFrame = *frame;
+		return;
+	}
+	else
+	{
+		*frame = index;
+		*nextFrame = index + 1;
+	}
+	
+	if (_flipbook.is_blended)
+	{
+		*blend = (float)(_flip_time % _flipbook.frame_time) / _flipbook.frame_time;
+	}
+}
+
+
+void CSprite::getFlipbookFrameRect(int frame, float* x, float* y, float* w, float* h) const
+{
+	CImage* image = getImage();
+	
+	if ((image == NULL) || !isFlipbook())
+	{
+		*x = 0.0f;
+		*y = 0.0f;
+		*w = (image) ? image->getWidth() : 0.0f;
+		*h = (image) ? image->getHeight() : 0.0f;
+		return;
 	}
 	
-	if (_action & eSpriteActNone)
+	*w = (float)(image->getWidth() / _flipbook.cols);
+	*h = (float)(image->getHeight() / _flipbook.rows);
+	*x = (frame % _flipbook.cols) * (*w);
+	*y = (frame / _flipbook.cols) * (*h);
+}
+
+
+int CSprite::getFlipbookClips(spriteClip* clips) const
+{
+	int frame, next_frame;
+	float blend;
+	
+	getFlipbookFrame(&frame, &next_frame, &blend);
+	getFlipbookFrameRect(frame, &clips[0].x, &clips[0].y, &clips[0].w, &clips[0].h);
+	clips[0].alpha = 1.0f - blend;
+	
+	if (blend <= 0.0f)
 	{
-		_action = (eSpriteAct)0;
+		return 1;
 	}
+	
+	getFlipbookFrameRect(next_frame, &clips[1].x, &clips[1].y, &clips[1].w, &clips[1].h);
+	clips[1].alpha = blend;
+	
+	return 2;
 }
 
 
 void CSprite::updateAnim()
 {
+	if (isFlipbook())
+	{
+		stepFlipbook(TIME_LAST_FRAME);
+		return;
+	}
+	
 	switch(_anim_type)
 	{
 		case ANIM_TYPE_ONCE:
@@ -5,6 +5,7 @@
 #import <OpenGLES/ES1/glext.h>
 #include "types.h"
 #include "Vector3.h"
+#include "Tween.h"
 
 static const int SPRITE_ANIM_FRAMES_MAX = 64;
 
@@ -49,22 +50,17 @@ typedef enum eSpriteAct
 	eSpriteActBlink = 0x0020,			/*!< Sprite blinks in and out of visibility. */
 } eSpriteAct;
 
-/*! \enum eSpriteAct
-*	\brief Used to help identify what part or direction of the sprite action is currently occuring in.
+/*! \enum eSpriteTrack
+*	\brief The tween tracks that drive the sprite actions.
 */
-typedef enum eSpriteActState
+typedef enum eSpriteTrack
 {
-	eSpriteActStateNone = 0x0000,		/*!< No action. */
-	eSpriteActStatePulse1 = 0x0001,		/*!< General size change action state. */
-	eSpriteActStatePulse2 = 0x0002,		/*!< General size change action state. */
-	eSpriteActStateColPulse1 = 0x0004,	/*!< General color change action state. */
-	eSpriteActStateColPulse2 = 0x0008,	/*!< General color change action state. */
-	eSpriteActStateRotate1 = 0x0010,	/*!< General rotation action state. */
-	eSpriteActStateRotate2 = 0x0020,	/*!< General rotation action state. */
-	eSpriteActStateBlink1 = 0x0040,		/*!< General blink action state. */
-	eSpriteActStateBlink2 = 0x0080,		/*!< General blink action state. */
-	eSpriteActStateDone = 0x0100,		/*!< General action done state. */
-} eSpriteActState;
+	eSpriteTrackScale = 0,		/*!< The size scale track. */
+	eSpriteTrackColor,			/*!< The color pulse track. */
+	eSpriteTrackRotate,			/*!< The rotation track. */
+	eSpriteTrackBlink,			/*!< The blink track. */
+	eSpriteTrackMAX,			/*!< The total number of tracks. */
+} eSpriteTrack;
 
 /*! \enum eSpriteRotateDir
 *	\brief Used to help initiate a sprite rotation action in a certain direction.
@@ -79,6 +75,36 @@ typedef enum eSpriteRotateDir
 
 
 
+/*! \struct spriteFlipbook
+*	\brief Describes a flipbook animation whose frames are cells of one atlas image.
+*
+* The frames are laid out left to right, then top to bottom, and every cell has the same size.
+*/
+typedef struct spriteFlipbook
+{
+	int cols;			/*!< The number of frame columns in the atlas. */
+	int rows;			/*!< The number of frame rows in the atlas. */
+	int num_frames;		/*!< The number of frames used, which can be less than cols * rows. Zero means the sprite is not a flipbook. */
+	int frame_time;		/*!< The time in milliseconds that each frame is shown. */
+	BOOL is_looping;	/*!< Indicates that the animation starts over after the last frame. Otherwise it stays on the last frame. */
+	BOOL is_blended;	/*!< Indicates that each frame fades into the next one. */
+} spriteFlipbook;
+
+static const int SPRITE_CLIPS_MAX = 2;	// The most clips that getFlipbookClips() returns.
+
+/*! \struct spriteClip
+*	\brief A part of the sprite image that is drawn, and the share of the sprite alpha that it is drawn with.
+*/
+typedef struct spriteClip
+{
+	float x;			/*!< The x offset into the image. */
+	float y;			/*!< The y offset into the image. */
+	float w;			/*!< The clip width. */
+	float h;			/*!< The clip height. */
+	float alpha;		/*!< The share of the sprite alpha, from 0.0 to 1.0. */
+} spriteClip;
+
+
 class CImage;
 
 // The sprite class consists of an image, an animation sequence, and a gl texture.
@@ -93,6 +119,7 @@ public:
 	CImage* _images[SPRITE_ANIM_FRAMES_MAX];				/*!< If the sprite consists of an animation, then this is used to hold the animation image frames.  Otherwise, only the first frame is used. */
 	BOOL _did_allocate_image_mem[SPRITE_ANIM_FRAMES_MAX];	/*!< Indicates that memory was allocated to load an image.  If not, free will not be called on the image. Otherwise, we know that we got our image from image loader which handles it's own free-ing. */
 	GLuint _anim_texture_names[SPRITE_ANIM_FRAMES_MAX];		/*!< The gl texture names for the #_images. */
+	BOOL _did_generate_texture[SPRITE_ANIM_FRAMES_MAX];		/*!< Indicates that the texture was generated by this sprite rather than shared from the image loader. */
 	int _x;													/*!< The x position relative to the position of the CGameObject that this sprite belongs to, not the world position. */
 	int _y;													/*!< The y position relative to the position of the CGameObject that this sprite belongs to, not the world position. */
 	int _z;													/*!< The z position relative to the position of the CGameObject that this sprite belongs to, not the world position. */
@@ -125,28 +152,28 @@ private:
 	int _largest_half_depth;			/*!< The pixel half-depth of the sprite's largest animation frame. */	
 	BOOL _is_visible;					/*!< Indicates whether this sprite will be rendered or not. */
 	BOOL _is_animated;					/*!< Specifies that this sprite consists of frames of animation. */
-	int _action_scale_time;				/*!< The duration that the action must be completed within. */
-	int _action_scale_time_counter;		/*!< The time counter for the current action. */
-	int _action_scale_num_pulses;		/*!< The number of times that the sprite will run a size scale action. One full size scale cycle consists of start to end size. */
-	int _action_color_time;				/*!< The duration that the action must be completed within. */
-	int _action_color_time_counter;		/*!< The time counter for the current action. */
-	int _action_color_num_pulses;		/*!< The number of times that the color will pulse. Each pulse cycle is from the original color to the destination color. */
-	int _action_rotate_time;			/*!< The duration that the action must be completed within. */
-	int _action_rotate_time_counter;	/*!< The time counter for the current action. */
-	int _action_rotate_num_rots;		/*!< The number of times that the sprite will rotate one full rotation. */
-	int _action_blink_on_time;			/*!< The time that the sprite will be visible. */
-	int _action_blink_on_time_rand;		/*!< The random factor for the sprite on-time visibility. This changes each action state transition. */
-	int _action_blink_on_time_rand_val;	/*!< The random threshold value. _action_blink_on_time_rand is based off of this value. */ 
-	int _action_blink_on_time_counter;	/*!< The time counter for the sprite on-time visibility. */
-	int _action_blink_off_time;			/*!< The time that the sprite will be invisible. */
-	int _action_blink_off_time_rand;	/*!< The random factor for the sprite off-time visibility. */
-	int _action_blink_off_time_rand_val;/*!< The random threshold value. _action_blink_off_time_rand is based off of this value. */
-	int _action_blink_off_time_counter;	/*!< The time counter for the sprite off-time visibility. */
-	int _num_blinks;					/*!< The number of times that the sprite will blink in and out of visibiliy. One blink is one full cycle of on, then off. */
+	tweenTrack _tracks[eSpriteTrackMAX];	/*!< The tween tracks of the sprite actions, kept together so that they are stepped in one pass. */
 	int _action;						/*!< The sprite action. */
-	int _action_state;					/*!< The sprite action state. */
-	eSpriteRotateDir _rot_dir;			/*!< The sprite rotation direction. */
 	eAnimType _anim_type;				/*!< Specifies what type of animation this sprite contaiins.  Look at the enum for a more detailed description. */
+	spriteFlipbook _flipbook;			/*!< The flipbook animation of the sprite, if any. */
+	int _flip_time;						/*!< The time in milliseconds since the flipbook animation started. */
+	
+	/*! \fn seekTrack(int track, int time)
+	 *  \brief Moves an action track to the given time and applies the change in its values to the sprite.
+	 *  
+	 *	\param track The track, one of #eSpriteTrack.
+	 *	\param time The time in milliseconds since the track started.
+	 *  \return n/a
+	 */
+	void seekTrack(int track, int time);
+	
+	/*! \fn getTrackAction(int track)
+	 *  \brief Returns the action flag of an action track.
+	 *  
+	 *	\param track The track, one of #eSpriteTrack.
+	 *  \return The flag, one of #eSpriteAct.
+	 */
+	static int getTrackAction(int track);
 	
 public:	
 	/*! \fn CSprite()
@@ -173,6 +200,14 @@ public:
 	 */
 	void init(void);
 	
+	/*! \fn resetState()
+	 *  \brief Resets the color, scale, rotation, visibility and actions of the sprite as init() would, and restarts its flipbook animation, but keeps its images, position and flipbook layout.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void resetState(void);
+	
 	/*! \fn init(int x, int y, int z)
 	 *  \brief The CSprite class initialization function with extra parameters.
 	 *  
@@ -218,6 +253,15 @@ public:
 	 */
 	void loadSpriteImage(CImage* image);
 	
+	/*! \fn setSpriteImage(CImage* image)
+	 *  \brief Replaces the images of the sprite with a single already loaded image, keeping its color, scale, rotation, actions and flipbook.
+	 *  
+	 * Unlike destroy() followed by init() and loadSpriteImage(), this leaves a live sprite running, and costs no texture upload for image loader images.
+	 *	\param image A pointer the the already loaded #CImage.
+	 *  \return n/a
+	 */
+	void setSpriteImage(CImage* image);
+	
 	/*! \fn bindSpriteImage(uint32 imageID)
 	 *  \brief If the sprite has already been loaded but no image has been assiciated with it, this can be called to bind an already loaded image to a texture name for rendering.
 	 *  
@@ -397,6 +441,91 @@ public:
 	 */
 	void updateAnim(void);
 	
+	/*! \fn setFlipbook(int cols, int rows, int numFrames, int frameTime, BOOL isLooping = TRUE, BOOL isBlended = FALSE)
+	 *  \brief Turns the sprite image into a flipbook atlas, so that the animation frames are cells of one texture instead of separate images.
+	 *  
+	 * Since every frame uses the same texture, animated flipbook sprites and particles can still be drawn in one batch.
+	 *	\param cols The number of frame columns in the atlas. Zero turns the flipbook off.
+	 *	\param rows The number of frame rows in the atlas. Zero turns the flipbook off.
+	 *	\param numFrames The number of frames used, or zero for cols * rows.
+	 *	\param frameTime The time in milliseconds that each frame is shown.
+	 *	\param isLooping TRUE to start over after the last frame, FALSE to stay on the last frame.
+	 *	\param isBlended TRUE to fade each frame into the next one.
+	 *  \return n/a
+	 */
+	void setFlipbook(int cols, int rows, int numFrames, int frameTime, BOOL isLooping = TRUE, BOOL isBlended = FALSE);
+	
+	/*! \fn setFlipbook(const spriteFlipbook& flipbook)
+	 *  \brief Sets the flipbook animation of the sprite.
+	 *  
+	 *	\param flipbook The flipbook animation. A zero frame count turns the flipbook off.
+	 *  \return n/a
+	 */
+	void setFlipbook(const spriteFlipbook& flipbook);
+	
+	/*! \fn getFlipbook(void)
+	 *  \brief Returns the flipbook animation of the sprite.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline const spriteFlipbook& getFlipbook(void) const { return _flipbook; }
+	
+	/*! \fn isFlipbook(void)
+	 *  \brief Returns TRUE if the sprite is a flipbook animation.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline BOOL isFlipbook(void) const { return (_flipbook.num_frames > 0); }
+	
+	/*! \fn setFlipbookTime(int time)
+	 *  \brief Sets the time since the flipbook animation started. Particles set this to zero when they are released, so their frame follows their age.
+	 *  
+	 *	\param time The time in milliseconds.
+	 *  \return n/a
+	 */
+	inline void setFlipbookTime(int time) { _flip_time = (time > 0) ? time : 0; }
+	
+	/*! \fn stepFlipbook(int time)
+	 *  \brief Moves the flipbook animation forward or backward in time.
+	 *  
+	 *	\param time The time in milliseconds to move by.
+	 *  \return n/a
+	 */
+	inline void stepFlipbook(int time) { setFlipbookTime(_flip_time + time); }
+	
+	/*! \fn getFlipbookFrame(int* frame, int* nextFrame, float* blend)
+	 *  \brief Returns the flipbook frames that are showing at the current flipbook time.
+	 *  
+	 *	\param frame Filled with the current frame.
+	 *	\param nextFrame Filled with the frame that the current one fades into.
+	 *	\param blend Filled with how far the current frame has faded into the next one, from 0.0 to 1.0. This is always 0.0 when blending is off.
+	 *  \return n/a
+	 */
+	void getFlipbookFrame(int* frame, int* nextFrame, float* blend) const;
+	
+	/*! \fn getFlipbookFrameRect(int frame, float* x, float* y, float* w, float* h)
+	 *  \brief Returns the pixel rectangle of a flipbook frame in the atlas image.
+	 *  
+	 *	\param frame The frame.
+	 *	\param x Filled with the x offset into the image.
+	 *	\param y Filled with the y offset into the image.
+	 *	\param w Filled with the frame width.
+	 *	\param h Filled with the frame height.
+	 *  \return n/a
+	 */
+	void getFlipbookFrameRect(int frame, float* x, float* y, float* w, float* h) const;
+	
+	/*! \fn getFlipbookClips(spriteClip* clips)
+	 *  \brief Returns the parts of the image that draw the sprite at the current flipbook time.
+	 *  
+	 * A sprite that is not a flipbook is the whole image. A blended flipbook is its current frame and the next frame, faded into each other.
+	 *	\param clips Filled with up to #SPRITE_CLIPS_MAX clips.
+	 *  \return The number of clips.
+	 */
+	int getFlipbookClips(spriteClip* clips) const;
+	
 	/*! \fn setFrameSpeedsMS(int speed)
 	 *  \brief Sets all frame speeds to one uniform speed in milliseconds.
 	 *  
@@ -500,13 +629,30 @@ public:
 	 */
 	void updateAction(void);
 	
+	/*! \fn stepAction(int time)
+	 *  \brief Moves the sprite action(s) forward or backward in time.
+	 *  
+	 * Every action is evaluated directly at its new time, so a step of any size, in either direction, costs the same as a single frame.
+	 *	\param time The time in milliseconds to move by. Negative values rewind the actions.
+	 *  \return n/a
+	 */
+	void stepAction(int time);
+	
+	/*! \fn setActionTime(int time)
+	 *  \brief Sets every started sprite action to the given time since it started.
+	 *  
+	 *	\param time The time in milliseconds since the action started.
+	 *  \return n/a
+	 */
+	void setActionTime(int time);
+	
 	/*! \fn resetAction(void)
 	 *  \brief Set the current action back to null.
 	 *  
 	 *	\param n/a
 	 *  \return n/a
 	 */
-	inline void resetAction(void) { _action = 0; _action_state = 0; }
+	void resetAction(void);
 	
 	/*! \fn setVisible(BOOL visible)
 	 *  \brief Set the visibility of the sprite.
@@ -540,8 +686,21 @@ public:
 	 */
 	inline void setAnimDirection(eAnimDirection dir) { _anim_dir = dir; }
 	
-	inline int getCurrentNumColorPulses(void) { return _action_color_num_pulses; }
-	inline void setCurrentNumColorPulses(int numPulses) { _action_color_num_pulses = numPulses; }
+	/*! \fn getCurrentNumColorPulses(void)
+	 *  \brief Returns the number of color pulses left to run, or #__INF.
+	 *  
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline int getCurrentNumColorPulses(void) { return CTween::getCyclesLeft(&_tracks[eSpriteTrackColor]); }
+	
+	/*! \fn setCurrentNumColorPulses(int numPulses)
+	 *  \brief Sets the number of color pulses left to run.
+	 *  
+	 *	\param numPulses The number of pulses left to run, or #__INF.
+	 *  \return n/a
+	 */
+	void setCurrentNumColorPulses(int numPulses);
 	inline void setColor(float r, float g, float b) { _color.r = r; _color.g = g; _color.b = b; }
 	inline void setColor(float r, float g, float b, float a) { _color.r = r; _color.g = g; _color.b = b; _color.a = a; }
 	inline void setColor(const color theColor) { _color = theColor; }
@@ -0,0 +1,378 @@
+/*
+ *  SpriteBatch.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "SystemDefines.h"
+#include "SpriteBatch.h"
+#include "Sprite.h"
+#include "Graphics.h"
+#include "MathUtil.h"
+
+
+CSpriteBatch::CSpriteBatch()
+{
+	_max_sprites = 0;
+	_num_sprites = 0;
+	_depth = 0;
+	_is_sort_by_texture = TRUE;
+	_prev_batch = NULL;
+	memset(_modelview, 0, sizeof(_modelview));
+}
+
+
+CSpriteBatch::~CSpriteBatch()
+{
+	destroy();
+}
+
+
+void CSpriteBatch::init(const int maxSprites)
+{
+	destroy();
+
+	_max_sprites = min(max(maxSprites, 1), QUAD_INDEX_MAX_QUADS);
+
+	_vertices = ArrayList<spriteBatchVertex>::alloc(_max_sprites * SPRITE_BATCH_QUAD_VERTICES);
+	_sorted_vertices = ArrayList<spriteBatchVertex>::alloc(_max_sprites * SPRITE_BATCH_QUAD_VERTICES);
+	_entries = ArrayList<spriteBatchEntry>::alloc(_max_sprites);
+}
+
+
+void CSpriteBatch::destroy()
+{
+	_vertices = NULL;
+	_sorted_vertices = NULL;
+	_entries = NULL;
+
+	_max_sprites = 0;
+	_num_sprites = 0;
+	_depth = 0;
+}
+
+
+void CSpriteBatch::begin()
+{
+	if (_depth == 0)
+	{
+		_prev_batch = CGraphics::getSpriteBatch();
+		CGraphics::setSpriteBatch(this);
+	}
+
+	_depth++;
+}
+
+
+void CSpriteBatch::end()
+{
+	if (_depth <= 0)
+	{
+		DPRINT_GRAPHICS("CSpriteBatch::end error: end called without begin \n");
+		return;
+	}
+
+	_depth--;
+
+	if (_depth == 0)
+	{
+		// Stop routing first so that nothing drawn by the flush ends up back in the batch.
+		CGraphics::setSpriteBatch(_prev_batch);
+		_prev_batch = NULL;
+
+		flush();
+	}
+}
+
+
+void CSpriteBatch::addSprite(const CSprite* sprite, const float x, const float y)
+{
+	if ((sprite == NULL) || (sprite->getImage() == NULL))
+	{
+		return;
+	}
+
+	spriteClip clips[SPRITE_CLIPS_MAX];
+	
+	// This is the whole image unless the sprite is a flipbook, in which case it is the frames that are showing.
+	int num_clips = sprite->getFlipbookClips(clips);
+	
+	for (int i = 0; i < num_clips; ++i)
+	{
+		addSprite(sprite, x, y, clips[i].x, clips[i].y, clips[i].w, clips[i].h, clips[i].alpha);
+	}
+}
+
+
+void CSpriteBatch::addSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale)
+{
+	if (sprite == NULL)
+	{
+		return;
+	}
+
+	CImage* image = sprite->getImage();
+
+	// If the alpha is zero, don't bother drawing.
+	if ((image == NULL) || (!sprite->isVisible()) || ((sprite->_color.a * alphaScale) <= 0.0))
+	{
+		return;
+	}
+
+	if (_max_sprites <= 0)
+	{
+		DPRINT_GRAPHICS("CSpriteBatch::addSprite error: The batch has not been initialized \n");
+		return;
+	}
+
+	checkModelview();
+
+	if (_num_sprites >= _max_sprites)
+	{
+		flush();
+	}
+
+	GLfloat quad[8];
+	GLfloat tex_coords[8];
+
+	CGraphics::buildQuadVertices(quad, x, y, clipW, clipH);
+	CGraphics::buildQuadTexCoords(tex_coords, offsetX, offsetY, clipW, clipH, image);
+
+	// This is the same transform that CGraphics::drawSprite() builds on the matrix stack: scale about the sprite position, then rotate about the scaled sprite center.
+	float center_x = x + (sprite->getHalfWidth() * sprite->_scale.x);
+	float center_y = y + (sprite->getHalfHeight() * sprite->_scale.y);
+
+	BOOL is_rotated = (sprite->_angle.x != 0.0) || (sprite->_angle.y != 0.0) || (sprite->_angle.z != 0.0);
+	float sin_x = 0.0f, cos_x = 1.0f;
+	float sin_y = 0.0f, cos_y = 1.0f;
+	float sin_z = 0.0f, cos_z = 1.0f;
+
+	if (is_rotated)
+	{
+		float angle_x = sprite->_angle.x;
+		float angle_y = sprite->_angle.y;
+		float angle_z = sprite->_angle.z;
+
+		sin_x = sinf(DEGREES_TO_RADIANS(angle_x));
+		cos_x = cosf(DEGREES_TO_RADIANS(angle_x));
+		sin_y = sinf(DEGREES_TO_RADIANS(angle_y));
+		cos_y = cosf(DEGREES_TO_RADIANS(angle_y));
+		sin_z = sinf(DEGREES_TO_RADIANS(angle_z));
+		cos_z = cosf(DEGREES_TO_RADIANS(angle_z));
+	}
+
+	GLubyte r = (GLubyte)(sprite->_color.r * 255.0f);
+	GLubyte g = (GLubyte)(sprite->_color.g * 255.0f);
+	GLubyte b = (GLubyte)(sprite->_color.b * 255.0f);
+	GLubyte a = (GLubyte)(sprite->_color.a * alphaScale * 255.0f);
+
+	spriteBatchVertex* vertices = &_vertices[_num_sprites * SPRITE_BATCH_QUAD_VERTICES];
+
+	for (int i = 0; i < SPRITE_BATCH_QUAD_VERTICES; ++i)
+	{
+		float vx = x + ((quad[(i * 2) + 0] - x) * sprite->_scale.x);
+		float vy = y + ((quad[(i * 2) + 1] - y) * sprite->_scale.y);
+
+		if (is_rotated)
+		{
+			float dx = vx - center_x;
+			float dy = vy - center_y;
+			float dz = 0.0f;
+			float t;
+
+			// Rotate about z, then y, then x, which is the order glRotatef() applies them to the vertex.
+			t = (dx * cos_z) - (dy * sin_z);
+			dy = (dx * sin_z) + (dy * cos_z);
+			dx = t;
+
+			t = (dx * cos_y) + (dz * sin_y);
+			dz = (dz * cos_y) - (dx * sin_y);
+			dx = t;
+
+			dy = (dy * cos_x) - (dz * sin_x);
+
+			vx = center_x + dx;
+			vy = center_y + dy;
+		}
+
+		vertices[i].x = vx;
+		vertices[i].y = vy;
+		vertices[i].u = tex_coords[(i * 2) + 0];
+		vertices[i].v = tex_coords[(i * 2) + 1];
+		vertices[i].r = r;
+		vertices[i].g = g;
+		vertices[i].b = b;
+		vertices[i].a = a;
+	}
+
+	_entries[_num_sprites].tex_name = sprite->getTexName();
+	_entries[_num_sprites].order = _num_sprites;
+	_num_sprites++;
+}
+
+
+void CSpriteBatch::addQuads(const GLfloat* quads, const int numQuads, const float x, const float y, color theColor)
+{
+	// If the alpha is zero, don't bother drawing.
+	if ((quads == NULL) || (theColor.a <= 0.0))
+	{
+		return;
+	}
+
+	if (_max_sprites <= 0)
+	{
+		DPRINT_GRAPHICS("CSpriteBatch::addQuads error: The batch has not been initialized \n");
+		return;
+	}
+
+	checkModelview();
+
+	GLubyte r = (GLubyte)(theColor.r * 255.0f);
+	GLubyte g = (GLubyte)(theColor.g * 255.0f);
+	GLubyte b = (GLubyte)(theColor.b * 255.0f);
+	GLubyte a = (GLubyte)(theColor.a * 255.0f);
+
+	for (int i = 0; i < numQuads; ++i)
+	{
+		if (_num_sprites >= _max_sprites)
+		{
+			flush();
+		}
+
+		spriteBatchVertex* vertices = &_vertices[_num_sprites * SPRITE_BATCH_QUAD_VERTICES];
+		const GLfloat* quad = &quads[i * SPRITE_BATCH_QUAD_VERTICES * 2];
+
+		for (int j = 0; j < SPRITE_BATCH_QUAD_VERTICES; ++j)
+		{
+			vertices[j].x = quad[(j * 2) + 0] + x;
+			vertices[j].y = quad[(j * 2) + 1] + y;
+			vertices[j].u = 0.0f;
+			vertices[j].v = 0.0f;
+			vertices[j].r = r;
+			vertices[j].g = g;
+			vertices[j].b = b;
+			vertices[j].a = a;
+		}
+
+		// Texture name zero marks untextured quads.
+		_entries[_num_sprites].tex_name = 0;
+		_entries[_num_sprites].order = _num_sprites;
+		_num_sprites++;
+	}
+}
+
+
+void CSpriteBatch::checkModelview()
+{
+	GLfloat modelview[16];
+
+	// The fixed function matrices are kept by the driver, so reading one back does not wait for the GPU.
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
+	if ((_num_sprites > 0) && (memcmp(modelview, _modelview, sizeof(_modelview)) != 0))
+	{
+		flush();
+	}
+
+	memcpy(_modelview, modelview, sizeof(_modelview));
+}
+
+
+int CSpriteBatch::compareEntries(const void* a, const void* b)
+{
+	const spriteBatchEntry* entry_a = (const spriteBatchEntry*)a;
+	const spriteBatchEntry* entry_b = (const spriteBatchEntry*)b;
+
+	if (entry_a->tex_name != entry_b->tex_name)
+	{
+		return (entry_a->tex_name < entry_b->tex_name) ? -1 : 1;
+	}
+
+	// Keep the original order within a texture, qsort is not stable on its own.
+	return entry_a->order - entry_b->order;
+}
+
+
+void CSpriteBatch::flush()
+{
+	if (_num_sprites <= 0)
+	{
+		return;
+	}
+
+	if (_is_sort_by_texture)
+	{
+		qsort(_entries.getRawPtr(), _num_sprites, sizeof(spriteBatchEntry), compareEntries);
+	}
+
+	for (int i = 0; i < _num_sprites; ++i)
+	{
+		memcpy(
+			   &_sorted_vertices[i * SPRITE_BATCH_QUAD_VERTICES],
+			   &_vertices[_entries[i].order * SPRITE_BATCH_QUAD_VERTICES],
+			   sizeof(spriteBatchVertex) * SPRITE_BATCH_QUAD_VERTICES);
+	}
+
+	int offset = CGraphics::streamVertices(_sorted_vertices.getRawPtr(), _num_sprites * SPRITE_BATCH_QUAD_VERTICES * sizeof(spriteBatchVertex));
+	const char* vertices = (offset >= 0) ? (const char*)(size_t)offset : (const char*)_sorted_vertices.getRawPtr();
+
+	// The sprite transforms are already applied to the vertices, so only the modelview that the sprites were added under is left.
+	glPushMatrix();
+	glLoadMatrixf(_modelview);
+
+	// Make sure to enable the states that let us bind and draw the texture.
+	glEnable(GL_TEXTURE_2D);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	int first = 0;
+
+	while (first < _num_sprites)
+	{
+		// Find the run of sprites that share this texture.
+		int last = first + 1;
+		while ((last < _num_sprites) && (_entries[last].tex_name == _entries[first].tex_name))
+		{
+			++last;
+		}
+
+		const char* run_vertices = vertices + (first * SPRITE_BATCH_QUAD_VERTICES * sizeof(spriteBatchVertex));
+
+		if (_entries[first].tex_name == 0)
+		{
+			glDisable(GL_TEXTURE_2D);
+		}
+		else
+		{
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, _entries[first].tex_name);
+		}
+
+		glVertexPointer(2, GL_FLOAT, sizeof(spriteBatchVertex), run_vertices + offsetof(spriteBatchVertex, x));
+		glTexCoordPointer(2, GL_FLOAT, sizeof(spriteBatchVertex), run_vertices + offsetof(spriteBatchVertex, u));
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(spriteBatchVertex), run_vertices + offsetof(spriteBatchVertex, r));
+
+		CGraphics::drawQuads(last - first);
+
+		first = last;
+	}
+
+	CGraphics::unbindStreamBuffer();
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisable(GL_TEXTURE_2D);
+
+	// The color array leaves the current color undefined, so reset it for the next draw.
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+	glPopMatrix();
+
+	_num_sprites = 0;
+}
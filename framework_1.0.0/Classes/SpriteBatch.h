@@ -0,0 +1,199 @@
+/*
+ *  SpriteBatch.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __SPRITEBATCH_H__
+#define __SPRITEBATCH_H__
+
+#include <OpenGLES/ES1/gl.h>
+#include "types.h"
+#include "ArrayList.h"
+
+class CSprite;
+
+static const int SPRITE_BATCH_MAX_SPRITES = 1024;	// The default number of sprites that are held in the batch before it is drawn.
+static const int SPRITE_BATCH_QUAD_VERTICES = 4;	// Every sprite is one quad.
+
+/*! \struct spriteBatchVertex
+ *	\brief A single vertex of a batched sprite quad.
+ */
+typedef struct spriteBatchVertex
+{
+	GLfloat x;		/*!< The x position. */
+	GLfloat y;		/*!< The y position. */
+	GLfloat u;		/*!< The u texture coordinate. */
+	GLfloat v;		/*!< The v texture coordinate. */
+	GLubyte r;		/*!< The red color component. */
+	GLubyte g;		/*!< The green color component. */
+	GLubyte b;		/*!< The blue color component. */
+	GLubyte a;		/*!< The alpha color component. */
+} spriteBatchVertex;
+
+/*! \struct spriteBatchEntry
+ *	\brief A sprite waiting in the batch to be drawn.
+ */
+typedef struct spriteBatchEntry
+{
+	GLuint tex_name;	/*!< The texture of the sprite. */
+	int order;			/*!< The order the sprite was added in, which is also the index of its quad in the batch. */
+} spriteBatchEntry;
+
+
+/*! \class CSpriteBatch
+ * \brief The Sprite Batch class.
+ *
+ * The sprite batch collects 2D sprites and draws them with as few draw calls as possible.
+ * Every sprite is transformed into screen space on the CPU, so sprites with different positions, clip rectangles, colors, rotations and scales can share a draw.
+ * The modelview matrix that is current when a sprite is added still applies to it. Changing the matrix between two sprites draws the batch first.
+ * While a batch is begun, the 2D CGraphics::drawSprite() calls are routed into it, so existing drawing code does not need to change.
+ */
+class CSpriteBatch
+{
+public:
+	/*! \fn CSpriteBatch()
+	 *  \brief The CSpriteBatch class constructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	CSpriteBatch();
+
+	/*! \fn ~CSpriteBatch()
+	 *  \brief The CSpriteBatch class destructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	~CSpriteBatch();
+
+	/*! \fn init(const int maxSprites = SPRITE_BATCH_MAX_SPRITES)
+	 *  \brief The CSpriteBatch class initializer function.
+	 *
+	 *	\param maxSprites The number of sprites that are held before the batch has to be drawn.
+	 *  \return n/a
+	 */
+	void init(const int maxSprites = SPRITE_BATCH_MAX_SPRITES);
+
+	/*! \fn destroy(void)
+	 *  \brief The CSpriteBatch class destroy function.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void destroy(void);
+
+	/*! \fn begin(void)
+	 *  \brief Starts routing the 2D CGraphics::drawSprite() calls into this batch.
+	 *
+	 * Batches can be nested, only the outermost end() draws.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void begin(void);
+
+	/*! \fn end(void)
+	 *  \brief Draws all sprites collected since begin() and stops routing sprites into this batch.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void end(void);
+
+	/*! \fn flush(void)
+	 *  \brief Draws and empties the batch.
+	 *
+	 * When sorting is enabled the sprites are grouped by texture, so overlapping sprites with different textures may be drawn out of order.
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void flush(void);
+
+	/*! \fn addSprite(const CSprite* sprite, const float x, const float y)
+	 *  \brief Adds the whole sprite image to the batch, or the frames that are showing if the sprite is a flipbook.
+	 *
+	 *	\param sprite The sprite.
+	 *	\param x The x location on the screen.
+	 *	\param y The y location on the screen.
+	 *  \return n/a
+	 */
+	void addSprite(const CSprite* sprite, const float x, const float y);
+
+	/*! \fn addSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale)
+	 *  \brief Adds a clipped part of the sprite image to the batch.
+	 *
+	 *	\param sprite The sprite.
+	 *	\param x The x location on the screen.
+	 *	\param y The y location on the screen.
+	 *	\param offsetX The x offset into the sprite image.
+	 *	\param offsetY The y offset into the sprite image.
+	 *	\param clipW The clip width.
+	 *	\param clipH The clip height.
+	 *	\param alphaScale The share of the sprite alpha that the clip is drawn with.
+	 *  \return n/a
+	 */
+	void addSprite(const CSprite* sprite, const float x, const float y, const float offsetX, const float offsetY, const float clipW, const float clipH, const float alphaScale = 1.0f);
+
+	/*! \fn addQuads(const GLfloat* quads, const int numQuads, const float x, const float y, color theColor)
+	 *  \brief Adds untextured quads to the batch.
+	 *
+	 * This is used for shapes. Untextured quads sort before all textured sprites when sorting is enabled, so shapes end up behind the sprites of the same batch.
+	 *	\param quads The x and y positions of the quad vertices, 4 vertices per quad in the order top left, top right, bottom left, bottom right.
+	 *	\param numQuads The number of quads.
+	 *	\param x The x offset added to every vertex.
+	 *	\param y The y offset added to every vertex.
+	 *	\param theColor The color of the quads.
+	 *  \return n/a
+	 */
+	void addQuads(const GLfloat* quads, const int numQuads, const float x, const float y, color theColor);
+
+	/*! \fn setSortByTexture(BOOL sort)
+	 *  \brief Sets whether sprites are grouped by texture when drawn. Turn this off when sprites overlap and must be drawn in the order they were added.
+	 *
+	 *	\param sort TRUE to group sprites by texture.
+	 *  \return n/a
+	 */
+	inline void setSortByTexture(BOOL sort) { _is_sort_by_texture = sort; }
+
+	/*! \fn getNumSprites(void)
+	 *  \brief Returns the number of sprites waiting in the batch.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline int getNumSprites(void) { return _num_sprites; }
+
+private:
+	/*! \fn compareEntries(const void* a, const void* b)
+	 *  \brief Orders batch entries by texture, then by the order they were added.
+	 *
+	 *	\param a The first entry.
+	 *	\param b The second entry.
+	 *  \return n/a
+	 */
+	static int compareEntries(const void* a, const void* b);
+
+	/*! \fn checkModelview(void)
+	 *  \brief Draws the batch if the modelview matrix has changed since its sprites were added, and remembers the current matrix.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void checkModelview(void);
+
+	ArrayList<spriteBatchVertex> _vertices;			/*!< The sprite quads, in the order they were added. */
+	ArrayList<spriteBatchVertex> _sorted_vertices;	/*!< The sprite quads in draw order. */
+	ArrayList<spriteBatchEntry> _entries;			/*!< The sprites in the batch. */
+	int _max_sprites;			/*!< The number of sprites the batch can hold. */
+	int _num_sprites;			/*!< The number of sprites in the batch. */
+	int _depth;					/*!< The number of begin() calls that have not been ended yet. */
+	BOOL _is_sort_by_texture;	/*!< Indicates that sprites are grouped by texture when drawn. */
+	CSpriteBatch* _prev_batch;	/*!< The batch that sprites were routed to before begin() was called. */
+	GLfloat _modelview[16];		/*!< The modelview matrix that the sprites in the batch were added under. */
+};
+
+
+#endif
@@ -23,6 +23,8 @@
 #define DPRINT_HASHTABLE(...)	printf(__VA_ARGS__)
 #define DPRINT_STRINGI(...)		printf(__VA_ARGS__)
 #define DPRINT_STRINGD(...)		printf(__VA_ARGS__)
+#define DPRINT_BENCHMARK(...)	printf(__VA_ARGS__)
+#define DPRINT_UNITTEST(...)	printf(__VA_ARGS__)
 
 //#define ENABLE_PNGLOAD
 
@@ -0,0 +1,175 @@
+/*
+ *  ThreadPool.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <unistd.h>
+#include "SystemDefines.h"
+#include "ThreadPool.h"
+
+
+CThreadPool::CThreadPool()
+{
+	_num_threads = 1;
+	_job_func = NULL;
+	_job_data = NULL;
+	_num_jobs = 0;
+	_next_job = 0;
+	_num_jobs_done = 0;
+	_is_shutting_down = FALSE;
+
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_work_cond, NULL);
+	pthread_cond_init(&_done_cond, NULL);
+}
+
+
+CThreadPool::~CThreadPool()
+{
+	destroy();
+
+	pthread_cond_destroy(&_done_cond);
+	pthread_cond_destroy(&_work_cond);
+	pthread_mutex_destroy(&_mutex);
+}
+
+
+int CThreadPool::getNumCores()
+{
+	int num_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (num_cores < 1)
+	{
+		num_cores = 1;
+	}
+
+	return num_cores;
+}
+
+
+void CThreadPool::init(const int numThreads)
+{
+	destroy();
+
+	_num_threads = min(max(numThreads, 1), THREAD_POOL_MAX);
+
+	// The calling thread runs jobs as well, so we only need to create one less than the requested thread count.
+	for (int i = 1; i < _num_threads; ++i)
+	{
+		if (pthread_create(&_threads[i - 1], NULL, workerMain, this) != 0)
+		{
+			DPRINT_ENGINE("CThreadPool::init failed: Could not create worker thread %d \n", i);
+			_num_threads = i;
+			break;
+		}
+	}
+}
+
+
+void CThreadPool::destroy()
+{
+	if (_num_threads <= 1)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&_mutex);
+	_is_shutting_down = TRUE;
+	pthread_cond_broadcast(&_work_cond);
+	pthread_mutex_unlock(&_mutex);
+
+	for (int i = 1; i < _num_threads; ++i)
+	{
+		pthread_join(_threads[i - 1], NULL);
+	}
+
+	_num_threads = 1;
+	_is_shutting_down = FALSE;
+}
+
+
+void CThreadPool::runJobs(threadJobFunc func, void* data, const int numJobs)
+{
+	if (numJobs <= 0)
+	{
+		return;
+	}
+
+	// There is no point in waking up the workers for a single job.
+	if ((_num_threads <= 1) || (numJobs == 1))
+	{
+		for (int i = 0; i < numJobs; ++i)
+		{
+			func(data, i);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&_mutex);
+
+	_job_func = func;
+	_job_data = data;
+	_num_jobs = numJobs;
+	_next_job = 0;
+	_num_jobs_done = 0;
+	pthread_cond_broadcast(&_work_cond);
+
+	// Help out with the jobs, then wait for any jobs still running on the workers.
+	runPendingJobs();
+
+	while (_num_jobs_done < _num_jobs)
+	{
+		pthread_cond_wait(&_done_cond, &_mutex);
+	}
+
+	_job_func = NULL;
+	_job_data = NULL;
+
+	pthread_mutex_unlock(&_mutex);
+}
+
+
+void CThreadPool::runPendingJobs()
+{
+	while (_next_job < _num_jobs)
+	{
+		int job = _next_job++;
+		threadJobFunc func = _job_func;
+		void* data = _job_data;
+
+		pthread_mutex_unlock(&_mutex);
+		func(data, job);
+		pthread_mutex_lock(&_mutex);
+
+		_num_jobs_done++;
+		if (_num_jobs_done >= _num_jobs)
+		{
+			pthread_cond_signal(&_done_cond);
+		}
+	}
+}
+
+
+void* CThreadPool::workerMain(void* pool)
+{
+	CThreadPool* thread_pool = (CThreadPool*)pool;
+
+	pthread_mutex_lock(&thread_pool->_mutex);
+
+	while (!thread_pool->_is_shutting_down)
+	{
+		thread_pool->runPendingJobs();
+
+		if (!thread_pool->_is_shutting_down)
+		{
+			pthread_cond_wait(&thread_pool->_work_cond, &thread_pool->_mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&thread_pool->_mutex);
+
+	return NULL;
+}
@@ -0,0 +1,123 @@
+/*
+ *  ThreadPool.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <pthread.h>
+#include "types.h"
+
+// The maximum number of threads that a thread pool can run, including the calling thread.
+static const int THREAD_POOL_MAX = 8;
+
+/*! \typedef threadJobFunc
+ *	\brief A job that is run by the thread pool. The job index identifies which piece of the work this call is responsible for.
+ */
+typedef void (*threadJobFunc)(void* data, int jobIndex);
+
+/*! \class CThreadPool
+ * \brief The Thread Pool class.
+ *
+ * The thread pool keeps a set of worker threads alive so that work can be split into jobs and run in parallel without creating threads every frame.
+ * The calling thread always takes part in running jobs, so a pool with one thread simply runs every job inline.
+ */
+class CThreadPool
+{
+public:
+	/*! \fn CThreadPool()
+	 *  \brief The CThreadPool class constructor.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	CThreadPool();
+
+	/*! \fn ~CThreadPool()
+	 *  \brief The CThreadPool class destructor. Stops all worker threads.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	~CThreadPool();
+
+	/*! \fn init(const int numThreads)
+	 *  \brief Starts the worker threads.
+	 *
+	 * Any previously running worker threads are stopped first.
+	 *	\param numThreads The total number of threads to run jobs on, including the calling thread. Clamped to the range 1 to #THREAD_POOL_MAX.
+	 *  \return n/a
+	 */
+	void init(const int numThreads);
+
+	/*! \fn destroy()
+	 *  \brief Stops and joins all worker threads.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void destroy(void);
+
+	/*! \fn runJobs(threadJobFunc func, void* data, const int numJobs)
+	 *  \brief Runs the given job function once for every job index from 0 to numJobs - 1, spread across all threads.
+	 *
+	 * This call blocks until every job has completed. Jobs must not depend on the order in which they are run.
+	 *	\param func The job function.
+	 *	\param data The data passed to every job.
+	 *	\param numJobs The number of jobs to run.
+	 *  \return n/a
+	 */
+	void runJobs(threadJobFunc func, void* data, const int numJobs);
+
+	/*! \fn getNumThreads(void)
+	 *  \brief Returns the total number of threads that jobs run on, including the calling thread.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	inline int getNumThreads(void) { return _num_threads; }
+
+	/*! \fn getNumCores(void)
+	 *  \brief Returns the number of processor cores that are currently online.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	static int getNumCores(void);
+
+private:
+	/*! \fn workerMain(void* pool)
+	 *  \brief The entry point of every worker thread.
+	 *
+	 *	\param pool The thread pool that owns the worker.
+	 *  \return n/a
+	 */
+	static void* workerMain(void* pool);
+
+	/*! \fn runPendingJobs(void)
+	 *  \brief Runs jobs until there are no more jobs left to hand out. The mutex must be locked when this is called, and is locked when it returns.
+	 *
+	 *	\param n/a
+	 *  \return n/a
+	 */
+	void runPendingJobs(void);
+
+	pthread_t _threads[THREAD_POOL_MAX];	/*!< The worker threads. The calling thread is not stored here. */
+	int _num_threads;			/*!< The total number of threads that jobs run on, including the calling thread. */
+	pthread_mutex_t _mutex;		/*!< Guards all of the job state below. */
+	pthread_cond_t _work_cond;	/*!< Signaled when a new set of jobs is available or the pool is shutting down. */
+	pthread_cond_t _done_cond;	/*!< Signaled when the last job of the current set completes. */
+	threadJobFunc _job_func;	/*!< The job function of the current set of jobs. */
+	void* _job_data;			/*!< The data passed to the current set of jobs. */
+	int _num_jobs;				/*!< The number of jobs in the current set. */
+	int _next_job;				/*!< The index of the next job to hand out. */
+	int _num_jobs_done;			/*!< The number of jobs of the current set that have completed. */
+	BOOL _is_shutting_down;		/*!< Tells the worker threads to exit. */
+};
+
+
+#endif
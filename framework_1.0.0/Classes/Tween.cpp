@@ -0,0 +1,204 @@
+/*
+ *  Tween.cpp
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#include <string.h>
+#include "SystemDefines.h"
+#include "Tween.h"
+
+
+void CTween::setPingPong(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles, eTweenEase ease)
+{
+	memset(track, 0, sizeof(tweenTrack));
+
+	track->mode = eTweenModePingPong;
+	track->ease = ease;
+	track->duration = max(duration, 1);
+	track->num_cycles = numCycles;
+	track->num_values = min(numValues, TWEEN_MAX_VALUES);
+
+	for (int i = 0; i < track->num_values; ++i)
+	{
+		track->from[i] = from[i];
+		track->to[i] = to[i];
+	}
+}
+
+
+void CTween::setContinuous(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles)
+{
+	setPingPong(track, from, to, numValues, duration, numCycles);
+
+	track->mode = eTweenModeContinuous;
+}
+
+
+void CTween::setBlink(tweenTrack* track, const int onTime, const int randOnTime, const int offTime, const int randOffTime, const int numBlinks, const unsigned int seed)
+{
+	memset(track, 0, sizeof(tweenTrack));
+
+	track->mode = eTweenModeBlink;
+	track->num_cycles = numBlinks;
+	track->num_values = 1;
+	track->on_time = max(onTime, 0);
+	track->seed = seed;
+
+	// The cycle length is the average cycle length when the on and off times are randomized separately.
+	track->jitter = (max(randOnTime, 0) + max(randOffTime, 0)) / 2;
+	track->duration = max(track->on_time + max(offTime, 0) + track->jitter, 1);
+}
+
+
+int CTween::getBlinkOnTime(const tweenTrack* track, const int cycle)
+{
+	if (track->jitter <= 0)
+	{
+		return track->on_time;
+	}
+
+	// Hash the cycle index so that the same cycle always gets the same random time, no matter when it is evaluated.
+	unsigned int hash = track->seed ^ ((unsigned int)cycle * 2654435761u);
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3bu;
+	hash ^= hash >> 16;
+
+	return track->on_time + (int)(hash % (unsigned int)(track->jitter + 1));
+}
+
+
+int CTween::getCyclesDone(const tweenTrack* track, const int time)
+{
+	if (time <= 0)
+	{
+		return 0;
+	}
+
+	int cycles = time / track->duration;
+
+	if (track->mode == eTweenModeBlink)
+	{
+		// Every on and every off counts as one cycle.
+		cycles *= 2;
+		if ((time % track->duration) >= getBlinkOnTime(track, time / track->duration))
+		{
+			cycles++;
+		}
+	}
+
+	if (track->num_cycles != __INF)
+	{
+		cycles = min(cycles, track->num_cycles);
+	}
+
+	return cycles;
+}
+
+
+int CTween::getCyclesLeft(const tweenTrack* track)
+{
+	if (track->mode == eTweenModeNone)
+	{
+		return 0;
+	}
+
+	if (track->num_cycles == __INF)
+	{
+		return __INF;
+	}
+
+	return max(track->num_cycles - getCyclesDone(track, track->elapsed), 0);
+}
+
+
+float CTween::ease(const int ease, const float t)
+{
+	switch (ease)
+	{
+		case eTweenEaseIn:
+			return t * t;
+
+		case eTweenEaseOut:
+			return t * (2.0f - t);
+
+		case eTweenEaseInOut:
+			return t * t * (3.0f - (2.0f * t));
+
+		case eTweenEaseLinear:
+		default:
+			return t;
+	}
+}
+
+
+BOOL CTween::evaluate(const tweenTrack* track, const int time, float* values)
+{
+	int clamped_time = max(time, 0);
+	int cycle = clamped_time / track->duration;
+	BOOL is_running = TRUE;
+
+	switch (track->mode)
+	{
+		case eTweenModePingPong:
+		case eTweenModeContinuous:
+		{
+			float t = (float)(clamped_time % track->duration) / track->duration;
+
+			// Once every cycle has run, stay at the end of the last cycle.
+			if ((track->num_cycles != __INF) && (cycle >= track->num_cycles))
+			{
+				cycle = max(track->num_cycles, 0);
+				t = 0.0f;
+				is_running = FALSE;
+			}
+
+			t = ease(track->ease, t);
+
+			for (int i = 0; i < track->num_values; ++i)
+			{
+				float span = track->to[i] - track->from[i];
+
+				if (track->mode == eTweenModeContinuous)
+				{
+					values[i] = track->from[i] + (span * (cycle + t));
+				}
+				else if ((cycle % 2) == 0)
+				{
+					values[i] = track->from[i] + (span * t);
+				}
+				else
+				{
+					values[i] = track->to[i] - (span * t);
+				}
+			}
+		}
+			break;
+
+		case eTweenModeBlink:
+		{
+			int phase = getCyclesDone(track, clamped_time);
+
+			if ((track->num_cycles != __INF) && (phase >= track->num_cycles))
+			{
+				// Always end with the track on.
+				values[0] = 1.0f;
+				is_running = FALSE;
+			}
+			else
+			{
+				values[0] = ((phase % 2) == 0) ? 1.0f : 0.0f;
+			}
+		}
+			break;
+
+		case eTweenModeNone:
+		default:
+			is_running = FALSE;
+			break;
+	}
+
+	return is_running;
+}
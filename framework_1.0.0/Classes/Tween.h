@@ -0,0 +1,175 @@
+/*
+ *  Tween.h
+ *  framework
+ *
+ *  Copyright 2010 LlamaFace. All rights reserved.
+ *
+ */
+
+#ifndef __TWEEN_H__
+#define __TWEEN_H__
+
+#include "types.h"
+
+static const int TWEEN_MAX_VALUES = 4;	// The most values a single track can animate, enough for a color.
+
+/*! \enum eTweenEase
+ *	\brief The easing curves that a track can use between its keys.
+ */
+typedef enum _eTweenEase
+{
+	eTweenEaseLinear = 0,	/*!< Constant speed. */
+	eTweenEaseIn,			/*!< Starts slow and speeds up. */
+	eTweenEaseOut,			/*!< Starts fast and slows down. */
+	eTweenEaseInOut,		/*!< Starts and ends slow. */
+	eTweenEaseMAX,			/*!< The total number of easing curves. */
+} eTweenEase;
+
+/*! \enum eTweenMode
+ *	\brief How a track moves between its keys over time.
+ */
+typedef enum _eTweenMode
+{
+	eTweenModeNone = 0,		/*!< The track is not running. */
+	eTweenModePingPong,		/*!< Every cycle goes from the first key to the second key and the next cycle goes back again. */
+	eTweenModeContinuous,	/*!< Every cycle adds the difference between the keys again, so the value keeps moving in the same direction. */
+	eTweenModeBlink,		/*!< The single value switches between 1 (on) and 0 (off). */
+} eTweenMode;
+
+/*! \struct tweenTrack
+ *	\brief A keyframed channel that is evaluated from the time since it started.
+ *
+ * Nothing is accumulated from frame to frame, so the value at any time is exact and does not drift.
+ */
+typedef struct tweenTrack
+{
+	int mode;				/*!< The track mode, one of #eTweenMode. */
+	int ease;				/*!< The easing curve, one of #eTweenEase. */
+	int elapsed;			/*!< The time in milliseconds since the track started. */
+	int duration;			/*!< The time in milliseconds of one cycle. For blink tracks this is the time of one on and off cycle. */
+	int num_cycles;			/*!< The number of cycles before the track finishes, or #__INF. For blink tracks every on and every off counts as one cycle. */
+	int num_values;			/*!< The number of values animated by the track. */
+	float from[TWEEN_MAX_VALUES];	/*!< The first key. */
+	float to[TWEEN_MAX_VALUES];		/*!< The second key. */
+	int on_time;			/*!< The shortest time in milliseconds that a blink track stays on. */
+	int jitter;				/*!< The largest random time in milliseconds that is moved from off to on in every blink cycle. */
+	unsigned int seed;		/*!< The seed of the random blink times. */
+} tweenTrack;
+
+
+/*! \class CTween
+ * \brief The Tween class.
+ *
+ * A utility class that starts and evaluates tween tracks.
+ * Tracks are plain data that keep their own elapsed time, so the owner moves a track by setting that time and evaluating it again.
+ */
+class CTween
+{
+public:
+	/*! \fn setPingPong(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles, eTweenEase ease = eTweenEaseLinear)
+	 *  \brief Starts a track that goes back and forth between two keys.
+	 *
+	 *	\param track The track.
+	 *	\param from The first key.
+	 *	\param to The second key.
+	 *	\param numValues The number of values in each key.
+	 *	\param duration The time in milliseconds to go from one key to the other.
+	 *	\param numCycles The number of times to go from one key to the other, or #__INF.
+	 *	\param ease The easing curve.
+	 *  \return n/a
+	 */
+	static void setPingPong(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles, eTweenEase ease = eTweenEaseLinear);
+
+	/*! \fn setContinuous(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles)
+	 *  \brief Starts a track that keeps moving by the difference between two keys every cycle.
+	 *
+	 *	\param track The track.
+	 *	\param from The first key.
+	 *	\param to The value reached at the end of the first cycle.
+	 *	\param numValues The number of values in each key.
+	 *	\param duration The time in milliseconds of one cycle.
+	 *	\param numCycles The number of cycles, or #__INF.
+	 *  \return n/a
+	 */
+	static void setContinuous(tweenTrack* track, const float* from, const float* to, const int numValues, const int duration, const int numCycles);
+
+	/*! \fn setBlink(tweenTrack* track, const int onTime, const int randOnTime, const int offTime, const int randOffTime, const int numBlinks, const unsigned int seed)
+	 *  \brief Starts a track that switches on and off.
+	 *
+	 * The random on and off times share one random split per cycle so that every cycle has the same length, which lets the track be evaluated at any time without replaying it.
+	 *	\param track The track.
+	 *	\param onTime The time in milliseconds that the track stays on.
+	 *	\param randOnTime The randomness threshold for the on-time.
+	 *	\param offTime The time in milliseconds that the track stays off.
+	 *	\param randOffTime The randomness threshold for the off-time.
+	 *	\param numBlinks The number of times the track switches, or #__INF.
+	 *	\param seed The seed of the random times.
+	 *  \return n/a
+	 */
+	static void setBlink(tweenTrack* track, const int onTime, const int randOnTime, const int offTime, const int randOffTime, const int numBlinks, const unsigned int seed);
+
+	/*! \fn stop(tweenTrack* track)
+	 *  \brief Stops a track.
+	 *
+	 *	\param track The track.
+	 *  \return n/a
+	 */
+	static inline void stop(tweenTrack* track) { track->mode = eTweenModeNone; }
+
+	/*! \fn isActive(const tweenTrack* track)
+	 *  \brief Returns TRUE if the track is running.
+	 *
+	 *	\param track The track.
+	 *  \return n/a
+	 */
+	static inline BOOL isActive(const tweenTrack* track) { return (track->mode != eTweenModeNone); }
+
+	/*! \fn evaluate(const tweenTrack* track, const int time, float* values)
+	 *  \brief Returns the values of a track at the given time since it started.
+	 *
+	 *	\param track The track.
+	 *	\param time The time in milliseconds since the track started.
+	 *	\param values Filled with the track values.
+	 *  \return TRUE while the track is still running at that time, FALSE once it has finished. The final values are written either way.
+	 */
+	static BOOL evaluate(const tweenTrack* track, const int time, float* values);
+
+	/*! \fn getCyclesDone(const tweenTrack* track, const int time)
+	 *  \brief Returns the number of cycles the track has completed at the given time since it started.
+	 *
+	 *	\param track The track.
+	 *	\param time The time in milliseconds since the track started.
+	 *  \return n/a
+	 */
+	static int getCyclesDone(const tweenTrack* track, const int time);
+
+	/*! \fn getCyclesLeft(const tweenTrack* track)
+	 *  \brief Returns the number of cycles the track has left to run, or #__INF.
+	 *
+	 *	\param track The track.
+	 *  \return n/a
+	 */
+	static int getCyclesLeft(const tweenTrack* track);
+
+	/*! \fn ease(const int ease, const float t)
+	 *  \brief Applies an easing curve.
+	 *
+	 *	\param ease The easing curve, one of #eTweenEase.
+	 *	\param t The linear progress from 0.0 to 1.0.
+	 *  \return The eased progress from 0.0 to 1.0.
+	 */
+	static float ease(const int ease, const float t);
+
+private:
+	/*! \fn getBlinkOnTime(const tweenTrack* track, const int cycle)
+	 *  \brief Returns the on-time of one blink cycle.
+	 *
+	 *	\param track The track.
+	 *	\param cycle The index of the on and off cycle.
+	 *  \return n/a
+	 */
+	static int getBlinkOnTime(const tweenTrack* track, const int cycle);
+};
+
+
+#endif
@@ -12,6 +12,20 @@
 #include "AppDefines.h"
 #include "Physics.h"
 #include "ParticleSystem.h"
+#include "Image.h"
+#include "TGALoader.h"
+#include "BMPLoader.h"
+#include "XmlReader.h"
+#include "XmlParser.h"
+#include "ParticleBudget.h"
+#include "QualityController.h"
+#include "ParticleEffectLibrary.h"
+#include "FileIO.h"
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
 
 
 #if defined (ENABLE_UNITTESTING)
@@ -676,6 +690,834 @@ void CUnitTests::handleMultiTouch(float x1, float y1, eTouchPhase phase1, float
 }
 
 
+#elif defined (ENABLE_PARTICLE_BENCHMARK)
+
+static const int PARTICLE_BENCHMARK_MASSES = 10;		// The number of masses to draw.
+static const int PARTICLE_BENCHMARK_MASS_SIZE = 10000;	// The number of particles per mass.
+static const int PARTICLE_BENCHMARK_FRAMES = 120;		// The number of frames to measure for each thread count.
+
+CUnitTests::CUnitTests()
+{
+	init();
+}
+
+CUnitTests::~CUnitTests()
+{
+	destroy();
+}
+
+void CUnitTests::init()
+{
+	_bg_color.r = 0.0f;
+	_bg_color.g = 0.0f;
+	_bg_color.b = 0.0f;
+	_bg_color.a = 1.0f;
+	
+	engine->_image_loader->loadImagePack(image_pack_unittest, (int)(sizeof(image_pack_unittest) / sizeof(uint32)));
+	
+	_particle_sys.init(PARTICLE_BENCHMARK_MASSES, PARTICLE_BENCHMARK_MASS_SIZE);
+	
+	for (int i = 0; i < PARTICLE_BENCHMARK_MASSES; ++i)
+	{
+		_particle_sys.setMode(i, particle_mode_props[eParticleModeBigBang]);
+		_particle_sys.recenterMass(i, (SCRN_W / (PARTICLE_BENCHMARK_MASSES + 1)) * (i + 1), SCRN_H / 2, 0);
+		_particle_sys.setEnable3D(i, TRUE);
+		_particle_sys.setDrawMode(i, eParticleDrawModeBillBoard);
+		_particle_sys.setMassActive(i, TRUE);
+	}
+	
+	_camera.init();
+	set3Dview();
+	
+	// Start by measuring a single thread, then add one thread at a time up to the number of cores.
+	_num_threads = 1;
+	_frame_counter = 0;
+	_draw_time = 0;
+	_particle_sys.setNumThreads(_num_threads);
+	
+	_particle_sys.setIsRunning(TRUE);
+}
+
+void CUnitTests::destroy()
+{
+	engine->_image_loader->unloadImagePack();
+	_particle_sys.destroy();
+}
+
+void CUnitTests::update()
+{
+	_camera.update();
+	_particle_sys.update();
+}
+
+void CUnitTests::draw()
+{
+	timeval start_time, end_time;
+	
+	gettimeofday(&start_time, NULL);
+	_particle_sys.draw(_camera.getViewMatrix());
+	gettimeofday(&end_time, NULL);
+	
+	_draw_time += ((end_time.tv_sec - start_time.tv_sec) * 1000000) + (end_time.tv_usec - start_time.tv_usec);
+	
+	if (++_frame_counter < PARTICLE_BENCHMARK_FRAMES)
+	{
+		return;
+	}
+	
+	DPRINT_BENCHMARK("particle draw: %d thread(s), %d particles, %ld us per frame \n", 
+					 _num_threads, 
+					 PARTICLE_BENCHMARK_MASSES * PARTICLE_BENCHMARK_MASS_SIZE, 
+					 _draw_time / _frame_counter);
+	
+	// Move on to the next thread count, wrapping back to one thread after all cores have been measured.
+	_num_threads = (_num_threads % CThreadPool::getNumCores()) + 1;
+	_frame_counter = 0;
+	_draw_time = 0;
+	_particle_sys.setNumThreads(_num_threads);
+}
+
+void CUnitTests::handleTouch(float x, float y, eTouchPhase phase)
+{
+	_camera.handleTouch(x, y, phase);
+}
+
+void CUnitTests::handleMultiTouch(float x1, float y1, eTouchPhase phase1, float x2, float y2, eTouchPhase phase2)
+{
+	_camera.handleMultiTouch(x1, y1, phase1, x2, y2, phase2);
+}
+
+
+#elif defined (ENABLE_IMAGE_DECODE_BENCHMARK)
+
+static const int IMAGE_DECODE_BENCHMARK_FRAMES = 60;	// The number of frames to measure for each set of kernels.
+
+// Writes a little endian value into an encoded image header.
+static void writeLE(unsigned char* dst, unsigned int value, int numBytes)
+{
+	for (int i = 0; i < numBytes; ++i)
+	{
+		dst[i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+// Re-encodes an RGBA image as an uncompressed, bottom-up TGA or BMP, so that the benchmark decodes the same pixels as the images in the bundle.
+static unsigned char* encodeImage(const CImage* image, bool isTGA, int* length)
+{
+	int w = (int)image->getWidth();
+	int h = (int)image->getHeight();
+	int bytes_per_pixel = isTGA ? 4 : 3;
+	int stride = isTGA ? (w * 4) : (((w * 3) + 3) & ~3);
+	int header_size = isTGA ? 18 : 54;
+	
+	*length = header_size + (stride * h);
+	unsigned char* data = new unsigned char[*length];
+	memset(data, 0, *length);
+	
+	if (isTGA)
+	{
+		data[2] = 2;
+		writeLE(data + 12, w, 2);
+		writeLE(data + 14, h, 2);
+		data[16] = 32;
+	}
+	else
+	{
+		data[0] = 'B';
+		data[1] = 'M';
+		writeLE(data + 2, *length, 4);
+		writeLE(data + 10, header_size, 4);
+		writeLE(data + 14, 40, 4);
+		writeLE(data + 18, w, 4);
+		writeLE(data + 22, h, 4);
+		writeLE(data + 26, 1, 2);
+		writeLE(data + 28, 24, 2);
+	}
+	
+	const unsigned char* pixels = (const unsigned char*)image->getImageData();
+	
+	for (int y = 0; y < h; ++y)
+	{
+		const unsigned char* src = pixels + ((h - 1 - y) * w * 4);
+		unsigned char* dst = data + header_size + (y * stride);
+		
+		for (int x = 0; x < w; ++x)
+		{
+			dst[(x * bytes_per_pixel) + 0] = src[(x * 4) + 2];
+			dst[(x * bytes_per_pixel) + 1] = src[(x * 4) + 1];
+			dst[(x * bytes_per_pixel) + 2] = src[(x * 4) + 0];
+			
+			if (isTGA)
+			{
+				dst[(x * bytes_per_pixel) + 3] = src[(x * 4) + 3];
+			}
+		}
+	}
+	
+	return data;
+}
+
+CUnitTests::CUnitTests()
+{
+	init();
+}
+
+CUnitTests::~CUnitTests()
+{
+	destroy();
+}
+
+void CUnitTests::init()
+{
+	_bg_color.r = 0.0f;
+	_bg_color.g = 0.0f;
+	_bg_color.b = 0.0f;
+	_bg_color.a = 1.0f;
+	
+	memset(_encoded_tga, 0, sizeof(_encoded_tga));
+	memset(_encoded_bmp, 0, sizeof(_encoded_bmp));
+	
+	for (int i = 0; i < FILE_ID_IMAGE_MAX; ++i)
+	{
+		CImage image;
+		image.load(imageFileNames[i]);
+		
+		if (image.getImageData() == NULL)
+		{
+			continue;
+		}
+		
+		_encoded_tga[i] = encodeImage(&image, true, &_encoded_tga_length[i]);
+		_encoded_bmp[i] = encodeImage(&image, false, &_encoded_bmp_length[i]);
+		image.unload();
+	}
+	
+	// Start with the scalar kernels, then alternate.
+	_use_simd = false;
+	_frame_counter = 0;
+	_tga_time = 0;
+	_bmp_time = 0;
+	_decoded_bytes = 0.0;
+	
+	set2Dview();
+}
+
+void CUnitTests::destroy()
+{
+	for (int i = 0; i < FILE_ID_IMAGE_MAX; ++i)
+	{
+		delete [] _encoded_tga[i];
+		delete [] _encoded_bmp[i];
+		_encoded_tga[i] = NULL;
+		_encoded_bmp[i] = NULL;
+	}
+}
+
+void CUnitTests::update()
+{
+	TGALoader tga_loader;
+	BMPLoader bmp_loader;
+	timeval start_time, mid_time, end_time;
+	
+	tga_loader.use_simd = _use_simd;
+	bmp_loader.use_simd = _use_simd;
+	
+	for (int i = 0; i < FILE_ID_IMAGE_MAX; ++i)
+	{
+		if (_encoded_tga[i] == NULL)
+		{
+			continue;
+		}
+		
+		// Decode the way a texture would be loaded: swizzled, flipped to the top row first and premultiplied.
+		gettimeofday(&start_time, NULL);
+		tga_loader.read(_encoded_tga[i], _encoded_tga_length[i], true);
+		gettimeofday(&mid_time, NULL);
+		bmp_loader.read(_encoded_bmp[i], _encoded_bmp_length[i], true);
+		gettimeofday(&end_time, NULL);
+		
+		_tga_time += ((mid_time.tv_sec - start_time.tv_sec) * 1000000) + (mid_time.tv_usec - start_time.tv_usec);
+		_bmp_time += ((end_time.tv_sec - mid_time.tv_sec) * 1000000) + (end_time.tv_usec - mid_time.tv_usec);
+		_decoded_bytes += tga_loader.bit_data_length;
+	}
+	
+	if (++_frame_counter < IMAGE_DECODE_BENCHMARK_FRAMES)
+	{
+		return;
+	}
+	
+	DPRINT_BENCHMARK("image decode: %s kernels, %.1f MB/s tga, %.1f MB/s bmp \n", 
+					 _use_simd ? "SIMD" : "scalar", 
+					 _decoded_bytes / ((_tga_time > 0) ? _tga_time : 1), 
+					 _decoded_bytes / ((_bmp_time > 0) ? _bmp_time : 1));
+	
+	// Only alternate if there are SIMD kernels to compare against.
+	_use_simd = (!_use_simd) && hasImageDecodeSIMD();
+	_frame_counter = 0;
+	_tga_time = 0;
+	_bmp_time = 0;
+	_decoded_bytes = 0.0;
+}
+
+void CUnitTests::draw()
+{
+	CGraphics::drawRect(0, 0, SCRN_W, SCRN_H, _bg_color, TRUE);
+}
+
+void CUnitTests::handleTouch(float x, float y, eTouchPhase phase)
+{
+	
+}
+
+void CUnitTests::handleMultiTouch(float x1, float y1, eTouchPhase phase1, float x2, float y2, eTouchPhase phase2)
+{
+	
+}
+
+
+#elif defined (ENABLE_XML_PARSE_BENCHMARK)
+
+static const int XML_PARSE_BENCHMARK_SIZE = 60000;		// The size of the generated document. XmlReader's String can not hold more than 65535 characters.
+static const int XML_PARSE_BENCHMARK_FRAMES = 60;		// The number of frames to measure before printing.
+
+// Does the work a definition loader would: counts the elements and decodes every attribute value.
+class CXmlBenchmarkHandler : public XmlHandler
+{
+public:
+	int num_elements;
+	int num_attributes;
+	
+	CXmlBenchmarkHandler()
+	{
+		num_elements = 0;
+		num_attributes = 0;
+	}
+	
+	bool startElement(const XmlSpan& name, const XmlAttribute* attributes, int numAttributes)
+	{
+		char value[256];
+		
+		for (int i = 0; i < numAttributes; ++i)
+		{
+			xmlDecode(attributes[i].Value, value, sizeof(value));
+		}
+		
+		num_elements++;
+		num_attributes += numAttributes;
+		return true;
+	}
+};
+
+// Appends to the generated document. Nothing is appended if it would outgrow the buffer.
+static void appendXml(char* xml, int* length, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(xml + *length, XML_PARSE_BENCHMARK_SIZE - *length, format, args);
+	va_end(args);
+	
+	if ((written > 0) && (*length + written < XML_PARSE_BENCHMARK_SIZE))
+	{
+		*length += written;
+	}
+	
+	xml[*length] = '\0';
+}
+
+CUnitTests::CUnitTests()
+{
+	init();
+}
+
+CUnitTests::~CUnitTests()
+{
+	destroy();
+}
+
+void CUnitTests::init()
+{
+	_bg_color.r = 0.0f;
+	_bg_color.g = 0.0f;
+	_bg_color.b = 0.0f;
+	_bg_color.a = 1.0f;
+	
+	// Generate effect and menu definitions, using only the markup that XmlReader understands. Every entry is shorter than 512 characters.
+	_xml = new char[XML_PARSE_BENCHMARK_SIZE];
+	_xml_length = 0;
+	appendXml(_xml, &_xml_length, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<definitions>\n<effects>\n");
+	
+	for (int i = 0; _xml_length < XML_PARSE_BENCHMARK_SIZE / 2; ++i)
+	{
+		appendXml(_xml, &_xml_length, 
+				  "\t<effect name=\"effect_%d\" camera=\"reset\" mass_size=\"%d\">\n"
+				  "\t\t<mass image=\"%s\" x=\"%d\" y=\"%d\" z=\"0\" loop=\"3\">\n"
+				  "\t\t\t<props gravity=\"0.5\" velocity=\"12\" spread=\"360\" life=\"60\" color=\"1.0 0.5 0.25 1.0\" blend=\"additive\"/>\n"
+				  "\t\t</mass>\n"
+				  "\t</effect>\n", 
+				  i, 100 + (i % 50), imageFileNames[i % FILE_ID_IMAGE_MAX], SCRN_W / 2, SCRN_H / 2);
+	}
+	
+	appendXml(_xml, &_xml_length, "</effects>\n<menu>\n");
+	
+	for (int i = 0; _xml_length < XML_PARSE_BENCHMARK_SIZE - 512; ++i)
+	{
+		appendXml(_xml, &_xml_length, 
+				  "\t<button id=\"%d\" x=\"%d\" y=\"%d\" image=\"%s\">Play &amp; win &lt;%d&gt;</button>\n", 
+				  i, (i * 40) % SCRN_W, (i * 60) % SCRN_H, imageFileNames[i % FILE_ID_IMAGE_MAX], i);
+	}
+	
+	appendXml(_xml, &_xml_length, "</menu>\n</definitions>\n");
+	
+	_frame_counter = 0;
+	_reader_time = 0;
+	_parser_time = 0;
+	
+	set2Dview();
+}
+
+void CUnitTests::destroy()
+{
+	delete [] _xml;
+	_xml = NULL;
+}
+
+void CUnitTests::update()
+{
+	timeval start_time, mid_time, end_time;
+	CXmlBenchmarkHandler handler;
+	XmlParser parser;
+	int reader_elements = 0;
+	
+	gettimeofday(&start_time, NULL);
+	{
+		XmlReader reader(_xml, _xml_length);
+		
+		while (reader.Read())
+		{
+			if (reader.NodeType == XmlNodeType_Element)
+			{
+				reader_elements++;
+			}
+		}
+	}
+	gettimeofday(&mid_time, NULL);
+	bool parsed = parser.parse(_xml, _xml_length, &handler);
+	gettimeofday(&end_time, NULL);
+	
+	_reader_time += ((mid_time.tv_sec - start_time.tv_sec) * 1000000) + (mid_time.tv_usec - start_time.tv_usec);
+	_parser_time += ((end_time.tv_sec - mid_time.tv_sec) * 1000000) + (end_time.tv_usec - mid_time.tv_usec);
+	
+	if (!parsed || (handler.num_elements != reader_elements))
+	{
+		DPRINT_BENCHMARK("xml parse: failed at offset %d, %d elements, reader saw %d \n", parser.getErrorOffset(), handler.num_elements, reader_elements);
+	}
+	
+	if (++_frame_counter < XML_PARSE_BENCHMARK_FRAMES)
+	{
+		return;
+	}
+	
+	double parsed_bytes = (double)_xml_length * _frame_counter;
+	
+	DPRINT_BENCHMARK("xml parse: %d bytes, %d elements, %d attributes, %.1f MB/s reader, %.1f MB/s parser \n", 
+					 _xml_length, 
+					 handler.num_elements, 
+					 handler.num_attributes, 
+					 parsed_bytes / ((_reader_time > 0) ? _reader_time : 1), 
+					 parsed_bytes / ((_parser_time > 0) ? _parser_time : 1));
+	
+	_frame_counter = 0;
+	_reader_time = 0;
+	_parser_time = 0;
+}
+
+void CUnitTests::draw()
+{
+	CGraphics::drawRect(0, 0, SCRN_W, SCRN_H, _bg_color, TRUE);
+}
+
+void CUnitTests::handleTouch(float x, float y, eTouchPhase phase)
+{
+	
+}
+
+void CUnitTests::handleMultiTouch(float x1, float y1, eTouchPhase phase1, float x2, float y2, eTouchPhase phase2)
+{
+	
+}
+
+
+#elif defined (ENABLE_SYSTEM_TESTS)
+
+// Prints a check that failed. Returns the result of the check.
+static bool checkTest(const bool condition, const char* description)
+{
+	if (!condition)
+	{
+		DPRINT_UNITTEST("system test check failed: %s \n", description);
+	}
+	
+	return condition;
+}
+
+// Reports the same cost for both systems for a number of frames, as the systems would when they update and draw.
+static void runBudgetFrames(CParticleBudget* budget, CParticleSystem* high, CParticleSystem* low, const int cost, const int numFrames)
+{
+	for (int i = 0; i < numFrames; ++i)
+	{
+		budget->reportCost(high, 1000, cost);
+		budget->reportCost(low, 1000, cost);
+		budget->update();
+	}
+}
+
+// The quotas must shrink, low priority first, when the particles get expensive, and grow back when they get cheap again.
+static bool testParticleBudget()
+{
+	// The systems are declared first, so the budget is destroyed while they still exist.
+	CParticleSystem high;
+	CParticleSystem low;
+	CParticleBudget budget;
+	bool passed = true;
+	
+	budget.init(6000, 8000);
+	passed &= checkTest(budget.registerSystem(&high, 2, 4000) && budget.registerSystem(&low, 1, 4000), "budget registers systems");
+	
+	// 0.1 microseconds per particle: the particle limit of 6000 is what binds.
+	runBudgetFrames(&budget, &high, &low, 100, 120);
+	passed &= checkTest((high.getParticleQuota() == 4000) && (low.getParticleQuota() == 2000), "budget quotas when cheap");
+	
+	// 4 microseconds per particle: about 2000 particles fit in 8000 microseconds, and the high priority system gets them.
+	runBudgetFrames(&budget, &high, &low, 4000, 120);
+	passed &= checkTest((high.getParticleQuota() >= 1900) && (high.getParticleQuota() <= 2000) && (low.getParticleQuota() == 0), "budget quotas under load");
+	
+	runBudgetFrames(&budget, &high, &low, 100, 120);
+	passed &= checkTest((high.getParticleQuota() == 4000) && (low.getParticleQuota() == 2000), "budget quotas after load");
+	
+	budget.unregisterSystem(&low);
+	passed &= checkTest((low.getParticleQuota() == -1) && (budget.getQuota(&low) == -1), "budget lifts quota on unregister");
+	
+	return passed;
+}
+
+// Feeds the same frame time until the controller reaches a tier. Returns the number of frames that took, or -1 if it never did.
+static int framesUntilTier(CQualityController* quality, const int frameTime, const eQualityTier tier, const int maxFrames)
+{
+	for (int i = 1; i <= maxFrames; ++i)
+	{
+		quality->update(frameTime);
+		
+		if (quality->getTier() == tier)
+		{
+			return i;
+		}
+	}
+	
+	return -1;
+}
+
+// A rise that is undone straight away must double the wait for the next one. A rise that holds must not, and a long stable stretch must halve it again.
+static bool testQualityHysteresis()
+{
+	const int slow = 40;
+	const int fast = 10;
+	const int between = 19;
+	const int max_frames = QUALITY_EVAL_FRAMES * 64;
+	CQualityController quality;
+	bool passed = true;
+	
+	quality.init(17);
+	passed &= checkTest(framesUntilTier(&quality, slow, eQualityTierMedium, max_frames) == QUALITY_EVAL_FRAMES * QUALITY_DEGRADE_EVALS, "quality drops after slow evaluations");
+	passed &= checkTest(framesUntilTier(&quality, fast, eQualityTierHigh, max_frames) == QUALITY_EVAL_FRAMES * QUALITY_IMPROVE_EVALS, "quality rises after fast evaluations");
+	
+	// Undone straight away: the next rise waits twice as long.
+	passed &= checkTest(framesUntilTier(&quality, slow, eQualityTierMedium, max_frames) == QUALITY_EVAL_FRAMES * QUALITY_DEGRADE_EVALS, "quality drops again");
+	passed &= checkTest(framesUntilTier(&quality, fast, eQualityTierHigh, max_frames) == QUALITY_EVAL_FRAMES * QUALITY_IMPROVE_EVALS * 2, "undone rise doubles the wait");
+	
+	// The rise holds for one evaluation, so the drop after it does not double the wait again.
+	for (int i = 0; i < QUALITY_EVAL_FRAMES; ++i)
+	{
+		quality.update(fast);
+	}
+	
+	passed &= checkTest(framesUntilTier(&quality, slow, eQualityTierMedium, max_frames) == QUALITY_EVAL_FRAMES * QUALITY_DEGRADE_EVALS, "quality drops after a held rise");
+	
+	// A stable stretch between the thresholds halves the wait back to where it started.
+	for (int i = 0; i < QUALITY_EVAL_FRAMES * QUALITY_STABLE_EVALS; ++i)
+	{
+		quality.update(between);
+	}
+	
+	passed &= checkTest(quality.getTier() == eQualityTierMedium, "quality holds between the thresholds");
+	// The first fast evaluation still has the frames from between the thresholds in its samples, so it does not count.
+	passed &= checkTest(framesUntilTier(&quality, fast, eQualityTierHigh, max_frames) == QUALITY_EVAL_FRAMES * (QUALITY_IMPROVE_EVALS + 1), "stable stretch halves the wait");
+	
+	return passed;
+}
+
+// Returns TRUE if every active particle of the mass has the given size scale.
+static bool isMassScale(CParticleSystem* system, const float scale)
+{
+	const particleMass& mass = system->getMass(0);
+	int num_active = 0;
+	
+	for (int i = 0; i < mass.num_particles; ++i)
+	{
+		if (mass.particles[i].is_active)
+		{
+			num_active++;
+			
+			if (fabs(mass.particles[i].sprite._scale.x - scale) > 0.001f)
+			{
+				return false;
+			}
+		}
+	}
+	
+	return (num_active > 0);
+}
+
+// Seeking the actions must put the particles at the exact state of the given time, no matter where they were before.
+static bool testSeekActions()
+{
+	const int size_speed = 1000;
+	const int num_particles = 4;
+	CParticleSystem system;
+	particleProperties props;
+	bool passed = true;
+	
+	system.init(1, num_particles);
+	if (!checkTest(system.getNumMasses() == 1, "seek test system starts"))
+	{
+		return false;
+	}
+	
+	// Every particle is released in the first update, and pulses its size from 1 to 2 and back forever.
+	memset(&props, 0, sizeof(particleProperties));
+	props.life_time = __INF;
+	props.release_rate = num_particles;
+	props.size_start = 1.0f;
+	props.size_end = 2.0f;
+	props.size_speed = size_speed;
+	props.size_count = __INF;
+	props.image_id = FILE_ID_IMAGE_PARTICLE;
+	
+	system.setMode(0, props);
+	system.setMassActive(0, TRUE);
+	system.setIsRunning(TRUE);
+	
+	int frame_time = TIME_LAST_FRAME;
+	TIME_LAST_FRAME = 100;
+	system.update();
+	TIME_LAST_FRAME = frame_time;
+	passed &= checkTest(isMassScale(&system, 1.1f), "seek test particles are released");
+	
+	system.seekActions(0, size_speed / 4);
+	passed &= checkTest(isMassScale(&system, 1.25f), "seek forward");
+	
+	system.seekActions(0, size_speed + (size_speed / 2));
+	passed &= checkTest(isMassScale(&system, 1.5f), "seek into the pulse back");
+	
+	system.seekActions(0, 0);
+	passed &= checkTest(isMassScale(&system, 1.0f), "seek back to the start");
+	
+	// Seeking a mass that does not exist must leave the particles alone.
+	system.seekActions(1, size_speed / 2);
+	system.seekActions(-1, size_speed / 2);
+	passed &= checkTest(isMassScale(&system, 1.0f), "seek ignores a bad mass");
+	
+	system.destroy();
+	
+	return passed;
+}
+
+// Writes a library of the given number of one mass effects, named "effect_<index>". Returns FALSE if the file could not be written.
+static BOOL writeTestEffectLibrary(const char* filePath, const int numEffects)
+{
+	FILE* file = fopen(filePath, "wb");
+	
+	if (!file)
+	{
+		return FALSE;
+	}
+	
+	// Every effect is padded to the alignment. The header and the entries are already a multiple of it in size.
+	const unsigned int effect_size = (unsigned int)(sizeof(particleEffectHeader) + sizeof(particleEffectMass));
+	const unsigned int effect_stride = (effect_size + PARTICLE_EFFECT_ALIGNMENT - 1) & ~(PARTICLE_EFFECT_ALIGNMENT - 1);
+	const unsigned int first_offset = (unsigned int)(sizeof(particleEffectLibraryHeader) + (numEffects * sizeof(particleEffectLibraryEntry)));
+	const char padding[PARTICLE_EFFECT_ALIGNMENT] = { 0 };
+	particleEffectLibraryHeader library_header;
+	BOOL is_written = TRUE;
+	
+	memset(&library_header, 0, sizeof(particleEffectLibraryHeader));
+	library_header.magic = PARTICLE_EFFECT_LIBRARY_MAGIC;
+	library_header.version = PARTICLE_EFFECT_VERSION;
+	library_header.num_effects = numEffects;
+	is_written &= (fwrite(&library_header, sizeof(particleEffectLibraryHeader), 1, file) == 1);
+	
+	for (int i = 0; i < numEffects; ++i)
+	{
+		particleEffectLibraryEntry entry;
+		
+		memset(&entry, 0, sizeof(particleEffectLibraryEntry));
+		snprintf(entry.name, PARTICLE_EFFECT_NAME_MAX, "effect_%d", i);
+		entry.offset = first_offset + (i * effect_stride);
+		entry.size = effect_size;
+		is_written &= (fwrite(&entry, sizeof(particleEffectLibraryEntry), 1, file) == 1);
+	}
+	
+	for (int i = 0; i < numEffects; ++i)
+	{
+		particleEffectHeader header;
+		particleEffectMass mass;
+		
+		memset(&header, 0, sizeof(particleEffectHeader));
+		header.magic = PARTICLE_EFFECT_MAGIC;
+		header.version = PARTICLE_EFFECT_VERSION;
+		header.props_size = sizeof(particleProperties);
+		header.size = effect_size;
+		snprintf(header.name, PARTICLE_EFFECT_NAME_MAX, "effect_%d", i);
+		header.num_masses = 1;
+		header.mass_size = 100;
+		memset(&mass, 0, sizeof(particleEffectMass));
+		is_written &= (fwrite(&header, sizeof(particleEffectHeader), 1, file) == 1);
+		is_written &= (fwrite(&mass, sizeof(particleEffectMass), 1, file) == 1);
+		is_written &= (fwrite(padding, 1, effect_stride - effect_size, file) == (effect_stride - effect_size));
+	}
+	
+	fclose(file);
+	
+	return is_written;
+}
+
+// Benchmarks mapping a library of 1000 effects and looking every one of them up by name, as a screen does when it plays an effect.
+static bool testEffectLibrary()
+{
+	const int num_effects = 1000;
+	const char* tmp_dir = getenv("TMPDIR");
+	char file_path[FILEIO_MAX_PATH];
+	char name[PARTICLE_EFFECT_NAME_MAX];
+	CParticleEffectLibrary library;
+	int num_found = 0;
+	bool passed = true;
+	
+	snprintf(file_path, FILEIO_MAX_PATH, "%s/effect_test.%s", tmp_dir ? tmp_dir : "/tmp", PARTICLE_EFFECT_EXTENSION);
+	if (!checkTest(writeTestEffectLibrary(file_path, num_effects), "effect library is written"))
+	{
+		return false;
+	}
+	
+	timeval start_time;
+	gettimeofday(&start_time, NULL);
+	
+	passed &= checkTest(library.load(file_path), "effect library loads");
+	int load_time = CParticleBudget::getElapsedTime(start_time);
+	
+	for (int i = 0; i < num_effects; ++i)
+	{
+		size_t size = 0;
+		
+		snprintf(name, PARTICLE_EFFECT_NAME_MAX, "effect_%d", i);
+		const void* effect = library.getEffect(library.findEffect(name), &size);
+		
+		if (getParticleEffectHeader(effect, size))
+		{
+			num_found++;
+		}
+	}
+	
+	int total_time = CParticleBudget::getElapsedTime(start_time);
+	
+	DPRINT_BENCHMARK("effect library: mapped %d effects in %d us, mapped and looked all of them up in %d us \n", num_effects, load_time, total_time);
+	passed &= checkTest(num_found == num_effects, "effect library finds every effect");
+	passed &= checkTest(library.findEffect("effect_missing") == -1, "effect library misses an unknown effect");
+	
+	library.unload();
+	remove(file_path);
+	
+	return passed;
+}
+
+typedef struct systemTest
+{
+	const char* name;
+	bool (*run)(void);
+} systemTest;
+
+// Every system test, run once when the screen starts.
+static const systemTest system_tests[] =
+{
+	{ "particle budget", testParticleBudget },
+	{ "quality hysteresis", testQualityHysteresis },
+	{ "seek actions", testSeekActions },
+	{ "effect library", testEffectLibrary },
+};
+
+CUnitTests::CUnitTests()
+{
+	init();
+}
+
+CUnitTests::~CUnitTests()
+{
+	destroy();
+}
+
+void CUnitTests::init()
+{
+	const int num_tests = (int)(sizeof(system_tests) / sizeof(systemTest));
+	
+	_num_failed = 0;
+	
+	for (int i = 0; i < num_tests; ++i)
+	{
+		bool passed = system_tests[i].run();
+		
+		DPRINT_UNITTEST("system test %s: %s \n", system_tests[i].name, passed ? "passed" : "FAILED");
+		
+		if (!passed)
+		{
+			_num_failed++;
+		}
+	}
+	
+	DPRINT_UNITTEST("system tests: %d of %d failed \n", _num_failed, num_tests);
+	
+	// The screen shows the result: green when every test passed, red otherwise.
+	_bg_color.r = (_num_failed > 0) ? 1.0f : 0.0f;
+	_bg_color.g = (_num_failed > 0) ? 0.0f : 1.0f;
+	_bg_color.b = 0.0f;
+	_bg_color.a = 1.0f;
+	
+	set2Dview();
+}
+
+void CUnitTests::destroy()
+{
+	
+}
+
+void CUnitTests::update()
+{
+	
+}
+
+void CUnitTests::draw()
+{
+	CGraphics::drawRect(0, 0, SCRN_W, SCRN_H, _bg_color, TRUE);
+}
+
+void CUnitTests::handleTouch(float x, float y, eTouchPhase phase)
+{
+	
+}
+
+void CUnitTests::handleMultiTouch(float x1, float y1, eTouchPhase phase1, float x2, float y2, eTouchPhase phase2)
+{
+	
+}
+
+
 #endif
 
 
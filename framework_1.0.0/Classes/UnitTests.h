@@ -8,6 +8,7 @@
 #include "ParticleSystem.h"
 #include "Camera.h"
 #include "AppDefines.h"
+#include "GameData.h"
 
 static const int UNIT_TEST_MAX_OBJECTS = 100;
 
@@ -60,6 +61,38 @@ private:
 	
 	CSprite _tiles;
 	
+#elif defined(ENABLE_PARTICLE_BENCHMARK)
+	
+	CParticleSystem _particle_sys;
+	CCamera _camera;
+	int _num_threads;		// The number of vertex building threads currently being measured.
+	int _frame_counter;		// The number of frames measured so far with the current thread count.
+	long _draw_time;		// The total draw time in microseconds of the frames measured so far.
+	
+#elif defined(ENABLE_IMAGE_DECODE_BENCHMARK)
+	
+	unsigned char* _encoded_tga[FILE_ID_IMAGE_MAX];	// Every image re-encoded as a 32 bit bottom-up TGA.
+	int _encoded_tga_length[FILE_ID_IMAGE_MAX];
+	unsigned char* _encoded_bmp[FILE_ID_IMAGE_MAX];	// Every image re-encoded as a 24 bit bottom-up BMP.
+	int _encoded_bmp_length[FILE_ID_IMAGE_MAX];
+	bool _use_simd;			// The decode kernels currently being measured.
+	int _frame_counter;		// The number of frames measured so far with the current kernels.
+	long _tga_time;			// The total TGA decode time in microseconds so far.
+	long _bmp_time;			// The total BMP decode time in microseconds so far.
+	double _decoded_bytes;	// The number of RGBA bytes produced by each format so far.
+	
+#elif defined(ENABLE_XML_PARSE_BENCHMARK)
+	
+	char* _xml;				// The generated effect and menu definitions.
+	int _xml_length;
+	int _frame_counter;		// The number of frames measured so far.
+	long _reader_time;		// The total XmlReader time in microseconds so far.
+	long _parser_time;		// The total XmlParser time in microseconds so far.
+	
+#elif defined(ENABLE_SYSTEM_TESTS)
+	
+	int _num_failed;		// The number of system tests that failed.
+	
 #endif
 };
 
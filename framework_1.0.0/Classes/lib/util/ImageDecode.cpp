@@ -0,0 +1,204 @@
+#include "ImageDecode.h"
+
+#if defined (IMAGE_DECODE_NEON)
+#include <arm_neon.h>
+#elif defined (IMAGE_DECODE_SSSE3)
+#include <tmmintrin.h>
+#endif
+
+
+
+bool hasImageDecodeSIMD()
+{
+#if defined (IMAGE_DECODE_NEON) || defined (IMAGE_DECODE_SSSE3)
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+// Divides by 255 with rounding. Every kernel uses this exact formula so that they all produce the same pixels.
+static inline unsigned char premultiplyChannel(unsigned int c, unsigned int a)
+{
+	unsigned int t = (c * a) + 128;
+
+	return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+
+static void convertPixelRowScalar(const unsigned char* src, unsigned char* dst, int numPixels, int srcFormat, bool premultiply)
+{
+	int src_step = (srcFormat == ImageDecodeFormat_BGRA32) ? 4 : 3;
+
+	for (int i = 0; i < numPixels; ++i)
+	{
+		unsigned char a = (srcFormat == ImageDecodeFormat_BGRA32) ? src[3] : 255;
+
+		if (premultiply)
+		{
+			dst[0] = premultiplyChannel(src[2], a);
+			dst[1] = premultiplyChannel(src[1], a);
+			dst[2] = premultiplyChannel(src[0], a);
+		}
+		else
+		{
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+		}
+
+		dst[3] = a;
+
+		src += src_step;
+		dst += 4;
+	}
+}
+
+
+#if defined (IMAGE_DECODE_NEON)
+
+static inline uint8x8_t premultiplyChannels(uint8x8_t c, uint8x8_t a)
+{
+	uint16x8_t t = vmull_u8(c, a);
+
+	// (t + ((t + 128) >> 8) + 128) >> 8, the same as premultiplyChannel.
+	return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+
+// Returns the number of pixels converted. The scalar kernel finishes the rest of the row.
+static int convertPixelRowSIMD(const unsigned char* src, unsigned char* dst, int numPixels, int srcFormat, bool premultiply)
+{
+	int i = 0;
+
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		uint8x8x4_t rgba;
+
+		// The structure loads split the channels apart, so the swizzle is free.
+		if (srcFormat == ImageDecodeFormat_BGRA32)
+		{
+			uint8x8x4_t bgra = vld4_u8(src + (i * 4));
+			rgba.val[0] = bgra.val[2];
+			rgba.val[1] = bgra.val[1];
+			rgba.val[2] = bgra.val[0];
+			rgba.val[3] = bgra.val[3];
+		}
+		else
+		{
+			uint8x8x3_t bgr = vld3_u8(src + (i * 3));
+			rgba.val[0] = bgr.val[2];
+			rgba.val[1] = bgr.val[1];
+			rgba.val[2] = bgr.val[0];
+			rgba.val[3] = vdup_n_u8(255);
+		}
+
+		if (premultiply && (srcFormat == ImageDecodeFormat_BGRA32))
+		{
+			rgba.val[0] = premultiplyChannels(rgba.val[0], rgba.val[3]);
+			rgba.val[1] = premultiplyChannels(rgba.val[1], rgba.val[3]);
+			rgba.val[2] = premultiplyChannels(rgba.val[2], rgba.val[3]);
+		}
+
+		vst4_u8(dst + (i * 4), rgba);
+	}
+
+	return i;
+}
+
+#elif defined (IMAGE_DECODE_SSSE3)
+
+static inline __m128i premultiplyChannels(__m128i rgba)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+
+	// Spread every alpha over its pixel, with 255 in the alpha lane so that alpha itself is left alone.
+	const __m128i alpha_mask = _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+	const __m128i alpha_lane = _mm_set1_epi32(0xFF000000);
+	__m128i alpha = _mm_or_si128(_mm_shuffle_epi8(rgba, alpha_mask), alpha_lane);
+
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(rgba, zero), _mm_unpacklo_epi8(alpha, zero)), round);
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(rgba, zero), _mm_unpackhi_epi8(alpha, zero)), round);
+
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+	return _mm_packus_epi16(lo, hi);
+}
+
+
+// Returns the number of pixels converted. The scalar kernel finishes the rest of the row.
+static int convertPixelRowSIMD(const unsigned char* src, unsigned char* dst, int numPixels, int srcFormat, bool premultiply)
+{
+	int i = 0;
+
+	if (srcFormat == ImageDecodeFormat_BGRA32)
+	{
+		const __m128i swizzle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		for (; i + 4 <= numPixels; i += 4)
+		{
+			__m128i rgba = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + (i * 4))), swizzle);
+
+			if (premultiply)
+			{
+				rgba = premultiplyChannels(rgba);
+			}
+
+			_mm_storeu_si128((__m128i*)(dst + (i * 4)), rgba);
+		}
+	}
+	else
+	{
+		const __m128i swizzle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+		const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+		// Four pixels are 12 bytes, but 16 are loaded, so stop while the load still fits in the row.
+		for (; i + 6 <= numPixels; i += 4)
+		{
+			__m128i rgba = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + (i * 3))), swizzle), alpha);
+
+			_mm_storeu_si128((__m128i*)(dst + (i * 4)), rgba);
+		}
+	}
+
+	return i;
+}
+
+#endif
+
+
+void convertPixelRow(const unsigned char* src, unsigned char* dst, int numPixels, int srcFormat, bool premultiply, bool useSIMD)
+{
+	int done = 0;
+
+	// Opaque pixels are unchanged by premultiplying.
+	if (srcFormat != ImageDecodeFormat_BGRA32)
+	{
+		premultiply = false;
+	}
+
+#if defined (IMAGE_DECODE_NEON) || defined (IMAGE_DECODE_SSSE3)
+	if (useSIMD)
+	{
+		done = convertPixelRowSIMD(src, dst, numPixels, srcFormat, premultiply);
+	}
+#endif
+
+	int src_step = (srcFormat == ImageDecodeFormat_BGRA32) ? 4 : 3;
+
+	convertPixelRowScalar(src + (done * src_step), dst + (done * 4), numPixels - done, srcFormat, premultiply);
+}
+
+
+void convertPixelRows(const unsigned char* src, int srcStride, int srcFormat, unsigned char* dst, int width, int height, bool flipRows, bool premultiply, bool useSIMD)
+{
+	for (int y = 0; y < height; ++y)
+	{
+		int src_row = flipRows ? (height - 1 - y) : y;
+
+		convertPixelRow(src + (src_row * srcStride), dst + (y * width * 4), width, srcFormat, premultiply, useSIMD);
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef __IMAGEDECODE_H__
+#define __IMAGEDECODE_H__
+
+#include <stddef.h>
+
+// The SIMD kernels are picked at compile time. Every kernel has a scalar version that produces exactly the same pixels.
+#if defined (__ARM_NEON__) || defined (__ARM_NEON)
+#define IMAGE_DECODE_NEON
+#elif defined (__SSSE3__)
+#define IMAGE_DECODE_SSSE3
+#endif
+
+
+// The pixel layouts that the decode kernels read.
+static const int ImageDecodeFormat_BGR24 =		0;		//< 3 bytes per pixel, blue first, as stored by 24 bit TGA and BMP files.
+static const int ImageDecodeFormat_BGRA32 =		1;		//< 4 bytes per pixel, blue first, as stored by 32 bit TGA and BMP files.
+
+
+// Returns true if the SIMD kernels are compiled in. Otherwise the scalar kernels are always used.
+bool hasImageDecodeSIMD(void);
+
+// Converts one row of BGR or BGRA pixels to RGBA, optionally multiplying the color channels by alpha. Pixels without alpha get an alpha of 255.
+void convertPixelRow(const unsigned char* src, unsigned char* dst, int numPixels, int srcFormat, bool premultiply, bool useSIMD = true);
+
+// Converts a whole image to tightly packed RGBA.
+// srcStride is the byte distance between source rows. If flipRows is set, the last source row becomes the first destination row.
+void convertPixelRows(const unsigned char* src, int srcStride, int srcFormat, unsigned char* dst, int width, int height, bool flipRows, bool premultiply, bool useSIMD = true);
+
+
+#endif
@@ -0,0 +1,46 @@
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+
+const unsigned char* mapFile(const char* fileName, size_t* fileSize)
+{
+	int file = open(fileName, O_RDONLY);
+
+	if (file < 0)
+	{
+		return NULL;
+	}
+
+	struct stat file_stat;
+
+	if ((fstat(file, &file_stat) != 0) || (file_stat.st_size <= 0))
+	{
+		close(file);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (data == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	*fileSize = (size_t)file_stat.st_size;
+
+	return (const unsigned char*)data;
+}
+
+
+void unmapFile(const unsigned char* data, size_t fileSize)
+{
+	if (data)
+	{
+		munmap((void*)data, fileSize);
+	}
+}
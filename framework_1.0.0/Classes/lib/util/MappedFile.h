@@ -0,0 +1,15 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <stddef.h>
+
+
+// Memory maps a whole file read only. Returns NULL if the file could not be opened, is empty or could not be mapped.
+// The mapping stays valid after the file is closed. Pages are only read in when they are touched.
+const unsigned char* mapFile(const char* fileName, size_t* fileSize);
+
+// Releases a mapping returned by mapFile.
+void unmapFile(const unsigned char* data, size_t fileSize);
+
+
+#endif
@@ -0,0 +1,607 @@
+#include <string.h>
+#include "XmlParser.h"
+#include "MappedFile.h"
+
+
+static inline bool isWhitespace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+
+// Names end at whitespace or at any character that has a meaning inside a tag.
+static inline bool isNameEnd(char c)
+{
+	return isWhitespace(c) || (c == '>') || (c == '/') || (c == '=') || (c == '<') || (c == '\"') || (c == '\'');
+}
+
+
+static inline const char* skipWhitespace(const char* p, const char* end)
+{
+	while ((p < end) && isWhitespace(*p))
+	{
+		p++;
+	}
+
+	return p;
+}
+
+
+static inline const char* skipName(const char* p, const char* end)
+{
+	while ((p < end) && !isNameEnd(*p))
+	{
+		p++;
+	}
+
+	return p;
+}
+
+
+// Returns the first occurrence of seq in [p, end), or NULL.
+static const char* findSequence(const char* p, const char* end, const char* seq, int seqLength)
+{
+	while (end - p >= seqLength)
+	{
+		p = (const char*)memchr(p, seq[0], (end - p) - (seqLength - 1));
+
+		if (p == NULL)
+		{
+			return NULL;
+		}
+
+		if (memcmp(p, seq, seqLength) == 0)
+		{
+			return p;
+		}
+
+		p++;
+	}
+
+	return NULL;
+}
+
+
+static inline bool startsWith(const char* p, const char* end, const char* str, int strLength)
+{
+	return (end - p >= strLength) && (memcmp(p, str, strLength) == 0);
+}
+
+
+// Writes a code point as UTF-8 and returns the number of bytes written, or 0 if it is not a valid code point.
+static int encodeUTF8(unsigned long c, char* dst)
+{
+	if ((c == 0) || (c > 0x10FFFF))
+	{
+		return 0;
+	}
+
+	if (c < 0x80)
+	{
+		dst[0] = (char)c;
+		return 1;
+	}
+
+	if (c < 0x800)
+	{
+		dst[0] = (char)(0xC0 | (c >> 6));
+		dst[1] = (char)(0x80 | (c & 0x3F));
+		return 2;
+	}
+
+	if (c < 0x10000)
+	{
+		dst[0] = (char)(0xE0 | (c >> 12));
+		dst[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+		dst[2] = (char)(0x80 | (c & 0x3F));
+		return 3;
+	}
+
+	dst[0] = (char)(0xF0 | (c >> 18));
+	dst[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+	dst[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+	dst[3] = (char)(0x80 | (c & 0x3F));
+	return 4;
+}
+
+
+// Decodes the entity that starts at p, which is an '&', into dst. Returns the length of the entity, or 0 if it is not one that can be decoded.
+// A decoded entity is never longer than the entity itself.
+static int decodeEntity(const char* p, const char* end, char* dst, int* decodedLength)
+{
+	const char* semicolon = (const char*)memchr(p, ';', ((end - p) < 12) ? (end - p) : 12);
+
+	if (semicolon == NULL)
+	{
+		return 0;
+	}
+
+	int entity_length = (int)(semicolon - p) + 1;
+
+	if (p[1] == '#')
+	{
+		bool is_hex = (entity_length > 3) && ((p[2] == 'x') || (p[2] == 'X'));
+		const char* digit = p + (is_hex ? 3 : 2);
+		unsigned long c = 0;
+
+		if (digit == semicolon)
+		{
+			return 0;
+		}
+
+		for (; digit < semicolon; ++digit)
+		{
+			int value;
+
+			if ((*digit >= '0') && (*digit <= '9'))
+			{
+				value = *digit - '0';
+			}
+			else if (is_hex && (*digit >= 'a') && (*digit <= 'f'))
+			{
+				value = *digit - 'a' + 10;
+			}
+			else if (is_hex && (*digit >= 'A') && (*digit <= 'F'))
+			{
+				value = *digit - 'A' + 10;
+			}
+			else
+			{
+				return 0;
+			}
+
+			c = (c * (is_hex ? 16 : 10)) + value;
+		}
+
+		*decodedLength = encodeUTF8(c, dst);
+
+		return (*decodedLength > 0) ? entity_length : 0;
+	}
+
+	static const struct
+	{
+		const char* entity;
+		int length;
+		char c;
+	} predefined[] =
+	{
+		{ "&lt;", 4, '<' },
+		{ "&gt;", 4, '>' },
+		{ "&amp;", 5, '&' },
+		{ "&quot;", 6, '\"' },
+		{ "&apos;", 6, '\'' },
+	};
+
+	for (unsigned int i = 0; i < sizeof(predefined) / sizeof(predefined[0]); ++i)
+	{
+		if ((entity_length == predefined[i].length) && (memcmp(p, predefined[i].entity, entity_length) == 0))
+		{
+			dst[0] = predefined[i].c;
+			*decodedLength = 1;
+			return entity_length;
+		}
+	}
+
+	return 0;
+}
+
+
+bool xmlSpanEquals(const XmlSpan& span, const char* str)
+{
+	return (strncmp(span.str, str, span.length) == 0) && (str[span.length] == '\0');
+}
+
+
+int xmlDecode(const XmlSpan& span, char* dst, int dstSize)
+{
+	const char* p = span.str;
+	const char* end = span.str + span.length;
+	int length = 0;
+
+	while (p < end)
+	{
+		// Copy everything up to the next entity in one go.
+		const char* amp = (const char*)memchr(p, '&', end - p);
+		int run = (int)(((amp != NULL) ? amp : end) - p);
+
+		if (length + run >= dstSize)
+		{
+			return -1;
+		}
+
+		memcpy(dst + length, p, run);
+		length += run;
+		p += run;
+
+		if (p == end)
+		{
+			break;
+		}
+
+		char decoded[4];
+		int decoded_length = 0;
+		int entity_length = decodeEntity(p, end, decoded, &decoded_length);
+
+		if (entity_length == 0)
+		{
+			decoded[0] = '&';
+			decoded_length = 1;
+			entity_length = 1;
+		}
+
+		if (length + decoded_length >= dstSize)
+		{
+			return -1;
+		}
+
+		memcpy(dst + length, decoded, decoded_length);
+		length += decoded_length;
+		p += entity_length;
+	}
+
+	if (length >= dstSize)
+	{
+		return -1;
+	}
+
+	dst[length] = '\0';
+
+	return length;
+}
+
+
+const XmlAttribute* xmlFindAttribute(const XmlAttribute* attributes, int numAttributes, const char* name)
+{
+	for (int i = 0; i < numAttributes; ++i)
+	{
+		if (xmlSpanEquals(attributes[i].Name, name))
+		{
+			return &attributes[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+
+XmlParser::XmlParser()
+{
+	m_depth = 0;
+	m_errorOffset = -1;
+}
+
+
+XmlParser::~XmlParser()
+{
+
+}
+
+
+bool XmlParser::fail(const char* xml, const char* pos)
+{
+	m_errorOffset = (int)(pos - xml);
+
+	return false;
+}
+
+
+bool XmlParser::parse(const char* xml, int length, XmlHandler* handler)
+{
+	m_depth = 0;
+	m_errorOffset = -1;
+
+	if ((xml == NULL) || (length < 0) || (handler == NULL))
+	{
+		m_errorOffset = 0;
+		return false;
+	}
+
+	const char* p = xml;
+	const char* end = xml + length;
+
+	while (p < end)
+	{
+		//------------------------------------------------------------------------------
+		// TEXT
+		//------------------------------------------------------------------------------
+		if (*p != '<')
+		{
+			const char* start = p;
+			const char* tag = (const char*)memchr(p, '<', end - p);
+
+			if (tag == NULL)
+			{
+				tag = end;
+			}
+
+			p = skipWhitespace(p, tag);
+
+			// Whitespace between markup is not reported, and nothing else may appear outside the root element.
+			if (p < tag)
+			{
+				if (m_depth == 0)
+				{
+					return fail(xml, p);
+				}
+
+				XmlSpan value = { start, (int)(tag - start) };
+
+				if (!handler->text(value))
+				{
+					return fail(xml, start);
+				}
+			}
+
+			p = tag;
+			continue;
+		}
+
+		const char* tag = p;
+
+		if (end - p < 2)
+		{
+			return fail(xml, p);
+		}
+
+		switch (p[1])
+		{
+			//------------------------------------------------------------------------------
+			// END ELEMENT
+			//------------------------------------------------------------------------------
+			case '/':
+				{
+					XmlSpan name;
+					name.str = p + 2;
+					p = skipName(name.str, end);
+					name.length = (int)(p - name.str);
+					p = skipWhitespace(p, end);
+
+					if ((p == end) || (*p != '>') || (m_depth == 0))
+					{
+						return fail(xml, tag);
+					}
+
+					// The end tag must close the innermost open element.
+					XmlSpan& open = m_open[m_depth - 1];
+
+					if ((open.length != name.length) || (memcmp(open.str, name.str, name.length) != 0))
+					{
+						return fail(xml, tag);
+					}
+
+					m_depth--;
+					p++;
+
+					if (!handler->endElement(name))
+					{
+						return fail(xml, tag);
+					}
+				}
+				break;
+
+			//------------------------------------------------------------------------------
+			// XML DECLARATION AND PROCESSING INSTRUCTIONS
+			//------------------------------------------------------------------------------
+			case '?':
+				p = findSequence(p + 2, end, "?>", 2);
+
+				if (p == NULL)
+				{
+					return fail(xml, tag);
+				}
+
+				p += 2;
+				break;
+
+			//------------------------------------------------------------------------------
+			// COMMENTS, CDATA AND DOCUMENT TYPE
+			//------------------------------------------------------------------------------
+			case '!':
+				if (startsWith(p, end, "<!--", 4))
+				{
+					p = findSequence(p + 4, end, "-->", 3);
+
+					if (p == NULL)
+					{
+						return fail(xml, tag);
+					}
+
+					p += 3;
+				}
+				else if (startsWith(p, end, "<![CDATA[", 9))
+				{
+					XmlSpan value;
+					value.str = p + 9;
+					p = findSequence(value.str, end, "]]>", 3);
+
+					if ((p == NULL) || (m_depth == 0))
+					{
+						return fail(xml, tag);
+					}
+
+					value.length = (int)(p - value.str);
+					p += 3;
+
+					if (!handler->cdata(value))
+					{
+						return fail(xml, tag);
+					}
+				}
+				else if (startsWith(p, end, "<!DOCTYPE", 9))
+				{
+					// Skip the internal subset, if there is one, which may contain '>' characters of its own.
+					int brackets = 0;
+
+					for (p += 9; (p < end) && ((*p != '>') || (brackets > 0)); ++p)
+					{
+						if (*p == '[')
+						{
+							brackets++;
+						}
+						else if (*p == ']')
+						{
+							brackets--;
+						}
+					}
+
+					if (p == end)
+					{
+						return fail(xml, tag);
+					}
+
+					p++;
+				}
+				else
+				{
+					return fail(xml, tag);
+				}
+				break;
+
+			//------------------------------------------------------------------------------
+			// ELEMENT
+			//------------------------------------------------------------------------------
+			default:
+				{
+					XmlSpan name;
+					name.str = p + 1;
+					p = skipName(name.str, end);
+					name.length = (int)(p - name.str);
+
+					if (name.length == 0)
+					{
+						return fail(xml, tag);
+					}
+
+					int num_attributes = 0;
+					bool is_empty = false;
+
+					// Parse out any attributes until the tag is closed.
+					while (true)
+					{
+						p = skipWhitespace(p, end);
+
+						if (p == end)
+						{
+							return fail(xml, tag);
+						}
+
+						if (*p == '>')
+						{
+							p++;
+							break;
+						}
+
+						if (*p == '/')
+						{
+							if ((end - p < 2) || (p[1] != '>'))
+							{
+								return fail(xml, p);
+							}
+
+							is_empty = true;
+							p += 2;
+							break;
+						}
+
+						if (num_attributes == XML_PARSER_MAX_ATTRIBUTES)
+						{
+							return fail(xml, p);
+						}
+
+						XmlAttribute& attribute = m_attributes[num_attributes];
+						attribute.Name.str = p;
+						p = skipName(p, end);
+						attribute.Name.length = (int)(p - attribute.Name.str);
+						p = skipWhitespace(p, end);
+
+						if ((attribute.Name.length == 0) || (p == end) || (*p != '='))
+						{
+							return fail(xml, p);
+						}
+
+						p = skipWhitespace(p + 1, end);
+
+						if ((p == end) || ((*p != '\"') && (*p != '\'')))
+						{
+							return fail(xml, p);
+						}
+
+						// Find the closing quote of the same type.
+						const char* close_quote = (const char*)memchr(p + 1, *p, end - (p + 1));
+
+						if (close_quote == NULL)
+						{
+							return fail(xml, p);
+						}
+
+						attribute.Value.str = p + 1;
+						attribute.Value.length = (int)(close_quote - attribute.Value.str);
+						p = close_quote + 1;
+						num_attributes++;
+					}
+
+					if (!handler->startElement(name, m_attributes, num_attributes))
+					{
+						return fail(xml, tag);
+					}
+
+					if (is_empty)
+					{
+						if (!handler->endElement(name))
+						{
+							return fail(xml, tag);
+						}
+					}
+					else
+					{
+						if (m_depth == XML_PARSER_MAX_DEPTH)
+						{
+							return fail(xml, tag);
+						}
+
+						m_open[m_depth++] = name;
+					}
+				}
+				break;
+		}
+	}
+
+	// Every element that was opened must have been closed.
+	if (m_depth > 0)
+	{
+		return fail(xml, end);
+	}
+
+	return true;
+}
+
+
+bool XmlParser::parseFile(const char* fileName, XmlHandler* handler)
+{
+	m_errorOffset = -1;
+
+	size_t file_size = 0;
+
+	// Pages are only read in as the parse reaches them.
+	const unsigned char* data = mapFile(fileName, &file_size);
+
+	if (data == NULL)
+	{
+		m_errorOffset = 0;
+		return false;
+	}
+
+	if (file_size > 0x7FFFFFFF)
+	{
+		unmapFile(data, file_size);
+		m_errorOffset = 0;
+		return false;
+	}
+
+	bool result = parse((const char*)data, (int)file_size, handler);
+
+	unmapFile(data, file_size);
+
+	return result;
+}
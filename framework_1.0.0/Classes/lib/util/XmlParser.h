@@ -0,0 +1,102 @@
+#ifndef __XMLPARSER_H__
+#define __XMLPARSER_H__
+
+#include <stddef.h>
+
+static const int XML_PARSER_MAX_ATTRIBUTES =	32;		//< The maximum number of attributes on one element.
+static const int XML_PARSER_MAX_DEPTH =			64;		//< The maximum number of elements that can be open at once.
+
+
+
+// A piece of the XML text, used in place. The characters are not terminated, and any entities
+// in them are left as they are until xmlDecode() is called.
+struct XmlSpan
+{
+	const char*	str;		//< The first character, inside the parsed buffer.
+	int			length;		//< The number of characters.
+};
+
+
+// Class for holding an XML attribute as spans of the parsed buffer.
+struct XmlAttribute
+{
+	XmlSpan		Name;
+	XmlSpan		Value;		//< The characters between the quotes.
+};
+
+
+
+// Returns true if the span holds exactly the given terminated string.
+bool xmlSpanEquals(const XmlSpan& span, const char* str);
+
+// Decodes the predefined entities (&lt; &gt; &amp; &quot; &apos;) and character references (&#65; &#x41;)
+// in the span into dst, which is always terminated. Unknown entities are copied as they are.
+// Returns the decoded length, which is never longer than the span, or -1 if dst is too small.
+int xmlDecode(const XmlSpan& span, char* dst, int dstSize);
+
+// Returns the attribute with the given name, or NULL if the element does not have it.
+const XmlAttribute* xmlFindAttribute(const XmlAttribute* attributes, int numAttributes, const char* name);
+
+
+
+// Receives the contents of a document from XmlParser as it is parsed. Every span points into the
+// parsed buffer, so it stays valid for as long as the buffer does, but no longer than parse() for a file.
+// Returning false from any call stops the parse.
+class XmlHandler
+{
+public:
+	virtual ~XmlHandler() {}
+
+	// An element was opened. The attributes are only valid during this call.
+	// An empty element (for example, <item/> ) is followed by endElement() straight away.
+	virtual bool startElement(const XmlSpan& /*name*/, const XmlAttribute* /*attributes*/, int /*numAttributes*/) { return true; }
+
+	// An element was closed.
+	virtual bool endElement(const XmlSpan& /*name*/) { return true; }
+
+	// The text content between two tags, if it is not all whitespace.
+	virtual bool text(const XmlSpan& /*value*/) { return true; }
+
+	// The contents of a CDATA section (for example, <![CDATA[my escaped text]]> ), which are never decoded.
+	virtual bool cdata(const XmlSpan& /*value*/) { return true; }
+};
+
+
+
+// SAX style XML parser. Where XmlReader copies every name, value and attribute into a new String,
+// this parser walks a buffer that the caller owns, or a file it memory maps, and hands spans of it
+// to an XmlHandler. Nothing is allocated while parsing.
+//
+// End tags must match the element they close. The XML declaration, processing instructions,
+// comments and the document type declaration are skipped.
+class XmlParser
+{
+private:
+	XmlAttribute	m_attributes[XML_PARSER_MAX_ATTRIBUTES];	//< The attributes of the element being parsed.
+	XmlSpan			m_open[XML_PARSER_MAX_DEPTH];				//< The names of the elements that are currently open.
+	int				m_depth;									//< The number of elements that are currently open.
+	int				m_errorOffset;								//< The offset at which the last parse failed, or -1.
+
+	// Records where the parse failed and returns false.
+	bool fail(const char* xml, const char* pos);
+
+public:
+	XmlParser();
+	~XmlParser();
+
+	// @brief Parses a whole document, passing its contents to the handler in document order.
+	//
+	// @return True if the document was parsed to the end and every element was closed; false if it
+	// is malformed, exceeds the limits above, or the handler stopped the parse.
+	bool parse(const char* xml, int length, XmlHandler* handler);
+
+	// @brief Memory maps a file and parses it. The mapping is released before this returns.
+	//
+	// @return True if the file was mapped and parsed to the end.
+	bool parseFile(const char* fileName, XmlHandler* handler);
+
+	// Returns the offset of the character at which the last parse failed, or -1 if it succeeded.
+	int getErrorOffset() const { return m_errorOffset; }
+};
+
+#endif
@@ -35,6 +35,12 @@ XmlReader::XmlReader(String xml, int size)
 }
 
 XmlReader::~XmlReader()
+{	
+	destroy();
+}
+
+
+void XmlReader::destroy()
 {	
 	Attribute* attr = m_Attribute;
 	Attribute* attrToDelete = NULL;
@@ -46,11 +52,7 @@ XmlReader::~XmlReader()
 		
 		SAFE_DEL(attrToDelete);
 	}
-}
-
-
-void XmlReader::destroy()
-{	
+	
 	//m_text = NULL;
 	m_Attribute = NULL;
 	m_nAttributes = 0;
@@ -59,10 +61,8 @@ void XmlReader::destroy()
 
 void XmlReader::AddAttribute(int startName, int endName, int startValue, int endValue)
 {
-	if (m_text.equals(NULL))
+	if (m_text.toCharArray() == NULL)
 		return;
-	//if (m_text == NULL)
-	//	return;
 		
 	Attribute *newattribute = new Attribute();
 	newattribute->Name = m_text.substring(startName, endName);
@@ -80,8 +80,8 @@ bool XmlReader::Read()
 	Name = "";
 	Value = "";
 	
-	m_Attribute = NULL;
-	m_nAttributes = 0;
+	// Free the attributes of the previous element.
+	destroy();
 	
 	if (!m_text.toCharArray() || (m_pos >= m_end))
 		return false;
@@ -72,9 +72,11 @@ public:
 	
 	// Default constructor.
 	XmlReader(String xml, int size);
-	~XmlReader();
 	
 	// Default destructor.  Removes all attributes from the linked list.
+	~XmlReader();
+	
+	// Removes all attributes from the linked list.
 	void destroy();
 
 	// Creates a new attribute with the name and value indicated by the locations
@@ -0,0 +1,482 @@
+// Compiles the text form of particle effects into an effect library that the app memory maps at startup.
+// See README.txt for the text format.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <vector>
+
+// The framework types header pulls in OpenGL ES, which is not available to a host tool, so the few basic types that the particle properties use are defined here instead.
+#define __TYPES_H__
+typedef signed char BOOL;
+#define TRUE (1)
+#define FALSE (0)
+static const int __INF = -12345;
+
+#include "ParticleEffect.h"
+
+
+static const int LINE_MAX_LENGTH = 512;
+static const int TOKENS_MAX = 8;
+
+typedef struct propInfo
+{
+	const char* name;
+	size_t offset;
+	int storage;
+} propInfo;
+
+#define PROP_INFO(id, offset, key, storage, dataType, limit, minValue, maxValue, increment, dependencies, name, description)	{ key, offset, storage },
+
+// Every property of the particle system, by its key. The properties that are not stored in particleProperties, such as the mass size, are skipped.
+static const propInfo prop_info[] =
+{
+	PARTICLE_PROPERTY_LIST(PROP_INFO)
+};
+
+#undef PROP_INFO
+
+static const int NUM_PROPS = (int)(sizeof(prop_info) / sizeof(propInfo));
+
+static const char* draw_mode_names[eParticleDrawModeMAX] = { "normal", "billboard", "point" };
+
+
+typedef struct effectSource
+{
+	particleEffectHeader header;
+	std::vector<particleEffectMass> masses;
+} effectSource;
+
+
+static const char* source_name = "";
+static int line_number = 0;
+
+static void fail(const char* message, const char* token)
+{
+	fprintf(stderr, "%s:%d: %s %s\n", source_name, line_number, message, token ? token : "");
+	exit(1);
+}
+
+
+static int parseInt(const char* token)
+{
+	if (strcmp(token, "inf") == 0)
+	{
+		return __INF;
+	}
+
+	char* end = NULL;
+	long value = strtol(token, &end, 0);
+
+	if ((end == token) || (*end != '\0'))
+	{
+		fail("expected an integer or inf, got", token);
+	}
+
+	return (int)value;
+}
+
+
+static float parseFloat(const char* token)
+{
+	if (strcmp(token, "inf") == 0)
+	{
+		return (float)__INF;
+	}
+
+	char* end = NULL;
+	float value = strtof(token, &end);
+
+	if ((end == token) || ((*end != '\0') && (strcmp(end, "f") != 0)))
+	{
+		fail("expected a number or inf, got", token);
+	}
+
+	return value;
+}
+
+
+static bool parseBool(const char* token)
+{
+	if ((strcmp(token, "true") == 0) || (strcmp(token, "1") == 0))
+	{
+		return true;
+	}
+
+	if ((strcmp(token, "false") == 0) || (strcmp(token, "0") == 0))
+	{
+		return false;
+	}
+
+	fail("expected true or false, got", token);
+	return false;
+}
+
+
+static void copyName(char* dst, const char* src, int size)
+{
+	if ((int)strlen(src) >= size)
+	{
+		fail("name is too long:", src);
+	}
+
+	strncpy(dst, src, size);
+}
+
+
+// Unset properties are zero, apart from the ones that would make a mass invisible or static.
+static void initMass(particleEffectMass* mass)
+{
+	memset(mass, 0, sizeof(particleEffectMass));
+	mass->props.fade_count = 1;
+	mass->props.size_start = 1.0f;
+	mass->props.size_end = 1.0f;
+	mass->props.size_count = 1;
+	mass->props.r = 1.0f;
+	mass->props.g = 1.0f;
+	mass->props.b = 1.0f;
+	mass->props.draw_mode = eParticleDrawModeNormal;
+	mass->props.flip_looping = TRUE;
+	mass->flags = eParticleEffectMassFlagActive;
+}
+
+
+static void setProperty(particleEffectMass* mass, const char* name, const char* value)
+{
+	for (int i = 0; i < NUM_PROPS; ++i)
+	{
+		if ((prop_info[i].storage == eParticlePropStorageNone) || (strcmp(prop_info[i].name, name) != 0))
+		{
+			continue;
+		}
+
+		char* field = (char*)&mass->props + prop_info[i].offset;
+
+		switch (prop_info[i].storage)
+		{
+			case eParticlePropStorageInt:
+				*(int*)field = parseInt(value);
+				break;
+
+			case eParticlePropStorageFloat:
+				*(float*)field = parseFloat(value);
+				break;
+
+			case eParticlePropStorageBOOL:
+				*(BOOL*)field = parseBool(value) ? TRUE : FALSE;
+				break;
+
+			case eParticlePropStorageBool:
+				*(bool*)field = parseBool(value);
+				break;
+
+			// The draw mode is the only short, and it is given by name.
+			case eParticlePropStorageShort:
+			{
+				int draw_mode = -1;
+
+				for (int j = 0; j < eParticleDrawModeMAX; ++j)
+				{
+					if (strcmp(draw_mode_names[j], value) == 0)
+					{
+						draw_mode = j;
+					}
+				}
+
+				if (draw_mode < 0)
+				{
+					fail("expected normal, billboard or point, got", value);
+				}
+
+				*(short*)field = (short)draw_mode;
+			}
+				break;
+		}
+
+		return;
+	}
+
+	fail("unknown property", name);
+}
+
+
+static int tokenize(char* line, char* tokens[])
+{
+	int num_tokens = 0;
+
+	// Everything after a # is a comment.
+	char* comment = strchr(line, '#');
+
+	if (comment)
+	{
+		*comment = '\0';
+	}
+
+	for (char* token = strtok(line, " \t\r\n"); (token != NULL); token = strtok(NULL, " \t\r\n"))
+	{
+		if (num_tokens >= TOKENS_MAX)
+		{
+			fail("too many values", NULL);
+		}
+
+		tokens[num_tokens++] = token;
+	}
+
+	return num_tokens;
+}
+
+
+static void parseSource(const char* fileName, std::vector<effectSource>& effects)
+{
+	FILE* in = fopen(fileName, "r");
+
+	if (in == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(1);
+	}
+
+	source_name = fileName;
+	line_number = 0;
+
+	char line[LINE_MAX_LENGTH];
+	char* tokens[TOKENS_MAX];
+	effectSource* effect = NULL;
+	particleEffectMass* mass = NULL;
+
+	while (fgets(line, LINE_MAX_LENGTH, in))
+	{
+		line_number++;
+
+		int num_tokens = tokenize(line, tokens);
+
+		if (num_tokens == 0)
+		{
+			continue;
+		}
+
+		const char* key = tokens[0];
+
+		if (effect == NULL)
+		{
+			if ((strcmp(key, "effect") != 0) || (num_tokens != 2))
+			{
+				fail("expected effect <name>, got", key);
+			}
+
+			effects.push_back(effectSource());
+			effect = &effects.back();
+			memset(&effect->header, 0, sizeof(particleEffectHeader));
+			copyName(effect->header.name, tokens[1], PARTICLE_EFFECT_NAME_MAX);
+			effect->header.camera = eParticleEffectCameraNone;
+		}
+		else if (mass == NULL)
+		{
+			if (strcmp(key, "end") == 0)
+			{
+				if ((effect->masses.empty()) || (effect->header.mass_size <= 0))
+				{
+					fail("an effect needs a mass_size and at least one mass:", effect->header.name);
+				}
+
+				effect = NULL;
+			}
+			else if ((strcmp(key, "mass_size") == 0) && (num_tokens == 2))
+			{
+				effect->header.mass_size = parseInt(tokens[1]);
+			}
+			else if ((strcmp(key, "camera") == 0) && (num_tokens == 2))
+			{
+				const char* camera_names[] = { "none", "reset", "init" };
+				effect->header.camera = -1;
+
+				for (int i = 0; i < 3; ++i)
+				{
+					if (strcmp(camera_names[i], tokens[1]) == 0)
+					{
+						effect->header.camera = i;
+					}
+				}
+
+				if (effect->header.camera < 0)
+				{
+					fail("expected none, reset or init, got", tokens[1]);
+				}
+			}
+			else if ((strcmp(key, "mass") == 0) && (num_tokens == 1))
+			{
+				effect->masses.push_back(particleEffectMass());
+				mass = &effect->masses.back();
+				initMass(mass);
+			}
+			else
+			{
+				fail("unexpected", key);
+			}
+		}
+		else
+		{
+			if (strcmp(key, "end") == 0)
+			{
+				mass = NULL;
+			}
+			else if ((strcmp(key, "position") == 0) && ((num_tokens == 3) || (num_tokens == 4)))
+			{
+				mass->pos_x = parseInt(tokens[1]);
+				mass->pos_y = parseInt(tokens[2]);
+
+				if (num_tokens == 4)
+				{
+					mass->pos_z = parseInt(tokens[3]);
+					mass->flags |= eParticleEffectMassFlagPosition3D;
+				}
+			}
+			else if ((strcmp(key, "impulse") == 0) && ((num_tokens == 3) || (num_tokens == 4)))
+			{
+				mass->impulse_x = parseInt(tokens[1]);
+				mass->impulse_y = parseInt(tokens[2]);
+				mass->impulse_z = (num_tokens == 4) ? parseInt(tokens[3]) : 0;
+			}
+			else if ((strcmp(key, "loop_count") == 0) && (num_tokens == 2))
+			{
+				mass->loop_count = parseInt(tokens[1]);
+			}
+			else if ((strcmp(key, "active") == 0) && (num_tokens == 2))
+			{
+				mass->flags = parseBool(tokens[1]) ? (mass->flags | eParticleEffectMassFlagActive) : (mass->flags & ~eParticleEffectMassFlagActive);
+			}
+			else if ((strcmp(key, "image") == 0) && (num_tokens == 2))
+			{
+				copyName(mass->image_name, tokens[1], PARTICLE_EFFECT_IMAGE_NAME_MAX);
+			}
+			else if (num_tokens == 2)
+			{
+				setProperty(mass, key, tokens[1]);
+			}
+			else
+			{
+				fail("unexpected", key);
+			}
+		}
+	}
+
+	fclose(in);
+
+	if ((effect != NULL) || (mass != NULL))
+	{
+		fail("missing end at the end of the file", NULL);
+	}
+}
+
+
+static unsigned int alignOffset(unsigned int offset)
+{
+	return (offset + (PARTICLE_EFFECT_ALIGNMENT - 1)) & ~(PARTICLE_EFFECT_ALIGNMENT - 1);
+}
+
+
+static bool writeLibrary(const char* outFileName, std::vector<effectSource>& effects)
+{
+	particleEffectLibraryHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PARTICLE_EFFECT_LIBRARY_MAGIC;
+	header.version = PARTICLE_EFFECT_VERSION;
+	header.num_effects = (unsigned int)effects.size();
+
+	std::vector<particleEffectLibraryEntry> entries(effects.size());
+	unsigned int offset = alignOffset(sizeof(particleEffectLibraryHeader) + (header.num_effects * sizeof(particleEffectLibraryEntry)));
+
+	for (size_t i = 0; i < effects.size(); ++i)
+	{
+		particleEffectHeader* effect = &effects[i].header;
+		effect->magic = PARTICLE_EFFECT_MAGIC;
+		effect->version = PARTICLE_EFFECT_VERSION;
+		effect->props_size = sizeof(particleProperties);
+		effect->num_masses = (int)effects[i].masses.size();
+		effect->size = sizeof(particleEffectHeader) + (effect->num_masses * sizeof(particleEffectMass));
+
+		for (size_t j = 0; j < i; ++j)
+		{
+			if (strcmp(entries[j].name, effect->name) == 0)
+			{
+				fprintf(stderr, "Effect %s is defined more than once\n", effect->name);
+				return false;
+			}
+		}
+
+		memset(&entries[i], 0, sizeof(particleEffectLibraryEntry));
+		strncpy(entries[i].name, effect->name, PARTICLE_EFFECT_NAME_MAX);
+		entries[i].offset = offset;
+		entries[i].size = effect->size;
+
+		offset = alignOffset(offset + effect->size);
+	}
+
+	FILE* out = fopen(outFileName, "wb");
+
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not write %s\n", outFileName);
+		return false;
+	}
+
+	static const unsigned char padding[PARTICLE_EFFECT_ALIGNMENT] = { 0 };
+	unsigned int written = 0;
+
+	fwrite(&header, sizeof(header), 1, out);
+	written += sizeof(header);
+
+	if (!entries.empty())
+	{
+		fwrite(&entries[0], sizeof(particleEffectLibraryEntry), entries.size(), out);
+		written += (unsigned int)(entries.size() * sizeof(particleEffectLibraryEntry));
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i)
+	{
+		fwrite(padding, 1, entries[i].offset - written, out);
+		fwrite(&effects[i].header, sizeof(particleEffectHeader), 1, out);
+		fwrite(&effects[i].masses[0], sizeof(particleEffectMass), effects[i].masses.size(), out);
+		written = entries[i].offset + entries[i].size;
+	}
+
+	bool is_ok = (ferror(out) == 0);
+	fclose(out);
+
+	return is_ok;
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* out_file_name = NULL;
+	std::vector<effectSource> effects;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+		{
+			out_file_name = argv[++i];
+		}
+		else
+		{
+			parseSource(argv[i], effects);
+		}
+	}
+
+	if ((out_file_name == NULL) || (effects.empty()))
+	{
+		printf("Usage: pfxc -o effects.%s effects.pfxt ...\n", PARTICLE_EFFECT_EXTENSION);
+		return 1;
+	}
+
+	if (!writeLibrary(out_file_name, effects))
+	{
+		return 1;
+	}
+
+	printf("Wrote %d effects to %s\n", (int)effects.size(), out_file_name);
+
+	return 0;
+}
@@ -0,0 +1,238 @@
+// texcook - cooks images into GPU ready textures for CImage.
+//
+// Images are decoded with Core Graphics exactly the way CImage::load decodes them at runtime, so the cooked
+// pixels are premultiplied RGBA in the same row order, and sprites draw them with the same texture coordinates.
+// See framework_1.0.0/Classes/CookedTexture.h for the container layout.
+
+#import <Foundation/Foundation.h>
+#import <ApplicationServices/ApplicationServices.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../Classes/CookedTexture.h"
+
+
+static bool isPowerOfTwo(unsigned int value)
+{
+	return ((value != 0) && ((value & (value - 1)) == 0));
+}
+
+
+static unsigned int alignOffset(unsigned int offset)
+{
+	return (offset + (COOKED_TEXTURE_ALIGNMENT - 1)) & ~(COOKED_TEXTURE_ALIGNMENT - 1);
+}
+
+
+// Decodes an image into premultiplied RGBA. The caller frees the returned pixels.
+static unsigned char* decodeImage(const char* fileName, unsigned int* width, unsigned int* height)
+{
+	NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:fileName]];
+	CGImageSourceRef source = CGImageSourceCreateWithURL((CFURLRef)url, NULL);
+
+	if (source == NULL)
+	{
+		return NULL;
+	}
+
+	CGImageRef image = CGImageSourceCreateImageAtIndex(source, 0, NULL);
+	CFRelease(source);
+
+	if (image == NULL)
+	{
+		return NULL;
+	}
+
+	*width = (unsigned int)CGImageGetWidth(image);
+	*height = (unsigned int)CGImageGetHeight(image);
+
+	unsigned char* pixels = (unsigned char*)calloc((*width) * (*height) * 4, 1);
+	CGColorSpaceRef color_space = CGColorSpaceCreateDeviceRGB();
+	CGContextRef context = CGBitmapContextCreate(pixels, *width, *height, 8, (*width) * 4, color_space, kCGImageAlphaPremultipliedLast);
+
+	CGContextDrawImage(context, CGRectMake(0.0, 0.0, (CGFloat)(*width), (CGFloat)(*height)), image);
+
+	CGContextRelease(context);
+	CGColorSpaceRelease(color_space);
+	CGImageRelease(image);
+
+	return pixels;
+}
+
+
+// Halves a level with a box filter. Premultiplied pixels can be averaged directly.
+static unsigned char* buildMipLevel(const unsigned char* src, unsigned int srcW, unsigned int srcH, unsigned int dstW, unsigned int dstH)
+{
+	unsigned char* dst = (unsigned char*)malloc(dstW * dstH * 4);
+
+	for (unsigned int y = 0; y < dstH; ++y)
+	{
+		unsigned int y0 = y * 2;
+		unsigned int y1 = (y0 + 1 < srcH) ? y0 + 1 : y0;
+
+		for (unsigned int x = 0; x < dstW; ++x)
+		{
+			unsigned int x0 = x * 2;
+			unsigned int x1 = (x0 + 1 < srcW) ? x0 + 1 : x0;
+
+			for (unsigned int c = 0; c < 4; ++c)
+			{
+				unsigned int sum = src[((y0 * srcW) + x0) * 4 + c] +
+								   src[((y0 * srcW) + x1) * 4 + c] +
+								   src[((y1 * srcW) + x0) * 4 + c] +
+								   src[((y1 * srcW) + x1) * 4 + c];
+
+				dst[((y * dstW) + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+
+	return dst;
+}
+
+
+static bool cookImage(const char* inFileName, const char* outFileName, bool buildMips)
+{
+	unsigned int width, height;
+	unsigned char* levels[COOKED_TEXTURE_MAX_LEVELS];
+
+	levels[0] = decodeImage(inFileName, &width, &height);
+
+	if (levels[0] == NULL)
+	{
+		fprintf(stderr, "texcook: could not decode %s\n", inFileName);
+		return false;
+	}
+
+	cookedTextureHeader header;
+	memset(&header, 0, sizeof(cookedTextureHeader));
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+	header.format = eCookedTextureFormatRGBA8888;
+	header.flags = eCookedTextureFlagPremultiplied;
+	header.width = width;
+	header.height = height;
+	header.num_levels = 1;
+
+	// OpenGL ES 1.1 can only mipmap power of two textures.
+	if ((buildMips) && (!isPowerOfTwo(width) || !isPowerOfTwo(height)))
+	{
+		fprintf(stderr, "texcook: %s is %ux%u, which is not a power of two, so no mip levels are built\n", inFileName, width, height);
+		buildMips = false;
+	}
+
+	unsigned int offset = alignOffset(sizeof(cookedTextureHeader));
+	unsigned int level_w = width;
+	unsigned int level_h = height;
+
+	for (unsigned int i = 0; i < (unsigned int)COOKED_TEXTURE_MAX_LEVELS; ++i)
+	{
+		if (i > 0)
+		{
+			if ((!buildMips) || ((level_w == 1) && (level_h == 1)))
+			{
+				break;
+			}
+
+			unsigned int next_w = (level_w > 1) ? (level_w / 2) : 1;
+			unsigned int next_h = (level_h > 1) ? (level_h / 2) : 1;
+
+			levels[i] = buildMipLevel(levels[i - 1], level_w, level_h, next_w, next_h);
+			level_w = next_w;
+			level_h = next_h;
+			header.num_levels = i + 1;
+		}
+
+		header.levels[i].offset = offset;
+		header.levels[i].size = level_w * level_h * 4;
+		header.levels[i].width = level_w;
+		header.levels[i].height = level_h;
+
+		offset = alignOffset(offset + header.levels[i].size);
+	}
+
+	FILE* out = fopen(outFileName, "wb");
+	bool is_ok = (out != NULL);
+
+	if (is_ok)
+	{
+		static const unsigned char padding[COOKED_TEXTURE_ALIGNMENT] = {0};
+
+		fwrite(&header, sizeof(cookedTextureHeader), 1, out);
+
+		for (unsigned int i = 0; i < header.num_levels; ++i)
+		{
+			fwrite(padding, 1, header.levels[i].offset - ftell(out), out);
+			fwrite(levels[i], 1, header.levels[i].size, out);
+		}
+
+		is_ok = (ferror(out) == 0);
+		fclose(out);
+	}
+
+	if (is_ok)
+	{
+		printf("texcook: %s -> %s (%ux%u, %u levels)\n", inFileName, outFileName, width, height, header.num_levels);
+	}
+	else
+	{
+		fprintf(stderr, "texcook: could not write %s\n", outFileName);
+	}
+
+	for (unsigned int i = 0; i < header.num_levels; ++i)
+	{
+		free(levels[i]);
+	}
+
+	return is_ok;
+}
+
+
+int main(int argc, const char* argv[])
+{
+	NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+	bool build_mips = true;
+	const char* out_dir = NULL;
+	int num_failed = 0;
+	int num_files = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-nomips") == 0)
+		{
+			build_mips = false;
+			continue;
+		}
+
+		if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+		{
+			out_dir = argv[++i];
+			continue;
+		}
+
+		// The cooked texture replaces the image extension, and goes next to the image unless an output directory is given.
+		NSString* in_path = [NSString stringWithUTF8String:argv[i]];
+		NSString* out_path = [[in_path stringByDeletingPathExtension] stringByAppendingPathExtension:@COOKED_TEXTURE_EXTENSION];
+
+		if (out_dir)
+		{
+			out_path = [[NSString stringWithUTF8String:out_dir] stringByAppendingPathComponent:[out_path lastPathComponent]];
+		}
+
+		if (!cookImage(argv[i], [out_path UTF8String], build_mips))
+		{
+			num_failed++;
+		}
+
+		num_files++;
+	}
+
+	if (num_files == 0)
+	{
+		printf("usage: texcook [-nomips] [-o outdir] image...\n");
+	}
+
+	[pool release];
+
+	return (num_failed > 0) ? 1 : 0;
+}